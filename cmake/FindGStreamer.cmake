@@ -1,25 +1,52 @@
 MACRO(LOAD_LIB_GStreamer)                                                   
-    SET(LIB_GStreamer_DIR E:/gstreamer/1.0/msvc_x86_64) 
-    MESSAGE(STATUS "LIB_GStreamer_DIR: ${LIB_GStreamer_DIR}")                             
-    FIND_FILE(GStreamer_INCLUDE_DIR include ${LIB_GStreamer_DIR} NO_DEFAULT_PATH)          
-    FIND_FILE(GStreamer_LIBRARY_DIR lib ${LIB_GStreamer_DIR} NO_DEFAULT_PATH)           
+    # the MSVC build uses the GStreamer SDK installed on E:
+    IF(MSVC)
+        SET(LIB_GStreamer_DIR E:/gstreamer/1.0/msvc_x86_64) 
+        MESSAGE(STATUS "LIB_GStreamer_DIR: ${LIB_GStreamer_DIR}")                             
+        FIND_FILE(GStreamer_INCLUDE_DIR include ${LIB_GStreamer_DIR} NO_DEFAULT_PATH)          
+        FIND_FILE(GStreamer_LIBRARY_DIR lib ${LIB_GStreamer_DIR} NO_DEFAULT_PATH)           
                       
-    IF(GStreamer_LIBRARY_DIR)
-        file(GLOB GStreamer_LIBS ${GStreamer_LIBRARY_DIR}/*.lib)
-        MESSAGE(STATUS "GStreamer_LIBRARY_DIR : ${GStreamer_LIBRARY_DIR}")
-        # MESSAGE(STATUS "GStreamer_LIBS : ${GStreamer_LIBS}")
-    ENDIF()
+        IF(GStreamer_LIBRARY_DIR)
+            file(GLOB GStreamer_LIBS ${GStreamer_LIBRARY_DIR}/*.lib)
+            MESSAGE(STATUS "GStreamer_LIBRARY_DIR : ${GStreamer_LIBRARY_DIR}")
+            # MESSAGE(STATUS "GStreamer_LIBS : ${GStreamer_LIBS}")
+        ENDIF()
     
-    IF(GStreamer_INCLUDE_DIR)                                                      
-        file(GLOB SUBDIRECTORIES ${GStreamer_INCLUDE_DIR}/*)
-        set(GStreamer_INCLUDE_DIR "")
-        foreach(SUBDIRECTORY ${SUBDIRECTORIES})
-            if(IS_DIRECTORY ${SUBDIRECTORY})
-                list(APPEND GStreamer_INCLUDE_DIR ${SUBDIRECTORY})
-            endif()
-        endforeach()
-        # MESSAGE(STATUS "GStreamer_INCLUDE_DIR : ${GStreamer_INCLUDE_DIR}")
+        IF(GStreamer_INCLUDE_DIR)                                                      
+            file(GLOB SUBDIRECTORIES ${GStreamer_INCLUDE_DIR}/*)
+            set(GStreamer_INCLUDE_DIR "")
+            foreach(SUBDIRECTORY ${SUBDIRECTORIES})
+                if(IS_DIRECTORY ${SUBDIRECTORY})
+                    list(APPEND GStreamer_INCLUDE_DIR ${SUBDIRECTORY})
+                endif()
+            endforeach()
+            # MESSAGE(STATUS "GStreamer_INCLUDE_DIR : ${GStreamer_INCLUDE_DIR}")
+        ELSE()
+            MESSAGE(FATAL_ERROR "GStreamer_LIBS not found!")
+        ENDIF()
+        SET(GStreamer_RTSP_SERVER_FOUND TRUE)
     ELSE()
-        MESSAGE(FATAL_ERROR "GStreamer_LIBS not found!")
+        # elsewhere the system packages are found with pkg-config
+        FIND_PACKAGE(PkgConfig REQUIRED)
+        PKG_CHECK_MODULES(GST REQUIRED gstreamer-1.0 gstreamer-base-1.0 gstreamer-app-1.0 gstreamer-video-1.0
+                          gstreamer-audio-1.0 gstreamer-pbutils-1.0)
+        PKG_CHECK_MODULES(GST_RTSP_SERVER gstreamer-rtsp-server-1.0)
+
+        SET(GStreamer_INCLUDE_DIR ${GST_INCLUDE_DIRS})
+        SET(GStreamer_LIBRARY_DIR ${GST_LIBRARY_DIRS})
+        SET(GStreamer_LIBS ${GST_LIBRARIES})
+
+        # only rtsp_test_server and the StreamManager scale test need the RTSP server
+        IF(GST_RTSP_SERVER_FOUND)
+            LIST(APPEND GStreamer_INCLUDE_DIR ${GST_RTSP_SERVER_INCLUDE_DIRS})
+            LIST(APPEND GStreamer_LIBRARY_DIR ${GST_RTSP_SERVER_LIBRARY_DIRS})
+            LIST(APPEND GStreamer_LIBS ${GST_RTSP_SERVER_LIBRARIES})
+            SET(GStreamer_RTSP_SERVER_FOUND TRUE)
+        ELSE()
+            MESSAGE(STATUS "gstreamer-rtsp-server-1.0 not found, skipping rtsp_test_server and the scale test")
+            SET(GStreamer_RTSP_SERVER_FOUND FALSE)
+        ENDIF()
+
+        MESSAGE(STATUS "GStreamer_LIBS : ${GStreamer_LIBS}")
     ENDIF()
 ENDMACRO()
\ No newline at end of file
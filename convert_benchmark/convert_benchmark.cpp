@@ -0,0 +1,156 @@
+/*
+ * Compares the yuvConvert kernels against the scalar path (they must be
+ * bit-exact) and times them against cv::cvtColor(COLOR_YUV2BGR_NV12), which
+ * is what gstCamera and gstDecoder used before.  The accuracy of the scalar
+ * path itself is checked by tests/yuvConvert_test against a floating-point
+ * reference.
+ *
+ * Also times the fused yuvConvertResizeNV12ToBGR() against the previous
+ * cv::cvtColor + cv::resize sequence of gstDecoder's preview.
+ *
+ *   convert_benchmark [iterations]
+ */
+#include "yuvConvert.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// average time of a conversion in milliseconds
+template<typename Func>
+static double timeIt( int iterations, Func func )
+{
+	func();	// warm-up
+
+	const auto begin = std::chrono::steady_clock::now();
+
+	for( int n=0; n < iterations; n++ )
+		func();
+
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+}
+
+int main( int argc, char** argv )
+{
+	const int iterations = (argc > 1) ? atoi(argv[1]) : 50;
+
+	const yuvConvertPath paths[] = { YUV_CONVERT_SCALAR, YUV_CONVERT_SSE41, YUV_CONVERT_AVX2, YUV_CONVERT_NEON };
+	const int sizes[][2] = { {1280, 720}, {1920, 1080}, {3840, 2160}, {1283, 721} };
+
+	const yuvColorSpace colorSpaces[] = {
+		yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_LIMITED),
+		yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_FULL),
+		yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_LIMITED),
+		yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_FULL)
+	};
+
+	bool exact = true;
+
+	for( const auto& size : sizes )
+	{
+		const int width = size[0];
+		const int height = size[1];
+		const int uvStride = (width + 1) / 2 * 2;
+
+		// random NV12 image, the chroma plane directly follows the luma plane
+		cv::Mat nv12(height + (height + 1) / 2, uvStride, CV_8UC1);
+		cv::randu(nv12, 0, 256);
+
+		const uint8_t* y = nv12.ptr(0);
+		const uint8_t* uv = nv12.ptr(height);
+
+		cv::Mat reference(height, width, CV_8UC3);
+		cv::Mat output(height, width, CV_8UC3);
+
+		// every kernel must match the scalar path for every colorimetry
+		for( const yuvColorSpace& colorSpace : colorSpaces )
+		{
+			yuvConvertSetPath(YUV_CONVERT_SCALAR);
+			yuvConvertNV12ToBGR(y, uvStride, uv, uvStride, reference.data, (uint32_t)reference.step, width, height, colorSpace);
+
+			for( yuvConvertPath path : paths )
+			{
+				if( path == YUV_CONVERT_SCALAR || !yuvConvertSetPath(path) )
+					continue;
+
+				output.setTo(0);
+				yuvConvertNV12ToBGR(y, uvStride, uv, uvStride, output.data, (uint32_t)output.step, width, height, colorSpace);
+
+				if( cv::norm(reference, output, cv::NORM_INF) != 0 )
+				{
+					printf("convert_benchmark -- %s differs from scalar at %dx%d (%s, %s range)\n",
+						  yuvConvertPathToStr(path), width, height, yuvMatrixToStr(colorSpace.matrix),
+						  colorSpace.range == YUV_RANGE_FULL ? "full" : "limited");
+					exact = false;
+				}
+			}
+		}
+
+		// timings
+		if( width % 2 == 0 && height % 2 == 0 )
+		{
+			const double ms = timeIt(iterations, [&]() { cv::cvtColor(nv12, output, cv::COLOR_YUV2BGR_NV12); });
+			printf("%4dx%-4d  %-8s %7.3f ms\n", width, height, "opencv", ms);
+		}
+
+		for( yuvConvertPath path : paths )
+		{
+			if( !yuvConvertSetPath(path) )
+				continue;
+
+			const double ms = timeIt(iterations, [&]() {
+				yuvConvertNV12ToBGR(y, uvStride, uv, uvStride, output.data, (uint32_t)output.step, width, height, colorSpaces[2]);
+			});
+
+			printf("%4dx%-4d  %-8s %7.3f ms\n", width, height, yuvConvertPathToStr(path), ms);
+		}
+	}
+
+	// fused convert + downscale
+	const int resizes[][4] = { {3840, 2160, 1280, 720}, {1920, 1080, 1280, 720}, {3840, 2160, 640, 360} };
+
+	yuvConvertSetPath(YUV_CONVERT_AUTO);
+
+	for( const auto& size : resizes )
+	{
+		const int width = size[0];
+		const int height = size[1];
+		const int dstWidth = size[2];
+		const int dstHeight = size[3];
+
+		cv::Mat nv12(height * 3 / 2, width, CV_8UC1);
+		cv::randu(nv12, 0, 256);
+
+		cv::Mat bgr(height, width, CV_8UC3);
+		cv::Mat output(dstHeight, dstWidth, CV_8UC3);
+
+		const double opencv = timeIt(iterations, [&]() {
+			cv::cvtColor(nv12, bgr, cv::COLOR_YUV2BGR_NV12);
+			cv::resize(bgr, output, cv::Size(dstWidth, dstHeight));
+		});
+
+		printf("%4dx%-4d -> %4dx%-4d  %-18s %7.3f ms\n", width, height, dstWidth, dstHeight, "cvtColor+resize", opencv);
+
+		const yuvInterpolation modes[] = { YUV_INTERP_NEAREST, YUV_INTERP_BILINEAR };
+
+		for( yuvInterpolation interp : modes )
+		{
+			const double ms = timeIt(iterations, [&]() {
+				yuvConvertResizeNV12ToBGR(nv12.ptr(0), width, nv12.ptr(height), width, width, height,
+									 output.data, (uint32_t)output.step, dstWidth, dstHeight, interp);
+			});
+
+			printf("%4dx%-4d -> %4dx%-4d  fused %-12s %7.3f ms\n", width, height, dstWidth, dstHeight, yuvInterpolationToStr(interp), ms);
+		}
+	}
+
+	printf("convert_benchmark -- kernels are %s\n", exact ? "bit-exact" : "NOT bit-exact");
+	return exact ? 0 : 1;
+}
@@ -1,17 +1,43 @@
 #include "gstCamera.h"
+#include "gstFrame.h"
+#include "gstState.h"
+#include "gstPipelineBuilder.h"
+#include "gstDeviceCache.h"
 #include <gst/app/gstappsink.h>
 #include <sstream> 
 
+#include <algorithm>
+#include <utility>
+
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 
+// default camera
+#ifdef _WIN32
+const char* gstCamera::DefaultResource = "dshow://0";
+#else
+const char* gstCamera::DefaultResource = "v4l2:///dev/video0";
+#endif
+
+
 // constructor
 gstCamera::gstCamera()
 {	
 	mAppSink   = NULL;
 	mBus       = NULL;
 	mPipeline  = NULL;	
+	mRenderer  = NULL;
+	mBusWatcher = NULL;
+	mDeviceCaps = NULL;
+
+	mConvertThreads = 0;
+	mDecoderThreads = 0;
+
+	mWaitingFirstFrame = false;
+	mTimeToFirstFrame  = -1.0f;
+	mTeardownTime      = -1.0f;
 }
 
 
@@ -20,6 +46,11 @@ gstCamera::~gstCamera()
 {
 	Close();
 
+	delete mBusWatcher;
+	mBusWatcher = NULL;
+
+	mFormatCache.Detach();
+
 	if( mAppSink != NULL )
 	{
 		gst_object_unref(mAppSink);
@@ -37,18 +68,42 @@ gstCamera::~gstCamera()
 		gst_object_unref(mPipeline);
 		mPipeline = NULL;
 	}
+
+	if( mDeviceCaps != NULL )
+	{
+		gst_caps_unref(mDeviceCaps);
+		mDeviceCaps = NULL;
+	}
 	
 	// SAFE_DELETE(mBufferManager);
+	delete mRenderer;
+	mRenderer = NULL;
 }
 
 // Create
 gstCamera* gstCamera::Create( )
+{
+	return Create(DefaultResource);
+}
+
+// Create
+gstCamera* gstCamera::Create( const char* resource )
+{
+	return Create(resource, 0, 0);
+}
+
+// Create
+gstCamera* gstCamera::Create( const char* resource, uint32_t convertThreads, uint32_t decoderThreads )
 {
 	// create camera instance
 	gstCamera* cam = new gstCamera();
 	
 	if( !cam )
 		return NULL;
+
+	cam->mResource = resource != NULL ? resource : DefaultResource;
+	cam->mConvertThreads = convertThreads;
+	cam->mDecoderThreads = decoderThreads;
 	
 	// initialize camera (with fallback)
 	if( !cam->init() )
@@ -69,99 +124,359 @@ float gstCamera::findFramerate( const std::vector<float>& frameRates, float fram
 	if( numRates == 0 )
 		return frameRate;
 	
+	// the highest rate, which is also the one closest to being at least the requested rate
 	float bestRate = 0.0f;
-	float bestDiff = 10000.0f;
 	
 	for( uint32_t n=0; n < numRates; n++ )
 	{
-		const float diff = fabsf(frameRates[n] - frameRate);
-		
-		if( diff < bestDiff )
-		{
+		if( frameRates[n] > bestRate )
 			bestRate = frameRates[n];
-			bestDiff = diff;
-		}
 	}
 	
 	return bestRate;
 }
 
+// queryCaps
+static GstCaps* queryCaps( const char* element, const char* property, int value )
+{
+	GstElement* source = gst_element_factory_make(element, NULL);
+
+	if( !source )
+		return NULL;
+
+	g_object_set(source, property, value, NULL);
+
+	// the device is opened in READY, and then reports every mode it supports
+	GstCaps* caps = NULL;
+
+	if( gst_element_set_state(source, GST_STATE_READY) != GST_STATE_CHANGE_FAILURE )
+	{
+		GstPad* pad = gst_element_get_static_pad(source, "src");
+
+		if( pad != NULL )
+		{
+			caps = gst_pad_query_caps(pad, NULL);
+			gst_object_unref(pad);
+		}
+	}
+
+	gst_element_set_state(source, GST_STATE_NULL);
+	gst_object_unref(source);
+
+	return caps;
+}
+
+// discover
 bool gstCamera::discover()
 {
-	// 创建v4l2设备服务
-	GstDeviceProvider* deviceProvider = gst_device_provider_factory_get_by_name("v4l2deviceprovider");
+	const size_t separator = mResource.find("://");
+
+	if( separator == std::string::npos )
+		return true;
+
+	const std::string protocol = mResource.substr(0, separator);
+	const std::string location = mResource.substr(separator + 3);
+
+	// there is no device provider for dshow, ask the source itself
+	if( protocol == "dshow" )
+	{
+		GstCaps* caps = queryCaps("dshowvideosrc", "device-index", location.empty() ? 0 : atoi(location.c_str()));
+
+		if( !caps )
+		{
+			printf( "gstCamera -- failed to retrieve caps for dshow device %s\n", location.c_str());
+			return false;
+		}
+
+		if( mDeviceCaps != NULL )
+			gst_caps_unref(mDeviceCaps);
+
+		mDeviceCaps = caps;
+		return true;
+	}
+
+	// only v4l2 devices are enumerated, the other sources are opened as they are
+	if( protocol != "v4l2" )
+		return true;
+
+	// the devices are only enumerated again when a different one is plugged in
+	gstDeviceCache::Device device;
+
+	if( !gstDeviceCache::Get()->Lookup(location.c_str(), device) )
+	{
+		printf( "gstCamera -- could not find v4l2 device %s\n", location.c_str());
+		return false;
+	}
+
+	printf( "gstCamera -- found v4l2 device: %s (%s)\n", device.name.c_str(), device.busInfo.c_str());
+
+#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 4)
+	// on JetPack >= 5.0.1, the newer Logitech C920's send a H264 stream that nvv4l2decoder has trouble decoding, so change it to MJPEG
+	if( strcmp(device.name.c_str(), "HD Pro Webcam C920") == 0 && mOptions.codecType == videoOptions::CODEC_V4L2 && mOptions.codec == videoOptions::CODEC_UNKNOWN )
+		mOptions.codec = videoOptions::CODEC_MJPEG;
+#endif
+
+	// get the caps of the device
+	GstCaps* device_caps = gst_caps_from_string(device.caps.c_str());
 	
-	if( !deviceProvider )
+	if( !device_caps )
 	{
-		printf( "gstCamera -- failed to create v4l2 device provider during discovery\n");
+		printf( "gstCamera -- failed to retrieve caps for v4l2 device %s\n", location.c_str());
 		return false;
 	}
 	
-	// 获取v4l2设备的列表
-	GList* deviceList = gst_device_provider_get_devices(deviceProvider);
+	// the best caps are picked by matchCaps() once the output is known
+	if( mDeviceCaps != NULL )
+		gst_caps_unref(mDeviceCaps);
+
+	mDeviceCaps = device_caps;
+	return true;
+}
+
+// a mode of the camera, as a candidate for matchCaps()
+struct cameraProfile
+{
+	std::string format;	// raw format name, or "MJPEG"
+	uint32_t    width;
+	uint32_t    height;
+	gint        frameNum;
+	gint        frameDen;
+	float       frameRate;
+	float       cost;		// estimated conversion work, in Mpixel/s
+	bool        native;	// delivered in a format the frames can be used in as they are
+};
+
+// formatCost (per pixel, relative to one videoconvert pass)
+static float formatCost( const std::string& format )
+{
+	if( format == "NV12" || format == "I420" )
+		return 0.0f;	// gstFrame and the converters read them as they are
+	else if( format == "YUY2" || format == "UYVY" )
+		return 1.0f;	// repacked and subsampled
+	else if( format == "MJPEG" )
+		return 4.0f;	// decoded, then usually converted too
+
+	return 2.0f;		// RGB and the rest go through the color matrix
+}
+
+// collectFormats
+static void collectFormats( const GValue* value, std::vector<std::string>& formats )
+{
+	if( !value )
+		return;
+
+	if( G_VALUE_HOLDS_STRING(value) )
+	{
+		formats.push_back(g_value_get_string(value));
+	}
+	else if( GST_VALUE_HOLDS_LIST(value) )
+	{
+		for( guint n=0; n < gst_value_list_get_size(value); n++ )
+			collectFormats(gst_value_list_get_value(value, n), formats);
+	}
+}
+
+// collectRates
+static void collectRates( const GValue* value, gint rateNum, gint rateDen, std::vector< std::pair<gint, gint> >& rates )
+{
+	if( !value )
+		return;
+
+	if( GST_VALUE_HOLDS_FRACTION(value) )
+	{
+		const gint num = gst_value_get_fraction_numerator(value);
+		const gint den = gst_value_get_fraction_denominator(value);
 
-	if( !deviceList )
+		if( num > 0 && den > 0 )
+			rates.push_back(std::make_pair(num, den));
+	}
+	else if( GST_VALUE_HOLDS_LIST(value) )
+	{
+		for( guint n=0; n < gst_value_list_get_size(value); n++ )
+			collectRates(gst_value_list_get_value(value, n), rateNum, rateDen, rates);
+	}
+	else if( GST_VALUE_HOLDS_FRACTION_RANGE(value) )
 	{
-		printf( "gstCamera -- didn't discover any v4l2 devices\n");
+		const GValue* min = gst_value_get_fraction_range_min(value);
+		const GValue* max = gst_value_get_fraction_range_max(value);
+
+		// a range can be set to the requested rate exactly (e.g. 30000/1001 for 29.97), otherwise it tops out at its max
+		if( gst_util_fraction_compare(rateNum, rateDen, gst_value_get_fraction_numerator(min), gst_value_get_fraction_denominator(min)) >= 0 &&
+		    gst_util_fraction_compare(rateNum, rateDen, gst_value_get_fraction_numerator(max), gst_value_get_fraction_denominator(max)) <= 0 )
+		{
+			rates.push_back(std::make_pair(rateNum, rateDen));
+		}
+		else
+		{
+			collectRates(max, rateNum, rateDen, rates);
+		}
+	}
+}
+
+// collectSize
+static bool collectSize( const GstStructure* structure, const char* field, uint32_t requested, uint32_t* size )
+{
+	const GValue* value = gst_structure_get_value(structure, field);
+
+	if( !value )
 		return false;
+
+	if( G_VALUE_HOLDS_INT(value) )
+	{
+		*size = g_value_get_int(value);
+		return true;
 	}
 
-	// 查找请求的/dev/video*设备
-	GstDevice* device = NULL;
-	
-	for( GList* n=deviceList; n; n = n->next )
+	if( GST_VALUE_HOLDS_INT_RANGE(value) )
 	{
-		GstDevice* d = GST_DEVICE(n->data);
-		
-		const char* deviceName = gst_device_get_display_name(d);
-		
-		printf( "gstCamera -- found v4l2 device: %s\n", deviceName);
-	
-	#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 4)
-		// on JetPack >= 5.0.1, the newer Logitech C920's send a H264 stream that nvv4l2decoder has trouble decoding, so change it to MJPEG
-		if( strcmp(deviceName, "HD Pro Webcam C920") == 0 && mOptions.codecType == videoOptions::CODEC_V4L2 && mOptions.codec == videoOptions::CODEC_UNKNOWN )
-			mOptions.codec = videoOptions::CODEC_MJPEG;
-	#endif
-	
-		GstStructure* properties = gst_device_get_properties(d);
-		
-		if( properties != NULL )
+		const gint min = gst_value_get_int_range_min(value);
+		const gint max = gst_value_get_int_range_max(value);
+
+		*size = (uint32_t)std::min(std::max((gint)requested, min), max);
+		return true;
+	}
+
+	return false;
+}
+
+// matchCaps
+bool gstCamera::matchCaps( GstCaps* caps, gstPipelineBuilder::Options& options ) const
+{
+	const uint32_t numCaps = gst_caps_get_size(caps);
+	const float requestedRate = options.frameRate > 0.0f ? options.frameRate : (float)DefaultFrameRate;
+
+	gint requestedNum = 0;
+	gint requestedDen = 1;
+
+	if( options.frameNum > 0 && options.frameDen > 0 )
+	{
+		requestedNum = (gint)options.frameNum;
+		requestedDen = (gint)options.frameDen;
+	}
+	else
+	{
+		gstPipelineBuilder::RateToFraction(requestedRate, &requestedNum, &requestedDen);
+	}
+
+	std::vector<cameraProfile> profiles;
+
+	for( uint32_t n=0; n < numCaps; n++ )
+	{
+		const GstStructure* structure = gst_caps_get_structure(caps, n);
+		std::vector<std::string> formats;
+
+		if( gst_structure_has_name(structure, "video/x-raw") )
+			collectFormats(gst_structure_get_value(structure, "format"), formats);
+		else if( gst_structure_has_name(structure, "image/jpeg") )
+			formats.push_back("MJPEG");
+
+		cameraProfile profile;
+
+		if( formats.empty() || !collectSize(structure, "width", options.width, &profile.width) || !collectSize(structure, "height", options.height, &profile.height) )
+			continue;
+
+		// lock the highest rate of the mode (for a range that contains it, the requested one)
+		std::vector< std::pair<gint, gint> > rates;
+		std::vector<float> frameRates;
+
+		collectRates(gst_structure_get_value(structure, "framerate"), requestedNum, requestedDen, rates);
+
+		for( size_t r=0; r < rates.size(); r++ )
+			frameRates.push_back((float)rates[r].first / rates[r].second);
+
+		profile.frameRate = findFramerate(frameRates, requestedRate);
+		profile.frameNum  = 0;
+		profile.frameDen  = 1;
+
+		for( size_t r=0; r < rates.size(); r++ )
 		{
-			printf( "%s\n", gst_structure_to_string(properties));
-			
-			const char* devicePath = gst_structure_get_string(properties, "device.path");
-			
-			// if( devicePath != NULL && strcasecmp(devicePath, mOptions.resource.location.c_str()) == 0 )
-			// {
-			// 	device = d;
-			// 	break;
-			// }
+			if( frameRates[r] == profile.frameRate )
+			{
+				profile.frameNum = rates[r].first;
+				profile.frameDen = rates[r].second;
+				break;
+			}
+		}
+
+		const float pixelRate = (float)profile.width * profile.height * profile.frameRate * 1e-6f;
+		const bool scaled = options.width != 0 && options.height != 0 && (profile.width != options.width || profile.height != options.height);
+
+		for( size_t f=0; f < formats.size(); f++ )
+		{
+			profile.format = formats[f];
+			profile.native = formatCost(formats[f]) == 0.0f;
+			profile.cost   = pixelRate * (formatCost(formats[f]) + (scaled ? 1.0f : 0.0f));
+
+			profiles.push_back(profile);
 		}
 	}
-	
-	if( !device )
+
+	if( profiles.empty() )
 	{
-		// printf( "gstCamera -- could not find v4l2 device %s\n", mOptions.resource.location.c_str());
+		printf( "gstCamera -- the device has no usable raw or MJPEG modes\n");
 		return false;
 	}
-	
-	// get the caps of the device
-	GstCaps* device_caps = gst_device_get_caps(device);
-	
-	if( !device_caps )
+
+	// at least the requested size and rate if possible (otherwise the closest), then the cheapest
+	const auto undersized = [&options]( const cameraProfile& p ) { return p.width < options.width || p.height < options.height; };
+	const auto slow = [requestedRate]( const cameraProfile& p ) { return p.frameRate + 0.5f < requestedRate; };
+
+	const cameraProfile* best = &profiles[0];
+
+	for( size_t n=1; n < profiles.size(); n++ )
 	{
-		// printf( "gstCamera -- failed to retrieve caps for v4l2 device %s\n", mOptions.resource.location.c_str());
-		return false;
+		const cameraProfile& p = profiles[n];
+		bool better;
+
+		if( undersized(p) != undersized(*best) )
+			better = !undersized(p);
+		else if( undersized(p) && p.width * p.height != best->width * best->height )
+			better = p.width * p.height > best->width * best->height;
+		else if( slow(p) != slow(*best) )
+			better = !slow(p);
+		else if( slow(p) && p.frameRate != best->frameRate )
+			better = p.frameRate > best->frameRate;
+		else
+			better = p.cost < best->cost;
+
+		if( better )
+			best = &p;
 	}
-	
-	// printCaps(device_caps);
-	
-	// pick the best caps
-	// if( !matchCaps(device_caps) )
-	// 	return false;
-	
-	// printf( "gstCamera -- selected device profile:  codec=%s format=%s width=%u height=%u framerate=%u\n", videoOptions::CodecToStr(mOptions.codec), imageFormatToStr(mFormatYUV), GetWidth(), GetHeight(), GetFrameRate());
-	
+
+	// the output stays NV12 unless the camera delivers I420, which is read as it is
+	std::ostringstream ss;
+
+	if( best->format == "MJPEG" )
+		ss << "image/jpeg";
+	else
+		ss << "video/x-raw,format=(string)" << best->format;
+
+	ss << ",width=(int)" << best->width << ",height=(int)" << best->height;
+
+	if( best->frameNum > 0 )
+	{
+		ss << ",framerate=(fraction)" << best->frameNum << "/" << best->frameDen;
+		options.frameRate = best->frameRate;
+		options.frameNum  = best->frameNum;
+		options.frameDen  = best->frameDen;
+	}
+
+	if( best->native )
+		options.format = best->format;
+
+	options.sourceCaps = ss.str();
+
+	printf( "gstCamera -- selected device profile:  format=%s width=%u height=%u framerate=%.2f (%zu modes)\n",
+		best->format.c_str(), best->width, best->height, best->frameRate, profiles.size());
+
+	const float pixelRate = (float)best->width * best->height * best->frameRate * 1e-6f;
+
+	if( best->native )
+		printf( "gstCamera -- %s is delivered natively, videoconvert is left out (avoids ~%.1f Mpixel/s of conversion)\n", best->format.c_str(), pixelRate);
+
+	if( best->cost > 0.0f )
+		printf( "gstCamera -- estimated conversion cost %.1f Mpixel/s\n", best->cost);
+
 	return true;
 }
 
@@ -191,17 +506,32 @@ bool gstCamera::init()
   	printf ("This program is linked against GStreamer %d.%d.%d %s\n",
           	major, minor, micro, nano_str);
 
-	// discover();
+	// the device's caps come from the cache, unless it was never seen before
+	discover();
 
 	// 解析并启动 uri
 	GError* err = NULL;
 	// std::string uri = "nvarguscamerasrc sensor-id=0 ! video/x-raw(memory:NVMM), width=(int)1280, height=(int)720, framerate=30/1, format=(string)NV12 ! nvvidconv flip-method=2 ! video/x-raw ! appsink name=mysink";
 	// std::string uri = "filesrc location=D://video/sample.mp4 ! qtdemux ! queue ! h264parse ! nvv4l2decoder name=decoder enable-max-performance=1 ! video/x-raw(memory:NVMM) ! nvvidconv name=vidconv ! video/x-raw ! appsink name=mysink";
-	std::string uri = "dshowvideosrc device-index=0 do-timestamp=true ! videoconvert ! video/x-raw, format=NV12, width=(int)1280, height=(int)720 ! appsink name=mysink sync=false";
 	// std::string uri = "dshowvideosrc device-index=0 do-timestamp=true ! nvv4l2decoder ! nvvidconv ! video/x-raw,format=BGR,width=(int)1280,height=(int)720 ! appsink name=mysink sync=false";
+	gstPipelineBuilder::Options options;
+
+	options.width  = DefaultWidth;
+	options.height = DefaultHeight;
+
+	options.convertThreads = mConvertThreads;
+	options.decoderThreads = mDecoderThreads;
+
+	// open the camera in the mode closest to the output, so it needs as little conversion as possible
+	if( mDeviceCaps != NULL )
+		matchCaps(mDeviceCaps, options);
+
+	mLaunchStr = gstPipelineBuilder::Build(mResource, options);
+
+	printf("gstCamera -- pipeline string:\n%s\n", mLaunchStr.c_str());
 
 	// launch pipeline
-	mPipeline = gst_parse_launch(uri.c_str(), &err);
+	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
 
 	if( err != NULL )
 	{
@@ -228,8 +558,17 @@ bool gstCamera::init()
 		return false;
 	}
 
-	// add watch for messages (disabled when we poll the bus ourselves, instead of gmainloop)
-	//gst_bus_add_watch(mBus, (GstBusFunc)gst_message_print, NULL);
+	// dispatch bus messages from their own thread, errors and warnings get logged
+	gstBusWatcher::Callbacks busCallbacks;
+	busCallbacks.stateChanged = onBusStateChanged;
+
+	mBusWatcher = gstBusWatcher::Create(mPipeline, busCallbacks, this, "gstCamera");
+
+	if( !mBusWatcher || !mBusWatcher->Start() )
+	{
+		printf("gstCamera failed to start watching the pipeline bus\n");
+		return false;
+	}
 
 	// get the appsrc 用于接收 GStreamer 流中的数据
 	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
@@ -252,10 +591,16 @@ bool gstCamera::init()
 	cb.new_sample  = onBuffer;	// 回调函数 onBuffer 会在新的样本数据可用时被调用。这是主要用于处理每一帧数据的回调。
 	
 	gst_app_sink_set_callbacks(mAppSink, &cb, (void*)this, NULL);
+
+	// parse the caps once per negotiation instead of for every frame
+	mFormatCache.Attach(appsinkElement, "gstCamera");
 	
 	// disable looping for cameras
 	// mOptions.loop = 0;	// 防止在相机应用中无限循环播放/
 
+	// preview window at the camera resolution, displayed from its own thread
+	mRenderer = gstRenderer::Create("sample");
+
 	return true;
 }
 
@@ -264,11 +609,15 @@ bool gstCamera::init()
 void gstCamera::onEOS(_GstAppSink* sink, void* user_data)
 {
 	printf("gstCamera -- end of stream (EOS)\n");
-	cv::destroyAllWindows();
+
 	if( !user_data )
 		return;
 
-	// gstCamera* dec = (gstCamera*)user_data;
+	gstCamera* dec = (gstCamera*)user_data;
+
+	// close the preview window
+	if( dec->mRenderer != NULL )
+		dec->mRenderer->Stop();
 
 	// dec->mEOS = true;	
 	// dec->mStreaming = dec->isLooping();
@@ -278,12 +627,6 @@ void gstCamera::onEOS(_GstAppSink* sink, void* user_data)
 GstFlowReturn gstCamera::onPreroll(_GstAppSink* sink, void* user_data)
 {
 	printf("gstCamera -- onPreroll\n");
-
-	if( !user_data )
-		return GST_FLOW_OK;
-
-	gstCamera* dec = (gstCamera*)user_data;
-	dec->checkMsgBus();
 	return GST_FLOW_OK;
 }
 
@@ -298,7 +641,6 @@ GstFlowReturn gstCamera::onBuffer(_GstAppSink* sink, void* user_data)
 	gstCamera* dec = (gstCamera*)user_data;
 	
 	dec->checkBuffer();
-	dec->checkMsgBus();
 	
 	return GST_FLOW_OK;
 }
@@ -321,27 +663,30 @@ void gstCamera::checkBuffer()
 		return;
 	}
 	
-	// 获取样本的容器格式（caps）表示该样本包含的多媒体数据的描述
-	GstCaps* gstCaps = gst_sample_get_caps(gstSample);
-	
-	if( !gstCaps )
+	// the format only gets parsed again when the caps change
+	gstFormat::Ptr format = mFormatCache.Get(gstSample);
+
+	if( !format )
 	{
-		printf("gstCamera -- gst_sample had NULL caps...\n");
+		printf("gstCamera -- failed to parse the caps of incoming sample\n");
 		release_return;
 	}
+
+	// wrap the sample without copying, the handle keeps the buffer mapped
+	gstFrame::Ptr frame = gstFrame::Create(gstSample, format);
+
+	if( mWaitingFirstFrame.exchange(false) )
+	{
+		mTimeToFirstFrame = elapsed(mOpenTime);
+		printf("gstCamera -- first frame after %.1f ms\n", mTimeToFirstFrame.load());
+	}
 	
-	// 从样本中检索缓冲区，缓冲区包含实际的多媒体数据
-	GstBuffer* gstBuffer = gst_sample_get_buffer(gstSample);
-	
-	if( !gstBuffer )
+	if( !frame )
 	{
-		printf("gstCamera -- app_sink_pull_sample() returned NULL...\n");
+		printf("gstCamera -- failed to map incoming sample\n");
 		release_return;
 	}
 
-	GstMapInfo mapInfo;
-	gst_buffer_map(gstBuffer, &mapInfo, GST_MAP_READ);
-
 	// for (int i = 0; i < 10; ++i) {
 	// 	for (int j = 0; j < 10; ++j) {
 	// 		std::cout << static_cast<int>(mapInfo.data[i * 10 + j]) << ",";
@@ -349,20 +694,9 @@ void gstCamera::checkBuffer()
 	// 	std::cout << std::endl;
 	// }
 
-	int height = 720;
-	int width = 1280;
-	cv::Mat nv12Mat(height * 3 / 2, width, CV_8UC1, (void*)mapInfo.data);
-    cv::Mat bgrMat(height, width, CV_8UC3);
-    cv::cvtColor(nv12Mat, bgrMat, cv::COLOR_YUV2BGR_NV12);
-
-	// cv::Mat frame(720, 1280, CV_8UC3, mapInfo.data);
-	// cv::Mat frame(1080, 1920, CV_8UC3, mapInfo.data);
-	// cv::normalize(frame, frame, 0, 255, cv::NORM_MINMAX);
-	cv::imshow("sample", bgrMat);
-	// cv::imwrite("sample.jpg", frame);
-	cv::waitKey(1);
+	// hand the frame to the preview thread, which only ever shows the latest one
+	mRenderer->Render(frame);
 
-	gst_buffer_unmap(gstBuffer, &mapInfo);
 	// // enqueue the buffer for color conversion
 	// if( !mBufferManager->Enqueue(gstBuffer, gstCaps) )
 	// {
@@ -430,65 +764,72 @@ bool gstCamera::Open()
 
 	// transition pipline to STATE_PLAYING
 	printf("opening gstCamera for streaming, transitioning pipeline to GST_STATE_PLAYING\n");
-	
-	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_PLAYING);
 
-	if( result == GST_STATE_CHANGE_ASYNC )
-	{
-#if 0
-		GstMessage* asyncMsg = gst_bus_timed_pop_filtered(mBus, 5 * GST_SECOND, 
-    	 					      (GstMessageType)(GST_MESSAGE_ASYNC_DONE|GST_MESSAGE_ERROR)); 
+	mRenderer->Start();
 
-		if( asyncMsg != NULL )
-		{
-			gst_message_print(mBus, asyncMsg, this);
-			gst_message_unref(asyncMsg);
-		}
-		else
-			printf(LOG_GSTREAMER "gstCamera NULL message after transitioning pipeline to PLAYING...\n");
-#endif
-	}
-	else if( result != GST_STATE_CHANGE_SUCCESS )
+	// time-to-first-frame is measured from here to the first checkBuffer()
+	mOpenTime = std::chrono::steady_clock::now();
+	mTimeToFirstFrame = -1.0f;
+	mWaitingFirstFrame = true;
+
+	// wait for the pipeline to start instead of sleeping
+	if( !gstSetState(mPipeline, GST_STATE_PLAYING, DefaultStateTimeout, "gstCamera") )
 	{
-		printf("gstCamera failed to set pipeline state to PLAYING (error %u)\n", result);
+		gst_element_set_state(mPipeline, GST_STATE_NULL);
+		mWaitingFirstFrame = false;
+		mRenderer->Stop();
 		return false;
 	}
 
-	checkMsgBus();
-	_sleep(100);
-	checkMsgBus();
+	printf("gstCamera -- pipeline started in %.1f ms\n", elapsed(mOpenTime));
 
 	// mStreaming = true;
 	return true;
 }
+
+// OpenAsync
+std::future<bool> gstCamera::OpenAsync()
+{
+	return std::async(std::launch::async, [this]() { return Open(); });
+}
 	
 // Close
 void gstCamera::Close()
 {
-	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_NULL);
+	const std::chrono::steady_clock::time_point closeTime = std::chrono::steady_clock::now();
 
-	if( result != GST_STATE_CHANGE_SUCCESS )
-		printf("gstCamera failed to set pipeline state to PLAYING (error %u)\n", result);
+	gstSetState(mPipeline, GST_STATE_NULL, DefaultStateTimeout, "gstCamera");
+
+	if( mRenderer != NULL )
+		mRenderer->Stop();
+
+	mWaitingFirstFrame = false;
+	mTeardownTime = elapsed(closeTime);
+
+	printf("gstCamera -- pipeline stopped in %.1f ms\n", mTeardownTime.load());
 
-	// usleep(250*1000);	
-	_sleep(250);
-	checkMsgBus();
 	// mStreaming = false;
 	// LogInfo(LOG_GSTREAMER "gstCamera -- pipeline stopped\n");
 }
 
-// checkMsgBus
-void gstCamera::checkMsgBus()
+// CloseAsync
+std::future<void> gstCamera::CloseAsync()
 {
-	while(true)
-	{
-		GstMessage* msg = gst_bus_pop(mBus);
-
-		if( !msg )
-			break;
+	return std::async(std::launch::async, [this]() { Close(); });
+}
 
-		// gst_message_print(mBus, msg, this);
-		gst_message_unref(msg);
-	}
+// elapsed
+float gstCamera::elapsed( const std::chrono::steady_clock::time_point& start )
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
+// onBusStateChanged
+void gstCamera::onBusStateChanged( const char* source, GstState oldState, GstState newState, bool pipeline, void* user_data )
+{
+	if( !pipeline )
+		return;
+
+	printf("gstCamera -- pipeline state changed from %s to %s\n",
+		gst_element_state_get_name(oldState), gst_element_state_get_name(newState));
+}
@@ -3,7 +3,13 @@
 
 // #include "videoSource.h"
 // #include "gstBufferManager.h"
+#include "gstRenderer.h"
+#include "gstBusWatcher.h"
+#include "gstPipelineBuilder.h"
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <string>
 #include <vector>
 #include <opencv2/opencv.hpp>
@@ -26,12 +32,30 @@ public:
 		OK      = 1	/**< frame capture successful */
 	};
 
+	/**
+	 * Retrieve the caps of the camera, from gstDeviceCache for v4l2 devices
+	 * or by querying dshowvideosrc.  Does nothing for the other sources.
+	 */
 	bool discover();
+
 	/**
 	 * Create a MIPI CSI or V4L2 camera device.
 	 */
 	static gstCamera* Create();
 
+	/**
+	 * Create a camera from a resource URI, e.g. "v4l2:///dev/video0",
+	 * "dshow://0" or "csi://0" (see gstPipelineBuilder).
+	 */
+	static gstCamera* Create( const char* resource );
+
+	/**
+	 * Create a camera from a resource URI, with the number of threads of
+	 * videoconvert/videoscale (n-threads) and of the MJPEG decoder when it's
+	 * a libav one (max-threads).  0 keeps the elements' defaults.
+	 */
+	static gstCamera* Create( const char* resource, uint32_t convertThreads, uint32_t decoderThreads=0 );
+
 	/**
 	 * Release the camera interface and resources.
 	 * Destroying the camera will also Close() the stream if it is still open.
@@ -50,6 +74,12 @@ public:
 	 */
 	virtual bool Open();
 
+	/**
+	 * Open() the stream from another thread, without blocking the caller.
+	 * The future becomes ready with the result of Open().
+	 */
+	std::future<bool> OpenAsync();
+
 	/**
 	 * Stop streaming the camera.
 	 * @note Close() is automatically called by the camera's destructor when
@@ -58,12 +88,39 @@ public:
 	 */
 	virtual void Close();
 
+	/**
+	 * Close() the stream from another thread, without blocking the caller.
+	 * The camera must not be deleted before the future is ready.
+	 */
+	std::future<void> CloseAsync();
+
 	/**
 	 * Capture the next image frame from the camera.
 	 * @see videoSource::Capture
 	 */
 	virtual bool Capture( void** image, int* status=NULL );
 
+	/**
+	 * The currently negotiated video format (empty until the first caps arrive).
+	 */
+	inline gstFormat::Ptr GetFormat() const		{ return mFormatCache.GetCurrent(); }
+
+	/**
+	 * Time in milliseconds from the last Open() to the first frame,
+	 * or -1 if no frame was received yet.
+	 */
+	inline float GetTimeToFirstFrame() const	{ return mTimeToFirstFrame; }
+
+	/**
+	 * Time in milliseconds the last Close() took to stop the pipeline, or -1.
+	 */
+	inline float GetTeardownTime() const		{ return mTeardownTime; }
+
+	/**
+	 * Number of frames the preview window didn't get to display.
+	 */
+	inline uint64_t GetPreviewFramesSkipped() const	{ return mRenderer != NULL ? mRenderer->GetFramesSkipped() : 0; }
+
 	/**
 	 * Capture the next image frame from the camera and convert it to float4 RGBA format,
 	 * with pixel intensities ranging between 0.0 and 255.0.
@@ -124,29 +181,64 @@ public:
 	 * Default camera height, unless otherwise specified during Create()
  	 */
 	static const uint32_t DefaultHeight = 720;
+
+	/**
+	 * Default camera frame rate, unless otherwise specified during Create()
+ 	 */
+	static const uint32_t DefaultFrameRate = 30;
+
+	/**
+	 * Open()/Close() state change timeout in milliseconds
+	 */
+	static const uint64_t DefaultStateTimeout = 5000;
+
+	/**
+	 * Default camera, unless otherwise specified during Create()
+	 */
+	static const char* DefaultResource;
 	
 private:
 	static void onEOS(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onPreroll(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onBuffer(_GstAppSink* sink, void* user_data);
 
+	static void onBusStateChanged( const char* source, GstState oldState, GstState newState, bool pipeline, void* user_data );
+
 	gstCamera();
 
 	bool init();
 
-	void checkMsgBus();
 	void checkBuffer();
+
+	static float elapsed( const std::chrono::steady_clock::time_point& start );
 	
 	float findFramerate( const std::vector<float>& frameRates, float frameRate ) const;
+
+	bool matchCaps( GstCaps* caps, gstPipelineBuilder::Options& options ) const;
 	
 	_GstBus*     mBus;
 	_GstAppSink* mAppSink;
 	_GstElement* mPipeline;
 
+	std::string  mResource;
 	std::string  mLaunchStr;
 	// imageFormat  mFormatYUV;
 	
 	// gstBufferManager* mBufferManager;
+
+	gstRenderer* mRenderer;
+	gstBusWatcher* mBusWatcher;
+	gstFormatCache mFormatCache;
+
+	GstCaps* mDeviceCaps;
+
+	uint32_t mConvertThreads;
+	uint32_t mDecoderThreads;
+
+	std::chrono::steady_clock::time_point mOpenTime;
+	std::atomic<bool>  mWaitingFirstFrame;
+	std::atomic<float> mTimeToFirstFrame;
+	std::atomic<float> mTeardownTime;
 };
 
 #endif
@@ -1,6 +1,4 @@
 #include "gstCamera.h"
-#include <cuda_runtime.h>
-#include <cuda.h>
 #include <glib.h>
 
 int main(int argc, char *argv[])
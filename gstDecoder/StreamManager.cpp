@@ -0,0 +1,818 @@
+#include "StreamManager.h"
+
+#include <algorithm>
+#include <future>
+#include <system_error>
+
+#include <opencv2/core.hpp>
+
+#include <stdio.h>
+
+
+// streaming tasks of a stream before any has run: the RTP and RTCP sockets of rtspsrc, its jitterbuffer and the output queue
+#define STREAM_TASKS_ESTIMATE 4
+
+
+// per-stream state, shared with the ready queue
+struct StreamManager::Stream : public std::enable_shared_from_this<StreamManager::Stream>
+{
+	uint32_t       id;
+	std::string    uri;
+	gstDecoder*    decoder;
+	gstTaskPool*   taskPool;
+	StreamManager* manager;
+
+	// set while the stream is in the ready queue or being drained
+	std::atomic<bool> scheduled;
+
+	// held while a worker drains the stream, guards the decoder
+	std::mutex mutex;
+
+	std::atomic<uint64_t> frames;
+	std::atomic<uint64_t> batchDropped;
+	std::atomic<uint64_t> latencySum;	// us
+	std::atomic<uint64_t> latencyMax;	// us
+
+	// index of the NUMA node it's placed on, and of its ready queue (-1 for none, queue 0)
+	int node;
+
+	// previous fps sample, guarded by mStreamsMutex
+	uint64_t lastFrames;
+	std::chrono::steady_clock::time_point lastSample;
+
+	Stream() : id(0), decoder(NULL), taskPool(NULL), manager(NULL), scheduled(false), frames(0), batchDropped(0), latencySum(0), latencyMax(0), node(-1), lastFrames(0) {}
+};
+
+
+// constructor
+StreamManager::StreamManager( const Options& options )
+{
+	mOptions      = options;
+	mCallback     = NULL;
+	mCallbackData = NULL;
+	mNextId       = 0;
+	mRejected     = 0;
+	mStopWorkers  = false;
+	mRunning      = false;
+
+	mBatches       = 0;
+	mBatchedFrames = 0;
+	mBatchFill     = 0.0;
+	mBatchWait     = 0.0;
+	mBatchMaxWait  = 0.0f;
+
+	mLastSwitches   = gstTaskPool::GetContextSwitches();
+	mLastSwitchTime = std::chrono::steady_clock::now();
+
+	if( mOptions.workerThreads == 0 )
+		mOptions.workerThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	mPlacement = gstPlacement::Create(mOptions.placement);
+
+	const uint32_t queues = mPlacement->IsEnabled() ? mPlacement->GetNumNodes() : 1;
+
+	for( uint32_t n=0; n < queues; n++ )
+		mReady.push_back(std::unique_ptr<ReadyQueue>(new ReadyQueue()));
+
+	// every node needs a worker to drain its streams
+	mOptions.workerThreads = std::max(mOptions.workerThreads, queues);
+}
+
+
+// destructor
+StreamManager::~StreamManager()
+{
+	Stop();
+
+	std::vector<uint32_t> ids;
+
+	{
+		std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+		for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+			ids.push_back(n->first);
+	}
+
+	for( size_t n=0; n < ids.size(); n++ )
+		RemoveStream(ids[n]);
+
+	delete mPlacement;
+}
+
+
+// Create
+StreamManager* StreamManager::Create( const Options& options )
+{
+	return new StreamManager(options);
+}
+
+
+// AddStream
+int StreamManager::AddStream( const char* uri )
+{
+	if( !uri )
+		return -1;
+
+	gstDecoder::Options options = mOptions.decoder;
+	options.uri = uri;
+
+	return AddStream(options);
+}
+
+
+// AddStream
+int StreamManager::AddStream( const gstDecoder::Options& options )
+{
+	gstDecoder::Options streamOptions = options;
+
+	if( !admit(options.taskPool, options.uri) )
+		return -1;
+
+	// pin the streaming threads to the node of the workers draining the stream
+	const int node = mPlacement->Assign();
+
+	if( node >= 0 && streamOptions.affinity.empty() )
+		streamOptions.affinity = mPlacement->GetCPUs(node);
+
+	gstDecoder* decoder = gstDecoder::Create(streamOptions);
+
+	if( !decoder )
+	{
+		printf("StreamManager -- failed to create decoder for %s\n", options.uri.c_str());
+		mPlacement->Release(node);
+		dismiss(options.taskPool);
+		return -1;
+	}
+
+	StreamPtr stream = std::make_shared<Stream>();
+
+	stream->uri        = options.uri;
+	stream->decoder    = decoder;
+	stream->taskPool   = options.taskPool;
+	stream->node       = node;
+	stream->manager    = this;
+	stream->lastSample = std::chrono::steady_clock::now();
+
+	decoder->SetFrameListener(onFrame, stream.get());
+
+	{
+		std::lock_guard<std::mutex> lock(mStreamsMutex);
+		stream->id = mNextId++;
+		mStreams[stream->id] = stream;
+	}
+
+	// streams added while running are opened right away
+	std::lock_guard<std::mutex> lock(mStateMutex);
+
+	if( mRunning && !decoder->Open() )
+		printf("StreamManager -- failed to open stream %u (%s)\n", stream->id, stream->uri.c_str());
+
+	return stream->id;
+}
+
+
+// admit
+bool StreamManager::admit( gstTaskPool* pool, const std::string& uri )
+{
+	if( !pool || pool->GetMaxThreads() == 0 )
+		return true;
+
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+	const uint32_t streams = mPoolStreams[pool];
+	const uint32_t maxThreads = pool->GetMaxThreads();
+
+	// the threads the admitted streams hold, once they run, if that's more
+	uint32_t estimate = STREAM_TASKS_ESTIMATE;
+
+	if( streams > 0 )
+		estimate = std::max(estimate, (pool->GetStats().busy + streams - 1) / streams);
+
+	if( (streams + 1) * estimate > maxThreads )
+	{
+		printf("StreamManager -- refusing %s, its task pool has no threads left (%u streams admitted, ~%u threads each, %u threads)\n",
+			uri.c_str(), streams, estimate, maxThreads);
+
+		mRejected++;
+		return false;
+	}
+
+	mPoolStreams[pool]++;
+	return true;
+}
+
+
+// dismiss
+void StreamManager::dismiss( gstTaskPool* pool )
+{
+	if( !pool || pool->GetMaxThreads() == 0 )
+		return;
+
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+	if( mPoolStreams[pool] > 0 )
+		mPoolStreams[pool]--;
+}
+
+
+// RemoveStream
+bool StreamManager::RemoveStream( uint32_t id )
+{
+	StreamPtr stream;
+
+	{
+		std::lock_guard<std::mutex> lock(mStreamsMutex);
+		std::map<uint32_t, StreamPtr>::iterator n = mStreams.find(id);
+
+		if( n == mStreams.end() )
+			return false;
+
+		stream = n->second;
+		mStreams.erase(n);
+	}
+
+	// wait for a worker that is draining the stream, the decoder stops
+	// calling onFrame() once it's deleted (the stream itself stays alive
+	// as long as it's in the ready queue)
+	std::lock_guard<std::mutex> lock(stream->mutex);
+
+	delete stream->decoder;
+	stream->decoder = NULL;
+
+	mPlacement->Release(stream->node);
+	dismiss(stream->taskPool);
+
+	// and forget its frames waiting to be batched
+	std::lock_guard<std::mutex> batchLock(mBatchMutex);
+
+	for( std::deque<BatchFrame>::iterator n=mBatchFrames.begin(); n != mBatchFrames.end(); )
+	{
+		if( n->stream == stream )
+			n = mBatchFrames.erase(n);
+		else
+			n++;
+	}
+
+	return true;
+}
+
+
+// SetFrameCallback
+void StreamManager::SetFrameCallback( FrameCallback callback, void* user_data )
+{
+	mCallback     = callback;
+	mCallbackData = user_data;
+}
+
+
+// Start
+bool StreamManager::Start()
+{
+	std::lock_guard<std::mutex> lock(mStateMutex);
+
+	if( mRunning )
+		return true;
+
+	// workers first, so the frames produced while the others are opening are delivered
+	mStopWorkers = false;
+
+	// the workers are dealt over the nodes' queues
+	for( uint32_t n=0; n < mOptions.workerThreads; n++ )
+	{
+		try
+		{
+			mWorkers.push_back(std::thread(&StreamManager::worker, this, n % (uint32_t)mReady.size()));
+		}
+		catch( const std::system_error& e )
+		{
+			printf("StreamManager -- failed to start worker thread (%s)\n", e.what());
+			break;
+		}
+	}
+
+	if( mWorkers.size() < mReady.size() )
+	{
+		// a node without a worker would never deliver its streams' frames
+		mStopWorkers = true;
+
+		{
+			std::lock_guard<std::mutex> readyLock(mReadyMutex);
+
+			for( size_t n=0; n < mReady.size(); n++ )
+				mReady[n]->cond.notify_all();
+		}
+
+		for( size_t n=0; n < mWorkers.size(); n++ )
+			mWorkers[n].join();
+
+		mWorkers.clear();
+		return false;
+	}
+
+	std::vector<StreamPtr> streams;
+
+	{
+		std::lock_guard<std::mutex> streamsLock(mStreamsMutex);
+
+		for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+			streams.push_back(n->second);
+	}
+
+	// open every stream at once, so the total is bounded by the slowest one
+	// and not by the sum (connecting to an RTSP server takes a while)
+	std::vector< std::future<bool> > results;
+
+	for( size_t n=0; n < streams.size(); n++ )
+		results.push_back(streams[n]->decoder->OpenAsync());
+
+	uint32_t opened = 0;
+
+	for( size_t n=0; n < results.size(); n++ )
+	{
+		if( results[n].get() )
+			opened++;
+		else
+			printf("StreamManager -- failed to open stream %u (%s)\n", streams[n]->id, streams[n]->uri.c_str());
+	}
+
+	printf("StreamManager -- opened %u of %zu streams with %zu worker threads\n", opened, streams.size(), mWorkers.size());
+
+	mRunning = true;
+	return opened > 0 || streams.empty();
+}
+
+
+// Stop
+void StreamManager::Stop()
+{
+	std::lock_guard<std::mutex> lock(mStateMutex);
+
+	if( !mRunning )
+		return;
+
+	std::vector<StreamPtr> streams;
+
+	{
+		std::lock_guard<std::mutex> streamsLock(mStreamsMutex);
+
+		for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+			streams.push_back(n->second);
+	}
+
+	std::vector< std::future<void> > results;
+
+	for( size_t n=0; n < streams.size(); n++ )
+		results.push_back(streams[n]->decoder->CloseAsync());
+
+	for( size_t n=0; n < results.size(); n++ )
+		results[n].wait();
+
+	{
+		std::lock_guard<std::mutex> readyLock(mReadyMutex);
+		mStopWorkers = true;
+
+		for( size_t n=0; n < mReady.size(); n++ )
+			mReady[n]->cond.notify_all();
+	}
+
+	for( size_t n=0; n < mWorkers.size(); n++ )
+		mWorkers[n].join();
+
+	mWorkers.clear();
+
+	// streams that were still waiting can be scheduled again after a restart
+	std::deque<StreamPtr> pending;
+
+	{
+		std::lock_guard<std::mutex> readyLock(mReadyMutex);
+
+		for( size_t n=0; n < mReady.size(); n++ )
+		{
+			pending.insert(pending.end(), mReady[n]->streams.begin(), mReady[n]->streams.end());
+			mReady[n]->streams.clear();
+		}
+	}
+
+	for( size_t n=0; n < pending.size(); n++ )
+		pending[n]->scheduled = false;
+
+	// wake up CaptureBatch()
+	{
+		std::lock_guard<std::mutex> batchLock(mBatchMutex);
+		mRunning = false;
+		mBatchCond.notify_all();
+	}
+}
+
+
+// onFrame
+void StreamManager::onFrame( gstDecoder* decoder, void* user_data )
+{
+	Stream* stream = (Stream*)user_data;
+
+	// most of the time the stream is already scheduled, no need to take a lock
+	if( stream->scheduled.exchange(true) )
+		return;
+
+	stream->manager->schedule(stream->shared_from_this());
+}
+
+
+// schedule
+void StreamManager::schedule( const StreamPtr& stream )
+{
+	ReadyQueue* queue = mReady[stream->node >= 0 ? stream->node : 0].get();
+
+	std::lock_guard<std::mutex> lock(mReadyMutex);
+	queue->streams.push_back(stream);
+	queue->cond.notify_one();
+}
+
+
+// worker
+void StreamManager::worker( uint32_t index )
+{
+	ReadyQueue* queue = mReady[index].get();
+
+	// consume the frames on the node that decoded them
+	if( mPlacement->IsEnabled() )
+		gstPlacement::PinThread(mPlacement->GetCPUs(index));
+
+	while( true )
+	{
+		StreamPtr stream;
+
+		{
+			std::unique_lock<std::mutex> lock(mReadyMutex);
+			queue->cond.wait(lock, [this, queue]() { return mStopWorkers || !queue->streams.empty(); });
+
+			if( mStopWorkers )
+				break;
+
+			stream = queue->streams.front();
+			queue->streams.pop_front();
+		}
+
+		process(stream);
+	}
+}
+
+
+// process
+void StreamManager::process( const StreamPtr& stream )
+{
+	std::lock_guard<std::mutex> lock(stream->mutex);
+
+	// Capture() would re-open a decoder that was closed
+	if( !stream->decoder || !stream->decoder->IsStreaming() )
+	{
+		stream->scheduled = false;
+		return;
+	}
+
+	gstFrame::Ptr frame;
+
+	while( stream->decoder->Capture(frame, NULL, 0) )
+	{
+		const uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frame->GetArrivalTime()).count();
+
+		stream->frames.fetch_add(1, std::memory_order_relaxed);
+		stream->latencySum.fetch_add(latency, std::memory_order_relaxed);
+
+		if( latency > stream->latencyMax.load(std::memory_order_relaxed) )
+			stream->latencyMax.store(latency, std::memory_order_relaxed);
+
+		if( mOptions.batching )
+			queueBatch(stream, frame);
+		else if( mCallback != NULL )
+			mCallback(stream->id, frame, mCallbackData);
+
+		frame.reset();
+	}
+
+	stream->scheduled = false;
+
+	// a frame queued after the last Capture() but before the flag was
+	// cleared didn't schedule the stream, so check again
+	if( stream->decoder->GetFramesQueued() > 0 && !stream->scheduled.exchange(true) )
+		schedule(stream);
+}
+
+
+// queueBatch
+void StreamManager::queueBatch( const StreamPtr& stream, const gstFrame::Ptr& frame )
+{
+	std::lock_guard<std::mutex> lock(mBatchMutex);
+
+	if( mBatchFrames.size() >= mOptions.batchQueueSize && !mBatchFrames.empty() )
+	{
+		mBatchFrames.front().stream->batchDropped.fetch_add(1, std::memory_order_relaxed);
+		mBatchFrames.pop_front();
+	}
+
+	BatchFrame batchFrame;
+
+	batchFrame.stream = stream;
+	batchFrame.frame  = frame;
+
+	mBatchFrames.push_back(batchFrame);
+	mBatchCond.notify_one();
+}
+
+
+// CaptureBatch
+bool StreamManager::CaptureBatch( FrameBatch* batch, uint64_t deadline, uint64_t timeout )
+{
+	if( !batch )
+		return false;
+
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::vector<BatchFrame> frames;
+
+	{
+		std::unique_lock<std::mutex> lock(mBatchMutex);
+
+		auto ready = [this]() { return !mBatchFrames.empty() || !mRunning; };
+
+		// wait for the first frame
+		if( timeout == UINT64_MAX )
+			mBatchCond.wait(lock, ready);
+		else
+			mBatchCond.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+
+		// then for the batch to fill up, or the deadline
+		const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadline);
+
+		while( !mBatchFrames.empty() )
+		{
+			while( !mBatchFrames.empty() && frames.size() < batch->GetCapacity() )
+			{
+				frames.push_back(mBatchFrames.front());
+				mBatchFrames.pop_front();
+			}
+
+			if( frames.size() >= batch->GetCapacity() || !mRunning )
+				break;
+
+			if( !mBatchCond.wait_until(lock, end, ready) )
+				break;
+		}
+	}
+
+	const float wait = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	// convert every frame straight into its slot of the batch
+	cv::parallel_for_(cv::Range(0, (int)frames.size()), [&frames, batch]( const cv::Range& range )
+	{
+		for( int n=range.start; n < range.end; n++ )
+			batch->Set(n, frames[n].stream->id, frames[n].frame);
+	});
+
+	batch->Resize((uint32_t)frames.size());
+	batch->SetWaitTime(wait);
+
+	if( frames.empty() )
+		return false;
+
+	std::lock_guard<std::mutex> lock(mBatchMutex);
+
+	mBatches++;
+	mBatchedFrames += frames.size();
+	mBatchFill     += batch->GetFillRatio();
+	mBatchWait     += wait;
+	mBatchMaxWait   = std::max(mBatchMaxWait, wait);
+
+	return true;
+}
+
+
+// GetBatchStats
+StreamManager::BatchStats StreamManager::GetBatchStats()
+{
+	std::lock_guard<std::mutex> lock(mBatchMutex);
+
+	BatchStats stats;
+
+	stats.batches = mBatches;
+	stats.frames  = mBatchedFrames;
+	stats.maxWait = mBatchMaxWait;
+
+	if( mBatches > 0 )
+	{
+		stats.avgFill = (float)(mBatchFill / mBatches);
+		stats.avgWait = (float)(mBatchWait / mBatches);
+	}
+
+	return stats;
+}
+
+
+// sample
+void StreamManager::sample( Stream* stream, StreamStats& stats )
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const uint64_t frames = stream->frames.load(std::memory_order_relaxed);
+	const float seconds = std::chrono::duration<float>(now - stream->lastSample).count();
+
+	stats.uri        = stream->uri;
+	stats.frames     = frames;
+	stats.fps        = seconds > 0.0f ? (frames - stream->lastFrames) / seconds : 0.0f;
+	stats.avgLatency = frames > 0 ? stream->latencySum.load(std::memory_order_relaxed) / (float)frames * 0.001f : 0.0f;
+	stats.maxLatency = stream->latencyMax.load(std::memory_order_relaxed) * 0.001f;
+
+	stream->lastFrames = frames;
+	stream->lastSample = now;
+
+	if( stream->decoder != NULL )
+	{
+		stats.streaming        = stream->decoder->IsStreaming() ? 1 : 0;
+		stats.eos              = stream->decoder->IsEOS() ? 1 : 0;
+		stats.error            = stream->decoder->HasError() ? 1 : 0;
+		const gstDecoder::Stats decoderStats = stream->decoder->GetStats();
+
+		stats.dropped          = decoderStats.droppedUpstream + decoderStats.droppedSink + decoderStats.droppedQueue + decoderStats.droppedStale
+						 + stream->batchDropped.load(std::memory_order_relaxed);
+		stats.timeToFirstFrame = stream->decoder->GetTimeToFirstFrame();
+		stats.disconnected     = stream->decoder->GetConnectionState() != gstDecoder::CONNECTED ? 1 : 0;
+		stats.reconnects       = stream->decoder->GetReconnects();
+		stats.recoveryTime     = stream->decoder->GetRecoveryTime();
+		stats.decoderThreads   = stream->decoder->GetDecoderThreads();
+		stats.convertThreads   = stream->decoder->GetConvertThreads();
+	}
+
+	if( stream->node >= 0 )
+		stats.node = (int)mPlacement->GetNodeId(stream->node);
+}
+
+
+// accumulate
+static void accumulate( StreamManager::StreamStats& total, const StreamManager::StreamStats& stats, float& latencySum )
+{
+	total.streaming += stats.streaming;
+	total.eos       += stats.eos;
+	total.error     += stats.error;
+	total.disconnected += stats.disconnected;
+	total.reconnects   += stats.reconnects;
+	total.decoderThreads += stats.decoderThreads;
+	total.convertThreads += stats.convertThreads;
+	total.frames    += stats.frames;
+	total.dropped   += stats.dropped;
+	total.fps       += stats.fps;
+	total.maxLatency = std::max(total.maxLatency, stats.maxLatency);
+	total.timeToFirstFrame = std::max(total.timeToFirstFrame, stats.timeToFirstFrame);
+	total.recoveryTime     = std::max(total.recoveryTime, stats.recoveryTime);
+
+	latencySum += stats.avgLatency * stats.frames;
+
+	if( total.frames > 0 )
+		total.avgLatency = latencySum / total.frames;
+}
+
+
+// GetNumStreams
+uint32_t StreamManager::GetNumStreams()
+{
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+	return (uint32_t)mStreams.size();
+}
+
+
+// GetStats
+bool StreamManager::GetStats( uint32_t id, StreamStats& stats )
+{
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+	std::map<uint32_t, StreamPtr>::iterator n = mStreams.find(id);
+
+	if( n == mStreams.end() )
+		return false;
+
+	stats = StreamStats();
+	sample(n->second.get(), stats);
+	return true;
+}
+
+
+// GetTotalStats
+StreamManager::StreamStats StreamManager::GetTotalStats()
+{
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+	StreamStats total;
+	float latencySum = 0.0f;
+
+	for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+	{
+		StreamStats stats;
+		sample(n->second.get(), stats);
+		accumulate(total, stats, latencySum);
+	}
+
+	total.rejected = mRejected;
+	return total;
+}
+
+
+// PrintStats
+void StreamManager::PrintStats()
+{
+	std::vector<StreamStats> streams;
+	std::vector<uint32_t> ids;
+
+	{
+		std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+		for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+		{
+			StreamStats stats;
+			sample(n->second.get(), stats);
+
+			streams.push_back(stats);
+			ids.push_back(n->first);
+		}
+	}
+
+	StreamStats total;
+	float latencySum = 0.0f;
+
+	{
+		std::lock_guard<std::mutex> lock(mStreamsMutex);
+		total.rejected = mRejected;
+	}
+
+	for( size_t n=0; n < streams.size(); n++ )
+	{
+		const StreamStats& s = streams[n];
+
+		printf("StreamManager -- [%u] %-40s %s %6.1f fps  %8llu frames  %6llu dropped  latency %5.1f/%5.1f ms  first frame %6.1f ms",
+			ids[n], s.uri.c_str(), s.error ? "ERROR" : s.eos ? "EOS  " : s.disconnected ? "LOST " : s.streaming ? "OK   " : "IDLE ", s.fps,
+			(unsigned long long)s.frames, (unsigned long long)s.dropped, s.avgLatency, s.maxLatency, s.timeToFirstFrame);
+
+		if( s.reconnects > 0 )
+			printf("  %llu reconnects (last %.1f ms)", (unsigned long long)s.reconnects, s.recoveryTime);
+
+		if( s.decoderThreads > 0 || s.convertThreads > 0 )
+			printf("  threads %u+%u", s.decoderThreads, s.convertThreads);
+
+		if( s.node >= 0 )
+			printf("  node %i", s.node);
+
+		printf("\n");
+
+		accumulate(total, s, latencySum);
+	}
+
+	printf("StreamManager -- %u/%zu streaming  %.1f fps  %llu frames  %llu dropped  latency %.1f/%.1f ms",
+		total.streaming, streams.size(), total.fps, (unsigned long long)total.frames,
+		(unsigned long long)total.dropped, total.avgLatency, total.maxLatency);
+
+	if( total.rejected > 0 )
+		printf("  %llu refused", (unsigned long long)total.rejected);
+
+	printf("\n");
+
+	// compare the shared task pool against GStreamer's default one
+	const uint64_t switches = gstTaskPool::GetContextSwitches();
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const float seconds = std::chrono::duration<float>(now - mLastSwitchTime).count();
+
+	if( switches > 0 && seconds > 0.0f )
+		printf("StreamManager -- %.0f context switches/s (%s task pool)\n", (switches - mLastSwitches) / seconds,
+			mOptions.decoder.taskPool != NULL ? "shared" : "default");
+
+	mLastSwitches   = switches;
+	mLastSwitchTime = now;
+
+	if( mPlacement->IsEnabled() )
+		mPlacement->Print();
+
+	if( mOptions.decoder.taskPool != NULL )
+		mOptions.decoder.taskPool->Print();
+
+	if( mOptions.decoder.threadBudget != NULL )
+		mOptions.decoder.threadBudget->Print();
+
+	if( mOptions.batching )
+	{
+		const BatchStats batches = GetBatchStats();
+
+		printf("StreamManager -- %llu batches  %.1f%% filled  wait %.1f/%.1f ms\n", (unsigned long long)batches.batches,
+			batches.avgFill * 100.0f, batches.avgWait, batches.maxWait);
+	}
+}
+
+
+// IsFinished
+bool StreamManager::IsFinished()
+{
+	std::lock_guard<std::mutex> lock(mStreamsMutex);
+
+	for( std::map<uint32_t, StreamPtr>::iterator n=mStreams.begin(); n != mStreams.end(); n++ )
+	{
+		const gstDecoder* decoder = n->second->decoder;
+
+		if( decoder != NULL && !decoder->IsEOS() && !decoder->HasError() )
+			return false;
+	}
+
+	return true;
+}
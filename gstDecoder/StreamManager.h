@@ -0,0 +1,296 @@
+#ifndef __STREAM_MANAGER_H__
+#define __STREAM_MANAGER_H__
+
+#include "gstDecoder.h"
+#include "FrameBatch.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Runs many gstDecoder streams in one process.
+ *
+ * Instead of one Capture() loop (and thread) per stream, each decoder
+ * notifies the manager when it queues a frame, and a fixed pool of worker
+ * threads drains the streams that have frames ready and hands them to the
+ * frame callback.  A stream is only ever serviced by one worker at a time,
+ * so its frames are delivered in order.
+ *
+ * With Options::batching, the frames are gathered for CaptureBatch()
+ * instead, which converts frames of any stream into one FrameBatch for
+ * batched inference.
+ *
+ * The decoders share the bus dispatch thread (see gstBusWatcher), so the
+ * number of threads created by the manager doesn't depend on the number of
+ * streams, apart from the ones GStreamer runs inside each pipeline.
+ *
+ * With Options::placement, each stream is assigned a NUMA node (see
+ * gstPlacement): its streaming threads are pinned to the CPUs of the node,
+ * and it's drained by workers pinned to the same CPUs, so its frames are
+ * written and read on one node.
+ *
+ * When the streams share a gstTaskPool with maxThreads, each streaming task
+ * holds a thread of it until the stream stops, so AddStream() only admits a
+ * stream while the pool has threads left for its tasks, estimated from the
+ * threads the running streams use.
+ */
+class StreamManager
+{
+public:
+	/**
+	 * Called from a worker thread for every decoded frame.  The handle can be
+	 * kept after the callback returns, but holding on to it keeps the
+	 * decoder's buffer in use.
+	 */
+	typedef void (*FrameCallback)( uint32_t stream, const gstFrame::Ptr& frame, void* user_data );
+
+	/**
+	 * Manager settings, passed to Create().
+	 */
+	struct Options
+	{
+		/**
+		 * Number of worker threads delivering frames, 0 uses the number of CPUs.
+		 */
+		uint32_t workerThreads;
+
+		/**
+		 * Settings of the streams added by uri, the preview is disabled by default.
+		 */
+		gstDecoder::Options decoder;
+
+		/**
+		 * Gather the frames for CaptureBatch() instead of calling the frame callback.
+		 */
+		bool batching;
+
+		/**
+		 * Maximum number of frames waiting for CaptureBatch(), the oldest are
+		 * dropped beyond that.  Each waiting frame holds a decoder buffer.
+		 */
+		uint32_t batchQueueSize;
+
+		/**
+		 * How streams are placed on the NUMA nodes.  The workers are divided
+		 * between the nodes (at least one each) and pinned to them.  On a
+		 * single node, nothing is pinned.
+		 */
+		gstPlacementPolicy placement;
+
+		Options() : workerThreads(0), batching(false), batchQueueSize(64), placement(PLACEMENT_NONE)	{ decoder.preview = false; }
+	};
+
+	/**
+	 * Statistics of a stream, or of all the streams (see GetTotalStats()).
+	 */
+	struct StreamStats
+	{
+		std::string uri;		/**< the stream's uri (empty for the totals) */
+		uint32_t streaming;		/**< 1 if the stream is playing (number of streams for the totals) */
+		uint32_t eos;			/**< 1 if the stream ended */
+		uint32_t error;		/**< 1 if the stream failed */
+		uint32_t disconnected;	/**< 1 if the stream lost its connection and is reconnecting */
+		uint64_t reconnects;		/**< times the stream was reconnected */
+		uint64_t frames;		/**< frames delivered */
+		uint64_t dropped;		/**< frames dropped anywhere in the pipeline or queue (see gstDecoder::Stats) */
+		float    fps;			/**< frames delivered per second since the previous sample */
+		float    avgLatency;		/**< average time in ms between the decoder queueing a frame and its delivery */
+		float    maxLatency;		/**< longest time in ms between the decoder queueing a frame and its delivery */
+		float    timeToFirstFrame;	/**< ms between Open() and the first frame (worst stream for the totals) */
+		float    recoveryTime;	/**< ms from losing the connection to the first frame after the last reconnection, or -1 (worst stream for the totals) */
+		uint32_t decoderThreads;	/**< threads of the decoder, 0 for its default (see gstDecoder::Options::threadBudget) */
+		uint32_t convertThreads;	/**< threads of the converter, 0 for its default */
+		int      node;			/**< NUMA node the stream is placed on, -1 if not placed (see Options::placement) */
+		uint64_t rejected;		/**< streams AddStream() refused because their task pool was full (totals only) */
+
+		StreamStats() : streaming(0), eos(0), error(0), disconnected(0), reconnects(0), frames(0), dropped(0), fps(0), avgLatency(0), maxLatency(0), timeToFirstFrame(-1), recoveryTime(-1), decoderThreads(0), convertThreads(0), node(-1), rejected(0) {}
+	};
+
+	/**
+	 * Statistics of the batches returned by CaptureBatch().
+	 */
+	struct BatchStats
+	{
+		uint64_t batches;		/**< batches returned */
+		uint64_t frames;		/**< frames in those batches */
+		float    avgFill;		/**< average fraction of the batch capacity filled */
+		float    avgWait;		/**< average time in ms CaptureBatch() waited for frames */
+		float    maxWait;		/**< longest time in ms CaptureBatch() waited for frames */
+
+		BatchStats() : batches(0), frames(0), avgFill(0), avgWait(0), maxWait(0) {}
+	};
+
+	/**
+	 * Create the manager.  Streams are added with AddStream().
+	 */
+	static StreamManager* Create( const Options& options=Options() );
+
+	/**
+	 * Stop and release all the streams.
+	 */
+	~StreamManager();
+
+	/**
+	 * Add a stream with the default decoder settings.
+	 * If the manager is already started, the stream is opened right away.
+	 * @returns the id of the stream, or -1 if the decoder couldn't be created
+	 *          or its task pool has no threads left for it.
+	 */
+	int AddStream( const char* uri );
+
+	/**
+	 * Add a stream with its own decoder settings.
+	 * @see AddStream()
+	 */
+	int AddStream( const gstDecoder::Options& options );
+
+	/**
+	 * Close and release a stream.  Once it returns, no more frames of the
+	 * stream are delivered.  Must not be called from the frame callback.
+	 * @returns `false` if there is no such stream.
+	 */
+	bool RemoveStream( uint32_t stream );
+
+	/**
+	 * Set the frame callback (or NULL to discard the frames).  Only call this while stopped.
+	 */
+	void SetFrameCallback( FrameCallback callback, void* user_data );
+
+	/**
+	 * Open all the streams in parallel and start delivering frames.
+	 * @returns `false` if none of the streams could be opened.
+	 */
+	bool Start();
+
+	/**
+	 * Close all the streams in parallel and stop the workers.
+	 */
+	void Stop();
+
+	/**
+	 * Gather up to batch->GetCapacity() frames, from any stream, into `batch`.
+	 *
+	 * Waits up to `timeout` milliseconds for a first frame, then up to
+	 * `deadline` milliseconds more for the batch to fill, and returns with the
+	 * frames received by then, oldest first.  The frames are converted into
+	 * the batch in parallel.  Requires Options::batching.
+	 *
+	 * @returns `false` if no frame arrived before the timeout.
+	 */
+	bool CaptureBatch( FrameBatch* batch, uint64_t deadline, uint64_t timeout=gstDecoder::DefaultTimeout );
+
+	/**
+	 * Fill ratio and wait time of the batches returned so far.
+	 */
+	BatchStats GetBatchStats();
+
+	/**
+	 * Number of streams added.
+	 */
+	uint32_t GetNumStreams();
+
+	/**
+	 * Retrieve the statistics of a stream, the fps are measured since the previous call.
+	 * @returns `false` if there is no such stream.
+	 */
+	bool GetStats( uint32_t stream, StreamStats& stats );
+
+	/**
+	 * Statistics of all the streams combined.
+	 */
+	StreamStats GetTotalStats();
+
+	/**
+	 * Print the statistics of every stream, followed by the totals, the
+	 * context switches per second of the process, the placement of the
+	 * streams on the NUMA nodes, and the usage of the streams' task pool and
+	 * thread budget, if any.
+	 */
+	void PrintStats();
+
+	/**
+	 * Returns true once every stream has either ended or failed.
+	 */
+	bool IsFinished();
+
+	/**
+	 * Returns true if the manager is started.
+	 */
+	inline bool IsRunning() const			{ return mRunning; }
+
+private:
+	StreamManager( const Options& options );
+
+	struct Stream;
+	typedef std::shared_ptr<Stream> StreamPtr;
+
+	static void onFrame( gstDecoder* decoder, void* user_data );
+
+	void schedule( const StreamPtr& stream );
+	void process( const StreamPtr& stream );
+	void sample( Stream* stream, StreamStats& stats );
+	void queueBatch( const StreamPtr& stream, const gstFrame::Ptr& frame );
+	void worker( uint32_t index );
+
+	bool admit( gstTaskPool* pool, const std::string& uri );
+	void dismiss( gstTaskPool* pool );
+
+	Options       mOptions;
+	FrameCallback mCallback;
+	void*         mCallbackData;
+
+	std::map<uint32_t, StreamPtr> mStreams;
+	std::mutex mStreamsMutex;
+	uint32_t   mNextId;
+
+	// streams admitted into each task pool, and the ones refused (guarded by mStreamsMutex)
+	std::map<gstTaskPool*, uint32_t> mPoolStreams;
+	uint64_t mRejected;
+
+	// streams with frames ready, one queue per NUMA node with placement
+	struct ReadyQueue
+	{
+		std::deque<StreamPtr>   streams;
+		std::condition_variable cond;
+	};
+
+	std::vector< std::unique_ptr<ReadyQueue> > mReady;
+	std::mutex               mReadyMutex;
+	std::vector<std::thread> mWorkers;
+	bool                     mStopWorkers;
+
+	gstPlacement* mPlacement;
+
+	struct BatchFrame
+	{
+		StreamPtr     stream;
+		gstFrame::Ptr frame;
+	};
+
+	std::deque<BatchFrame>  mBatchFrames;
+	std::mutex              mBatchMutex;
+	std::condition_variable mBatchCond;
+
+	uint64_t mBatches;
+	uint64_t mBatchedFrames;
+	double   mBatchFill;
+	double   mBatchWait;
+	float    mBatchMaxWait;
+
+	std::mutex        mStateMutex;
+	std::atomic<bool> mRunning;
+
+	uint64_t mLastSwitches;
+	std::chrono::steady_clock::time_point mLastSwitchTime;
+};
+
+#endif
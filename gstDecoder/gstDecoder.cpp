@@ -1,17 +1,81 @@
 #include "gstDecoder.h"
+#include "yuvConvert.h"
+#include "gstState.h"
+#include "gstPipelineBuilder.h"
 #include <gst/app/gstappsink.h>
 #include <sstream> 
 
+#include <algorithm>
+#include <random>
+
 #include <string.h>
 #include <math.h>
 
 
+// minimum time in milliseconds between two steps up of the adaptive decode mode
+#define ADAPTIVE_STEP_TIME 500
+
+// how often in milliseconds the reconnect thread checks for a stalled stream
+#define RECONNECT_POLL_TIME 100
+
+
+// default stream
+const char* gstDecoder::DefaultURI = "rtsp://192.168.2.160/livestream/12";
+
+
 // constructor
-gstDecoder::gstDecoder()
+gstDecoder::gstDecoder( const Options& options ) : mOptions(options)
 {	
 	mAppSink   = NULL;
 	mBus       = NULL;
 	mPipeline  = NULL;
+	mBuffers   = NULL;
+	mRenderer  = NULL;
+	mBusWatcher = NULL;
+	mLatencyTracer = NULL;
+	mCaptureStage  = 0;
+	mDecodeSpan    = 0;
+	mFrameSkipper  = NULL;
+	mPublisher     = NULL;
+	mCaptureAge    = 0.0f;
+	mFrameRate     = 0.0f;
+	mRateFrames    = 0;
+	mThreadAllocation = 0;
+	mDecoderThreads   = options.threadBudget != NULL ? 0 : options.decoderThreads;
+	mConvertThreads   = options.threadBudget != NULL ? 0 : options.convertThreads;
+	mLoadLow       = false;
+	mImagePool     = NULL;
+	mOwnImagePool  = NULL;
+	mImagesDropped = 0;
+	mQueue          = NULL;
+	mFramesReceived = 0;
+	mFramesCaptured = 0;
+	mFramesStale    = 0;
+	mSinkBuffers    = 0;
+	mQueueIn        = 0;
+	mQueueOut       = 0;
+	mSource          = NULL;
+	mDepaySink       = NULL;
+	mReconnectStop   = false;
+	mReconnectActive = false;
+	mConnectionLost  = false;
+	mConnectionState = CONNECTED;
+	mLastFrameTime   = std::chrono::steady_clock::time_point();
+	mReconnects      = 0;
+	mRecoveryTime    = -1.0f;
+	mStreaming = false;
+
+	mFrameListener     = NULL;
+	mFrameListenerData = NULL;
+
+	mDecodeModeListener     = NULL;
+	mDecodeModeListenerData = NULL;
+	mEOS       = false;
+	mError     = false;
+
+	mWaitingFirstFrame = false;
+	mTimeToFirstFrame  = -1.0f;
+	mTeardownTime      = -1.0f;
 }
 
 
@@ -20,12 +84,47 @@ gstDecoder::~gstDecoder()
 {
 	Close();
 
+	delete mBusWatcher;
+	mBusWatcher = NULL;
+
+	delete mLatencyTracer;
+	mLatencyTracer = NULL;
+
+	delete mFrameSkipper;
+	mFrameSkipper = NULL;
+
+	delete mPublisher;
+	mPublisher = NULL;
+
+	delete mOwnImagePool;
+	mOwnImagePool = NULL;
+
+	mFormatCache.Detach();
+
 	if( mAppSink != NULL )
 	{
 		gst_object_unref(mAppSink);
 		mAppSink = NULL;
 	}
 
+	if( mQueue != NULL )
+	{
+		gst_object_unref(mQueue);
+		mQueue = NULL;
+	}
+
+	if( mDepaySink != NULL )
+	{
+		gst_object_unref(mDepaySink);
+		mDepaySink = NULL;
+	}
+
+	if( mSource != NULL )
+	{
+		gst_object_unref(mSource);
+		mSource = NULL;
+	}
+
 	if( mBus != NULL )
 	{
 		gst_object_unref(mBus);
@@ -39,13 +138,24 @@ gstDecoder::~gstDecoder()
 	}
 	
 	// SAFE_DELETE(mBufferManager);
+	delete mRenderer;
+	mRenderer = NULL;
+
+	delete mBuffers;
+	mBuffers = NULL;
 }
 
 // Create
 gstDecoder* gstDecoder::Create( )
+{
+	return Create(Options());
+}
+
+// Create
+gstDecoder* gstDecoder::Create( const Options& options )
 {
 	// create camera instance
-	gstDecoder* cam = new gstDecoder();
+	gstDecoder* cam = new gstDecoder(options);
 	
 	if( !cam )
 		return NULL;
@@ -54,6 +164,7 @@ gstDecoder* gstDecoder::Create( )
 	if( !cam->init() )
 	{
 		// printf("gstDecoder -- failed to create device %s\n", cam->GetResource().c_str());
+		delete cam;
 		return NULL;
 	}
 	
@@ -117,11 +228,32 @@ bool gstDecoder::init()
 	// std::string uri = "nvarguscamerasrc sensor-id=0 ! video/x-raw(memory:NVMM), width=(int)1280, height=(int)720, framerate=30/1, format=(string)NV12 ! nvvidconv flip-method=2 ! video/x-raw ! appsink name=mysink";
 	// std::string uri = "filesrc location=D://video/sample.mp4 ! qtdemux ! queue ! h264parse ! nvv4l2decoder name=decoder enable-max-performance=1 ! video/x-raw(memory:NVMM) ! nvvidconv name=vidconv ! video/x-raw ! appsink name=mysink";
 	// std::string uri = "filesrc location=D:/video/sample.mp4 ! qtdemux ! queue ! h264parse ! avdec_h264 ! videoconvert ! video/x-raw,format=NV12 ! appsink name=mysink";
-	std::string uri = "rtspsrc location=rtsp://192.168.2.160/livestream/12 ! rtph264depay ! h264parse ! avdec_h264 name=decoder ! queue ! videoconvert ! video/x-raw,format=(string)NV12 ! appsink name=mysink sync=false";
 	// Windows 下 d3d11h264dec 解码器比 openh264dec 快很多 avdec_h264 也很慢
 	// 不要直接在管道中转码为RGB，可以转为NV12，否则会比较慢
+	if( mOptions.pipeline.empty() )
+	{
+		gstPipelineBuilder::Options builder;
+
+		builder.codec      = mOptions.codec;
+		builder.decoder    = mOptions.decoder;
+		builder.queueSize  = mOptions.pipelineQueueSize;
+		builder.queueLeaky = mOptions.pipelineQueueLeaky;
+
+		// with a budget, the threads are only known once the stream's resolution is
+		builder.decoderThreads = mDecoderThreads;
+		builder.convertThreads = mConvertThreads;
+
+		mLaunchStr = gstPipelineBuilder::Build(mOptions.uri, builder);
+	}
+	else
+	{
+		mLaunchStr = mOptions.pipeline;
+	}
+
+	printf("gstDecoder -- pipeline string:\n%s\n", mLaunchStr.c_str());
+
 	// launch pipeline
-	mPipeline = gst_parse_launch(uri.c_str(), &err);
+	mPipeline = gst_parse_launch(mLaunchStr.c_str(), &err);
 
 	if( err != NULL )
 	{
@@ -148,8 +280,29 @@ bool gstDecoder::init()
 		return false;
 	}
 
-	// add watch for messages (disabled when we poll the bus ourselves, instead of gmainloop)
-	//gst_bus_add_watch(mBus, (GstBusFunc)gst_message_print, NULL);
+	// dispatch bus messages from their own thread, instead of polling the bus from the streaming thread
+	gstBusWatcher::Callbacks busCallbacks;
+
+	busCallbacks.error        = onBusError;
+	busCallbacks.eos          = onBusEOS;
+	busCallbacks.qos          = onBusQoS;
+	busCallbacks.latency      = onBusLatency;
+	busCallbacks.buffering    = onBusBuffering;
+	busCallbacks.stateChanged = onBusStateChanged;
+	busCallbacks.filter       = onBusFilter;
+
+	// the streaming tasks are moved to the shared pool and pinned as they're created,
+	// and the latency tracer caches the clock as soon as the pipeline is playing
+	if( mOptions.taskPool != NULL || !mOptions.affinity.empty() || mOptions.traceLatency )
+		busCallbacks.sync = onBusSync;
+
+	mBusWatcher = gstBusWatcher::Create(mPipeline, busCallbacks, this, "gstDecoder");
+
+	if( !mBusWatcher || !mBusWatcher->Start() )
+	{
+		printf("gstDecoder failed to start watching the pipeline bus\n");
+		return false;
+	}
 
 	// get the appsrc 用于接收 GStreamer 流中的数据
 	GstElement* appsinkElement = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
@@ -162,6 +315,70 @@ bool gstDecoder::init()
 	}
 	
 	mAppSink = appsink;
+
+	// bound the appsink's own queue, so a stalled consumer can't pile up frames
+	gst_app_sink_set_max_buffers(mAppSink, mOptions.sinkMaxBuffers);
+	gst_app_sink_set_drop(mAppSink, mOptions.sinkDrop);
+
+	// count what goes in and out of the queues that may drop buffers
+	countBuffers(appsinkElement, "sink", &mSinkBuffers);
+
+	mQueue = gst_bin_get_by_name(GST_BIN(pipeline), gstPipelineBuilder::QueueName);
+
+	if( mQueue != NULL )
+	{
+		countBuffers(mQueue, "sink", &mQueueIn);
+		countBuffers(mQueue, "src", &mQueueOut);
+	}
+
+	// size the threads from the first caps with a resolution, ahead of the decoder if they
+	// come from the parser, or else ahead of the converter
+	if( mOptions.threadBudget != NULL )
+	{
+		GstElement* decoder = gst_bin_get_by_name(GST_BIN(pipeline), gstPipelineBuilder::DecoderName);
+		GstElement* elements[] = { decoder, mQueue };
+
+		for( size_t n=0; n < 2; n++ )
+		{
+			GstPad* pad = elements[n] != NULL ? gst_element_get_static_pad(elements[n], "sink") : NULL;
+
+			if( pad != NULL )
+			{
+				gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, onThreadCaps, this, NULL);
+				gst_object_unref(pad);
+			}
+		}
+
+		if( decoder != NULL )
+			gst_object_unref(decoder);
+	}
+
+	// the network source can be restarted on its own, see reconnect()
+	if( mOptions.reconnect )
+	{
+		GstElement* depay = gst_bin_get_by_name(GST_BIN(pipeline), gstPipelineBuilder::DepayName);
+		mSource = gst_bin_get_by_name(GST_BIN(pipeline), gstPipelineBuilder::SourceName);
+
+		if( mSource != NULL && depay != NULL )
+			mDepaySink = gst_element_get_static_pad(depay, "sink");
+
+		if( mDepaySink != NULL )
+		{
+			// rtspsrc adds a new pad for every session, which has to be linked again
+			g_signal_connect(mSource, "pad-added", G_CALLBACK(onSourcePad), this);
+
+			// a server that stops the stream sends EOS, which must not reach the appsink
+			gst_pad_add_probe(mDepaySink, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, onSourceEvent, this, NULL);
+		}
+		else if( mSource != NULL )
+		{
+			gst_object_unref(mSource);
+			mSource = NULL;
+		}
+
+		if( depay != NULL )
+			gst_object_unref(depay);
+	}
 	
 	// setup callbacks
 	GstAppSinkCallbacks cb;
@@ -172,10 +389,71 @@ bool gstDecoder::init()
 	cb.new_sample  = onBuffer;	// 回调函数 onBuffer 会在新的样本数据可用时被调用。这是主要用于处理每一帧数据的回调。
 	
 	gst_app_sink_set_callbacks(mAppSink, &cb, (void*)this, NULL);
+
+	// parse the caps once per negotiation instead of for every frame
+	mFormatCache.Attach(appsinkElement, "gstDecoder");
+
+	// per-stage latency, the probes are only installed when enabled
+	if( mOptions.traceLatency )
+	{
+		mLatencyTracer = gstLatencyTracer::Create(mPipeline, "gstDecoder");
+
+		if( mLatencyTracer != NULL )
+		{
+			mCaptureStage = mLatencyTracer->AddStage("Capture()");
+			mDecodeSpan   = mLatencyTracer->AddSpan("decode", gstPipelineBuilder::DecoderName, GST_ELEMENT_NAME(appsinkElement));
+
+			if( !mLatencyTracer->Attach() )
+			{
+				delete mLatencyTracer;
+				mLatencyTracer = NULL;
+			}
+		}
+	}
 	
+	// drop compressed frames in front of the decoder when Capture() falls behind
+	if( mOptions.adaptiveDecode )
+	{
+		GstElement* decoder = gst_bin_get_by_name(GST_BIN(pipeline), gstPipelineBuilder::DecoderName);
+
+		if( decoder != NULL )
+		{
+			mFrameSkipper = gstFrameSkipper::Create(decoder);
+			gst_object_unref(decoder);
+		}
+
+		if( !mFrameSkipper )
+			printf("gstDecoder -- adaptive decoding isn't available for this pipeline\n");
+	}
+
+	// share the frames with other processes
+	if( !mOptions.publishName.empty() )
+	{
+		mPublisher = gstShmPublisher::Create(mOptions.publishName.c_str(), mOptions.publishSlots);
+
+		if( !mPublisher )
+			return false;
+	}
+
 	// disable looping for cameras
 	// mOptions.loop = 0;	// 防止在相机应用中无限循环播放/
 
+	// queue of decoded frames waiting for Capture()
+	mBuffers = new RingBuffer<gstFrame::Ptr>(mOptions.queueSize, mOptions.queuePolicy);
+
+	printf("gstDecoder -- frame queue size %u (%s when full)\n", mBuffers->GetCapacity(),
+		mOptions.queuePolicy == RINGBUFFER_BLOCK ? "block" : "drop oldest");
+
+	// images for Capture(FramePool::Image&), nothing is allocated until then
+	mImagePool = mOptions.imagePool;
+
+	if( !mImagePool )
+		mImagePool = mOwnImagePool = FramePool::Create();
+
+	// preview window, displayed from its own thread (or a tile of a shared mosaic)
+	if( mOptions.preview && !mOptions.mosaic )
+		mRenderer = gstRenderer::Create("sample", mOptions.previewWidth, mOptions.previewHeight, mOptions.previewInterpolation);
+
 	return true;
 }
 
@@ -184,13 +462,19 @@ bool gstDecoder::init()
 void gstDecoder::onEOS(_GstAppSink* sink, void* user_data)
 {
 	printf("gstDecoder -- end of stream (EOS)\n");
-	cv::destroyAllWindows();
+
 	if( !user_data )
 		return;
 
-	// gstDecoder* dec = (gstDecoder*)user_data;
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// close the preview window
+	if( dec->mRenderer != NULL )
+		dec->mRenderer->Stop();
 
-	// dec->mEOS = true;	
+	// wake up Capture() once the remaining frames have been drained
+	dec->mEOS = true;	
+	dec->mBuffers->Shutdown();
 	// dec->mStreaming = dec->isLooping();
 }
 
@@ -198,12 +482,6 @@ void gstDecoder::onEOS(_GstAppSink* sink, void* user_data)
 GstFlowReturn gstDecoder::onPreroll(_GstAppSink* sink, void* user_data)
 {
 	printf("gstDecoder -- onPreroll\n");
-
-	if( !user_data )
-		return GST_FLOW_OK;
-
-	gstDecoder* dec = (gstDecoder*)user_data;
-	dec->checkMsgBus();
 	return GST_FLOW_OK;
 }
 
@@ -218,7 +496,6 @@ GstFlowReturn gstDecoder::onBuffer(_GstAppSink* sink, void* user_data)
 	gstDecoder* dec = (gstDecoder*)user_data;
 	
 	dec->checkBuffer();
-	dec->checkMsgBus();
 	
 	return GST_FLOW_OK;
 }
@@ -240,92 +517,274 @@ void gstDecoder::checkBuffer()
 		printf("gstDecoder -- app_sink_pull_sample() returned NULL...\n");
 		return;
 	}
+
+	mFramesReceived++;
+
+	// the reconnect thread waits for this while the source restarts
+	mLastFrameTime = std::chrono::steady_clock::now();
+
+	if( mConnectionState != CONNECTED )
+	{
+		std::lock_guard<std::mutex> lock(mReconnectMutex);
+		mReconnectCond.notify_all();
+	}
 	
-	// 获取样本的容器格式（caps）表示该样本包含的多媒体数据的描述
-	GstCaps* gstCaps = gst_sample_get_caps(gstSample);
-	
-	if( !gstCaps )
+	// the format only gets parsed again when the caps change
+	gstFormat::Ptr format = mFormatCache.Get(gstSample);
+
+	if( !format )
 	{
-		printf("gstDecoder -- gst_sample had NULL caps...\n");
+		printf("gstDecoder -- failed to parse the caps of incoming sample\n");
 		release_return;
 	}
-	GstStructure* gstCapsStruct = gst_caps_get_structure(gstCaps, 0);
-	const char* format = gst_structure_get_string(gstCapsStruct, "format");
-	int width, height;
-	gst_structure_get_int(gstCapsStruct, "width", &width);
-	gst_structure_get_int(gstCapsStruct, "height", &height);
-	
-	
-	// 从样本中检索缓冲区，缓冲区包含实际的多媒体数据
-	GstBuffer* gstBuffer = gst_sample_get_buffer(gstSample);
-	
-	if( !gstBuffer )
+
+	// wrap the sample without copying, the handle keeps the buffer mapped
+	gstFrame::Ptr frame = gstFrame::Create(gstSample, format);
+
+	if( !frame )
 	{
-		printf("gstDecoder -- app_sink_pull_sample() returned NULL...\n");
+		printf("gstDecoder -- failed to map incoming sample\n");
 		release_return;
 	}
 
-	GstMapInfo mapInfo;
-	gst_buffer_map(gstBuffer, &mapInfo, GST_MAP_READ);
+	// only a frame that can actually be delivered counts as the first one
+	if( mWaitingFirstFrame.exchange(false) )
+	{
+		mTimeToFirstFrame = elapsed(mOpenTime);
+		printf("gstDecoder -- first frame after %.1f ms\n", mTimeToFirstFrame.load());
+	}
+
 	// format is NV12, buffer size: 12441600, width: 3840, height: 2160
-	printf("format is %s, buffer size: %d, width: %d, height: %d\n", format, mapInfo.size, width, height);
+	// printf("format is %s, buffer size: %zu, width: %d, height: %d\n", frame->GetFormat(), frame->GetSize(), frame->GetWidth(), frame->GetHeight());
 	
-	cv::Mat nv12Mat(height * 3 / 2, width, CV_8UC1, (void*)mapInfo.data);
-    cv::Mat bgrMat(height, width, CV_8UC3);
-    cv::cvtColor(nv12Mat, bgrMat, cv::COLOR_YUV2BGR_NV12);
-	cv::resize(bgrMat, bgrMat, cv::Size(1280, 720));
-	cv::imshow("sample", bgrMat);
-	
-	// cv::Mat frame(720, 1280, CV_8UC3, mapInfo.data);
-	// cv::imshow("sample", frame);
-	// cv::imwrite("sample.jpg", frame);
-	cv::waitKey(1);
-
-	gst_buffer_unmap(gstBuffer, &mapInfo);
-	// // enqueue the buffer for color conversion
-	// if( !mBufferManager->Enqueue(gstBuffer, gstCaps) )
-	// {
-	// 	printf("gstDecoder -- failed to handle incoming buffer\n");
-	// 	release_return;
-	// }
+	// hand the frame to the preview thread, which only ever shows the latest one
+	if( mRenderer != NULL )
+		mRenderer->Render(frame);
+
+	if( mOptions.mosaic != NULL )
+		mOptions.mosaic->Render(mOptions.mosaicTile, frame);
+
+	// enqueue the frame for Capture(), the handle shares the decoder's buffer
+	if( !mBuffers->Push(frame, mOptions.queueTimeout) && mOptions.queuePolicy == RINGBUFFER_BLOCK )
+		printf("gstDecoder -- frame queue full, dropped frame (%llu total)\n", (unsigned long long)mBuffers->GetDropped());
+
+	if( mPublisher != NULL )
+		mPublisher->Publish(frame);
+
+	if( mFrameListener != NULL )
+		mFrameListener(this, mFrameListenerData);
+
+	// measure the rate frames are delivered at, and adapt it to the load
+	mRateFrames++;
+
+	const float rateTime = elapsed(mRateTime);
+
+	if( rateTime >= 1000.0f )
+	{
+		mFrameRate  = mRateFrames * 1000.0f / rateTime;
+		mRateFrames = 0;
+		mRateTime   = std::chrono::steady_clock::now();
+
+		// the throughput each allocation of the budget achieves
+		if( mThreadAllocation != 0 )
+			mOptions.threadBudget->Measure(mThreadAllocation, mFrameRate);
+	}
+
+	if( mFrameSkipper != NULL )
+		adaptDecode();
 	
 	// mOptions.frameCount++;
 	release_return;
 }
 
 
-#define RETURN_STATUS(code)  { if( status != NULL ) { *status=(code); } return ((code) == videoSource::OK ? true : false); }
+#define RETURN_STATUS(code)  { if( status != NULL ) { *status=(code); } return ((code) == OK ? true : false); }
 
 
 // Capture
-bool gstDecoder::Capture( void** output, int* status )
+bool gstDecoder::Capture( void** output, int* status, uint64_t timeout )
 {
 	// verify the output pointer exists
 	if( !output )
+		RETURN_STATUS(ERROR);
+
+	gstFrame::Ptr frame;
+
+	if( !Capture(frame, status, timeout) )
+		return false;
+
+	// mLastFrame keeps the buffer mapped until the next Capture()
+	*output = (void*)frame->GetPlane(0);
+	return true;
+}
+
+// Capture
+bool gstDecoder::Capture( cv::Mat& output, int* status, uint64_t timeout )
+{
+	gstFrame::Ptr frame;
+
+	if( !Capture(frame, status, timeout) )
 		return false;
-	if( !Open() )
+
+	const int width = mOptions.outputWidth != 0 ? mOptions.outputWidth : frame->GetWidth();
+	const int height = mOptions.outputHeight != 0 ? mOptions.outputHeight : frame->GetHeight();
+
+	output.create(height, width, CV_8UC3);
+
+	if( !frame->ToBGR(output.data, (uint32_t)output.step, width, height, mOptions.outputInterpolation) )
+		RETURN_STATUS(ERROR);
+
+	RETURN_STATUS(OK);
+}
+
+// Capture
+bool gstDecoder::Capture( FramePool::Image& output, int* status, uint64_t timeout )
+{
+	gstFrame::Ptr frame;
+
+	if( !Capture(frame, status, timeout) )
 		return false;
 
+	const uint32_t width = mOptions.outputWidth != 0 ? mOptions.outputWidth : frame->GetWidth();
+	const uint32_t height = mOptions.outputHeight != 0 ? mOptions.outputHeight : frame->GetHeight();
+
+	output = mImagePool->Acquire(width, height, CV_8UC3);
+
+	if( !output )
+	{
+		mImagesDropped++;
+		RETURN_STATUS(DROPPED);
+	}
+
+	if( !frame->ToBGR(output->data, (uint32_t)output->step, width, height, mOptions.outputInterpolation) )
+	{
+		output.reset();
+		RETURN_STATUS(ERROR);
+	}
+
+	RETURN_STATUS(OK);
+}
+
+// Capture
+bool gstDecoder::Capture( gstFrame::Ptr& output, int* status, uint64_t timeout )
+{
+	if( !mStreaming && !mEOS )
+	{
+		if( !Open() )
+			RETURN_STATUS(ERROR);
+	}
+
+	// release the previous frame back to the decoder
+	mLastFrame.reset();
 
 	// wait until a new frame is recieved
-	// const int result = mBufferManager->Dequeue(output, format, timeout);
-	
-	// if( result < 0 )
-	// {
-	// 	printf("gstDecoder::Capture() -- an error occurred retrieving the next image buffer\n");
-	// 	RETURN_STATUS(ERROR);
-	// }
-	// else if( result == 0 )
-	// {
-	// 	LogWarning(LOG_GSTREAMER "gstDecoder::Capture() -- a timeout occurred waiting for the next image buffer\n");
-	// 	RETURN_STATUS(TIMEOUT);
-	// }
+	while( true )
+	{
+		if( !mBuffers->Pop(mLastFrame, timeout) )
+		{
+			if( mError )
+			{
+				printf("gstDecoder::Capture() -- an error occurred retrieving the next image buffer\n");
+				RETURN_STATUS(ERROR);
+			}
+			else if( mEOS )
+			{
+				RETURN_STATUS(EOS);
+			}
 
-	// mLastTimestamp = mBufferManager->GetLastTimestamp();
-	// mRawFormat = mBufferManager->GetRawFormat();
+			if( timeout > 0 )
+				printf("gstDecoder::Capture() -- a timeout occurred waiting for the next image buffer\n");
 
-	// RETURN_STATUS(OK);
-	return true;
+			RETURN_STATUS(TIMEOUT);
+		}
+
+		// skip the frames that are too old to be of use, and wait for a fresh one
+		const float age = elapsed(mLastFrame->GetArrivalTime());
+		mCaptureAge = age;
+
+		if( mOptions.maxFrameAge == 0 || age <= mOptions.maxFrameAge )
+			break;
+
+		mFramesStale++;
+		mLastFrame.reset();
+	}
+
+	mFramesCaptured++;
+
+	if( mLatencyTracer != NULL )
+		mLatencyTracer->Record(mCaptureStage, mLastFrame->GetTimestamp());
+
+	output = mLastFrame;
+	RETURN_STATUS(OK);
+}
+
+// SetFrameListener
+void gstDecoder::SetFrameListener( FrameListener listener, void* user_data )
+{
+	mFrameListener     = listener;
+	mFrameListenerData = user_data;
+}
+
+// SetDecodeModeListener
+void gstDecoder::SetDecodeModeListener( DecodeModeListener listener, void* user_data )
+{
+	mDecodeModeListener     = listener;
+	mDecodeModeListenerData = user_data;
+}
+
+// adaptDecode
+void gstDecoder::adaptDecode()
+{
+	const uint32_t queued = mBuffers->GetSize();
+	const float age = mCaptureAge;
+
+	// a threshold of 0 isn't checked
+	const uint32_t depth = mOptions.adaptiveQueueDepth;
+	const uint64_t maxAge = mOptions.adaptiveMaxAge;
+
+	const bool overloaded = (depth > 0 && queued >= depth) || (maxAge > 0 && age >= maxAge);
+	const bool underloaded = (depth == 0 || queued <= depth / 2) && (maxAge == 0 || age <= maxAge / 2);
+
+	const gstDecodeMode current = mFrameSkipper->GetMode();
+	gstDecodeMode mode = current;
+
+	// step up quickly, but only step down after the load stayed low for a while
+	if( overloaded )
+	{
+		mLoadLow = false;
+
+		if( current < DECODE_KEYFRAMES && elapsed(mModeTime) >= ADAPTIVE_STEP_TIME )
+			mode = (gstDecodeMode)(current + 1);
+	}
+	else if( underloaded )
+	{
+		if( !mLoadLow )
+		{
+			mLoadLow = true;
+			mLoadLowTime = std::chrono::steady_clock::now();
+		}
+		else if( current > DECODE_ALL && elapsed(mLoadLowTime) >= mOptions.adaptiveHoldTime && elapsed(mModeTime) >= mOptions.adaptiveHoldTime )
+		{
+			mode = (gstDecodeMode)(current - 1);
+			mLoadLowTime = std::chrono::steady_clock::now();
+		}
+	}
+	else
+	{
+		mLoadLow = false;
+	}
+
+	if( mode == current )
+		return;
+
+	mFrameSkipper->SetMode(mode);
+	mModeTime = std::chrono::steady_clock::now();
+
+	printf("gstDecoder -- %s decoding %s frames (%u queued, %.1f ms behind, %.1f fps)\n", mOptions.uri.c_str(),
+		gstFrameSkipper::ModeToStr(mode), queued, age, (float)mFrameRate);
+
+	if( mDecodeModeListener != NULL )
+		mDecodeModeListener(this, mode, mFrameRate, mDecodeModeListenerData);
 }
 
 // Open
@@ -347,67 +806,593 @@ bool gstDecoder::Open()
 	// 	return false;
 	// }
 
+	std::lock_guard<std::mutex> lock(mStateMutex);
+
+	if( mStreaming )
+		return true;
+
 	// transition pipline to STATE_PLAYING
 	printf("opening gstDecoder for streaming, transitioning pipeline to GST_STATE_PLAYING\n");
 	
-	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_PLAYING);
+	mEOS = false;
+	mError = false;
+	mBuffers->Restart();
 
-	if( result == GST_STATE_CHANGE_ASYNC )
-	{
-#if 0
-		GstMessage* asyncMsg = gst_bus_timed_pop_filtered(mBus, 5 * GST_SECOND, 
-    	 					      (GstMessageType)(GST_MESSAGE_ASYNC_DONE|GST_MESSAGE_ERROR)); 
+	if( mRenderer != NULL )
+		mRenderer->Start();
 
-		if( asyncMsg != NULL )
-		{
-			gst_message_print(mBus, asyncMsg, this);
-			gst_message_unref(asyncMsg);
-		}
-		else
-			printf(LOG_GSTREAMER "gstDecoder NULL message after transitioning pipeline to PLAYING...\n");
-#endif
-	}
-	else if( result != GST_STATE_CHANGE_SUCCESS )
+	// time-to-first-frame is measured from here to the first checkBuffer()
+	mOpenTime = std::chrono::steady_clock::now();
+	mRateTime = mOpenTime;
+	mModeTime = mOpenTime;
+	mTimeToFirstFrame = -1.0f;
+	mWaitingFirstFrame = true;
+
+	// wait for the pipeline to preroll instead of sleeping
+	if( !gstSetState(mPipeline, GST_STATE_PLAYING, mOptions.openTimeout, "gstDecoder") )
 	{
-		printf("gstDecoder failed to set pipeline state to PLAYING (error %u)\n", result);
+		gst_element_set_state(mPipeline, GST_STATE_NULL);
+		mWaitingFirstFrame = false;
+
+		if( mRenderer != NULL )
+			mRenderer->Stop();
+
 		return false;
 	}
 
-	checkMsgBus();
-	_sleep(100);
-	checkMsgBus();
+	printf("gstDecoder -- pipeline started in %.1f ms\n", elapsed(mOpenTime));
 
-	// mStreaming = true;
+	mStreaming = true;
+	startReconnect();
 	return true;
 }
+
+// OpenAsync
+std::future<bool> gstDecoder::OpenAsync()
+{
+	return std::async(std::launch::async, [this]() { return Open(); });
+}
 	
 // Close
 void gstDecoder::Close()
 {
-	const GstStateChangeReturn result = gst_element_set_state(mPipeline, GST_STATE_NULL);
+	if( !mPipeline )
+		return;
+
+	std::lock_guard<std::mutex> lock(mStateMutex);
+
+	// the source must not be restarted while the pipeline shuts down
+	stopReconnect();
+
+	// release the streaming thread if it's blocked on a full queue
+	if( mBuffers != NULL )
+		mBuffers->Shutdown();
+
+	const std::chrono::steady_clock::time_point closeTime = std::chrono::steady_clock::now();
+
+	gstSetState(mPipeline, GST_STATE_NULL, mOptions.closeTimeout, "gstDecoder");
 
-	if( result != GST_STATE_CHANGE_SUCCESS )
-		printf("gstDecoder failed to set pipeline state to PLAYING (error %u)\n", result);
+	// the next Open() acquires threads again, in case the stream changed
+	releaseThreads();
 
-	// usleep(250*1000);	
-	_sleep(250);
-	checkMsgBus();
-	// mStreaming = false;
+	if( mRenderer != NULL )
+		mRenderer->Stop();
+
+	// don't hold on to a buffer of the stopped pipeline
+	if( mOptions.mosaic != NULL )
+		mOptions.mosaic->Clear(mOptions.mosaicTile);
+
+	mWaitingFirstFrame = false;
+	mTeardownTime = elapsed(closeTime);
+
+	if( mStreaming )
+		printf("gstDecoder -- pipeline stopped in %.1f ms\n", mTeardownTime.load());
+
+	mStreaming = false;
 	// LogInfo(LOG_GSTREAMER "gstDecoder -- pipeline stopped\n");
 }
 
-// checkMsgBus
-void gstDecoder::checkMsgBus()
+// CloseAsync
+std::future<void> gstDecoder::CloseAsync()
+{
+	return std::async(std::launch::async, [this]() { Close(); });
+}
+
+// elapsed
+float gstDecoder::elapsed( const std::chrono::steady_clock::time_point& start )
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// onBusError
+void gstDecoder::onBusError( const char* source, const GError* error, const char* debug, void* user_data )
+{
+	if( !user_data )
+		return;
+
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// wake up Capture() right away, it reports ERROR
+	dec->mError = true;
+	dec->mBuffers->Shutdown();
+
+	if( dec->mFrameListener != NULL )
+		dec->mFrameListener(dec, dec->mFrameListenerData);
+}
+
+// onBusEOS
+void gstDecoder::onBusEOS( void* user_data )
+{
+	if( !user_data )
+		return;
+
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// every sink has finished, the appsink usually reported it already
+	dec->mEOS = true;
+	dec->mBuffers->Shutdown();
+
+	if( dec->mFrameListener != NULL )
+		dec->mFrameListener(dec, dec->mFrameListenerData);
+}
+
+// onBusQoS
+void gstDecoder::onBusQoS( const char* source, const gstBusQoS& qos, void* user_data )
+{
+	printf("gstDecoder -- %s dropped a late buffer (%.1f ms late, %llu dropped so far)\n", source,
+		(double)qos.jitter / GST_MSECOND, (unsigned long long)qos.dropped);
+
+	if( !user_data || qos.dropped == (uint64_t)-1 )
+		return;
+
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// the QoS counters are running totals of each element
+	std::lock_guard<std::mutex> lock(dec->mStatsMutex);
+	dec->mQoSDropped[source] = qos.dropped;
+}
+
+// onCountBuffer
+GstPadProbeReturn gstDecoder::onCountBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	std::atomic<uint64_t>* counter = (std::atomic<uint64_t>*)user_data;
+
+	if( info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST )
+		counter->fetch_add(gst_buffer_list_length(GST_PAD_PROBE_INFO_BUFFER_LIST(info)), std::memory_order_relaxed);
+	else
+		counter->fetch_add(1, std::memory_order_relaxed);
+
+	return GST_PAD_PROBE_OK;
+}
+
+// countBuffers
+void gstDecoder::countBuffers( GstElement* element, const char* pad, std::atomic<uint64_t>* counter )
+{
+	GstPad* elementPad = gst_element_get_static_pad(element, pad);
+
+	if( !elementPad )
+		return;
+
+	gst_pad_add_probe(elementPad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST), onCountBuffer, counter, NULL);
+	gst_object_unref(elementPad);
+}
+
+// GetDecodeLatency
+bool gstDecoder::GetDecodeLatency( gstLatencyStats& stats ) const
+{
+	if( !mLatencyTracer )
+		return false;
+
+	return mLatencyTracer->GetSpan(mDecodeSpan, stats);
+}
+
+// GetStats
+gstDecoder::Stats gstDecoder::GetStats() const
+{
+	Stats stats;
+
+	stats.received = mFramesReceived;
+	stats.captured = mFramesCaptured;
+	stats.droppedQueue = mBuffers != NULL ? mBuffers->GetDropped() : 0;
+	stats.droppedStale = mFramesStale;
+	stats.skipped      = mFrameSkipper != NULL ? mFrameSkipper->GetSkipped() : 0;
+
+	// samples the appsink accepted but replaced before they were pulled
+	const uint64_t sinkIn = mSinkBuffers;
+	stats.droppedSink = sinkIn > stats.received ? sinkIn - stats.received : 0;
+
+	stats.droppedUpstream = 0;
+
+	// buffers that went into the leaky queue and neither came out nor are still in it
+	if( mQueue != NULL )
+	{
+		guint level = 0;
+		g_object_get(mQueue, "current-level-buffers", &level, NULL);
+
+		const uint64_t queueIn = mQueueIn;
+		const uint64_t queueOut = mQueueOut + level;
+
+		if( queueIn > queueOut )
+			stats.droppedUpstream += queueIn - queueOut;
+	}
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+
+	for( std::map<std::string, uint64_t>::const_iterator n=mQoSDropped.begin(); n != mQoSDropped.end(); n++ )
+		stats.droppedUpstream += n->second;
+
+	return stats;
+}
+
+// onBusLatency
+void gstDecoder::onBusLatency( const char* source, void* user_data )
+{
+	if( !user_data )
+		return;
+
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// an element changed its latency, redistribute it over the pipeline.  That
+	// queries every element, so it runs on GStreamer's thread pool instead of
+	// holding up the other pipelines sharing the bus dispatch thread
+	gst_element_call_async(dec->mPipeline, onRecalculateLatency, NULL, NULL);
+}
+
+// onRecalculateLatency
+void gstDecoder::onRecalculateLatency( GstElement* pipeline, gpointer user_data )
+{
+	gst_bin_recalculate_latency(GST_BIN(pipeline));
+}
+
+// onBusBuffering
+void gstDecoder::onBusBuffering( const char* source, int percent, void* user_data )
+{
+	printf("gstDecoder -- %s buffering %i%%\n", source, percent);
+}
+
+// onBusStateChanged
+void gstDecoder::onBusStateChanged( const char* source, GstState oldState, GstState newState, bool pipeline, void* user_data )
+{
+	if( !pipeline )
+		return;
+
+	printf("gstDecoder -- pipeline state changed from %s to %s\n",
+		gst_element_state_get_name(oldState), gst_element_state_get_name(newState));
+}
+
+// onBusFilter
+bool gstDecoder::onBusFilter( GstMessage* msg, void* user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec || !dec->mReconnectActive || GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR )
+		return false;
+
+	// errors of the network source only mean the connection dropped, the rest of the pipeline is fine
+	if( !gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg), GST_OBJECT(dec->mSource)) )
+		return false;
+
+	GError* err = NULL;
+	gst_message_parse_error(msg, &err, NULL);
+
+	dec->connectionLost(err != NULL ? err->message : "source error");
+
+	if( err != NULL )
+		g_error_free(err);
+
+	return true;
+}
+
+// onBusSync
+bool gstDecoder::onBusSync( GstMessage* msg, void* user_data )
 {
-	while(true)
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec )
+		return false;
+
+	// ENTER is posted by the streaming thread itself, before its loop runs
+	if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_STREAM_STATUS && !dec->mOptions.affinity.empty() )
 	{
-		GstMessage* msg = gst_bus_pop(mBus);
+		GstStreamStatusType type;
+		GstElement* owner = NULL;
+
+		gst_message_parse_stream_status(msg, &type, &owner);
+
+		if( type == GST_STREAM_STATUS_TYPE_ENTER )
+			gstPlacement::PinThread(dec->mOptions.affinity);
+	}
 
-		if( !msg )
+	if( dec->mLatencyTracer != NULL )
+		dec->mLatencyTracer->HandleMessage(msg);
+
+	if( dec->mOptions.taskPool != NULL )
+		return dec->mOptions.taskPool->HandleMessage(msg);
+
+	return false;
+}
+
+
+// onSourcePad
+void gstDecoder::onSourcePad( GstElement* element, GstPad* pad, gpointer user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	if( !dec || gst_pad_is_linked(dec->mDepaySink) )
+		return;
+
+	// pads of other media (e.g. audio) don't link, and are left alone
+	if( gst_pad_link(pad, dec->mDepaySink) == GST_PAD_LINK_OK )
+		printf("gstDecoder -- linked %s to the depayloader\n", GST_PAD_NAME(pad));
+}
+
+// onSourceEvent
+GstPadProbeReturn gstDecoder::onSourceEvent( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	gstDecoder* dec = (gstDecoder*)user_data;
+	GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+	if( !dec || GST_EVENT_TYPE(event) != GST_EVENT_EOS || !dec->mReconnectActive )
+		return GST_PAD_PROBE_OK;
+
+	// the decoder and appsink would stop for good on EOS
+	dec->connectionLost("end of stream");
+	return GST_PAD_PROBE_DROP;
+}
+
+// connectionLost
+void gstDecoder::connectionLost( const char* reason )
+{
+	printf("gstDecoder -- %s lost the connection (%s)\n", mOptions.uri.c_str(), reason);
+
+	{
+		std::lock_guard<std::mutex> lock(mReconnectMutex);
+		mConnectionLost = true;
+	}
+
+	mReconnectCond.notify_all();
+}
+
+// startReconnect
+void gstDecoder::startReconnect()
+{
+	if( !mSource || mReconnectThread.joinable() )
+		return;
+
+	mReconnectStop   = false;
+	mConnectionLost  = false;
+	mConnectionState = CONNECTED;
+	mReconnectActive = true;
+
+	mReconnectThread = std::thread(&gstDecoder::reconnect, this);
+}
+
+// stopReconnect
+void gstDecoder::stopReconnect()
+{
+	if( !mReconnectThread.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mReconnectMutex);
+		mReconnectStop = true;
+	}
+
+	mReconnectCond.notify_all();
+	mReconnectThread.join();
+
+	mReconnectActive = false;
+	mConnectionState = CONNECTED;
+}
+
+// reconnect
+void gstDecoder::reconnect()
+{
+	std::mt19937_64 random(std::random_device{}());
+	std::unique_lock<std::mutex> lock(mReconnectMutex);
+
+	// frames are expected from here on, at the latest reconnectTimeout later
+	std::chrono::steady_clock::time_point connectTime = std::chrono::steady_clock::now();
+
+	while( !mReconnectStop )
+	{
+		mReconnectCond.wait_for(lock, std::chrono::milliseconds(RECONNECT_POLL_TIME));
+
+		if( mReconnectStop )
 			break;
 
-		// gst_message_print(mBus, msg, this);
-		gst_message_unref(msg);
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		const std::chrono::steady_clock::time_point lastFrame = std::max(mLastFrameTime.load(), connectTime);
+		const bool stalled = mOptions.reconnectTimeout > 0 && now - lastFrame > std::chrono::milliseconds(mOptions.reconnectTimeout);
+
+		if( !mConnectionLost && !stalled )
+			continue;
+
+		if( stalled && !mConnectionLost )
+			printf("gstDecoder -- %s lost the connection (no frame for %llu ms)\n", mOptions.uri.c_str(), (unsigned long long)mOptions.reconnectTimeout);
+
+		const std::chrono::steady_clock::time_point lostTime = now;
+		uint32_t attempts = 0;
+
+		mConnectionState = DISCONNECTED;
+
+		while( !mReconnectStop && mConnectionState != CONNECTED )
+		{
+			if( mOptions.reconnectAttempts > 0 && attempts >= mOptions.reconnectAttempts )
+			{
+				printf("gstDecoder -- %s failed to reconnect after %u attempts\n", mOptions.uri.c_str(), attempts);
+
+				// report it like any other error, Capture() returns ERROR
+				mReconnectActive = false;
+				lock.unlock();
+
+				mError = true;
+				mBuffers->Shutdown();
+
+				if( mFrameListener != NULL )
+					mFrameListener(this, mFrameListenerData);
+
+				return;
+			}
+
+			// exponential backoff, half of it random so that streams that dropped together don't retry together
+			const uint64_t backoff = std::min(mOptions.reconnectMaxDelay, mOptions.reconnectDelay << std::min(attempts, 16u));
+			const uint64_t delay = backoff / 2 + std::uniform_int_distribution<uint64_t>(0, backoff / 2)(random);
+
+			if( mReconnectCond.wait_for(lock, std::chrono::milliseconds(delay), [this]() { return mReconnectStop; }) )
+				break;
+
+			attempts++;
+			mConnectionLost  = false;
+			mConnectionState = RECONNECTING;
+
+			printf("gstDecoder -- reconnecting %s (attempt %u, after %llu ms)\n", mOptions.uri.c_str(), attempts, (unsigned long long)delay);
+
+			// only the source is restarted, its new pad gets linked to the same depayloader
+			lock.unlock();
+			gst_element_set_state(mSource, GST_STATE_NULL);
+			const bool started = gst_element_sync_state_with_parent(mSource);
+			lock.lock();
+
+			connectTime = std::chrono::steady_clock::now();
+
+			if( started )
+			{
+				const uint64_t timeout = mOptions.reconnectTimeout > 0 ? mOptions.reconnectTimeout : DefaultStateTimeout;
+
+				mReconnectCond.wait_for(lock, std::chrono::milliseconds(timeout), [this, connectTime]() {
+					return mReconnectStop || mConnectionLost || mLastFrameTime.load() > connectTime; });
+			}
+
+			if( mLastFrameTime.load() > connectTime )
+			{
+				mRecoveryTime    = elapsed(lostTime);
+				mConnectionState = CONNECTED;
+				mReconnects++;
+
+				printf("gstDecoder -- %s reconnected in %.1f ms (%u attempts)\n", mOptions.uri.c_str(), mRecoveryTime.load(), attempts);
+			}
+			else if( !mReconnectStop )
+			{
+				mConnectionState = DISCONNECTED;
+				printf("gstDecoder -- %s reconnect attempt %u failed\n", mOptions.uri.c_str(), attempts);
+			}
+		}
 	}
 }
 
+
+// onThreadCaps
+GstPadProbeReturn gstDecoder::onThreadCaps( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+	if( event != NULL && GST_EVENT_TYPE(event) == GST_EVENT_CAPS && user_data != NULL )
+	{
+		GstCaps* caps = NULL;
+		gst_event_parse_caps(event, &caps);
+		((gstDecoder*)user_data)->acquireThreads(caps);
+	}
+
+	return GST_PAD_PROBE_OK;
+}
+
+
+// acquireThreads
+void gstDecoder::acquireThreads( GstCaps* caps )
+{
+	if( !caps || gst_caps_get_size(caps) == 0 )
+		return;
+
+	// compressed caps only carry the resolution once the parser found it
+	const GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+	gint width = 0;
+	gint height = 0;
+
+	if( !gst_structure_get_int(structure, "width", &width) || !gst_structure_get_int(structure, "height", &height) )
+		return;
+
+	gint num = 0;
+	gint den = 1;
+
+	const float frameRate = (gst_structure_get_fraction(structure, "framerate", &num, &den) && den != 0) ? (float)num / (float)den : 0.0f;
+
+	std::lock_guard<std::mutex> lock(mThreadsMutex);
+
+	if( mThreadAllocation != 0 )
+		return;
+
+	const gstThreadBudget::Allocation allocation = mOptions.threadBudget->Acquire(width, height, frameRate, onThreadsResized, this);
+
+	mThreadAllocation = allocation.id;
+	mDecoderThreads   = allocation.decoderThreads;
+	mConvertThreads   = allocation.convertThreads;
+
+	// the elements pick them up when they get these caps, which are on their way to them
+	setThreads(gstPipelineBuilder::DecoderName, "max-threads", allocation.decoderThreads);
+	setThreads(gstPipelineBuilder::ConvertName, "n-threads", allocation.convertThreads);
+	setThreads(gstPipelineBuilder::ScaleName, "n-threads", allocation.convertThreads);
+}
+
+
+// releaseThreads
+void gstDecoder::releaseThreads()
+{
+	std::lock_guard<std::mutex> lock(mThreadsMutex);
+
+	if( mThreadAllocation == 0 )
+		return;
+
+	mOptions.threadBudget->Release(mThreadAllocation);
+
+	mThreadAllocation = 0;
+	mDecoderThreads   = 0;
+	mConvertThreads   = 0;
+}
+
+
+// onThreadsResized (called by the budget when other streams come and go)
+void gstDecoder::onThreadsResized( const gstThreadBudget::Allocation& allocation, void* user_data )
+{
+	if( !user_data )
+		return;
+
+	gstDecoder* dec = (gstDecoder*)user_data;
+
+	// the budget's lock is held, and acquireThreads() may be waiting on it with mThreadsMutex
+	dec->mConvertThreads = allocation.convertThreads;
+
+	dec->setThreads(gstPipelineBuilder::ConvertName, "n-threads", allocation.convertThreads, true);
+	dec->setThreads(gstPipelineBuilder::ScaleName, "n-threads", allocation.convertThreads, true);
+}
+
+
+// setThreads
+void gstDecoder::setThreads( const char* name, const char* property, uint32_t threads, bool reconfigure )
+{
+	GstElement* element = gst_bin_get_by_name(GST_BIN(mPipeline), name);
+
+	if( !element )
+		return;
+
+	// hardware decoders and decodebin have no such property
+	if( g_object_class_find_property(G_OBJECT_GET_CLASS(element), property) != NULL )
+	{
+		g_object_set(element, property, (guint)threads, NULL);
+
+		// n-threads is only read when the caps are set, which a reconfigure does again
+		if( reconfigure )
+		{
+			GstPad* pad = gst_element_get_static_pad(element, "src");
+
+			if( pad != NULL )
+			{
+				gst_pad_mark_reconfigure(pad);
+				gst_object_unref(pad);
+			}
+		}
+	}
+
+	gst_object_unref(element);
+}
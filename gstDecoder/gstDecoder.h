@@ -3,8 +3,28 @@
 
 // #include "videoSource.h"
 // #include "gstBufferManager.h"
+#include "RingBuffer.h"
+#include "gstFrame.h"
+#include "gstRenderer.h"
+#include "gstBusWatcher.h"
+#include "gstPipelineBuilder.h"
+#include "gstLatencyTracer.h"
+#include "gstFrameSkipper.h"
+#include "gstShmRing.h"
+#include "gstMosaic.h"
+#include "gstThreadBudget.h"
+#include "gstTaskPool.h"
+#include "gstPlacement.h"
+#include "FramePool.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <gst/gst.h>
@@ -20,17 +40,264 @@ class gstDecoder
 public:
 	enum Status
 	{
+		DROPPED = -3,	/**< the frame was dropped because the image pool is full */
 		ERROR   = -2,	/**< an error occurred */
 		EOS     = -1,	/**< end-of-stream (EOS) */
 		TIMEOUT = 0,	/**< a timeout occurred */
 		OK      = 1	/**< frame capture successful */
 	};
 
+	/**
+	 * State of the connection to an rtsp:// stream (see Options::reconnect).
+	 */
+	enum ConnectionState
+	{
+		CONNECTED    = 0,	/**< frames are arriving, or the stream isn't open yet */
+		DISCONNECTED = 1,	/**< the connection was lost, waiting before the next attempt */
+		RECONNECTING = 2	/**< the source was restarted, waiting for its first frame */
+	};
+
+	/**
+	 * Frame counters, since the decoder was created.
+	 */
+	struct Stats
+	{
+		uint64_t received;		/**< frames delivered by the appsink */
+		uint64_t captured;		/**< frames returned by Capture() */
+		uint64_t droppedUpstream;	/**< dropped before the appsink, by the leaky queue or late (QoS) */
+		uint64_t droppedSink;		/**< dropped by the appsink (see Options::sinkMaxBuffers) */
+		uint64_t droppedQueue;		/**< dropped from the frame queue because Capture() didn't keep up */
+		uint64_t droppedStale;		/**< skipped by Capture() for being older than Options::maxFrameAge */
+		uint64_t skipped;		/**< compressed frames not decoded (see Options::adaptiveDecode) */
+	};
+
+	/**
+	 * Decoder settings, passed to Create().
+	 */
+	struct Options
+	{
+		/**
+		 * Stream to decode: an rtsp:// URL, any other URI supported by
+		 * uridecodebin (file://, http://, ...), or a local file path.
+		 */
+		std::string uri;
+
+		/**
+		 * Codec of the stream (for rtsp:// and files with a known container).
+		 */
+		gstVideoCodec codec;
+
+		/**
+		 * Decoder element to use, by default the fastest one available is
+		 * selected (see gstPipelineBuilder::SelectDecoder()).
+		 */
+		std::string decoder;
+
+		/**
+		 * Complete gst-launch pipeline, used instead of the one built from
+		 * `uri` if set.  It must end in an appsink named "mysink".
+		 */
+		std::string pipeline;
+
+		/**
+		 * Number of decoded frames buffered between the GStreamer streaming
+		 * thread and Capture().  Rounded up to a power of two.
+		 */
+		uint32_t queueSize;
+
+		/**
+		 * What to do when the queue is full because Capture() isn't keeping up.
+		 * RINGBUFFER_DROP_OLDEST never stalls the streaming thread, while
+		 * RINGBUFFER_BLOCK holds it for up to queueTimeout milliseconds.
+		 */
+		RingBufferPolicy queuePolicy;
+
+		/**
+		 * Time in milliseconds the streaming thread waits for a free slot
+		 * under RINGBUFFER_BLOCK before the new frame is dropped.
+		 */
+		uint64_t queueTimeout;
+
+		/**
+		 * Maximum number of decoded frames waiting in the pipeline's queue in
+		 * front of the converter (0 keeps GstQueue's defaults), and which
+		 * ones are dropped when it's full.
+		 */
+		uint32_t pipelineQueueSize;
+		gstQueueLeaky pipelineQueueLeaky;
+
+		/**
+		 * Number of threads of the libav decoders (their max-threads) and of
+		 * videoconvert/videoscale (their n-threads).  0 keeps the elements'
+		 * defaults: a thread per CPU for the decoder, one for the converter.
+		 */
+		uint32_t decoderThreads;
+		uint32_t convertThreads;
+
+		/**
+		 * Take the decoder and converter threads from a budget shared with the
+		 * other streams instead, sized by the resolution and frame rate of the
+		 * stream once its caps arrive (see gstThreadBudget).  The budget must
+		 * outlive the decoder.  If NULL, decoderThreads/convertThreads apply.
+		 */
+		gstThreadBudget* threadBudget;
+
+		/**
+		 * Run the streaming threads of the pipeline (source, queues, jitterbuffer)
+		 * in a pool shared with the other streams, instead of a thread of their
+		 * own each (see gstTaskPool).  The pool must outlive the decoder.
+		 * If NULL, GStreamer's default pool is used.
+		 */
+		gstTaskPool* taskPool;
+
+		/**
+		 * CPUs the streaming threads of the pipeline are pinned to as they
+		 * start, so they stay on one NUMA node (see gstPlacement).  Threads
+		 * they create, like those of the libav decoders, inherit the set on
+		 * Linux, and buffers are allocated on the node of the thread that
+		 * first writes them.  Empty leaves the threads to the OS.
+		 */
+		std::vector<uint32_t> affinity;
+
+		/**
+		 * Maximum number of samples held by the appsink (0 for no limit),
+		 * and whether the oldest are dropped or the pipeline blocks once
+		 * it's reached.
+		 */
+		uint32_t sinkMaxBuffers;
+		bool sinkDrop;
+
+		/**
+		 * Frames older than this many milliseconds when Capture() dequeues
+		 * them are skipped, and Capture() waits for a fresher one.
+		 * 0 returns every frame regardless of its age.
+		 */
+		uint64_t maxFrameAge;
+
+		/**
+		 * Skip decoding frames while the consumer falls behind, see gstFrameSkipper.
+		 *
+		 * When adaptiveQueueDepth frames are waiting in the queue, or Capture()
+		 * dequeues frames older than adaptiveMaxAge milliseconds, the decoder
+		 * steps from DECODE_ALL to DECODE_REFERENCE, then to DECODE_KEYFRAMES.
+		 * It steps back once both stay under half of those for adaptiveHoldTime
+		 * milliseconds (a threshold of 0 isn't checked).  Transitions are
+		 * reported to the DecodeModeListener.
+		 */
+		bool adaptiveDecode;
+		uint32_t adaptiveQueueDepth;
+		uint64_t adaptiveMaxAge;
+		uint64_t adaptiveHoldTime;
+
+		/**
+		 * Publish the decoded frames to a shared-memory ring of this name, so
+		 * other processes can read them with gstShmSubscriber.  Empty disables it.
+		 */
+		std::string publishName;
+
+		/**
+		 * Number of frames in the shared-memory ring.
+		 */
+		uint32_t publishSlots;
+
+		/**
+		 * Reconnect rtsp:// streams that drop out by restarting only the
+		 * network source (rtspsrc), while the depayloader, decoder, converter
+		 * and frame queue keep running.  The connection is considered lost
+		 * on an error from the source, an end-of-stream, or when no frame
+		 * arrived for reconnectTimeout milliseconds (DefaultReconnectTimeout
+		 * by default, 0 only reacts to errors and EOS, and then waits
+		 * DefaultStateTimeout for each attempt).
+		 *
+		 * Attempts are spaced by an exponential backoff with jitter, from
+		 * reconnectDelay up to reconnectMaxDelay milliseconds.  After
+		 * reconnectAttempts failed attempts in a row (0 for no limit), the
+		 * stream reports an error as it would without reconnecting.
+		 */
+		bool reconnect;
+		uint64_t reconnectDelay;
+		uint64_t reconnectMaxDelay;
+		uint64_t reconnectTimeout;
+		uint32_t reconnectAttempts;
+
+		/**
+		 * Size of the BGR images returned by Capture(cv::Mat&).
+		 * 0 keeps the decoded width/height.
+		 */
+		uint32_t outputWidth;
+		uint32_t outputHeight;
+
+		/**
+		 * Resampling filter for the Capture(cv::Mat&) output.
+		 */
+		yuvInterpolation outputInterpolation;
+
+		/**
+		 * Pool of the images returned by Capture(FramePool::Image&).  Sharing a
+		 * pool between decoders bounds their total memory.  If NULL, the
+		 * decoder uses its own pool, without a memory limit.
+		 */
+		FramePool* imagePool;
+
+		/**
+		 * Show the decoded frames in a preview window.  The window is driven
+		 * by its own thread, so it never holds up decoding.
+		 */
+		bool preview;
+
+		/**
+		 * Size of the preview window, 0 keeps the decoded width/height.
+		 */
+		uint32_t previewWidth;
+		uint32_t previewHeight;
+
+		/**
+		 * Resampling filter for the preview window.
+		 */
+		yuvInterpolation previewInterpolation;
+
+		/**
+		 * Show the frames in tile `mosaicTile` of a mosaic shared with other
+		 * decoders, instead of a preview window of their own.  The mosaic
+		 * must outlive the decoder.  If NULL, `preview` applies.
+		 */
+		gstMosaic* mosaic;
+		uint32_t mosaicTile;
+
+		/**
+		 * Time in milliseconds Open() waits for the pipeline to reach PLAYING,
+		 * and Close() for it to shut down.  UINT64_MAX waits indefinetly.
+		 */
+		uint64_t openTimeout;
+		uint64_t closeTimeout;
+
+		/**
+		 * Measure the latency of every element of the pipeline and of Capture()
+		 * (see GetLatencyTracer()).  Disabled, it costs nothing.
+		 */
+		bool traceLatency;
+
+		Options() : uri(DefaultURI), codec(VIDEO_CODEC_H264), queueSize(DefaultQueueSize), queuePolicy(RINGBUFFER_DROP_OLDEST), queueTimeout(UINT64_MAX),
+				  pipelineQueueSize(DefaultQueueSize), pipelineQueueLeaky(QUEUE_LEAKY_DOWNSTREAM), decoderThreads(0), convertThreads(0), threadBudget(NULL), taskPool(NULL), sinkMaxBuffers(1), sinkDrop(true), maxFrameAge(0),
+				  adaptiveDecode(false), adaptiveQueueDepth(DefaultQueueSize - 1), adaptiveMaxAge(200), adaptiveHoldTime(3000),
+				  publishSlots(gstShmPublisher::DefaultSlots),
+				  reconnect(true), reconnectDelay(500), reconnectMaxDelay(10000), reconnectTimeout(DefaultReconnectTimeout), reconnectAttempts(0),
+				  outputWidth(0), outputHeight(0), outputInterpolation(YUV_INTERP_BILINEAR),
+				  imagePool(NULL), preview(true), previewWidth(DefaultWidth), previewHeight(DefaultHeight), previewInterpolation(YUV_INTERP_BILINEAR),
+				  mosaic(NULL), mosaicTile(0),
+				  openTimeout(DefaultStateTimeout), closeTimeout(DefaultStateTimeout), traceLatency(false) {}
+	};
+
 	/**
 	 * Create a MIPI CSI or V4L2 camera device.
 	 */
 	static gstDecoder* Create();
 
+	/**
+	 * Create the decoder with the given options.
+	 */
+	static gstDecoder* Create( const Options& options );
+
 	/**
 	 * Release the camera interface and resources.
 	 * Destroying the camera will also Close() the stream if it is still open.
@@ -49,6 +316,12 @@ public:
 	 */
 	virtual bool Open();
 
+	/**
+	 * Open() the stream from another thread, without blocking the caller.
+	 * The future becomes ready with the result of Open().
+	 */
+	std::future<bool> OpenAsync();
+
 	/**
 	 * Stop streaming the camera.
 	 * @note Close() is automatically called by the camera's destructor when
@@ -57,11 +330,202 @@ public:
 	 */
 	virtual void Close();
 
+	/**
+	 * Close() the stream from another thread, without blocking the caller.
+	 * The decoder must not be deleted before the future is ready.
+	 */
+	std::future<void> CloseAsync();
+
 	/**
 	 * Capture the next image frame from the camera.
-	 * @see videoSource::Capture
+	 *
+	 * Frames are dequeued in the order they were decoded.  The returned image
+	 * is the luma plane of the frame, which stays valid until the next call to Capture().
+	 *
+	 * @deprecated The planes of a frame aren't necessarily contiguous (each one
+	 *             may be in its own memory block, see gstFrame), so the chroma
+	 *             can't be found from this pointer.  Use Capture(gstFrame::Ptr&)
+	 *             to get the location and stride of each plane.
+	 *
+	 * @param[out] image Pointer to the luma plane of the frame.
+	 * @param[out] status Optional, set to one of the gstDecoder::Status codes.
+	 * @param[in] timeout The time in milliseconds to wait for a frame.
+	 *                    0 returns immediately, UINT64_MAX waits indefinetly.
+	 *
+	 * @returns `true` if a frame was captured, `false` on timeout, EOS or error
+	 *          (check `status` to tell them apart).
 	 */
-	virtual bool Capture( void** image, int* status=NULL );
+	virtual bool Capture( void** image, int* status=NULL, uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Capture the next frame as a zero-copy handle.
+	 *
+	 * The handle keeps the decoder's GstSample alive and its buffer mapped, so the
+	 * planes can be read directly until the handle is released.  Unlike the void**
+	 * variant, the frame remains valid across calls to Capture().
+	 * @see Capture()
+	 */
+	bool Capture( gstFrame::Ptr& frame, int* status=NULL, uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Capture the next frame converted to BGR.
+	 *
+	 * The frame is converted and resized to Options::outputWidth/outputHeight in
+	 * a single pass, so the full-resolution BGR image is never produced.
+	 * The image is reallocated only if its size or type doesn't match.
+	 * @see Capture()
+	 */
+	bool Capture( cv::Mat& image, int* status=NULL, uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Capture the next frame converted to BGR, into an image from the pool.
+	 *
+	 * Unlike Capture(cv::Mat&), each image can be kept (e.g. handed to another
+	 * thread) without copying, and its memory is recycled once released.
+	 * If the pool reached its memory limit, the frame is dropped and `status`
+	 * is set to DROPPED (see Options::imagePool).
+	 * @see Capture()
+	 */
+	bool Capture( FramePool::Image& image, int* status=NULL, uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Number of frames dropped because the queue was full.
+	 */
+	inline uint64_t GetFramesDropped() const	{ return mBuffers != NULL ? mBuffers->GetDropped() : 0; }
+
+	/**
+	 * Frames received, captured and dropped at each point of the pipeline.
+	 */
+	Stats GetStats() const;
+
+	/**
+	 * Number of frames Capture(FramePool::Image&) dropped because the image pool was full.
+	 */
+	inline uint64_t GetImagesDropped() const	{ return mImagesDropped; }
+
+	/**
+	 * Number of frames currently waiting in the queue.
+	 */
+	inline uint32_t GetFramesQueued() const		{ return mBuffers != NULL ? mBuffers->GetSize() : 0; }
+
+	/**
+	 * Number of decoded frames the preview window didn't get to display.
+	 */
+	inline uint64_t GetPreviewFramesSkipped() const	{ return mRenderer != NULL ? mRenderer->GetFramesSkipped() : 0; }
+
+	/**
+	 * The currently negotiated video format (empty until the first caps arrive).
+	 */
+	inline gstFormat::Ptr GetFormat() const		{ return mFormatCache.GetCurrent(); }
+
+	/**
+	 * The shared-memory publisher, or NULL unless Options::publishName is set.
+	 */
+	inline gstShmPublisher* GetPublisher() const	{ return mPublisher; }
+
+	/**
+	 * Per-stage latency histograms, from the source to Capture(), or NULL
+	 * unless Options::traceLatency is set.  @see gstLatencyTracer
+	 */
+	inline gstLatencyTracer* GetLatencyTracer() const	{ return mLatencyTracer; }
+
+	/**
+	 * Time each frame took from entering the decoder to reaching the appsink,
+	 * measured per frame when Options::traceLatency is set.
+	 * @returns `false` if latency isn't traced.
+	 */
+	bool GetDecodeLatency( gstLatencyStats& stats ) const;
+
+	/**
+	 * Time in milliseconds from the last Open() to the first decoded frame,
+	 * or -1 if no frame was received yet.
+	 */
+	inline float GetTimeToFirstFrame() const	{ return mTimeToFirstFrame; }
+
+	/**
+	 * Time in milliseconds the last Close() took to stop the pipeline, or -1.
+	 */
+	inline float GetTeardownTime() const		{ return mTeardownTime; }
+
+	/**
+	 * State of the connection, always CONNECTED unless the stream is
+	 * reconnected (see Options::reconnect).
+	 */
+	inline ConnectionState GetConnectionState() const	{ return (ConnectionState)mConnectionState.load(); }
+
+	/**
+	 * Number of times the stream was reconnected since the decoder was created.
+	 */
+	inline uint64_t GetReconnects() const		{ return mReconnects; }
+
+	/**
+	 * Time in milliseconds from losing the connection to the first frame
+	 * after the last reconnection (backoff included), or -1.
+	 */
+	inline float GetRecoveryTime() const		{ return mRecoveryTime; }
+
+	/**
+	 * Returns true if the stream has been opened.
+	 */
+	inline bool IsStreaming() const			{ return mStreaming; }
+
+	/**
+	 * Returns true if the end of the stream was reached.
+	 */
+	inline bool IsEOS() const				{ return mEOS; }
+
+	/**
+	 * Returns true if the pipeline reported an error since the last Open().
+	 */
+	inline bool HasError() const				{ return mError; }
+
+	/**
+	 * The URI the decoder was created with.
+	 */
+	inline const std::string& GetURI() const	{ return mOptions.uri; }
+
+	/**
+	 * Called from the streaming thread after each frame is queued, and from the
+	 * bus thread on EOS or error, so that a consumer serving many decoders can
+	 * be notified instead of blocking in Capture() on each of them.
+	 * The listener must return quickly.
+	 */
+	typedef void (*FrameListener)( gstDecoder* decoder, void* user_data );
+
+	/**
+	 * Set the frame listener (or NULL to remove it).  Only call this while closed.
+	 */
+	void SetFrameListener( FrameListener listener, void* user_data );
+
+	/**
+	 * Called from the streaming thread when Options::adaptiveDecode changes
+	 * which frames are decoded.  `frameRate` is the rate frames were decoded
+	 * at over the last second, before the change.  The listener must return quickly.
+	 */
+	typedef void (*DecodeModeListener)( gstDecoder* decoder, gstDecodeMode mode, float frameRate, void* user_data );
+
+	/**
+	 * Set the decode mode listener (or NULL to remove it).  Only call this while closed.
+	 */
+	void SetDecodeModeListener( DecodeModeListener listener, void* user_data );
+
+	/**
+	 * Which frames are currently decoded (always DECODE_ALL unless Options::adaptiveDecode is set).
+	 */
+	inline gstDecodeMode GetDecodeMode() const	{ return mFrameSkipper != NULL ? mFrameSkipper->GetMode() : DECODE_ALL; }
+
+	/**
+	 * Frames delivered by the pipeline per second, measured over the last
+	 * second, which drops while frames are skipped.
+	 */
+	inline float GetFrameRate() const			{ return mFrameRate; }
+
+	/**
+	 * Number of threads of the decoder and of the converter, as set in the
+	 * options or allocated by the thread budget (0 for the elements' defaults).
+	 */
+	inline uint32_t GetDecoderThreads() const		{ return mDecoderThreads; }
+	inline uint32_t GetConvertThreads() const		{ return mConvertThreads; }
 
 	/**
 	 * Capture the next image frame from the camera and convert it to float4 RGBA format,
@@ -123,18 +587,76 @@ public:
 	 * Default camera height, unless otherwise specified during Create()
  	 */
 	static const uint32_t DefaultHeight = 720;
+
+	/**
+	 * Default number of frames buffered for Capture()
+	 */
+	static const uint32_t DefaultQueueSize = 4;
+
+	/**
+	 * Default stream, unless otherwise specified in the Options
+	 */
+	static const char* DefaultURI;
+
+	/**
+	 * Default Capture() timeout in milliseconds
+	 */
+	static const uint64_t DefaultTimeout = 1000;
+
+	/**
+	 * Default Open()/Close() state change timeout in milliseconds
+	 */
+	static const uint64_t DefaultStateTimeout = 5000;
+
+	/**
+	 * Default time in milliseconds without any frame before a stream is
+	 * considered stalled and reconnected (see Options::reconnectTimeout).
+	 * It allows for sources that take a few seconds to send their first
+	 * keyframe, or that briefly stop sending on a static scene.
+	 */
+	static const uint64_t DefaultReconnectTimeout = 15000;
 	
 private:
 	static void onEOS(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onPreroll(_GstAppSink* sink, void* user_data);
 	static GstFlowReturn onBuffer(_GstAppSink* sink, void* user_data);
 
-	gstDecoder();
+	static void onBusError( const char* source, const GError* error, const char* debug, void* user_data );
+	static void onBusEOS( void* user_data );
+	static void onBusQoS( const char* source, const gstBusQoS& qos, void* user_data );
+	static void onBusLatency( const char* source, void* user_data );
+	static void onRecalculateLatency( GstElement* pipeline, gpointer user_data );
+	static void onBusBuffering( const char* source, int percent, void* user_data );
+	static void onBusStateChanged( const char* source, GstState oldState, GstState newState, bool pipeline, void* user_data );
+	static bool onBusFilter( GstMessage* msg, void* user_data );
+	static bool onBusSync( GstMessage* msg, void* user_data );
+
+	static void onSourcePad( GstElement* element, GstPad* pad, gpointer user_data );
+	static GstPadProbeReturn onSourceEvent( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+
+	static GstPadProbeReturn onCountBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+	static void countBuffers( GstElement* element, const char* pad, std::atomic<uint64_t>* counter );
+
+	static GstPadProbeReturn onThreadCaps( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+	void acquireThreads( GstCaps* caps );
+	void releaseThreads();
+	void setThreads( const char* name, const char* property, uint32_t threads, bool reconfigure=false );
+
+	static void onThreadsResized( const gstThreadBudget::Allocation& allocation, void* user_data );
+
+	gstDecoder( const Options& options );
 
 	bool init();
 
-	void checkMsgBus();
 	void checkBuffer();
+	void adaptDecode();
+
+	void startReconnect();
+	void stopReconnect();
+	void reconnect();
+	void connectionLost( const char* reason );
+
+	static float elapsed( const std::chrono::steady_clock::time_point& start );
 	
 	float findFramerate( const std::vector<float>& frameRates, float frameRate ) const;
 	
@@ -146,6 +668,79 @@ private:
 	// imageFormat  mFormatYUV;
 	
 	// gstBufferManager* mBufferManager;
+
+	Options mOptions;
+	gstFrame::Ptr mLastFrame;
+	RingBuffer<gstFrame::Ptr>* mBuffers;
+	gstRenderer* mRenderer;
+	gstBusWatcher* mBusWatcher;
+	gstFormatCache mFormatCache;
+
+	FramePool* mImagePool;
+	FramePool* mOwnImagePool;
+	std::atomic<uint64_t> mImagesDropped;
+
+	_GstElement* mQueue;
+
+	std::atomic<uint64_t> mFramesReceived;
+	std::atomic<uint64_t> mFramesCaptured;
+	std::atomic<uint64_t> mFramesStale;
+	std::atomic<uint64_t> mSinkBuffers;
+	std::atomic<uint64_t> mQueueIn;
+	std::atomic<uint64_t> mQueueOut;
+
+	std::map<std::string, uint64_t> mQoSDropped;
+	mutable std::mutex mStatsMutex;
+
+	gstLatencyTracer* mLatencyTracer;
+	uint32_t          mCaptureStage;
+	uint32_t          mDecodeSpan;
+
+	gstFrameSkipper* mFrameSkipper;
+	gstShmPublisher* mPublisher;
+	std::atomic<float> mCaptureAge;
+	std::atomic<float> mFrameRate;
+	uint64_t mRateFrames;
+
+	std::mutex mThreadsMutex;
+	std::atomic<uint32_t> mThreadAllocation;
+	std::atomic<uint32_t> mDecoderThreads;
+	std::atomic<uint32_t> mConvertThreads;
+
+	bool     mLoadLow;
+	std::chrono::steady_clock::time_point mRateTime;
+	std::chrono::steady_clock::time_point mModeTime;
+	std::chrono::steady_clock::time_point mLoadLowTime;
+
+	_GstElement* mSource;
+	_GstPad*     mDepaySink;
+
+	std::thread mReconnectThread;
+	std::mutex  mReconnectMutex;
+	std::condition_variable mReconnectCond;
+	bool mReconnectStop;
+	std::atomic<bool> mReconnectActive;
+	std::atomic<bool> mConnectionLost;
+	std::atomic<int>  mConnectionState;
+	std::atomic<std::chrono::steady_clock::time_point> mLastFrameTime;
+	std::atomic<uint64_t> mReconnects;
+	std::atomic<float>    mRecoveryTime;
+
+	DecodeModeListener mDecodeModeListener;
+	void*              mDecodeModeListenerData;
+
+	std::atomic<bool> mStreaming;
+	std::atomic<bool> mEOS;
+	std::atomic<bool> mError;
+
+	FrameListener mFrameListener;
+	void*         mFrameListenerData;
+
+	std::mutex mStateMutex;
+	std::chrono::steady_clock::time_point mOpenTime;
+	std::atomic<bool>  mWaitingFirstFrame;
+	std::atomic<float> mTimeToFirstFrame;
+	std::atomic<float> mTeardownTime;
 };
 
 #endif
@@ -1,19 +1,147 @@
-#include "gstDecoder.h"
-#include <cuda_runtime.h>
-#include <cuda.h>
+#include "StreamManager.h"
 #include <glib.h>
 
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t signal_recieved = 0;
+
+static void sig_handler( int signo )
+{
+    if( signo == SIGINT )
+        signal_recieved = 1;
+}
+
 int main(int argc, char *argv[])
 {
-    gstDecoder *src = NULL;
-    src = gstDecoder::Create();
+    // usage: gstDecoder [--batch=N] [--publish=name] [--mosaic] [--threads[=N]] [--taskpool[=N]] [--placement=spread|pack|none] [uri ...], defaults to a single camera
+    StreamManager::Options options;
+    std::vector<std::string> uris;
+    std::string publishName;
+    uint32_t batchSize = 0;
+    bool mosaicPreview = false;
+    gstThreadBudget* threadBudget = NULL;
+    gstTaskPool* taskPool = NULL;
+
+    for( int n=1; n < argc; n++ )
+    {
+        if( strncmp(argv[n], "--batch=", 8) == 0 )
+        {
+            batchSize = atoi(argv[n] + 8);
+            options.batching = batchSize > 0;
+        }
+        else if( strncmp(argv[n], "--publish=", 10) == 0 )
+        {
+            publishName = argv[n] + 10;
+        }
+        else if( strcmp(argv[n], "--mosaic") == 0 )
+        {
+            mosaicPreview = true;
+        }
+        else if( strncmp(argv[n], "--threads", 9) == 0 )
+        {
+            // divide N threads (or the CPUs) between the decoders and converters of the streams
+            if( !threadBudget )
+                threadBudget = gstThreadBudget::Create(argv[n][9] == '=' ? atoi(argv[n] + 10) : 0);
+        }
+        else if( strncmp(argv[n], "--taskpool", 10) == 0 )
+        {
+            // run the streaming threads of every stream in one pool, admitting streams for at most N threads
+            if( !taskPool )
+                taskPool = gstTaskPool::Create(argv[n][10] == '=' ? atoi(argv[n] + 11) : 0);
+        }
+        else if( strncmp(argv[n], "--placement=", 12) == 0 )
+        {
+            // keep each stream's threads and its consumer on one NUMA node
+            const char* policy = argv[n] + 12;
+
+            if( strcmp(policy, "spread") == 0 )
+                options.placement = PLACEMENT_SPREAD;
+            else if( strcmp(policy, "pack") == 0 )
+                options.placement = PLACEMENT_PACK;
+            else
+                options.placement = PLACEMENT_NONE;
+        }
+        else
+        {
+            uris.push_back(argv[n]);
+        }
+    }
+
+    if( uris.empty() )
+        uris.push_back(gstDecoder::DefaultURI);
+
+    // every stream in one window, instead of a window per stream
+    gstMosaic* mosaic = mosaicPreview ? gstMosaic::Create("mosaic", (uint32_t)uris.size()) : NULL;
+
+    if( mosaic != NULL )
+        mosaic->Start();
+
+    options.decoder.threadBudget = threadBudget;
+    options.decoder.taskPool     = taskPool;
+
+    StreamManager *manager = StreamManager::Create(options);
+
+    // each stream is published to its own ring, <name>-<stream> (read them with gstShmReader)
+    for( size_t n=0; n < uris.size(); n++ )
+    {
+        gstDecoder::Options decoderOptions = options.decoder;
+
+        decoderOptions.uri = uris[n];
+
+        if( !publishName.empty() )
+            decoderOptions.publishName = publishName + "-" + std::to_string(n);
+
+        decoderOptions.mosaic     = mosaic;
+        decoderOptions.mosaicTile = (uint32_t)n;
 
-    src->Open();
-    while( 1 )
+        manager->AddStream(decoderOptions);
+    }
+
+    if( manager->GetNumStreams() == 0 || !manager->Start() )
     {
-        
-    // 	uchar3* image = NULL;
-    // 	int status = 0;
-    // 	src->Capture(&image, &status);
+        delete manager;
+        delete mosaic;
+        delete threadBudget;
+        delete taskPool;
+        return -1;
     }
-}
\ No newline at end of file
+
+    signal(SIGINT, sig_handler);
+
+    // gather the frames in batches of 640x640 inference inputs, waiting at most a frame interval
+    FrameBatch* batch = options.batching ? FrameBatch::Create(batchSize, 640, 640) : NULL;
+    gint64 lastStats = g_get_monotonic_time();
+
+    while( !signal_recieved && !manager->IsFinished() )
+    {
+        if( batch != NULL )
+            manager->CaptureBatch(batch, 33);
+        else
+            g_usleep(G_USEC_PER_SEC);
+
+        if( g_get_monotonic_time() - lastStats >= G_USEC_PER_SEC )
+        {
+            manager->PrintStats();
+            lastStats = g_get_monotonic_time();
+        }
+    }
+
+    manager->Stop();
+
+    const StreamManager::StreamStats total = manager->GetTotalStats();
+
+    printf("gstDecoder -- %llu frames from %u streams, %llu dropped\n", (unsigned long long)total.frames,
+           manager->GetNumStreams(), (unsigned long long)total.dropped);
+    printf("gstDecoder -- slowest time to first frame %.1f ms\n", total.timeToFirstFrame);
+    delete batch;
+    delete manager;
+    delete mosaic;
+    delete threadBudget;
+    delete taskPool;
+    return 0;
+}
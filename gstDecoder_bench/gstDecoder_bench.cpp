@@ -0,0 +1,423 @@
+/*
+ * Decode throughput of the gstDecoder ingest path.
+ *
+ * The test content is encoded locally with videotestsrc ! x264enc (720p,
+ * 1080p and 4K), so every machine measures the same streams without
+ * downloading anything.  The files are kept in the content directory and
+ * reused by the next runs.  Each stream is then decoded as fast as possible
+ * (sync=false, and the frame queue blocks instead of dropping) and
+ * consumed with Capture(), like the applications do.
+ *
+ * Results are printed as JSON on stdout (the log goes to stdout too, the
+ * JSON is the last thing printed), or written to --json=<file>:
+ *
+ *   frames/sec, CPU time per frame, and the p50/p99 time each frame takes
+ *   from entering the decoder to reaching the appsink (measured per frame
+ *   by gstLatencyTracer, with its ~19% histogram resolution).
+ *
+ * With a multithreaded decoder, the time between frames is 1/throughput and
+ * says nothing about how long each frame takes, which is why the latency is
+ * measured on the frames themselves.
+ *
+ * --latency also prints the time spent in each element (see gstLatencyTracer).
+ *
+ * --throughput=<file> instead decodes the 1080p stream with every H.264
+ * decoder available, and writes their frames per second to the file read by
+ * gstPipelineBuilder::LoadThroughput(), so the pipeline builder picks the
+ * decoder that is actually the fastest on this machine.  Write it to
+ * gstPipelineBuilder::DefaultThroughputFile in the applications' working
+ * directory to have it loaded automatically.
+ *
+ *   gstDecoder_bench [--frames=300] [--decoder=avdec_h264] [--bgr] [--latency]
+ *                    [--dir=<content directory>] [--json=<output file>]
+ *                    [--throughput=<file>]
+ */
+#include "gstDecoder.h"
+#include "gstPipelineBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+struct benchStream
+{
+	const char* name;
+	uint32_t    width;
+	uint32_t    height;
+	uint32_t    bitrate;	// kbit/s
+};
+
+static const benchStream gStreams[] =
+{
+	{ "720p",  1280, 720,  4000  },
+	{ "1080p", 1920, 1080, 8000  },
+	{ "4k",    3840, 2160, 25000 },
+};
+
+struct benchResult
+{
+	std::string name;
+	uint32_t width;
+	uint32_t height;
+	uint64_t frames;
+	uint64_t dropped;
+	double   seconds;
+	double   fps;
+	double   cpuPerFrame;	// ms
+	double   p50;		// ms from the decoder to the appsink
+	double   p99;		// ms
+	float    timeToFirstFrame;
+	bool     ok;
+};
+
+
+// process CPU time (user + system) in seconds, summed over all threads
+static double cpuTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+
+	if( !GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user) )
+		return 0.0;
+
+	const uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	const uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+
+	return (k + u) * 1e-7;
+#else
+	struct rusage usage;
+
+	if( getrusage(RUSAGE_SELF, &usage) != 0 )
+		return 0.0;
+
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+
+// encode the test content, unless a previous run already did
+static bool encodeStream( const benchStream& stream, uint32_t frames, const std::string& path )
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if( file != NULL )
+	{
+		fclose(file);
+		return true;
+	}
+
+	// a moving pattern, so the P-frames aren't empty, and a fixed GOP
+	char launch[1024];
+
+	snprintf(launch, sizeof(launch),
+		"videotestsrc num-buffers=%u pattern=smpte horizontal-speed=4 ! "
+		"video/x-raw,format=I420,width=%u,height=%u,framerate=30/1 ! "
+		"x264enc bitrate=%u speed-preset=medium key-int-max=60 bframes=0 ! "
+		"h264parse ! mp4mux ! filesink location=\"%s\"",
+		frames, stream.width, stream.height, stream.bitrate, path.c_str());
+
+	printf("gstDecoder_bench -- encoding %s test content (%u frames)\n", stream.name, frames);
+
+	GError* err = NULL;
+	GstElement* pipeline = gst_parse_launch(launch, &err);
+
+	if( err != NULL )
+	{
+		printf("gstDecoder_bench -- failed to create encoder pipeline\n");
+		printf("   (%s)\n", err->message);
+		g_error_free(err);
+
+		if( pipeline != NULL )
+			gst_object_unref(pipeline);
+
+		return false;
+	}
+
+	GstBus* bus = gst_element_get_bus(pipeline);
+	gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+	GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+	const bool ok = (msg != NULL && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS);
+
+	if( !ok )
+	{
+		printf("gstDecoder_bench -- failed to encode %s\n", path.c_str());
+		remove(path.c_str());
+	}
+
+	if( msg != NULL )
+		gst_message_unref(msg);
+
+	gst_element_set_state(pipeline, GST_STATE_NULL);
+	gst_object_unref(bus);
+	gst_object_unref(pipeline);
+
+	return ok;
+}
+
+
+// decode a stream through gstDecoder as fast as it goes
+static benchResult decodeStream( const benchStream& stream, const std::string& path, const std::string& decoder, bool bgr, bool latency )
+{
+	benchResult result;
+
+	result.name    = stream.name;
+	result.width   = stream.width;
+	result.height  = stream.height;
+	result.frames  = 0;
+	result.dropped = 0;
+	result.seconds = 0.0;
+	result.fps     = 0.0;
+	result.cpuPerFrame = 0.0;
+	result.p50 = 0.0;
+	result.p99 = 0.0;
+	result.timeToFirstFrame = -1.0f;
+	result.ok  = false;
+
+	gstDecoder::Options options;
+
+	options.uri          = path;
+	options.decoder      = decoder;
+	options.preview      = false;
+	options.queuePolicy  = RINGBUFFER_BLOCK;	// offline, every frame counts
+	options.queueTimeout = UINT64_MAX;
+	options.pipelineQueueLeaky = QUEUE_LEAKY_NONE;	// and nothing upstream drops either
+	options.sinkMaxBuffers     = 0;
+	options.sinkDrop           = false;
+	options.traceLatency = true;	// for the decode time of each frame
+
+	gstDecoder* dec = gstDecoder::Create(options);
+
+	if( !dec )
+		return result;
+
+	std::chrono::steady_clock::time_point lastArrival;
+	std::chrono::steady_clock::time_point begin;
+
+	gstFrame::Ptr frame;
+	cv::Mat image;
+	int status = 0;
+
+	const double cpuBegin = cpuTime();
+
+	if( !dec->Open() )
+	{
+		delete dec;
+		return result;
+	}
+
+	while( true )
+	{
+		const bool captured = bgr ? dec->Capture(image, &status) : dec->Capture(frame, &status);
+
+		if( !captured )
+		{
+			if( status == gstDecoder::TIMEOUT )
+				continue;
+
+			break;
+		}
+
+		// Capture(cv::Mat&) doesn't return the handle, time the arrival here instead
+		const std::chrono::steady_clock::time_point arrival = bgr ? std::chrono::steady_clock::now() : frame->GetArrivalTime();
+
+		if( result.frames == 0 )
+			begin = arrival;
+
+		lastArrival = arrival;
+		result.frames++;
+		frame.reset();
+	}
+
+	const double cpuEnd = cpuTime();
+
+	result.ok      = (status == gstDecoder::EOS && result.frames > 0);
+	const gstDecoder::Stats stats = dec->GetStats();
+
+	result.dropped = stats.droppedUpstream + stats.droppedSink + stats.droppedQueue;
+	result.timeToFirstFrame = dec->GetTimeToFirstFrame();
+
+	gstLatencyStats decode;
+	memset(&decode, 0, sizeof(decode));
+
+	if( !dec->GetDecodeLatency(decode) || decode.count == 0 )
+		printf("gstDecoder_bench -- couldn't measure the decode time of %s\n", stream.name);
+
+	if( latency && dec->GetLatencyTracer() != NULL )
+		dec->GetLatencyTracer()->Print();
+
+	dec->Close();
+	delete dec;
+
+	if( result.frames > 1 )
+	{
+		result.seconds     = std::chrono::duration<double>(lastArrival - begin).count();
+		result.fps         = (result.frames - 1) / result.seconds;
+		result.cpuPerFrame = (cpuEnd - cpuBegin) * 1000.0 / result.frames;
+		result.p50         = decode.p50;
+		result.p99         = decode.p99;
+	}
+
+	return result;
+}
+
+
+// decode a stream with every candidate decoder, and save their throughput for gstPipelineBuilder
+static int measureThroughput( const benchStream& stream, uint32_t frames, const std::string& directory, const std::string& output )
+{
+	const std::string path = directory + "/gstDecoder_bench_" + stream.name + "_" + std::to_string(frames) + ".mp4";
+
+	if( !encodeStream(stream, frames, path) )
+		return 1;
+
+	const std::vector<std::string> decoders = gstPipelineBuilder::ListDecoders(VIDEO_CODEC_H264);
+	uint32_t measured = 0;
+
+	for( size_t n=0; n < decoders.size(); n++ )
+	{
+		const benchResult result = decodeStream(stream, path, decoders[n], false, false);
+
+		// decoders that can't run here (missing hardware) aren't recorded
+		if( !result.ok )
+		{
+			printf("gstDecoder_bench -- %-16s unavailable\n", decoders[n].c_str());
+			continue;
+		}
+
+		printf("gstDecoder_bench -- %-16s %8.1f fps\n", decoders[n].c_str(), result.fps);
+
+		gstPipelineBuilder::SetThroughput(VIDEO_CODEC_H264, decoders[n], (float)result.fps);
+		measured++;
+	}
+
+	if( measured == 0 || !gstPipelineBuilder::SaveThroughput(output.c_str()) )
+		return 1;
+
+	printf("gstDecoder_bench -- wrote the throughput of %u decoders to %s\n", measured, output.c_str());
+	return 0;
+}
+
+
+// print the results as JSON
+static void writeJSON( FILE* file, const std::string& decoder, bool bgr, uint32_t frames, const std::vector<benchResult>& results )
+{
+	guint major, minor, micro, nano;
+	gst_version(&major, &minor, &micro, &nano);
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"benchmark\": \"gstDecoder\",\n");
+	fprintf(file, "  \"gstreamer\": \"%u.%u.%u\",\n", major, minor, micro);
+	fprintf(file, "  \"decoder\": \"%s\",\n", decoder.c_str());
+	fprintf(file, "  \"output\": \"%s\",\n", bgr ? "bgr" : "nv12");
+	fprintf(file, "  \"frames\": %u,\n", frames);
+	fprintf(file, "  \"results\": [\n");
+
+	for( size_t n=0; n < results.size(); n++ )
+	{
+		const benchResult& r = results[n];
+
+		fprintf(file, "    { \"name\": \"%s\", \"width\": %u, \"height\": %u, \"ok\": %s, \"frames\": %llu, \"dropped\": %llu, "
+			"\"seconds\": %.3f, \"fps\": %.2f, \"cpu_ms_per_frame\": %.3f, \"decode_p50_ms\": %.3f, \"decode_p99_ms\": %.3f, \"first_frame_ms\": %.1f }%s\n",
+			r.name.c_str(), r.width, r.height, r.ok ? "true" : "false", (unsigned long long)r.frames, (unsigned long long)r.dropped,
+			r.seconds, r.fps, r.cpuPerFrame, r.p50, r.p99, r.timeToFirstFrame, (n + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+}
+
+
+int main( int argc, char** argv )
+{
+	uint32_t frames = 300;
+	std::string decoder;
+	std::string directory = ".";
+	std::string json;
+	std::string throughput;
+	bool bgr = false;
+	bool latency = false;
+
+	for( int n=1; n < argc; n++ )
+	{
+		if( strncmp(argv[n], "--frames=", 9) == 0 )
+			frames = atoi(argv[n] + 9);
+		else if( strncmp(argv[n], "--decoder=", 10) == 0 )
+			decoder = argv[n] + 10;
+		else if( strncmp(argv[n], "--dir=", 6) == 0 )
+			directory = argv[n] + 6;
+		else if( strncmp(argv[n], "--json=", 7) == 0 )
+			json = argv[n] + 7;
+		else if( strncmp(argv[n], "--throughput=", 13) == 0 )
+			throughput = argv[n] + 13;
+		else if( strcmp(argv[n], "--bgr") == 0 )
+			bgr = true;
+		else if( strcmp(argv[n], "--latency") == 0 )
+			latency = true;
+		else
+		{
+			printf("usage: gstDecoder_bench [--frames=N] [--decoder=element] [--bgr] [--latency] [--dir=path] [--json=file] [--throughput=file]\n");
+			return -1;
+		}
+	}
+
+	gst_init(&argc, &argv);
+
+	if( !throughput.empty() )
+		return measureThroughput(gStreams[1], frames, directory, throughput);
+
+	// report the decoder the pipeline builder is going to pick
+	if( decoder.empty() )
+		decoder = gstPipelineBuilder::SelectDecoder(VIDEO_CODEC_H264);
+
+	std::vector<benchResult> results;
+	int failures = 0;
+
+	for( size_t n=0; n < sizeof(gStreams) / sizeof(benchStream); n++ )
+	{
+		const benchStream& stream = gStreams[n];
+		const std::string path = directory + "/gstDecoder_bench_" + stream.name + "_" + std::to_string(frames) + ".mp4";
+
+		if( !encodeStream(stream, frames, path) )
+		{
+			failures++;
+			continue;
+		}
+
+		const benchResult result = decodeStream(stream, path, decoder, bgr, latency);
+
+		if( !result.ok )
+			failures++;
+
+		printf("gstDecoder_bench -- %-6s %8.1f fps  %6.2f ms CPU/frame  decode p50 %6.2f ms  p99 %6.2f ms\n",
+			result.name.c_str(), result.fps, result.cpuPerFrame, result.p50, result.p99);
+
+		results.push_back(result);
+	}
+
+	FILE* file = stdout;
+
+	if( !json.empty() && (file = fopen(json.c_str(), "w")) == NULL )
+	{
+		printf("gstDecoder_bench -- failed to open %s\n", json.c_str());
+		file = stdout;
+	}
+
+	writeJSON(file, decoder, bgr, frames, results);
+
+	if( file != stdout )
+		fclose(file);
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Reads the frames a gstDecoder publishes to shared memory, from another
+ * process (see gstDecoder::Options::publishName and gstShmSubscriber).
+ *
+ *   gstDecoder --publish=cam rtsp://...     # publishes to cam-0
+ *   gstShmReader cam-0 [--show]
+ *
+ * Prints the frame rate and the number of frames skipped every second.
+ * Any number of readers can run at once, the frames are read in place.
+ * The reader waits for the ring to appear, and attaches again when the
+ * publisher restarts.
+ */
+#include "gstShmRing.h"
+#include "yuvConvert.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static volatile sig_atomic_t signal_recieved = 0;
+
+static void sig_handler( int signo )
+{
+	if( signo == SIGINT )
+		signal_recieved = 1;
+}
+
+
+int main( int argc, char** argv )
+{
+	if( argc < 2 )
+	{
+		printf("usage: gstShmReader <name> [--show]\n");
+		return -1;
+	}
+
+	const char* name = argv[1];
+	const bool show = (argc > 2 && strcmp(argv[2], "--show") == 0);
+
+	signal(SIGINT, sig_handler);
+
+	cv::Mat image;
+
+	while( !signal_recieved )
+	{
+		gstShmSubscriber* subscriber = gstShmSubscriber::Create(name);
+
+		if( !subscriber )
+		{
+			printf("gstShmReader -- waiting for %s\n", name);
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			continue;
+		}
+
+		printf("gstShmReader -- reading %s\n", name);
+
+		std::chrono::steady_clock::time_point lastStats = std::chrono::steady_clock::now();
+		uint64_t lastReceived = 0;
+
+		while( !signal_recieved )
+		{
+			gstShmSubscriber::FramePtr frame = subscriber->Acquire();
+
+			if( !frame && subscriber->IsClosed() )
+			{
+				printf("gstShmReader -- %s was closed\n", name);
+				break;
+			}
+
+			if( frame != NULL && show && strcmp(frame->format, "NV12") == 0 )
+			{
+				image.create(frame->height, frame->width, CV_8UC3);
+
+				yuvConvertNV12ToBGR(frame->planes[0], frame->stride[0], frame->planes[1], frame->stride[1],
+								image.data, (uint32_t)image.step, frame->width, frame->height);
+
+				frame.reset();	// release the slot before the window is drawn
+
+				cv::imshow(name, image);
+				cv::waitKey(1);
+			}
+
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			const double seconds = std::chrono::duration<double>(now - lastStats).count();
+
+			if( seconds >= 1.0 )
+			{
+				printf("gstShmReader -- %s  %5.1f fps  %8llu frames  %6llu skipped\n", name,
+					(subscriber->GetReceived() - lastReceived) / seconds,
+					(unsigned long long)subscriber->GetReceived(), (unsigned long long)subscriber->GetSkipped());
+
+				lastReceived = subscriber->GetReceived();
+				lastStats = now;
+			}
+		}
+
+		delete subscriber;
+	}
+
+	if( show )
+		cv::destroyAllWindows();
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "FrameBatch.h"
+
+#include <algorithm>
+
+#include <string.h>
+#include <stdio.h>
+
+
+// constructor
+FrameBatch::FrameBatch( uint32_t capacity, uint32_t width, uint32_t height, yuvInterpolation interp )
+{
+	mCapacity = capacity;
+	mSize     = 0;
+	mWidth    = width;
+	mHeight   = height;
+	mWaitTime = 0.0f;
+	mInterpolation = interp;
+
+	// the frames are stacked vertically, so the whole batch is one continuous image
+	mData.create(capacity * height, width, CV_8UC3);
+	mEntries.resize(capacity);
+
+	for( uint32_t n=0; n < capacity; n++ )
+	{
+		mEntries[n].stream    = 0;
+		mEntries[n].timestamp = GST_CLOCK_TIME_NONE;
+	}
+}
+
+
+// Create
+FrameBatch* FrameBatch::Create( uint32_t capacity, uint32_t width, uint32_t height, yuvInterpolation interp )
+{
+	if( capacity == 0 || width == 0 || height == 0 )
+	{
+		printf("FrameBatch -- invalid batch of %u frames of %ux%u\n", capacity, width, height);
+		return NULL;
+	}
+
+	return new FrameBatch(capacity, width, height, interp);
+}
+
+
+// Resize
+void FrameBatch::Resize( uint32_t frames )
+{
+	mSize = std::min(frames, mCapacity);
+}
+
+
+// Set
+bool FrameBatch::Set( uint32_t index, uint32_t stream, const gstFrame::Ptr& frame )
+{
+	if( index >= mCapacity || !frame )
+		return false;
+
+	Entry& entry = mEntries[index];
+
+	entry.stream    = stream;
+	entry.timestamp = frame->GetTimestamp();
+	entry.arrival   = frame->GetArrivalTime();
+
+	uint8_t* output = mData.data + index * GetFrameSize();
+
+	if( !frame->ToBGR(output, mWidth * 3, mWidth, mHeight, mInterpolation) )
+	{
+		memset(output, 0, GetFrameSize());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,136 @@
+#ifndef __FRAME_BATCH_H__
+#define __FRAME_BATCH_H__
+
+#include "gstFrame.h"
+
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Batch of BGR frames for batched inference.
+ *
+ * The frames are stored back to back in one contiguous buffer, allocated
+ * once by Create(), in NHWC order: frame n starts GetFrameSize() * n bytes
+ * into GetData(), and each row is packed (width * 3 bytes).  Frames are
+ * converted and resized straight into their slot, so filling a batch
+ * doesn't allocate or copy anything else.
+ *
+ * Each frame records the stream it came from and its PTS, so the results
+ * can be routed back.  The batch is filled by StreamManager::CaptureBatch().
+ */
+class FrameBatch
+{
+public:
+	/**
+	 * Create a batch.
+	 * @param capacity maximum number of frames
+	 * @param width    width every frame is resized to
+	 * @param height   height every frame is resized to
+	 * @param interp   resampling filter
+	 */
+	static FrameBatch* Create( uint32_t capacity, uint32_t width, uint32_t height, yuvInterpolation interp=YUV_INTERP_BILINEAR );
+
+	/**
+	 * Set the number of frames in the batch (at most the capacity).
+	 */
+	void Resize( uint32_t frames );
+
+	/**
+	 * Convert a frame into slot `index`, and record where it came from.
+	 * Different slots can be set from different threads at once.
+	 * @returns `false` if the frame's format isn't supported, the slot is then zeroed.
+	 */
+	bool Set( uint32_t index, uint32_t stream, const gstFrame::Ptr& frame );
+
+	/**
+	 * Number of frames in the batch.
+	 */
+	inline uint32_t GetSize() const			{ return mSize; }
+
+	/**
+	 * Maximum number of frames.
+	 */
+	inline uint32_t GetCapacity() const		{ return mCapacity; }
+
+	/**
+	 * Width of the frames.
+	 */
+	inline uint32_t GetWidth() const			{ return mWidth; }
+
+	/**
+	 * Height of the frames.
+	 */
+	inline uint32_t GetHeight() const			{ return mHeight; }
+
+	/**
+	 * Size of one frame in bytes.
+	 */
+	inline size_t GetFrameSize() const		{ return (size_t)mWidth * mHeight * 3; }
+
+	/**
+	 * The contiguous buffer holding every frame (GetCapacity() * GetFrameSize() bytes).
+	 */
+	inline uint8_t* GetData() const			{ return mData.data; }
+
+	/**
+	 * Frame `index` as an image sharing the batch's memory.
+	 */
+	inline cv::Mat GetFrame( uint32_t index ) const	{ return mData.rowRange(index * mHeight, (index + 1) * mHeight); }
+
+	/**
+	 * Id of the stream frame `index` came from.
+	 */
+	inline uint32_t GetStream( uint32_t index ) const	{ return mEntries[index].stream; }
+
+	/**
+	 * Presentation timestamp of frame `index` (in nanoseconds), or GST_CLOCK_TIME_NONE.
+	 */
+	inline GstClockTime GetTimestamp( uint32_t index ) const	{ return mEntries[index].timestamp; }
+
+	/**
+	 * Time frame `index` was received from its decoder.
+	 */
+	inline std::chrono::steady_clock::time_point GetArrivalTime( uint32_t index ) const	{ return mEntries[index].arrival; }
+
+	/**
+	 * Fraction of the capacity that was filled (0 to 1).
+	 */
+	inline float GetFillRatio() const			{ return mCapacity > 0 ? (float)mSize / mCapacity : 0.0f; }
+
+	/**
+	 * Time in milliseconds spent waiting for the frames of the batch.
+	 */
+	inline float GetWaitTime() const			{ return mWaitTime; }
+
+	/**
+	 * Set the time spent waiting for the frames of the batch.
+	 */
+	inline void SetWaitTime( float ms )		{ mWaitTime = ms; }
+
+private:
+	FrameBatch( uint32_t capacity, uint32_t width, uint32_t height, yuvInterpolation interp );
+
+	struct Entry
+	{
+		uint32_t     stream;
+		GstClockTime timestamp;
+		std::chrono::steady_clock::time_point arrival;
+	};
+
+	cv::Mat mData;
+	std::vector<Entry> mEntries;
+
+	uint32_t mCapacity;
+	uint32_t mSize;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	float    mWaitTime;
+
+	yuvInterpolation mInterpolation;
+};
+
+#endif
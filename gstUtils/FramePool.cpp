@@ -0,0 +1,300 @@
+#include "FramePool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <stdio.h>
+
+
+// smallest size class in bytes
+#define FRAMEPOOL_MIN_CLASS 4096
+
+
+// round a size up to its class, a multiple of a quarter of its power of two
+static size_t sizeClass( size_t bytes )
+{
+	if( bytes <= FRAMEPOOL_MIN_CLASS )
+		return FRAMEPOOL_MIN_CLASS;
+
+	size_t base = FRAMEPOOL_MIN_CLASS;
+
+	while( base * 2 <= bytes )
+		base *= 2;
+
+	const size_t quarter = base / 4;
+	return (bytes + quarter - 1) / quarter * quarter;
+}
+
+
+// shared with the images, which may outlive the pool
+struct FramePool::State
+{
+	std::map<size_t, std::vector<void*> > free;
+
+	uint64_t limit;
+	uint64_t timeout;
+	FramePoolPolicy policy;
+
+	uint64_t allocated;
+	uint64_t inUse;
+	uint64_t peak;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t dropped;
+	bool     closed;
+
+	mutable std::mutex mutex;
+	std::condition_variable released;
+
+	State() : limit(0), timeout(0), policy(FRAMEPOOL_DROP), allocated(0), inUse(0), peak(0), hits(0), misses(0), dropped(0), closed(false)	{}
+
+	// free cached blocks of other sizes until `size` more bytes fit under the limit
+	void evict( size_t size, std::vector<void*>& evicted )
+	{
+		for( std::map<size_t, std::vector<void*> >::iterator n=free.begin(); n != free.end() && allocated + size > limit; n++ )
+		{
+			while( !n->second.empty() && allocated + size > limit )
+			{
+				evicted.push_back(n->second.back());
+				n->second.pop_back();
+				allocated -= n->first;
+			}
+		}
+	}
+
+	// a cached block, or a newly allocated one, or NULL if over the limit
+	void* acquire( size_t size )
+	{
+		std::vector<void*> evicted;
+		void* block = NULL;
+		bool reserved = false;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+			while( true )
+			{
+				std::vector<void*>& list = free[size];
+
+				if( !list.empty() )
+				{
+					block = list.back();
+					list.pop_back();
+					inUse += size;
+					hits++;
+					break;
+				}
+
+				if( limit != 0 && allocated + size > limit )
+					evict(size, evicted);
+
+				if( limit == 0 || allocated + size <= limit )
+				{
+					// reserve the memory, it's allocated outside the lock
+					allocated += size;
+					inUse += size;
+					misses++;
+					reserved = true;
+
+					if( allocated > peak )
+						peak = allocated;
+
+					break;
+				}
+
+				if( policy == FRAMEPOOL_DROP || timeout == 0 || released.wait_until(lock, deadline) == std::cv_status::timeout )
+				{
+					dropped++;
+					break;
+				}
+			}
+		}
+
+		for( size_t n=0; n < evicted.size(); n++ )
+			cv::fastFree(evicted[n]);
+
+		if( !reserved )
+			return block;
+
+		try
+		{
+			block = cv::fastMalloc(size);
+		}
+		catch( const cv::Exception& )
+		{
+			printf("FramePool -- failed to allocate %zu bytes\n", size);
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			allocated -= size;
+			inUse -= size;
+			dropped++;
+			block = NULL;
+		}
+
+		return block;
+	}
+
+	// cache a block for the next acquire(), or free it if the pool is gone
+	void release( void* block, size_t size )
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			inUse -= size;
+
+			if( !closed )
+			{
+				free[size].push_back(block);
+				released.notify_one();
+				return;
+			}
+
+			allocated -= size;
+		}
+
+		cv::fastFree(block);
+	}
+
+	// free every cached block
+	void trim()
+	{
+		std::vector<void*> blocks;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for( std::map<size_t, std::vector<void*> >::iterator n=free.begin(); n != free.end(); n++ )
+			{
+				allocated -= n->first * n->second.size();
+				blocks.insert(blocks.end(), n->second.begin(), n->second.end());
+			}
+
+			free.clear();
+		}
+
+		for( size_t n=0; n < blocks.size(); n++ )
+			cv::fastFree(blocks[n]);
+	}
+};
+
+
+// constructor
+FramePool::FramePool( uint64_t limit, FramePoolPolicy policy, uint64_t timeout )
+{
+	mLimit  = limit;
+	mPolicy = policy;
+	mState  = std::make_shared<State>();
+
+	mState->limit   = limit;
+	mState->policy  = policy;
+	mState->timeout = timeout;
+}
+
+
+// destructor
+FramePool::~FramePool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mState->mutex);
+		mState->closed = true;
+	}
+
+	mState->trim();
+}
+
+
+// Create
+FramePool* FramePool::Create( uint64_t limit, FramePoolPolicy policy, uint64_t timeout )
+{
+	return new FramePool(limit, policy, timeout);
+}
+
+
+// Acquire
+FramePool::Image FramePool::Acquire( uint32_t width, uint32_t height, int type )
+{
+	if( width == 0 || height == 0 )
+		return Image();
+
+	const size_t step = ((size_t)width * CV_ELEM_SIZE(type) + RowAlignment - 1) / RowAlignment * RowAlignment;
+	const size_t size = sizeClass(step * height);
+
+	if( mLimit != 0 && size > mLimit )
+	{
+		printf("FramePool -- %ux%u image exceeds the %llu byte memory limit\n", width, height, (unsigned long long)mLimit);
+		return Image();
+	}
+
+	void* block = mState->acquire(size);
+
+	if( !block )
+		return Image();
+
+	std::shared_ptr<State> state = mState;
+
+	return Image(new cv::Mat(height, width, type, block, step), [state, block, size]( cv::Mat* image )
+	{
+		delete image;
+		state->release(block, size);
+	});
+}
+
+
+// Trim
+void FramePool::Trim()
+{
+	mState->trim();
+}
+
+
+// GetAllocated
+uint64_t FramePool::GetAllocated() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->allocated;
+}
+
+
+// GetInUse
+uint64_t FramePool::GetInUse() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->inUse;
+}
+
+
+// GetPeak
+uint64_t FramePool::GetPeak() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->peak;
+}
+
+
+// GetHits
+uint64_t FramePool::GetHits() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->hits;
+}
+
+
+// GetMisses
+uint64_t FramePool::GetMisses() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->misses;
+}
+
+
+// GetDropped
+uint64_t FramePool::GetDropped() const
+{
+	std::lock_guard<std::mutex> lock(mState->mutex);
+	return mState->dropped;
+}
@@ -0,0 +1,127 @@
+#ifndef __FRAME_POOL_H__
+#define __FRAME_POOL_H__
+
+#include <opencv2/core.hpp>
+
+#include <memory>
+#include <stdint.h>
+
+
+/**
+ * What FramePool::Acquire() does when the memory limit is reached.
+ */
+enum FramePoolPolicy
+{
+	FRAMEPOOL_DROP  = 0,	/**< fail right away, the caller drops the frame */
+	FRAMEPOOL_BLOCK = 1	/**< wait for an image to be released, up to the pool's timeout */
+};
+
+
+/**
+ * Recycles the memory of converted images, so streaming many cameras
+ * doesn't allocate and free several megabytes per frame.
+ *
+ * Images are handed out as shared pointers, and their memory goes back to
+ * the pool when the last reference is released (from any thread, even after
+ * the pool was deleted).  Requests are rounded up to size classes of a
+ * quarter of a power of two (at most 25% wasted), so images of slightly
+ * different sizes share blocks, and each class keeps its own free list.
+ *
+ * With a memory limit, the blocks in use and the cached free blocks never
+ * exceed it: cached blocks of other sizes are freed first, then Acquire()
+ * drops or blocks as configured, and every dropped request is counted.
+ */
+class FramePool
+{
+public:
+	/**
+	 * Pooled image, returned to the pool once released.
+	 */
+	typedef std::shared_ptr<cv::Mat> Image;
+
+	/**
+	 * Create a pool.
+	 * @param limit   maximum bytes allocated (in use + cached), 0 for no limit
+	 * @param policy  what Acquire() does when the limit is reached
+	 * @param timeout maximum time in milliseconds Acquire() blocks under FRAMEPOOL_BLOCK
+	 */
+	static FramePool* Create( uint64_t limit=0, FramePoolPolicy policy=FRAMEPOOL_DROP, uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Free the cached memory.  Images still in use are freed when released.
+	 */
+	~FramePool();
+
+	/**
+	 * Acquire an image.  The contents are undefined.
+	 * @returns the image, or an empty pointer if the memory limit was reached.
+	 */
+	Image Acquire( uint32_t width, uint32_t height, int type );
+
+	/**
+	 * Free all the cached blocks.
+	 */
+	void Trim();
+
+	/**
+	 * Bytes allocated (in use + cached).
+	 */
+	uint64_t GetAllocated() const;
+
+	/**
+	 * Bytes held by images in use.
+	 */
+	uint64_t GetInUse() const;
+
+	/**
+	 * Highest number of bytes allocated at once.
+	 */
+	uint64_t GetPeak() const;
+
+	/**
+	 * Acquire() calls served from the free lists.
+	 */
+	uint64_t GetHits() const;
+
+	/**
+	 * Acquire() calls that had to allocate.
+	 */
+	uint64_t GetMisses() const;
+
+	/**
+	 * Acquire() calls that failed because of the memory limit.
+	 */
+	uint64_t GetDropped() const;
+
+	/**
+	 * Memory limit in bytes (0 if unlimited).
+	 */
+	inline uint64_t GetLimit() const			{ return mLimit; }
+
+	/**
+	 * Policy applied when the limit is reached.
+	 */
+	inline FramePoolPolicy GetPolicy() const		{ return mPolicy; }
+
+	/**
+	 * Default Acquire() timeout under FRAMEPOOL_BLOCK, in milliseconds.
+	 */
+	static const uint64_t DefaultTimeout = 1000;
+
+	/**
+	 * Row alignment of the images, in bytes.
+	 */
+	static const uint32_t RowAlignment = 64;
+
+private:
+	FramePool( uint64_t limit, FramePoolPolicy policy, uint64_t timeout );
+
+	struct State;
+
+	std::shared_ptr<State> mState;
+
+	uint64_t        mLimit;
+	FramePoolPolicy mPolicy;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef __MAILBOX_H__
+#define __MAILBOX_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+#include <stdint.h>
+
+
+/**
+ * Single-slot "latest wins" mailbox between a producer and one consumer.
+ *
+ * Post() never blocks: if the consumer hasn't picked up the previous item
+ * yet, it is replaced by the new one and counted in GetSkipped().  This
+ * lets a slow consumer (e.g. a preview window) run at its own pace without
+ * ever stalling the producer, while always seeing the most recent item.
+ *
+ * Timeouts are in milliseconds.  0 returns immediately and UINT64_MAX
+ * waits indefinetly.
+ */
+template<typename T>
+class Mailbox
+{
+public:
+	/**
+	 * Create an empty mailbox.
+	 */
+	Mailbox() : mFull(false), mShutdown(false), mSkipped(0)	{}
+
+	/**
+	 * Deposit an item, replacing any item that wasn't picked up yet.
+	 * @returns `true` if the slot was empty, `false` if an unread item was
+	 *          skipped (or the mailbox is shut down).
+	 */
+	bool Post( T item )
+	{
+		T skipped;
+		bool empty = true;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if( mShutdown )
+				return false;
+
+			if( mFull )
+			{
+				skipped = std::move(mItem);
+				empty = false;
+				mSkipped++;
+			}
+
+			mItem = std::move(item);
+			mFull = true;
+			mCond.notify_one();
+		}
+
+		// the replaced item is released outside of the lock
+		return empty;
+	}
+
+	/**
+	 * Take the item, waiting up to `timeout` for one to be posted.
+	 * @returns `true` if an item was retrieved, `false` on timeout or shutdown.
+	 */
+	bool Wait( T& item, uint64_t timeout=UINT64_MAX )
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		const auto ready = [this]() { return mFull || mShutdown; };
+
+		if( timeout == UINT64_MAX )
+			mCond.wait(lock, ready);
+		else if( timeout > 0 )
+			mCond.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+
+		if( !mFull || mShutdown )
+			return false;
+
+		item = std::move(mItem);
+		mItem = T();
+		mFull = false;
+		return true;
+	}
+
+	/**
+	 * Wake the consumer and stop accepting new items.
+	 */
+	void Shutdown()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown = true;
+		mCond.notify_all();
+	}
+
+	/**
+	 * Accept new items again after Shutdown().
+	 */
+	void Restart()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown = false;
+	}
+
+	/**
+	 * Discard the pending item, if any (does not count as skipped).
+	 */
+	void Clear()
+	{
+		T item;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		item = std::move(mItem);
+		mItem = T();
+		mFull = false;
+	}
+
+	/**
+	 * Total number of items replaced before the consumer picked them up.
+	 */
+	inline uint64_t GetSkipped() const			{ return mSkipped.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns true if Shutdown() was called.
+	 */
+	inline bool IsShutdown() const			{ std::lock_guard<std::mutex> lock(mMutex); return mShutdown; }
+
+private:
+	T    mItem;
+	bool mFull;
+	bool mShutdown;
+
+	std::atomic<uint64_t> mSkipped;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mCond;
+};
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include <stdint.h>
+
+
+/**
+ * What RingBuffer::Push() does when the buffer is full.
+ */
+enum RingBufferPolicy
+{
+	RINGBUFFER_DROP_OLDEST = 0,	/**< discard the oldest queued item to make room (never blocks) */
+	RINGBUFFER_BLOCK       = 1	/**< wait for the consumer to free a slot, up to the push timeout */
+};
+
+
+/**
+ * Bounded lock-free queue used to hand items from a GStreamer streaming
+ * thread to the application's capture thread.
+ *
+ * Push() and Pop() never take a lock on the fast path.  Each cell carries
+ * a sequence number (D. Vyukov's bounded queue), which keeps the queue
+ * correct when the producer itself pops the oldest item to make room
+ * under RINGBUFFER_DROP_OLDEST.  The mutex and condition variables are
+ * only touched when a thread actually has to sleep.
+ *
+ * Timeouts are in milliseconds.  0 returns immediately and UINT64_MAX
+ * waits indefinetly.
+ */
+template<typename T>
+class RingBuffer
+{
+public:
+	/**
+	 * Create a queue holding at least `capacity` items.
+	 * The capacity is rounded up to the next power of two (minimum 2).
+	 */
+	RingBuffer( uint32_t capacity, RingBufferPolicy policy=RINGBUFFER_DROP_OLDEST )
+	{
+		uint32_t size = 2;
+
+		while( size < capacity )
+			size <<= 1;
+
+		mMask   = size - 1;
+		mPolicy = policy;
+		mCells.reset(new Cell[size]);
+
+		for( uint32_t n=0; n < size; n++ )
+			mCells[n].seq.store(n, std::memory_order_relaxed);
+
+		mHead = 0;
+		mTail = 0;
+		mDropped = 0;
+		mShutdown = false;
+		mConsumersWaiting = 0;
+		mProducersWaiting = 0;
+	}
+
+	/**
+	 * Enqueue an item (producer side).
+	 *
+	 * When the queue is full, RINGBUFFER_DROP_OLDEST discards the oldest item,
+	 * and RINGBUFFER_BLOCK waits up to `timeout` for the consumer.  If the wait
+	 * times out or the queue is shut down, the new item is dropped instead.
+	 * Either kind of drop is counted in GetDropped().
+	 *
+	 * @returns `true` if the item was queued, `false` if it was dropped.
+	 */
+	bool Push( T item, uint64_t timeout=UINT64_MAX )
+	{
+		if( mShutdown.load(std::memory_order_acquire) )
+		{
+			mDropped++;
+			return false;
+		}
+
+		bool queued = tryPush(item);
+
+		if( !queued && mPolicy == RINGBUFFER_DROP_OLDEST )
+		{
+			while( !queued )
+			{
+				T oldest;
+
+				if( tryPop(oldest) )
+					mDropped++;
+
+				queued = tryPush(item);
+			}
+		}
+		else if( !queued && timeout > 0 )
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mProducersWaiting++;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			wait(mNotFull, lock, timeout, [&]() {
+				queued = tryPush(item);
+				return queued || mShutdown.load(std::memory_order_acquire);
+			});
+
+			mProducersWaiting--;
+		}
+
+		if( !queued )
+		{
+			mDropped++;
+			return false;
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if( mConsumersWaiting.load(std::memory_order_relaxed) > 0 )
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mNotEmpty.notify_one();
+		}
+
+		return true;
+	}
+
+	/**
+	 * Dequeue the oldest item (consumer side), waiting up to `timeout`.
+	 * Items still queued after Shutdown() can be drained, after which
+	 * Pop() returns `false` immediately instead of waiting.
+	 *
+	 * @returns `true` if an item was retrieved, `false` on timeout or shutdown.
+	 */
+	bool Pop( T& item, uint64_t timeout=UINT64_MAX )
+	{
+		bool popped = tryPop(item);
+
+		if( !popped && timeout > 0 && !mShutdown.load(std::memory_order_acquire) )
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mConsumersWaiting++;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			wait(mNotEmpty, lock, timeout, [&]() {
+				popped = tryPop(item);
+				return popped || mShutdown.load(std::memory_order_acquire);
+			});
+
+			mConsumersWaiting--;
+		}
+
+		if( !popped )
+			return false;
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if( mProducersWaiting.load(std::memory_order_relaxed) > 0 )
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mNotFull.notify_one();
+		}
+
+		return true;
+	}
+
+	/**
+	 * Wake all waiting threads and stop accepting new items.
+	 * Used to signal EOS, errors, or that the stream was closed.
+	 */
+	void Shutdown()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown.store(true, std::memory_order_release);
+		mNotEmpty.notify_all();
+		mNotFull.notify_all();
+	}
+
+	/**
+	 * Accept new items again after Shutdown().
+	 */
+	void Restart()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown.store(false, std::memory_order_release);
+	}
+
+	/**
+	 * Discard all queued items (does not count as drops).
+	 */
+	void Clear()
+	{
+		T item;
+		while( tryPop(item) );
+	}
+
+	/**
+	 * Set the overflow policy.  Only call this while the producer is idle.
+	 */
+	inline void SetPolicy( RingBufferPolicy policy )	{ mPolicy = policy; }
+
+	/**
+	 * Get the overflow policy.
+	 */
+	inline RingBufferPolicy GetPolicy() const		{ return mPolicy; }
+
+	/**
+	 * Maximum number of items the queue can hold.
+	 */
+	inline uint32_t GetCapacity() const			{ return mMask + 1; }
+
+	/**
+	 * Approximate number of items currently queued.
+	 */
+	inline uint32_t GetSize() const				{ return (uint32_t)(mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_relaxed)); }
+
+	/**
+	 * Total number of items dropped because the queue was full.
+	 */
+	inline uint64_t GetDropped() const			{ return mDropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns true if Shutdown() was called.
+	 */
+	inline bool IsShutdown() const			{ return mShutdown.load(std::memory_order_acquire); }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	bool tryPush( T& item )
+	{
+		size_t pos = mHead.load(std::memory_order_relaxed);
+		Cell* cell = NULL;
+
+		for(;;)
+		{
+			cell = &mCells[pos & mMask];
+			const intptr_t diff = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+
+			if( diff == 0 )
+			{
+				if( mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+					break;
+			}
+			else if( diff < 0 )
+			{
+				return false;	// full
+			}
+			else
+			{
+				pos = mHead.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = std::move(item);
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop( T& item )
+	{
+		size_t pos = mTail.load(std::memory_order_relaxed);
+		Cell* cell = NULL;
+
+		for(;;)
+		{
+			cell = &mCells[pos & mMask];
+			const intptr_t diff = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+
+			if( diff == 0 )
+			{
+				if( mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+					break;
+			}
+			else if( diff < 0 )
+			{
+				return false;	// empty
+			}
+			else
+			{
+				pos = mTail.load(std::memory_order_relaxed);
+			}
+		}
+
+		item = std::move(cell->data);
+		cell->seq.store(pos + mMask + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<typename Predicate>
+	bool wait( std::condition_variable& cond, std::unique_lock<std::mutex>& lock, uint64_t timeout, Predicate pred )
+	{
+		if( timeout == UINT64_MAX )
+		{
+			cond.wait(lock, pred);
+			return true;
+		}
+
+		return cond.wait_for(lock, std::chrono::milliseconds(timeout), pred);
+	}
+
+	std::unique_ptr<Cell[]> mCells;
+	size_t mMask;
+
+	std::atomic<size_t> mHead;
+	std::atomic<size_t> mTail;
+	std::atomic<uint64_t> mDropped;
+	std::atomic<bool> mShutdown;
+
+	RingBufferPolicy mPolicy;
+
+	std::mutex mMutex;
+	std::condition_variable mNotEmpty;
+	std::condition_variable mNotFull;
+	std::atomic<uint32_t> mConsumersWaiting;
+	std::atomic<uint32_t> mProducersWaiting;
+};
+
+#endif
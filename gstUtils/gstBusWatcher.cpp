@@ -0,0 +1,386 @@
+#include "gstBusWatcher.h"
+
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <system_error>
+#include <thread>
+
+#include <stdio.h>
+
+
+// number of dispatch threads the watchers are spread over
+#define BUS_DISPATCH_THREADS 4
+
+
+/*
+ * Dispatch thread shared by a fixed subset of the watchers.  It runs while at
+ * least one of them is started, and processes their messages in the order they
+ * were posted.  The watchers are dealt round-robin over BUS_DISPATCH_THREADS
+ * dispatchers, so a callback that takes a while only holds up the pipelines
+ * sharing its thread, not every pipeline in the process.
+ */
+class gstBusDispatcher
+{
+public:
+	static gstBusDispatcher& Get( uint32_t shard )
+	{
+		// never destroyed, watchers that are still running at exit would otherwise terminate()
+		static gstBusDispatcher* dispatchers = new gstBusDispatcher[BUS_DISPATCH_THREADS];
+		return dispatchers[shard % BUS_DISPATCH_THREADS];
+	}
+
+	// the dispatcher of the next watcher created
+	static uint32_t NextShard()
+	{
+		static std::atomic<uint32_t> next(0);
+		return next.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// register a watcher, starting the thread for the first one
+	bool Add( gstBusWatcher* watcher )
+	{
+		std::lock_guard<std::mutex> control(mControlMutex);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mWatchers.insert(watcher);
+
+			if( mWatchers.size() > 1 || mThread.joinable() )
+				return true;
+
+			mStop = false;
+		}
+
+		try
+		{
+			mThread = std::thread(&gstBusDispatcher::run, this);
+		}
+		catch( const std::system_error& e )
+		{
+			printf("gstBusWatcher -- failed to start dispatch thread (%s)\n", e.what());
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mWatchers.erase(watcher);
+			return false;
+		}
+
+		return true;
+	}
+
+	// unregister a watcher, dropping its pending messages and waiting for its callbacks to return
+	void Remove( gstBusWatcher* watcher )
+	{
+		std::lock_guard<std::mutex> control(mControlMutex);
+		std::deque<Message> dropped;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+
+			mWatchers.erase(watcher);
+
+			for( std::deque<Message>::iterator n=mQueue.begin(); n != mQueue.end(); )
+			{
+				if( n->watcher == watcher )
+				{
+					dropped.push_back(*n);
+					n = mQueue.erase(n);
+				}
+				else
+				{
+					n++;
+				}
+			}
+
+			mIdle.wait(lock, [&]() { return mCurrent != watcher; });
+
+			if( mWatchers.empty() )
+			{
+				mStop = true;
+				mCond.notify_all();
+			}
+		}
+
+		for( size_t n=0; n < dropped.size(); n++ )
+			gst_message_unref(dropped[n].msg);
+
+		if( mStop && mThread.joinable() )
+			mThread.join();
+	}
+
+	// queue a message (called from the thread that posted it)
+	void Post( gstBusWatcher* watcher, GstMessage* msg )
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// the sync handler can still fire for a watcher that is being removed
+		if( mWatchers.count(watcher) == 0 )
+			return;
+
+		Message item = { watcher, gst_message_ref(msg) };
+		mQueue.push_back(item);
+		mCond.notify_one();
+	}
+
+	gstBusDispatcher() : mCurrent(NULL), mStop(false)	{}
+
+private:
+	struct Message
+	{
+		gstBusWatcher* watcher;
+		GstMessage*    msg;
+	};
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		while( true )
+		{
+			mCond.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+
+			if( mQueue.empty() )
+				break;
+
+			Message item = mQueue.front();
+			mQueue.pop_front();
+			mCurrent = item.watcher;
+
+			lock.unlock();
+			item.watcher->dispatch(item.msg);
+			gst_message_unref(item.msg);
+			lock.lock();
+
+			mCurrent = NULL;
+			mIdle.notify_all();
+		}
+	}
+
+	std::deque<Message>      mQueue;
+	std::set<gstBusWatcher*> mWatchers;
+	gstBusWatcher*           mCurrent;
+	bool                     mStop;
+
+	std::thread mThread;
+	std::mutex  mMutex;
+	std::mutex  mControlMutex;
+	std::condition_variable mCond;
+	std::condition_variable mIdle;
+};
+
+
+// constructor
+gstBusWatcher::gstBusWatcher( GstElement* pipeline, const Callbacks& callbacks, void* user_data, const char* name )
+{
+	mPipeline  = pipeline;
+	mBus       = gst_element_get_bus(pipeline);
+	mCallbacks = callbacks;
+	mUserData  = user_data;
+	mName      = name != NULL ? name : "gstBusWatcher";
+	mRunning   = false;
+	mErrors    = 0;
+	mWarnings  = 0;
+	mQoS       = 0;
+	mShard     = gstBusDispatcher::NextShard();
+}
+
+
+// destructor
+gstBusWatcher::~gstBusWatcher()
+{
+	Stop();
+
+	if( mBus != NULL )
+	{
+		gst_object_unref(mBus);
+		mBus = NULL;
+	}
+}
+
+
+// Create
+gstBusWatcher* gstBusWatcher::Create( GstElement* pipeline, const Callbacks& callbacks, void* user_data, const char* name )
+{
+	if( !pipeline )
+		return NULL;
+
+	gstBusWatcher* watcher = new gstBusWatcher(pipeline, callbacks, user_data, name);
+
+	if( !watcher->mBus )
+	{
+		printf("%s -- failed to retrieve GstBus from pipeline\n", watcher->mName.c_str());
+		delete watcher;
+		return NULL;
+	}
+
+	return watcher;
+}
+
+
+// Start
+bool gstBusWatcher::Start()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( mRunning )
+		return true;
+
+	if( !gstBusDispatcher::Get(mShard).Add(this) )
+		return false;
+
+	gst_bus_set_sync_handler(mBus, onSyncMessage, this, NULL);
+
+	mRunning = true;
+	return true;
+}
+
+
+// Stop
+void gstBusWatcher::Stop()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( !mRunning )
+		return;
+
+	gst_bus_set_sync_handler(mBus, NULL, NULL, NULL);
+	gstBusDispatcher::Get(mShard).Remove(this);
+
+	mRunning = false;
+}
+
+
+// onSyncMessage
+GstBusSyncReply gstBusWatcher::onSyncMessage( GstBus* bus, GstMessage* msg, gpointer user_data )
+{
+	gstBusWatcher* watcher = (gstBusWatcher*)user_data;
+
+	if( watcher->mCallbacks.sync != NULL && watcher->mCallbacks.sync(msg, watcher->mUserData) )
+		return GST_BUS_DROP;
+
+	// hand the message to the dispatch thread, and keep it off the bus's own queue
+	gstBusDispatcher::Get(watcher->mShard).Post(watcher, msg);
+	return GST_BUS_DROP;
+}
+
+
+// dispatch
+void gstBusWatcher::dispatch( GstMessage* msg )
+{
+	const char* source = GST_MESSAGE_SRC_NAME(msg);
+
+	if( !source )
+		source = "pipeline";
+
+	if( mCallbacks.filter != NULL && mCallbacks.filter(msg, mUserData) )
+		return;
+
+	switch( GST_MESSAGE_TYPE(msg) )
+	{
+		case GST_MESSAGE_ERROR:
+		{
+			GError* err = NULL;
+			gchar* debug = NULL;
+
+			gst_message_parse_error(msg, &err, &debug);
+			mErrors++;
+
+			printf("%s -- error from %s: %s\n", mName.c_str(), source, err != NULL ? err->message : "unknown");
+
+			if( debug != NULL )
+				printf("   (%s)\n", debug);
+
+			if( mCallbacks.error != NULL )
+				mCallbacks.error(source, err, debug, mUserData);
+
+			if( err != NULL )
+				g_error_free(err);
+
+			g_free(debug);
+			break;
+		}
+		case GST_MESSAGE_WARNING:
+		{
+			GError* err = NULL;
+			gchar* debug = NULL;
+
+			gst_message_parse_warning(msg, &err, &debug);
+			mWarnings++;
+
+			printf("%s -- warning from %s: %s\n", mName.c_str(), source, err != NULL ? err->message : "unknown");
+
+			if( debug != NULL )
+				printf("   (%s)\n", debug);
+
+			if( mCallbacks.warning != NULL )
+				mCallbacks.warning(source, err, debug, mUserData);
+
+			if( err != NULL )
+				g_error_free(err);
+
+			g_free(debug);
+			break;
+		}
+		case GST_MESSAGE_EOS:
+		{
+			if( mCallbacks.eos != NULL )
+				mCallbacks.eos(mUserData);
+
+			break;
+		}
+		case GST_MESSAGE_QOS:
+		{
+			gstBusQoS qos;
+			gboolean live = FALSE;
+			GstClockTime streamTime, timestamp, duration;
+			gint quality = 0;
+			GstFormat format;
+			guint64 processed = (guint64)-1;
+			guint64 dropped = (guint64)-1;
+
+			gst_message_parse_qos(msg, &live, &qos.runningTime, &streamTime, &timestamp, &duration);
+			gst_message_parse_qos_values(msg, &qos.jitter, &qos.proportion, &quality);
+			gst_message_parse_qos_stats(msg, &format, &processed, &dropped);
+
+			qos.live      = live ? true : false;
+			qos.processed = processed;
+			qos.dropped   = dropped;
+
+			mQoS++;
+
+			if( mCallbacks.qos != NULL )
+				mCallbacks.qos(source, qos, mUserData);
+
+			break;
+		}
+		case GST_MESSAGE_LATENCY:
+		{
+			if( mCallbacks.latency != NULL )
+				mCallbacks.latency(source, mUserData);
+
+			break;
+		}
+		case GST_MESSAGE_BUFFERING:
+		{
+			gint percent = 0;
+			gst_message_parse_buffering(msg, &percent);
+
+			if( mCallbacks.buffering != NULL )
+				mCallbacks.buffering(source, percent, mUserData);
+
+			break;
+		}
+		case GST_MESSAGE_STATE_CHANGED:
+		{
+			GstState oldState, newState, pending;
+			gst_message_parse_state_changed(msg, &oldState, &newState, &pending);
+
+			if( mCallbacks.stateChanged != NULL )
+				mCallbacks.stateChanged(source, oldState, newState, GST_MESSAGE_SRC(msg) == GST_OBJECT(mPipeline), mUserData);
+
+			break;
+		}
+		default:
+			break;
+	}
+}
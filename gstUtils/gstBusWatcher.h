@@ -0,0 +1,141 @@
+#ifndef __GSTREAMER_BUS_WATCHER_H__
+#define __GSTREAMER_BUS_WATCHER_H__
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+
+/**
+ * Quality-of-service report from an element (see gst_message_new_qos()).
+ */
+struct gstBusQoS
+{
+	bool         live;			/**< the element is live */
+	GstClockTime runningTime;	/**< running time of the late buffer */
+	int64_t      jitter;		/**< how late the buffer was (ns, negative if early) */
+	double       proportion;	/**< long-term processing rate, 1.0 is realtime */
+	uint64_t     processed;	/**< buffers processed so far, or -1 if unknown */
+	uint64_t     dropped;		/**< buffers dropped so far, or -1 if unknown */
+};
+
+
+/**
+ * Dispatches the messages of a pipeline's bus from a dedicated thread.
+ *
+ * A sync handler moves each message off the bus as soon as it is posted,
+ * and one of a few dispatch threads shared by every watcher in the process
+ * hands it to typed callbacks, so the streaming threads never have to drain
+ * the bus and hundreds of pipelines don't need hundreds of bus threads.
+ * Errors and warnings are always logged (with the debug details); the
+ * callbacks are all optional and run on the dispatch thread, so they should
+ * only update state or signal other threads: a slow callback delays the
+ * messages of the other pipelines sharing the thread.
+ */
+class gstBusWatcher
+{
+public:
+	/**
+	 * Message handlers, any of which may be NULL.
+	 */
+	struct Callbacks
+	{
+		void (*error)( const char* source, const GError* error, const char* debug, void* user_data );
+		void (*warning)( const char* source, const GError* error, const char* debug, void* user_data );
+		void (*eos)( void* user_data );
+		void (*qos)( const char* source, const gstBusQoS& qos, void* user_data );
+		void (*latency)( const char* source, void* user_data );
+		void (*buffering)( const char* source, int percent, void* user_data );
+		void (*stateChanged)( const char* source, GstState oldState, GstState newState, bool pipeline, void* user_data );
+
+		/**
+		 * Called first with every message.  Returns `true` if it handled the
+		 * message, which then isn't logged or passed to the other callbacks.
+		 */
+		bool (*filter)( GstMessage* msg, void* user_data );
+
+		/**
+		 * Called with every message from the thread that posted it, before it's
+		 * queued for the dispatch thread, for the messages that have to be handled
+		 * synchronously (e.g. STREAM_STATUS).  Returns `true` if it handled the
+		 * message, which is then dropped.  Must return quickly.
+		 */
+		bool (*sync)( GstMessage* msg, void* user_data );
+
+		Callbacks() : error(NULL), warning(NULL), eos(NULL), qos(NULL), latency(NULL), buffering(NULL), stateChanged(NULL), filter(NULL), sync(NULL) {}
+	};
+
+	/**
+	 * Watch the bus of a pipeline.  Messages are dispatched once Start() is called.
+	 *
+	 * @param pipeline  the pipeline, which identifies its own STATE_CHANGED messages
+	 * @param callbacks message handlers
+	 * @param user_data passed to every callback
+	 * @param name      prefix of the log messages (e.g. "gstDecoder")
+	 */
+	static gstBusWatcher* Create( GstElement* pipeline, const Callbacks& callbacks, void* user_data, const char* name );
+
+	/**
+	 * Stop dispatching messages and release the bus.
+	 */
+	~gstBusWatcher();
+
+	/**
+	 * Start dispatching messages.  Does nothing if it's already running.
+	 * @returns `false` if the dispatch thread couldn't be started.
+	 */
+	bool Start();
+
+	/**
+	 * Stop dispatching messages.  Once it returns, none of the callbacks are
+	 * running or will be called again.  Must not be called from a callback.
+	 */
+	void Stop();
+
+	/**
+	 * Number of error messages received.
+	 */
+	inline uint64_t GetErrors() const			{ return mErrors.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of warning messages received.
+	 */
+	inline uint64_t GetWarnings() const		{ return mWarnings.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of QoS messages received.
+	 */
+	inline uint64_t GetQoSMessages() const		{ return mQoS.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns true if messages are being dispatched.
+	 */
+	inline bool IsRunning() const			{ return mRunning.load(std::memory_order_acquire); }
+
+private:
+	gstBusWatcher( GstElement* pipeline, const Callbacks& callbacks, void* user_data, const char* name );
+
+	static GstBusSyncReply onSyncMessage( GstBus* bus, GstMessage* msg, gpointer user_data );
+
+	friend class gstBusDispatcher;
+	void dispatch( GstMessage* msg );
+
+	GstBus*     mBus;
+	GstElement* mPipeline;
+	Callbacks   mCallbacks;
+	void*       mUserData;
+	std::string mName;
+	uint32_t    mShard;
+
+	std::mutex  mControlMutex;
+
+	std::atomic<bool>     mRunning;
+	std::atomic<uint64_t> mErrors;
+	std::atomic<uint64_t> mWarnings;
+	std::atomic<uint64_t> mQoS;
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include "gstDeviceCache.h"
+
+#include <chrono>
+
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// constructor
+gstDeviceCache::gstDeviceCache( const char* filename )
+{
+	mFilename = filename != NULL ? filename : DefaultFilename();
+	mMonitor  = NULL;
+	mHits     = 0;
+	mMisses   = 0;
+
+	load();
+}
+
+
+// destructor
+gstDeviceCache::~gstDeviceCache()
+{
+	StopMonitor();
+}
+
+
+// Create
+gstDeviceCache* gstDeviceCache::Create( const char* filename )
+{
+	return new gstDeviceCache(filename);
+}
+
+
+// Get
+gstDeviceCache* gstDeviceCache::Get()
+{
+	// never destroyed, so it can be used until the very end of the process
+	static gstDeviceCache* cache = new gstDeviceCache(NULL);
+	return cache;
+}
+
+
+// DefaultFilename
+std::string gstDeviceCache::DefaultFilename()
+{
+	gchar* filename = g_build_filename(g_get_user_cache_dir(), "gstDeviceCache.ini", NULL);
+	const std::string str = filename;
+
+	g_free(filename);
+	return str;
+}
+
+
+// Lookup
+bool gstDeviceCache::Lookup( const char* path, Device& device )
+{
+	if( !path )
+		return false;
+
+	// a few ioctls tell whether it's still the same device at that path, with the same formats
+	std::string busInfo;
+	std::string card;
+	std::string fingerprint;
+
+	const bool queried = Fingerprint(path, busInfo, card, fingerprint);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::map<std::string, Device>::const_iterator n = mDevices.find(path);
+
+		if( queried && n != mDevices.end() && n->second.busInfo == busInfo && n->second.card == card && n->second.fingerprint == fingerprint )
+		{
+			device = n->second;
+			mHits++;
+			return true;
+		}
+	}
+
+	mMisses++;
+
+	if( !enumerate() )
+		return false;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::map<std::string, Device>::const_iterator n = mDevices.find(path);
+
+	if( n == mDevices.end() )
+	{
+		printf("gstDeviceCache -- could not find v4l2 device %s\n", path);
+		return false;
+	}
+
+	device = n->second;
+	return true;
+}
+
+
+// Invalidate
+void gstDeviceCache::Invalidate( const char* path )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if( path != NULL )
+		mDevices.erase(path);
+	else
+		mDevices.clear();
+
+	save();
+}
+
+
+// enumerate
+bool gstDeviceCache::enumerate()
+{
+	GstDeviceProvider* provider = gst_device_provider_factory_get_by_name("v4l2deviceprovider");
+
+	if( !provider )
+	{
+		printf("gstDeviceCache -- failed to create v4l2 device provider\n");
+		return false;
+	}
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// opens every device and queries all of its formats, this is what the cache saves
+	GList* deviceList = gst_device_provider_get_devices(provider);
+	std::map<std::string, Device> devices;
+
+	for( GList* n=deviceList; n; n = n->next )
+	{
+		Device device;
+
+		if( parseDevice(GST_DEVICE(n->data), device) )
+			devices[device.path] = device;
+	}
+
+	g_list_free_full(deviceList, gst_object_unref);
+	gst_object_unref(provider);
+
+	printf("gstDeviceCache -- enumerated %zu v4l2 devices in %.1f ms\n", devices.size(),
+		std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mDevices.swap(devices);
+	save();
+
+	return true;
+}
+
+
+// structureString
+static const char* structureString( const GstStructure* structure, const char* name, const char* legacyName )
+{
+	const char* str = gst_structure_get_string(structure, name);
+
+	// the v4l2 properties were renamed in GStreamer 1.22
+	if( !str && legacyName != NULL )
+		str = gst_structure_get_string(structure, legacyName);
+
+	return str;
+}
+
+
+// parseDevice
+bool gstDeviceCache::parseDevice( GstDevice* gstDevice, Device& device )
+{
+	GstStructure* properties = gst_device_get_properties(gstDevice);
+
+	if( !properties )
+		return false;
+
+	const char* api     = gst_structure_get_string(properties, "device.api");
+	const char* path    = structureString(properties, "api.v4l2.path", "device.path");
+	const char* busInfo = structureString(properties, "api.v4l2.cap.bus_info", "v4l2.device.bus_info");
+	const char* card    = structureString(properties, "api.v4l2.cap.card", "v4l2.device.card");
+
+	const bool v4l2 = api != NULL && strcmp(api, "v4l2") == 0 && path != NULL;
+
+	if( v4l2 )
+	{
+		device.path    = path;
+		device.busInfo = busInfo != NULL ? busInfo : "";
+		device.card    = card != NULL ? card : "";
+	}
+
+	gst_structure_free(properties);
+
+	if( !v4l2 )
+		return false;
+
+	// the provider doesn't report the formats in a form that's cheap to compare, so they're queried
+	std::string queriedBusInfo;
+	std::string queriedCard;
+
+	Fingerprint(device.path.c_str(), queriedBusInfo, queriedCard, device.fingerprint);
+
+	gchar* name = gst_device_get_display_name(gstDevice);
+
+	device.name = name != NULL ? name : "";
+	g_free(name);
+
+	GstCaps* caps = gst_device_get_caps(gstDevice);
+
+	if( caps != NULL )
+	{
+		gchar* str = gst_caps_to_string(caps);
+		device.caps = str;
+
+		g_free(str);
+		gst_caps_unref(caps);
+	}
+
+	return true;
+}
+
+
+// Fingerprint
+bool gstDeviceCache::Fingerprint( const char* path, std::string& busInfo, std::string& card, std::string& fingerprint )
+{
+#ifdef __linux__
+	if( !path )
+		return false;
+
+	const int fd = open(path, O_RDWR | O_NONBLOCK);
+
+	if( fd < 0 )
+		return false;
+
+	struct v4l2_capability caps;
+	memset(&caps, 0, sizeof(caps));
+
+	if( ioctl(fd, VIDIOC_QUERYCAP, &caps) < 0 )
+	{
+		close(fd);
+		return false;
+	}
+
+	busInfo = std::string((const char*)caps.bus_info, strnlen((const char*)caps.bus_info, sizeof(caps.bus_info)));
+	card    = std::string((const char*)caps.card, strnlen((const char*)caps.card, sizeof(caps.card)));
+
+	char str[64];
+
+	snprintf(str, sizeof(str), "%u.%u.%u %08x ", (caps.version >> 16) & 0xFF, (caps.version >> 8) & 0xFF, caps.version & 0xFF, caps.capabilities);
+	fingerprint = str;
+
+	// the pixel formats of the capture queue, in the order the driver lists them
+	const uint32_t type = (caps.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE) && !(caps.capabilities & V4L2_CAP_VIDEO_CAPTURE)
+					? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	struct v4l2_fmtdesc format;
+	memset(&format, 0, sizeof(format));
+
+	format.type = type;
+
+	for( format.index=0; ioctl(fd, VIDIOC_ENUM_FMT, &format) == 0; format.index++ )
+	{
+		const char fourcc[5] = { (char)(format.pixelformat & 0xFF), (char)((format.pixelformat >> 8) & 0xFF),
+							(char)((format.pixelformat >> 16) & 0xFF), (char)((format.pixelformat >> 24) & 0xFF), '\0' };
+
+		if( format.index > 0 )
+			fingerprint += ",";
+
+		fingerprint += fourcc;
+	}
+
+	close(fd);
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// load
+bool gstDeviceCache::load()
+{
+	GKeyFile* file = g_key_file_new();
+
+	if( !g_key_file_load_from_file(file, mFilename.c_str(), G_KEY_FILE_NONE, NULL) )
+	{
+		g_key_file_free(file);
+		return false;
+	}
+
+	// one group per device, named after its path
+	gsize numGroups = 0;
+	gchar** groups = g_key_file_get_groups(file, &numGroups);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for( gsize n=0; n < numGroups; n++ )
+	{
+		Device device;
+		device.path = groups[n];
+
+		const char* keys[] = { "bus-info", "card", "fingerprint", "name", "caps" };
+		std::string* values[] = { &device.busInfo, &device.card, &device.fingerprint, &device.name, &device.caps };
+
+		for( size_t k=0; k < 5; k++ )
+		{
+			gchar* value = g_key_file_get_string(file, groups[n], keys[k], NULL);
+
+			if( value != NULL )
+				*values[k] = value;
+
+			g_free(value);
+		}
+
+		mDevices[device.path] = device;
+	}
+
+	g_strfreev(groups);
+	g_key_file_free(file);
+
+	printf("gstDeviceCache -- loaded %zu v4l2 devices from %s\n", mDevices.size(), mFilename.c_str());
+	return true;
+}
+
+
+// save (called with mMutex locked)
+bool gstDeviceCache::save()
+{
+	GKeyFile* file = g_key_file_new();
+
+	for( std::map<std::string, Device>::const_iterator n = mDevices.begin(); n != mDevices.end(); n++ )
+	{
+		const char* group = n->first.c_str();
+
+		g_key_file_set_string(file, group, "bus-info", n->second.busInfo.c_str());
+		g_key_file_set_string(file, group, "card", n->second.card.c_str());
+		g_key_file_set_string(file, group, "fingerprint", n->second.fingerprint.c_str());
+		g_key_file_set_string(file, group, "name", n->second.name.c_str());
+		g_key_file_set_string(file, group, "caps", n->second.caps.c_str());
+	}
+
+	gchar* dir = g_path_get_dirname(mFilename.c_str());
+	g_mkdir_with_parents(dir, 0755);
+	g_free(dir);
+
+	// written to a temporary file and renamed, so a crash never leaves half a cache
+	GError* err = NULL;
+	const bool saved = g_key_file_save_to_file(file, mFilename.c_str(), &err);
+
+	if( !saved )
+	{
+		printf("gstDeviceCache -- failed to save %s (%s)\n", mFilename.c_str(), err != NULL ? err->message : "unknown");
+
+		if( err != NULL )
+			g_error_free(err);
+	}
+
+	g_key_file_free(file);
+	return saved;
+}
+
+
+// StartMonitor
+bool gstDeviceCache::StartMonitor()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( mMonitor != NULL )
+		return true;
+
+	mMonitor = gst_device_monitor_new();
+	gst_device_monitor_add_filter(mMonitor, "Video/Source", NULL);
+
+	// the events are handled right away on the provider's thread, nobody pops them off the bus
+	GstBus* bus = gst_device_monitor_get_bus(mMonitor);
+	gst_bus_set_sync_handler(bus, onMonitorMessage, this, NULL);
+	gst_object_unref(bus);
+
+	if( !gst_device_monitor_start(mMonitor) )
+	{
+		printf("gstDeviceCache -- failed to start the device monitor\n");
+		gst_object_unref(mMonitor);
+		mMonitor = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+
+// StopMonitor
+void gstDeviceCache::StopMonitor()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( !mMonitor )
+		return;
+
+	gst_device_monitor_stop(mMonitor);
+
+	GstBus* bus = gst_device_monitor_get_bus(mMonitor);
+	gst_bus_set_sync_handler(bus, NULL, NULL, NULL);
+	gst_object_unref(bus);
+
+	gst_object_unref(mMonitor);
+	mMonitor = NULL;
+}
+
+
+// onMonitorMessage
+GstBusSyncReply gstDeviceCache::onMonitorMessage( GstBus* bus, GstMessage* msg, gpointer user_data )
+{
+	gstDeviceCache* cache = (gstDeviceCache*)user_data;
+	GstDevice* gstDevice = NULL;
+
+	switch( GST_MESSAGE_TYPE(msg) )
+	{
+		case GST_MESSAGE_DEVICE_ADDED:   gst_message_parse_device_added(msg, &gstDevice); break;
+		case GST_MESSAGE_DEVICE_REMOVED: gst_message_parse_device_removed(msg, &gstDevice); break;
+		case GST_MESSAGE_DEVICE_CHANGED: gst_message_parse_device_changed(msg, &gstDevice, NULL); break;
+		default:                         return GST_BUS_DROP;
+	}
+
+	Device device;
+
+	if( gstDevice != NULL && parseDevice(gstDevice, device) )
+	{
+		std::lock_guard<std::mutex> lock(cache->mMutex);
+		std::map<std::string, Device>::iterator n = cache->mDevices.find(device.path);
+
+		if( GST_MESSAGE_TYPE(msg) == GST_MESSAGE_DEVICE_REMOVED )
+		{
+			if( n != cache->mDevices.end() )
+			{
+				printf("gstDeviceCache -- %s (%s) was removed\n", device.path.c_str(), device.name.c_str());
+				cache->mDevices.erase(n);
+				cache->save();
+			}
+		}
+		else if( n == cache->mDevices.end() || n->second.busInfo != device.busInfo || n->second.card != device.card ||
+			    n->second.fingerprint != device.fingerprint || n->second.caps != device.caps )
+		{
+			// the monitor also reports the devices already plugged in when it starts, those are only saved if they changed
+			printf("gstDeviceCache -- %s (%s) was %s\n", device.path.c_str(), device.name.c_str(), n == cache->mDevices.end() ? "added" : "changed");
+			cache->mDevices[device.path] = device;
+			cache->save();
+		}
+	}
+
+	if( gstDevice != NULL )
+		gst_object_unref(gstDevice);
+
+	return GST_BUS_DROP;
+}
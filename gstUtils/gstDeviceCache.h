@@ -0,0 +1,137 @@
+#ifndef __GSTREAMER_DEVICE_CACHE_H__
+#define __GSTREAMER_DEVICE_CACHE_H__
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+
+/**
+ * V4L2 devices and their caps, cached on disk between runs.
+ *
+ * Enumerating the devices with the v4l2 device provider opens every
+ * /dev/video* node and queries all of its formats, sizes and frame rates,
+ * which can take seconds with several cameras.  The cache keeps the result
+ * in a GKeyFile, one group per device path, so a camera starts with a
+ * VIDIOC_QUERYCAP and a few VIDIOC_ENUM_FMT: if the bus info, card name
+ * and format fingerprint of the device at that path still match the cached
+ * ones, the cached caps are used, and otherwise (a different camera was
+ * plugged in, or the driver was updated or reconfigured) the devices are
+ * enumerated again and the file is rewritten.
+ *
+ * While StartMonitor() is running, hotplug events update the cache as they
+ * happen.  Outside of Linux, the devices can't be queried without the
+ * provider, so they're always enumerated.
+ */
+class gstDeviceCache
+{
+public:
+	/**
+	 * A cached device.
+	 */
+	struct Device
+	{
+		std::string path;		/**< device node, e.g. /dev/video0 */
+		std::string busInfo;		/**< bus the device is plugged into, e.g. usb-0000:00:14.0-1 */
+		std::string card;		/**< card name reported by the driver */
+		std::string fingerprint;	/**< driver version, capabilities and pixel formats, see Fingerprint() */
+		std::string name;		/**< display name of the device */
+		std::string caps;		/**< every format the device supports, as a caps string */
+	};
+
+	/**
+	 * Load the cache from a file, which is created on the first enumeration.
+	 * @param filename path of the cache, NULL for DefaultFilename()
+	 */
+	static gstDeviceCache* Create( const char* filename=NULL );
+
+	/**
+	 * The cache shared by the process, in DefaultFilename().
+	 */
+	static gstDeviceCache* Get();
+
+	/**
+	 * Stop monitoring.
+	 */
+	~gstDeviceCache();
+
+	/**
+	 * Find the device at a path, enumerating the devices again if it isn't
+	 * cached or a different device is plugged in there now.
+	 * gst_init() must have been called.
+	 * @returns `false` if there is no such device.
+	 */
+	bool Lookup( const char* path, Device& device );
+
+	/**
+	 * Forget a device (or every device if `path` is NULL), so the next
+	 * Lookup() enumerates them again.
+	 */
+	void Invalidate( const char* path=NULL );
+
+	/**
+	 * Keep the cache up to date with devices being plugged in, removed or changed.
+	 * @returns `false` if the device monitor couldn't be started.
+	 */
+	bool StartMonitor();
+
+	/**
+	 * Stop updating the cache on hotplug events.
+	 */
+	void StopMonitor();
+
+	/**
+	 * Number of Lookup() calls served from the cache.
+	 */
+	inline uint64_t GetHits() const			{ return mHits; }
+
+	/**
+	 * Number of Lookup() calls that had to enumerate the devices.
+	 */
+	inline uint64_t GetMisses() const			{ return mMisses; }
+
+	/**
+	 * The file the cache is stored in.
+	 */
+	inline const std::string& GetFilename() const	{ return mFilename; }
+
+	/**
+	 * gstDeviceCache.ini in the user's cache directory (e.g. ~/.cache).
+	 */
+	static std::string DefaultFilename();
+
+	/**
+	 * Query what identifies the device at a path, and what it can capture
+	 * without enumerating its sizes and frame rates: the bus info and card
+	 * name, and a fingerprint of the driver version, the capabilities and
+	 * the pixel formats (VIDIOC_ENUM_FMT), e.g. "6.1.0 84a00001 YUYV,NV12".
+	 * @returns `false` if it isn't a V4L2 device, or outside of Linux.
+	 */
+	static bool Fingerprint( const char* path, std::string& busInfo, std::string& card, std::string& fingerprint );
+
+private:
+	gstDeviceCache( const char* filename );
+
+	static GstBusSyncReply onMonitorMessage( GstBus* bus, GstMessage* msg, gpointer user_data );
+	static bool parseDevice( GstDevice* gstDevice, Device& device );
+
+	bool enumerate();
+	bool load();
+	bool save();
+
+	std::map<std::string, Device> mDevices;
+	std::mutex  mMutex;
+	std::string mFilename;
+
+	GstDeviceMonitor* mMonitor;
+	std::mutex        mControlMutex;
+
+	std::atomic<uint64_t> mHits;
+	std::atomic<uint64_t> mMisses;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "gstFormat.h"
+
+#include <string.h>
+
+
+// constructor
+gstFormat::gstFormat()
+{
+	mCaps        = NULL;
+	mVideoFormat = GST_VIDEO_FORMAT_UNKNOWN;
+	mFormat      = NULL;
+	mWidth       = 0;
+	mHeight      = 0;
+	mNumPlanes   = 0;
+	mSize        = 0;
+	mFrameRate   = 0.0f;
+
+	memset(mStrides, 0, sizeof(mStrides));
+	memset(mOffsets, 0, sizeof(mOffsets));
+}
+
+
+// destructor
+gstFormat::~gstFormat()
+{
+	if( mCaps != NULL )
+	{
+		gst_caps_unref(mCaps);
+		mCaps = NULL;
+	}
+}
+
+
+// Create
+gstFormat::Ptr gstFormat::Create( GstCaps* caps )
+{
+	if( !caps )
+		return Ptr();
+
+	std::shared_ptr<gstFormat> format(new gstFormat());
+
+	if( !format->init(caps) )
+		return Ptr();
+
+	return format;
+}
+
+
+// init
+bool gstFormat::init( GstCaps* caps )
+{
+	mCaps = gst_caps_ref(caps);
+
+	if( !gst_video_info_from_caps(&mInfo, caps) )
+	{
+		printf("gstFormat -- caps are not raw video\n");
+		return false;
+	}
+
+	mVideoFormat = GST_VIDEO_INFO_FORMAT(&mInfo);
+	mFormat      = gst_video_format_to_string(mVideoFormat);
+	mWidth       = GST_VIDEO_INFO_WIDTH(&mInfo);
+	mHeight      = GST_VIDEO_INFO_HEIGHT(&mInfo);
+	mNumPlanes   = GST_VIDEO_INFO_N_PLANES(&mInfo);
+	mSize        = GST_VIDEO_INFO_SIZE(&mInfo);
+
+	if( mNumPlanes > MaxPlanes )
+	{
+		printf("gstFormat -- %s has %u planes, only %u are supported\n", mFormat, mNumPlanes, MaxPlanes);
+		return false;
+	}
+
+	// default layout of the format, as produced by the raw video elements
+	for( uint32_t n=0; n < mNumPlanes; n++ )
+	{
+		mStrides[n] = GST_VIDEO_INFO_PLANE_STRIDE(&mInfo, n);
+		mOffsets[n] = GST_VIDEO_INFO_PLANE_OFFSET(&mInfo, n);
+	}
+
+	if( GST_VIDEO_INFO_FPS_N(&mInfo) > 0 && GST_VIDEO_INFO_FPS_D(&mInfo) > 0 )
+		mFrameRate = (float)GST_VIDEO_INFO_FPS_N(&mInfo) / (float)GST_VIDEO_INFO_FPS_D(&mInfo);
+
+	mColorSpace = ToColorSpace(GST_VIDEO_INFO_COLORIMETRY(&mInfo), mHeight);
+	return true;
+}
+
+
+// Print
+void gstFormat::Print( const char* prefix ) const
+{
+	printf("%s -- negotiated %s %ux%u @ %g fps (%s, %s range)\n", prefix != NULL ? prefix : "gstFormat",
+		mFormat, mWidth, mHeight, mFrameRate, yuvMatrixToStr(mColorSpace.matrix),
+		mColorSpace.range == YUV_RANGE_FULL ? "full" : "limited");
+}
+
+
+// ToColorSpace
+yuvColorSpace gstFormat::ToColorSpace( const GstVideoColorimetry& colorimetry, uint32_t height )
+{
+	// same defaults as gst_video_info_from_caps() when colorimetry isn't specified
+	yuvColorSpace colorSpace(height > 576 ? YUV_MATRIX_BT709 : YUV_MATRIX_BT601, YUV_RANGE_LIMITED);
+
+	switch(colorimetry.matrix)
+	{
+		case GST_VIDEO_COLOR_MATRIX_BT601:
+		case GST_VIDEO_COLOR_MATRIX_FCC:
+			colorSpace.matrix = YUV_MATRIX_BT601;
+			break;
+		case GST_VIDEO_COLOR_MATRIX_BT709:
+		case GST_VIDEO_COLOR_MATRIX_SMPTE240M:	// close enough to BT.709 for display
+			colorSpace.matrix = YUV_MATRIX_BT709;
+			break;
+		default:
+			break;
+	}
+
+	if( colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255 )
+		colorSpace.range = YUV_RANGE_FULL;
+	else if( colorimetry.range == GST_VIDEO_COLOR_RANGE_16_235 )
+		colorSpace.range = YUV_RANGE_LIMITED;
+
+	return colorSpace;
+}
+
+
+// constructor
+gstFormatCache::gstFormatCache()
+{
+	mPad   = NULL;
+	mProbe = 0;
+	mName  = "gstFormat";
+}
+
+
+// destructor
+gstFormatCache::~gstFormatCache()
+{
+	Detach();
+}
+
+
+// Attach
+bool gstFormatCache::Attach( GstElement* element, const char* name )
+{
+	Detach();
+
+	if( name != NULL )
+		mName = name;
+
+	if( !element )
+		return false;
+
+	mPad = gst_element_get_static_pad(element, "sink");
+
+	if( !mPad )
+	{
+		printf("%s -- failed to get sink pad for caps negotiation\n", mName.c_str());
+		return false;
+	}
+
+	mProbe = gst_pad_add_probe(mPad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM), onProbe, this, NULL);
+	return true;
+}
+
+
+// Detach
+void gstFormatCache::Detach()
+{
+	if( !mPad )
+		return;
+
+	if( mProbe != 0 )
+		gst_pad_remove_probe(mPad, mProbe);
+
+	gst_object_unref(mPad);
+
+	mPad   = NULL;
+	mProbe = 0;
+}
+
+
+// onProbe
+GstPadProbeReturn gstFormatCache::onProbe( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	if( GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM )
+	{
+		GstQuery* query = GST_PAD_PROBE_INFO_QUERY(info);
+
+		// without this, decoders with padded output copy every frame to the default layout
+		if( query != NULL && GST_QUERY_TYPE(query) == GST_QUERY_ALLOCATION && !gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL) )
+			gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+
+		return GST_PAD_PROBE_OK;
+	}
+
+	GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+	if( event != NULL && GST_EVENT_TYPE(event) == GST_EVENT_CAPS && user_data != NULL )
+	{
+		GstCaps* caps = NULL;
+		gst_event_parse_caps(event, &caps);
+		((gstFormatCache*)user_data)->update(caps);
+	}
+
+	return GST_PAD_PROBE_OK;
+}
+
+
+// Get
+gstFormat::Ptr gstFormatCache::Get( GstSample* sample )
+{
+	if( !sample )
+		return gstFormat::Ptr();
+
+	GstCaps* caps = gst_sample_get_caps(sample);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if( mFormat != NULL && mFormat->Matches(caps) )
+			return mFormat;
+	}
+
+	return update(caps);
+}
+
+
+// GetCurrent
+gstFormat::Ptr gstFormatCache::GetCurrent() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mFormat;
+}
+
+
+// Reset
+void gstFormatCache::Reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFormat.reset();
+}
+
+
+// update
+gstFormat::Ptr gstFormatCache::update( GstCaps* caps )
+{
+	if( !caps )
+		return gstFormat::Ptr();
+
+	gstFormat::Ptr previous = GetCurrent();
+
+	if( previous != NULL && previous->Matches(caps) )
+		return previous;
+
+	gstFormat::Ptr format = gstFormat::Create(caps);
+
+	if( !format )
+		return format;
+
+	// only log actual changes, not equal caps that are a different object
+	if( !previous || !gst_caps_is_equal(previous->GetCaps(), caps) )
+		format->Print(mName.c_str());
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFormat = format;
+	return format;
+}
@@ -0,0 +1,222 @@
+#ifndef __GSTREAMER_FORMAT_H__
+#define __GSTREAMER_FORMAT_H__
+
+#include "yuvConvert.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+
+/**
+ * Video format negotiated on a pad, parsed once per caps.
+ *
+ * Parsing caps costs a handful of structure lookups and string compares,
+ * which adds up when done for every frame.  A gstFormat is built once from
+ * the caps (through GstVideoInfo) and then only read, so the per-frame path
+ * just accesses plain fields.  It is immutable and shared by every frame
+ * negotiated with the same caps, so frames from before a renegotiation keep
+ * describing their own layout.
+ */
+class gstFormat
+{
+public:
+	/**
+	 * Shared handle to a format.
+	 */
+	typedef std::shared_ptr<const gstFormat> Ptr;
+
+	/**
+	 * Maximum number of planes of the supported formats.
+	 */
+	static const uint32_t MaxPlanes = 3;
+
+	/**
+	 * Parse raw video caps.  A reference to the caps is kept for Matches().
+	 * @returns the format, or an empty handle if the caps aren't raw video.
+	 */
+	static Ptr Create( GstCaps* caps );
+
+	/**
+	 * Release the caps.
+	 */
+	~gstFormat();
+
+	/**
+	 * Returns true if the format was parsed from these caps.
+	 * Only compares pointers, so it is cheap enough to call for every buffer.
+	 */
+	inline bool Matches( const GstCaps* caps ) const	{ return caps == mCaps; }
+
+	/**
+	 * The caps the format was parsed from.
+	 */
+	inline GstCaps* GetCaps() const			{ return mCaps; }
+
+	/**
+	 * Width of the frames in pixels.
+	 */
+	inline uint32_t GetWidth() const			{ return mWidth; }
+
+	/**
+	 * Height of the frames in pixels.
+	 */
+	inline uint32_t GetHeight() const			{ return mHeight; }
+
+	/**
+	 * Pixel format of the frames.
+	 */
+	inline GstVideoFormat GetVideoFormat() const	{ return mVideoFormat; }
+
+	/**
+	 * Pixel format string (e.g. "NV12" or "I420").
+	 */
+	inline const char* GetFormat() const		{ return mFormat; }
+
+	/**
+	 * Number of planes (2 for NV12, 3 for I420).
+	 */
+	inline uint32_t GetNumPlanes() const		{ return mNumPlanes; }
+
+	/**
+	 * Row pitch of the given plane in bytes, in the default layout of the caps.
+	 * Buffers with a GstVideoMeta may differ, see gstFrame::GetStride().
+	 */
+	inline uint32_t GetStride( uint32_t plane ) const	{ return mStrides[plane]; }
+
+	/**
+	 * Offset of the given plane from the start of the buffer in bytes,
+	 * in the default layout of the caps.
+	 */
+	inline size_t GetOffset( uint32_t plane ) const	{ return mOffsets[plane]; }
+
+	/**
+	 * Size of a frame in bytes, in the default layout of the caps.
+	 */
+	inline size_t GetSize() const				{ return mSize; }
+
+	/**
+	 * The video info parsed from the caps, to map frames with gst_video_frame_map().
+	 */
+	inline const GstVideoInfo* GetVideoInfo() const	{ return &mInfo; }
+
+	/**
+	 * Framerate in frames per second, or 0 if it's variable or unknown.
+	 */
+	inline float GetFrameRate() const			{ return mFrameRate; }
+
+	/**
+	 * Colorimetry of the frames (matrix and range).
+	 */
+	inline const yuvColorSpace& GetColorSpace() const	{ return mColorSpace; }
+
+	/**
+	 * Describe the format on one line, e.g. "NV12 1920x1080 @ 30 fps (bt709)".
+	 */
+	void Print( const char* prefix ) const;
+
+	/**
+	 * Map GStreamer colorimetry to a YUV matrix and range.  Unknown values fall
+	 * back to GStreamer's defaults: BT.709 for HD resolutions, BT.601 for SD,
+	 * and limited range.
+	 */
+	static yuvColorSpace ToColorSpace( const GstVideoColorimetry& colorimetry, uint32_t height );
+
+private:
+	gstFormat();
+	gstFormat( const gstFormat& );
+	gstFormat& operator=( const gstFormat& );
+
+	bool init( GstCaps* caps );
+
+	GstCaps*       mCaps;
+	GstVideoInfo   mInfo;
+	GstVideoFormat mVideoFormat;
+	const char*    mFormat;
+
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mNumPlanes;
+	uint32_t mStrides[MaxPlanes];
+	size_t   mOffsets[MaxPlanes];
+	size_t   mSize;
+	float    mFrameRate;
+
+	yuvColorSpace mColorSpace;
+};
+
+
+/**
+ * Keeps the format negotiated on a pad, rebuilt only when the caps change.
+ *
+ * Attach() installs a probe that parses the caps of each CAPS event as it
+ * goes by, ahead of the buffers using them.  Get() then only has to compare
+ * the sample's caps pointer against the cached format.  If they differ
+ * (no probe attached, or caps that are equal but a different object), the
+ * format is rebuilt from the sample, so mid-stream changes are always
+ * picked up.
+ */
+class gstFormatCache
+{
+public:
+	/**
+	 * Create an empty cache.
+	 */
+	gstFormatCache();
+
+	/**
+	 * Remove the probe.
+	 */
+	~gstFormatCache();
+
+	/**
+	 * Watch for CAPS events on the sink pad of an element (e.g. the appsink).
+	 * Each new format is logged, prefixed with `name`.
+	 *
+	 * The probe also answers ALLOCATION queries with GstVideoMeta support,
+	 * so upstream decoders hand over their padded buffers as they are
+	 * instead of copying them to the default layout.
+	 * @returns `false` if the element has no sink pad.
+	 */
+	bool Attach( GstElement* element, const char* name );
+
+	/**
+	 * Remove the probe installed by Attach().
+	 */
+	void Detach();
+
+	/**
+	 * Format of a sample.  Parses the caps only if they changed.
+	 * @returns the format, or an empty handle if the caps can't be parsed.
+	 */
+	gstFormat::Ptr Get( GstSample* sample );
+
+	/**
+	 * The most recently negotiated format (may be empty).
+	 */
+	gstFormat::Ptr GetCurrent() const;
+
+	/**
+	 * Forget the current format, e.g. when the pipeline is stopped.
+	 */
+	void Reset();
+
+private:
+	static GstPadProbeReturn onProbe( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+
+	gstFormat::Ptr update( GstCaps* caps );
+
+	gstFormat::Ptr mFormat;
+	std::string    mName;
+
+	GstPad* mPad;
+	gulong  mProbe;
+
+	mutable std::mutex mMutex;
+};
+
+#endif
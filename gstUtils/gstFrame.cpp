@@ -0,0 +1,189 @@
+#include "gstFrame.h"
+
+#include <string.h>
+
+
+// constructor
+gstFrame::gstFrame()
+{
+	mSample    = NULL;
+	mBuffer    = NULL;
+	mMapped    = false;
+	mTimestamp = GST_CLOCK_TIME_NONE;
+
+	memset(&mVideoFrame, 0, sizeof(mVideoFrame));
+	memset(mPlanes, 0, sizeof(mPlanes));
+	memset(mStrides, 0, sizeof(mStrides));
+	memset(mPlaneSizes, 0, sizeof(mPlaneSizes));
+}
+
+
+// destructor
+gstFrame::~gstFrame()
+{
+	if( mMapped )
+	{
+		gst_video_frame_unmap(&mVideoFrame);
+		mMapped = false;
+	}
+
+	if( mSample != NULL )
+	{
+		gst_sample_unref(mSample);
+		mSample = NULL;
+	}
+}
+
+
+// Create
+gstFrame::Ptr gstFrame::Create( GstSample* sample )
+{
+	if( !sample )
+		return Ptr();
+
+	return Create(sample, gstFormat::Create(gst_sample_get_caps(sample)));
+}
+
+
+// Create
+gstFrame::Ptr gstFrame::Create( GstSample* sample, const gstFormat::Ptr& format )
+{
+	if( !sample || !format )
+		return Ptr();
+
+	Ptr frame(new gstFrame());
+
+	if( !frame->init(sample, format) )
+		return Ptr();
+
+	return frame;
+}
+
+
+// init
+bool gstFrame::init( GstSample* sample, const gstFormat::Ptr& format )
+{
+	mSample  = gst_sample_ref(sample);
+	mFormat  = format;
+	mArrival = std::chrono::steady_clock::now();
+
+	const GstVideoFormat videoFormat = mFormat->GetVideoFormat();
+
+	if( videoFormat != GST_VIDEO_FORMAT_NV12 && videoFormat != GST_VIDEO_FORMAT_I420 )
+	{
+		printf("gstFrame -- unsupported format %s\n", mFormat->GetFormat());
+		return false;
+	}
+
+	// 从样本中检索缓冲区，缓冲区包含实际的多媒体数据
+	mBuffer = gst_sample_get_buffer(mSample);
+
+	if( !mBuffer )
+	{
+		printf("gstFrame -- gst_sample had NULL buffer...\n");
+		return false;
+	}
+
+	// decoders that pad or align their planes describe the layout in a GstVideoMeta
+	if( !checkMeta() )
+		return false;
+
+	// each plane is mapped separately (following the GstVideoMeta if there is one), so buffers with
+	// a GstMemory per plane are read in place; the sample already holds a reference to the buffer
+	if( !gst_video_frame_map(&mVideoFrame, (GstVideoInfo*)mFormat->GetVideoInfo(), mBuffer,
+						(GstMapFlags)(GST_MAP_READ | GST_VIDEO_FRAME_MAP_FLAG_NO_REF)) )
+	{
+		printf("gstFrame -- failed to map the planes of a %s %ux%u buffer for reading\n",
+			mFormat->GetFormat(), mFormat->GetWidth(), mFormat->GetHeight());
+		return false;
+	}
+
+	mMapped = true;
+	mTimestamp = mBuffer->pts;
+
+	// the last row of each plane only needs its pixels, not the padding that follows them
+	const uint32_t numPlanes    = mFormat->GetNumPlanes();
+	const uint32_t chromaWidth  = (mFormat->GetWidth() + 1) / 2;
+	const uint32_t chromaHeight = (mFormat->GetHeight() + 1) / 2;
+
+	for( uint32_t n=0; n < numPlanes; n++ )
+	{
+		const uint32_t rows = (n == 0) ? mFormat->GetHeight() : chromaHeight;
+		const uint32_t rowSize = (n == 0) ? mFormat->GetWidth() : (numPlanes == 2 ? chromaWidth * 2 : chromaWidth);
+		const gint stride = GST_VIDEO_FRAME_PLANE_STRIDE(&mVideoFrame, n);
+
+		if( stride <= 0 || rowSize > (uint32_t)stride )
+		{
+			printf("gstFrame -- unsupported stride %i of plane %u of %s %ux%u\n", stride, n,
+				mFormat->GetFormat(), mFormat->GetWidth(), mFormat->GetHeight());
+			return false;
+		}
+
+		mPlanes[n]     = (const uint8_t*)GST_VIDEO_FRAME_PLANE_DATA(&mVideoFrame, n);
+		mStrides[n]    = (uint32_t)stride;
+		mPlaneSizes[n] = (size_t)mStrides[n] * (rows - 1) + rowSize;
+	}
+
+	return true;
+}
+
+
+// checkMeta
+bool gstFrame::checkMeta()
+{
+	const GstVideoMeta* meta = gst_buffer_get_video_meta(mBuffer);
+
+	// gst_video_frame_map() takes the format and size from the meta, which must agree with the caps
+	if( meta != NULL && (meta->format != mFormat->GetVideoFormat() || meta->n_planes != mFormat->GetNumPlanes() ||
+	    meta->width != mFormat->GetWidth() || meta->height != mFormat->GetHeight()) )
+	{
+		printf("gstFrame -- video meta (%s %ux%u) doesn't match the caps (%s %ux%u)\n",
+			gst_video_format_to_string(meta->format), meta->width, meta->height,
+			mFormat->GetFormat(), mFormat->GetWidth(), mFormat->GetHeight());
+		return false;
+	}
+
+	return true;
+}
+
+
+// GetSize
+size_t gstFrame::GetSize() const
+{
+	size_t size = 0;
+
+	for( uint32_t n=0; n < mFormat->GetNumPlanes(); n++ )
+		size += mPlaneSizes[n];
+
+	return size;
+}
+
+
+// ToBGR
+bool gstFrame::ToBGR( uint8_t* output, uint32_t stride, uint32_t width, uint32_t height, yuvInterpolation interp ) const
+{
+	if( !output )
+		return false;
+
+	if( width == 0 )
+		width = mFormat->GetWidth();
+
+	if( height == 0 )
+		height = mFormat->GetHeight();
+
+	// I420 comes straight from cameras that deliver it, with no videoconvert
+	if( mFormat->GetVideoFormat() == GST_VIDEO_FORMAT_I420 )
+	{
+		yuvConvertResizeI420ToBGR(mPlanes[0], mStrides[0], mPlanes[1], mStrides[1], mPlanes[2], mStrides[2],
+							 mFormat->GetWidth(), mFormat->GetHeight(),
+							 output, stride, width, height, interp, mFormat->GetColorSpace());
+
+		return true;
+	}
+
+	yuvConvertResizeNV12ToBGR(mPlanes[0], mStrides[0], mPlanes[1], mStrides[1],
+						 mFormat->GetWidth(), mFormat->GetHeight(),
+						 output, stride, width, height, interp, mFormat->GetColorSpace());
+
+	return true;
+}
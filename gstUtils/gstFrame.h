@@ -0,0 +1,169 @@
+#ifndef __GSTREAMER_FRAME_H__
+#define __GSTREAMER_FRAME_H__
+
+#include "gstFormat.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+
+
+/**
+ * Reference-counted handle to a decoded frame that still lives in its GstBuffer.
+ *
+ * The handle keeps a reference to the GstSample and keeps the buffer mapped
+ * for reading, so the planes can be accessed in place without any copies.
+ * The mapping and the sample are released when the last gstFrame::Ptr
+ * referencing the frame goes away.
+ *
+ * Each plane is mapped on its own with gst_video_frame_map(), so buffers
+ * made of several GstMemory blocks (e.g. one per plane) aren't merged into
+ * a copy, and the planes are located through the buffer's GstVideoMeta when
+ * it has one.  Decoders that pad or align their output (see
+ * gstFormatCache::Attach()) are read in place, with the strides and offsets
+ * of each buffer, rather than repacked upstream to the default layout of
+ * the caps.  The planes aren't necessarily contiguous.
+ *
+ * Holding on to frames also holds on to the upstream element's buffers, so
+ * consumers should drop their handles as soon as they're done with them.
+ */
+class gstFrame
+{
+public:
+	/**
+	 * Shared handle to a frame.
+	 */
+	typedef std::shared_ptr<gstFrame> Ptr;
+
+	/**
+	 * Maximum number of planes of the supported formats.
+	 */
+	static const uint32_t MaxPlanes = gstFormat::MaxPlanes;
+
+	/**
+	 * Wrap a sample pulled from an appsink, using its already negotiated format
+	 * (see gstFormatCache), so that no caps have to be parsed per frame.
+	 * A new reference to the sample is taken, so the caller still owns theirs.
+	 * @returns the frame handle, or an empty handle if the sample couldn't be mapped.
+	 */
+	static Ptr Create( GstSample* sample, const gstFormat::Ptr& format );
+
+	/**
+	 * Wrap a sample, parsing the format from its caps.
+	 * Prefer the variant taking a gstFormat when wrapping every frame of a stream.
+	 */
+	static Ptr Create( GstSample* sample );
+
+	/**
+	 * Unmap the buffer and release the sample.
+	 */
+	~gstFrame();
+
+	/**
+	 * Width of the frame in pixels.
+	 */
+	inline uint32_t GetWidth() const			{ return mFormat->GetWidth(); }
+
+	/**
+	 * Height of the frame in pixels.
+	 */
+	inline uint32_t GetHeight() const			{ return mFormat->GetHeight(); }
+
+	/**
+	 * Pixel format string from the caps (e.g. "NV12" or "I420").
+	 */
+	inline const char* GetFormat() const		{ return mFormat->GetFormat(); }
+
+	/**
+	 * The negotiated format the frame was decoded with.
+	 */
+	inline const gstFormat::Ptr& GetFormatInfo() const	{ return mFormat; }
+
+	/**
+	 * Number of planes (2 for NV12, 3 for I420).
+	 */
+	inline uint32_t GetNumPlanes() const		{ return mFormat->GetNumPlanes(); }
+
+	/**
+	 * Pointer to the first pixel of the given plane.
+	 */
+	inline const uint8_t* GetPlane( uint32_t plane ) const	{ return mPlanes[plane]; }
+
+	/**
+	 * Row pitch of the given plane in bytes.  It comes from the buffer's
+	 * GstVideoMeta if it has one, so it may differ from the caps' layout.
+	 */
+	inline uint32_t GetStride( uint32_t plane ) const		{ return mStrides[plane]; }
+
+	/**
+	 * Bytes spanned by the pixels of the given plane, from its first pixel to
+	 * the last pixel of its last row (the padding after it isn't included).
+	 */
+	inline size_t GetPlaneSize( uint32_t plane ) const	{ return mPlaneSizes[plane]; }
+
+	/**
+	 * Total of the sizes of the planes in bytes, see GetPlaneSize().
+	 */
+	size_t GetSize() const;
+
+	/**
+	 * Colorimetry of the frame (matrix and range), from the caps.
+	 */
+	inline const yuvColorSpace& GetColorSpace() const	{ return mFormat->GetColorSpace(); }
+
+	/**
+	 * Presentation timestamp of the buffer (in nanoseconds), or GST_CLOCK_TIME_NONE.
+	 */
+	inline GstClockTime GetTimestamp() const	{ return mTimestamp; }
+
+	/**
+	 * Time the frame was received from the appsink, used to measure how long
+	 * it waited before being consumed.
+	 */
+	inline std::chrono::steady_clock::time_point GetArrivalTime() const	{ return mArrival; }
+
+	/**
+	 * Convert the frame to packed 8-bit BGR, optionally resizing it in the same pass.
+	 *
+	 * @param output BGR output image of at least `stride * height` bytes
+	 * @param stride row pitch of the output in bytes
+	 * @param width  output width, or 0 for the width of the frame
+	 * @param height output height, or 0 for the height of the frame
+	 * @param interp resampling filter, if the size differs from the frame
+	 *
+	 * @returns `false` if the format of the frame isn't supported.
+	 */
+	bool ToBGR( uint8_t* output, uint32_t stride, uint32_t width=0, uint32_t height=0,
+			  yuvInterpolation interp=YUV_INTERP_BILINEAR ) const;
+
+	/**
+	 * The underlying sample.  It remains valid for the lifetime of the frame.
+	 */
+	inline GstSample* GetSample() const		{ return mSample; }
+
+private:
+	gstFrame();
+	gstFrame( const gstFrame& );
+	gstFrame& operator=( const gstFrame& );
+
+	bool init( GstSample* sample, const gstFormat::Ptr& format );
+	bool checkMeta();
+
+	GstSample*    mSample;
+	GstBuffer*    mBuffer;
+	GstVideoFrame mVideoFrame;
+	bool          mMapped;
+
+	gstFormat::Ptr mFormat;
+	const uint8_t* mPlanes[MaxPlanes];
+	uint32_t       mStrides[MaxPlanes];
+	size_t         mPlaneSizes[MaxPlanes];
+	GstClockTime   mTimestamp;
+
+	std::chrono::steady_clock::time_point mArrival;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "gstFrameSkipper.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+// constructor
+gstFrameSkipper::gstFrameSkipper( GstPad* pad )
+{
+	mPad   = pad;
+	mProbe = 0;
+	mMode  = DECODE_ALL;
+
+	mDecoded = 0;
+	mSkipped = 0;
+
+	mWaitKeyframe = false;
+	mParseNAL     = false;
+	mCodec        = VIDEO_CODEC_H264;
+	mLengthSize   = 0;
+}
+
+
+// destructor
+gstFrameSkipper::~gstFrameSkipper()
+{
+	if( mProbe != 0 )
+		gst_pad_remove_probe(mPad, mProbe);
+
+	gst_object_unref(mPad);
+}
+
+
+// Create
+gstFrameSkipper* gstFrameSkipper::Create( GstElement* decoder )
+{
+	if( !decoder )
+		return NULL;
+
+	GstPad* pad = gst_element_get_static_pad(decoder, "sink");
+
+	if( !pad )
+	{
+		printf("gstFrameSkipper -- %s has no sink pad, frames can't be skipped\n", GST_ELEMENT_NAME(decoder));
+		return NULL;
+	}
+
+	gstFrameSkipper* skipper = new gstFrameSkipper(pad);
+
+	// the caps tell the codec and how the NAL units are delimited
+	GstCaps* caps = gst_pad_get_current_caps(pad);
+
+	if( caps != NULL )
+	{
+		skipper->parseCaps(caps);
+		gst_caps_unref(caps);
+	}
+
+	skipper->mProbe = gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+								 onBuffer, skipper, NULL);
+
+	if( skipper->mProbe == 0 )
+	{
+		printf("gstFrameSkipper -- failed to add a probe to %s\n", GST_ELEMENT_NAME(decoder));
+		delete skipper;
+		return NULL;
+	}
+
+	return skipper;
+}
+
+
+// SetMode
+void gstFrameSkipper::SetMode( gstDecodeMode mode )
+{
+	mMode.store(mode, std::memory_order_relaxed);
+}
+
+
+// ModeToStr
+const char* gstFrameSkipper::ModeToStr( gstDecodeMode mode )
+{
+	switch(mode)
+	{
+		case DECODE_ALL:		return "all";
+		case DECODE_REFERENCE:	return "reference";
+		case DECODE_KEYFRAMES:	return "keyframes";
+	}
+
+	return "unknown";
+}
+
+
+// onBuffer
+GstPadProbeReturn gstFrameSkipper::onBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	gstFrameSkipper* skipper = (gstFrameSkipper*)user_data;
+
+	if( info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM )
+	{
+		GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+		if( GST_EVENT_TYPE(event) == GST_EVENT_CAPS )
+		{
+			GstCaps* caps = NULL;
+			gst_event_parse_caps(event, &caps);
+			skipper->parseCaps(caps);
+		}
+		else if( GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP )
+		{
+			skipper->mWaitKeyframe = false;
+		}
+
+		return GST_PAD_PROBE_OK;
+	}
+
+	if( info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST )
+	{
+		GstBufferList* list = gst_buffer_list_make_writable(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+		GST_PAD_PROBE_INFO_DATA(info) = list;
+
+		gst_buffer_list_foreach(list, onBufferList, skipper);
+
+		return gst_buffer_list_length(list) > 0 ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+	}
+
+	return skipper->skipBuffer(GST_PAD_PROBE_INFO_BUFFER(info)) ? GST_PAD_PROBE_DROP : GST_PAD_PROBE_OK;
+}
+
+
+// onBufferList
+gboolean gstFrameSkipper::onBufferList( GstBuffer** buffer, guint index, gpointer user_data )
+{
+	gstFrameSkipper* skipper = (gstFrameSkipper*)user_data;
+
+	// removed from the list by setting it to NULL
+	if( skipper->skipBuffer(*buffer) )
+	{
+		gst_buffer_unref(*buffer);
+		*buffer = NULL;
+	}
+
+	return TRUE;
+}
+
+
+// skipBuffer
+bool gstFrameSkipper::skipBuffer( GstBuffer* buffer )
+{
+	const gstDecodeMode mode = mMode.load(std::memory_order_relaxed);
+	bool skip = false;
+
+	if( !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) )
+	{
+		mWaitKeyframe = false;
+	}
+	else if( mode == DECODE_KEYFRAMES )
+	{
+		// the next delta units reference this one, so drop them too until the next keyframe
+		mWaitKeyframe = true;
+		skip = true;
+	}
+	else if( mWaitKeyframe )
+	{
+		skip = true;
+	}
+	else if( mode == DECODE_REFERENCE )
+	{
+		skip = isNonReference(buffer);
+	}
+
+	if( skip )
+		mSkipped.fetch_add(1, std::memory_order_relaxed);
+	else
+		mDecoded.fetch_add(1, std::memory_order_relaxed);
+
+	return skip;
+}
+
+
+// isNonReference
+bool gstFrameSkipper::isNonReference( GstBuffer* buffer ) const
+{
+	if( !mParseNAL )
+		return false;
+
+	GstMapInfo map;
+
+	if( !gst_buffer_map(buffer, &map, GST_MAP_READ) )
+		return false;
+
+	const uint8_t* data = map.data;
+	const size_t size = map.size;
+
+	size_t offset = 0;
+	int nonReference = -1;
+
+	// find the first slice, the other slices of the picture have the same reference flag
+	while( nonReference < 0 )
+	{
+		size_t nal = 0;
+
+		if( mLengthSize > 0 )
+		{
+			// avc / hvc1, each NAL unit is prefixed with its size
+			if( offset + mLengthSize > size )
+				break;
+
+			size_t length = 0;
+
+			for( uint32_t n=0; n < mLengthSize; n++ )
+				length = (length << 8) | data[offset + n];
+
+			nal = offset + mLengthSize;
+			offset = nal + length;
+		}
+		else
+		{
+			// byte-stream, each NAL unit starts after a 00 00 01 start code
+			while( offset + 3 <= size && !(data[offset] == 0 && data[offset+1] == 0 && data[offset+2] == 1) )
+				offset++;
+
+			if( offset + 3 > size )
+				break;
+
+			nal = offset + 3;
+			offset = nal;
+		}
+
+		if( nal >= size )
+			break;
+
+		if( mCodec == VIDEO_CODEC_H264 )
+		{
+			const uint8_t type = data[nal] & 0x1F;
+
+			if( type >= 1 && type <= 5 )
+				nonReference = ((data[nal] >> 5) & 0x03) == 0 ? 1 : 0;
+		}
+		else
+		{
+			// the even VCL types up to 14 are sub-layer non-reference pictures
+			const uint8_t type = (data[nal] >> 1) & 0x3F;
+
+			if( type <= 31 )
+				nonReference = (type <= 14 && (type & 1) == 0) ? 1 : 0;
+		}
+	}
+
+	gst_buffer_unmap(buffer, &map);
+	return nonReference == 1;
+}
+
+
+// parseCaps
+void gstFrameSkipper::parseCaps( GstCaps* caps )
+{
+	mParseNAL   = false;
+	mLengthSize = 0;
+
+	if( !caps || gst_caps_get_size(caps) == 0 )
+		return;
+
+	const GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+	if( gst_structure_has_name(structure, "video/x-h264") )
+		mCodec = VIDEO_CODEC_H264;
+	else if( gst_structure_has_name(structure, "video/x-h265") )
+		mCodec = VIDEO_CODEC_H265;
+	else
+		return;
+
+	mParseNAL = true;
+
+	const char* format = gst_structure_get_string(structure, "stream-format");
+
+	if( !format || strcmp(format, "byte-stream") == 0 )
+		return;
+
+	// the size of the length prefix is in the codec_data (avcC or hvcC), 4 bytes unless it says otherwise
+	mLengthSize = 4;
+
+	const GValue* value = gst_structure_get_value(structure, "codec_data");
+
+	if( !value || !GST_VALUE_HOLDS_BUFFER(value) )
+		return;
+
+	GstBuffer* codecData = gst_value_get_buffer(value);
+	GstMapInfo map;
+
+	if( !gst_buffer_map(codecData, &map, GST_MAP_READ) )
+		return;
+
+	const size_t index = (mCodec == VIDEO_CODEC_H265) ? 21 : 4;
+
+	if( map.size > index )
+		mLengthSize = (map.data[index] & 0x03) + 1;
+
+	gst_buffer_unmap(codecData, &map);
+}
@@ -0,0 +1,105 @@
+#ifndef __GSTREAMER_FRAME_SKIPPER_H__
+#define __GSTREAMER_FRAME_SKIPPER_H__
+
+#include "gstPipelineBuilder.h"
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <stdint.h>
+
+
+/**
+ * Which compressed frames are sent to the decoder.
+ */
+enum gstDecodeMode
+{
+	DECODE_ALL = 0,		/**< decode every frame */
+	DECODE_REFERENCE,		/**< skip the frames no other frame depends on */
+	DECODE_KEYFRAMES		/**< decode the keyframes only */
+};
+
+
+/**
+ * Lowers the decoding cost of a stream by dropping compressed frames
+ * before they reach the decoder, with a buffer probe on its sink pad.
+ *
+ * Only frames that nothing else refers to are dropped, so the decoded
+ * frames stay intact, whichever decoder is used (software or hardware):
+ *
+ *   - DECODE_REFERENCE drops the access units whose slices all have
+ *     nal_ref_idc == 0 (H.264) or are sub-layer non-reference pictures
+ *     (H.265 TRAIL_N, RASL_N, ...), typically the B-frames.
+ *   - DECODE_KEYFRAMES drops every delta unit, leaving 1 frame per GOP.
+ *
+ * When going back from DECODE_KEYFRAMES, delta units keep being dropped
+ * until the next keyframe, since their references were never decoded.
+ * The codec is read from the caps, MJPEG streams are all keyframes, so
+ * nothing is dropped from them.
+ *
+ * The mode can be changed from any thread while the pipeline runs.
+ */
+class gstFrameSkipper
+{
+public:
+	/**
+	 * Attach to the sink pad of a decoder element (or of a decodebin).
+	 * @returns NULL if the element has no sink pad, e.g. uridecodebin.
+	 */
+	static gstFrameSkipper* Create( GstElement* decoder );
+
+	/**
+	 * Remove the probe.
+	 */
+	~gstFrameSkipper();
+
+	/**
+	 * Change which frames are decoded.
+	 */
+	void SetMode( gstDecodeMode mode );
+
+	/**
+	 * Which frames are decoded.
+	 */
+	inline gstDecodeMode GetMode() const		{ return mMode.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of frames sent to the decoder.
+	 */
+	inline uint64_t GetDecoded() const		{ return mDecoded.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of frames dropped before the decoder.
+	 */
+	inline uint64_t GetSkipped() const		{ return mSkipped.load(std::memory_order_relaxed); }
+
+	/**
+	 * Convert a mode to its name (all, reference, keyframes).
+	 */
+	static const char* ModeToStr( gstDecodeMode mode );
+
+private:
+	gstFrameSkipper( GstPad* pad );
+
+	static GstPadProbeReturn onBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+	static gboolean onBufferList( GstBuffer** buffer, guint index, gpointer user_data );
+
+	bool skipBuffer( GstBuffer* buffer );
+	bool isNonReference( GstBuffer* buffer ) const;
+	void parseCaps( GstCaps* caps );
+
+	GstPad* mPad;
+	gulong  mProbe;
+
+	std::atomic<gstDecodeMode> mMode;
+	std::atomic<uint64_t> mDecoded;
+	std::atomic<uint64_t> mSkipped;
+
+	// only accessed from the streaming thread
+	bool          mWaitKeyframe;
+	bool          mParseNAL;	// H.264 or H.265
+	gstVideoCodec mCodec;
+	uint32_t      mLengthSize;	// NAL length prefix size (avc/hvc1), 0 for byte-stream
+};
+
+#endif
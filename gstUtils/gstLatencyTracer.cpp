@@ -0,0 +1,655 @@
+#include "gstLatencyTracer.h"
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdio.h>
+
+
+// number of recent frames each stage remembers, for the next stage to match
+#define LATENCY_HISTORY 256
+
+
+// constructor
+gstLatencyHistogram::gstLatencyHistogram()
+{
+	Reset();
+}
+
+
+// Add
+void gstLatencyHistogram::Add( uint64_t ns )
+{
+	const double us = ns * 0.001;
+	uint32_t bucket = 0;
+
+	if( us >= 1.0 )
+		bucket = std::min((uint32_t)(log2(us) * 4.0) + 1, NumBuckets - 1);
+
+	mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	mSum.fetch_add(ns, std::memory_order_relaxed);
+
+	uint64_t max = mMax.load(std::memory_order_relaxed);
+
+	while( ns > max && !mMax.compare_exchange_weak(max, ns, std::memory_order_relaxed) );
+}
+
+
+// GetStats
+void gstLatencyHistogram::GetStats( gstLatencyStats& stats ) const
+{
+	uint64_t buckets[NumBuckets];
+	uint64_t count = 0;
+
+	for( uint32_t n=0; n < NumBuckets; n++ )
+	{
+		buckets[n] = mBuckets[n].load(std::memory_order_relaxed);
+		count += buckets[n];
+	}
+
+	stats.count  = count;
+	stats.missed = mMissed.load(std::memory_order_relaxed);
+	stats.max    = mMax.load(std::memory_order_relaxed) * 1e-6f;
+	stats.mean   = count > 0 ? mSum.load(std::memory_order_relaxed) / (double)count * 1e-6 : 0.0f;
+
+	const double percentiles[] = { 0.50, 0.90, 0.99 };
+	float* results[] = { &stats.p50, &stats.p90, &stats.p99 };
+
+	for( uint32_t p=0; p < 3; p++ )
+	{
+		const uint64_t rank = (uint64_t)ceil(percentiles[p] * count);
+		uint64_t total = 0;
+
+		*results[p] = 0.0f;
+
+		for( uint32_t n=0; n < NumBuckets && count > 0; n++ )
+		{
+			total += buckets[n];
+
+			if( total >= rank )
+			{
+				// upper edge of the bucket, in ms
+				*results[p] = std::min((float)((n > 0 ? pow(2.0, n / 4.0) : 1.0) * 0.001), stats.max);
+				break;
+			}
+		}
+	}
+}
+
+
+// Reset
+void gstLatencyHistogram::Reset()
+{
+	for( uint32_t n=0; n < NumBuckets; n++ )
+		mBuckets[n] = 0;
+
+	mMissed = 0;
+	mSum    = 0;
+	mMax    = 0;
+}
+
+
+// a probed element, or an application stage
+struct gstLatencyTracer::Stage
+{
+	struct Frame
+	{
+		GstClockTime pts;
+		GstClockTime time;
+	};
+
+	std::string       name;
+	gstLatencyTracer* tracer;
+	Stage*            previous;
+
+	GstElement*          element;
+	gulong               padAdded;
+	std::vector<GstPad*> pads;
+	std::vector<gulong>  probes;
+
+	gstLatencyHistogram latency;
+	gstLatencyHistogram age;
+
+	// recent frames, guarded by mutex
+	Frame      history[LATENCY_HISTORY];
+	uint32_t   head;
+	std::mutex mutex;
+
+	Stage() : tracer(NULL), previous(NULL), element(NULL), padAdded(0), head(0)
+	{
+		for( uint32_t n=0; n < LATENCY_HISTORY; n++ )
+			history[n].pts = GST_CLOCK_TIME_NONE;
+	}
+
+	// store the time the frame went through, unless it already did
+	// (e.g. several RTP packets of the same frame)
+	bool add( GstClockTime pts, GstClockTime time )
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Frame& last = history[(head + LATENCY_HISTORY - 1) % LATENCY_HISTORY];
+
+		if( last.pts == pts )
+			return false;
+
+		history[head].pts  = pts;
+		history[head].time = time;
+		head = (head + 1) % LATENCY_HISTORY;
+		return true;
+	}
+
+	// when the frame went through, searching from the most recent
+	bool find( GstClockTime pts, GstClockTime* time )
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for( uint32_t n=1; n <= LATENCY_HISTORY; n++ )
+		{
+			const Frame& frame = history[(head + LATENCY_HISTORY - n) % LATENCY_HISTORY];
+
+			if( frame.pts == pts )
+			{
+				*time = frame.time;
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+
+// frames measured across several stages
+struct gstLatencyTracer::Span
+{
+	std::string name;
+	std::string first;
+	std::string last;
+
+	// the stage before `first`, and `last` (NULL until attached, or if not found)
+	Stage* from;
+	Stage* to;
+
+	gstLatencyHistogram latency;
+
+	Span() : from(NULL), to(NULL)	{}
+};
+
+
+// constructor
+gstLatencyTracer::gstLatencyTracer( GstElement* pipeline, const char* name )
+{
+	mPipeline = pipeline;
+	mName     = name != NULL ? name : "gstLatencyTracer";
+	mAttached = false;
+	mClock    = NULL;
+	mBaseTime = 0;
+
+	gst_object_ref(mPipeline);
+}
+
+
+// destructor
+gstLatencyTracer::~gstLatencyTracer()
+{
+	Detach();
+
+	for( size_t n=0; n < mSpans.size(); n++ )
+		delete mSpans[n];
+
+	for( size_t n=0; n < mClocks.size(); n++ )
+		gst_object_unref(mClocks[n]);
+
+	gst_object_unref(mPipeline);
+}
+
+
+// Create
+gstLatencyTracer* gstLatencyTracer::Create( GstElement* pipeline, const char* name )
+{
+	if( !pipeline || !GST_IS_BIN(pipeline) )
+		return NULL;
+
+	return new gstLatencyTracer(pipeline, name);
+}
+
+
+// AddStage
+uint32_t gstLatencyTracer::AddStage( const char* name )
+{
+	mAppStages.push_back(name != NULL ? name : "app");
+	return mAppStages.size() - 1;
+}
+
+
+// AddSpan
+uint32_t gstLatencyTracer::AddSpan( const char* name, const char* first, const char* last )
+{
+	Span* span = new Span();
+
+	span->name  = name != NULL ? name : "span";
+	span->first = first != NULL ? first : "";
+	span->last  = last != NULL ? last : "";
+
+	mSpans.push_back(span);
+	return mSpans.size() - 1;
+}
+
+
+// Attach
+bool gstLatencyTracer::Attach()
+{
+	if( mAttached )
+		return true;
+
+	// sorted from the sinks to the sources
+	std::vector<GstElement*> elements;
+
+	GstIterator* iter = gst_bin_iterate_sorted(GST_BIN(mPipeline));
+	GValue item = G_VALUE_INIT;
+	bool done = false;
+
+	while( !done )
+	{
+		switch( gst_iterator_next(iter, &item) )
+		{
+			case GST_ITERATOR_OK:
+				elements.push_back(GST_ELEMENT(gst_object_ref(g_value_get_object(&item))));
+				g_value_reset(&item);
+				break;
+			case GST_ITERATOR_RESYNC:
+				for( size_t n=0; n < elements.size(); n++ )
+					gst_object_unref(elements[n]);
+
+				elements.clear();
+				gst_iterator_resync(iter);
+				break;
+			default:
+				done = true;
+				break;
+		}
+	}
+
+	g_value_unset(&item);
+	gst_iterator_free(iter);
+
+	if( elements.empty() )
+	{
+		printf("%s -- no elements to trace latency in\n", mName.c_str());
+		return false;
+	}
+
+	std::reverse(elements.begin(), elements.end());
+
+	// sources that aren't linked yet (rtspsrc) can't be sorted, but come first anyway
+	std::stable_partition(elements.begin(), elements.end(), [](GstElement* element) { return element->numsinkpads == 0; });
+
+	// one stage per element, then the application stages
+	for( size_t n=0; n < elements.size() + mAppStages.size(); n++ )
+	{
+		Stage* stage = new Stage();
+
+		stage->tracer   = this;
+		stage->previous = mStages.empty() ? NULL : mStages.back();
+
+		if( n < elements.size() )
+		{
+			stage->element = elements[n];
+			stage->name    = GST_ELEMENT_NAME(stage->element);
+		}
+		else
+		{
+			stage->name = mAppStages[n - elements.size()];
+		}
+
+		mStages.push_back(stage);
+	}
+
+	// a span starts when the frame leaves the stage before its first one
+	for( size_t n=0; n < mSpans.size(); n++ )
+	{
+		Span* span = mSpans[n];
+
+		for( size_t m=1; m < mStages.size(); m++ )
+		{
+			if( mStages[m]->name == span->first )
+				span->from = mStages[m - 1];
+
+			if( mStages[m]->name == span->last )
+				span->to = mStages[m];
+		}
+
+		if( !span->from || !span->to )
+			printf("%s -- can't measure %s, %s or %s isn't traced\n", mName.c_str(), span->name.c_str(), span->first.c_str(), span->last.c_str());
+	}
+
+	for( size_t n=0; n < elements.size(); n++ )
+	{
+		Stage* stage = mStages[n];
+
+		// sinks are traced on the way in, the other elements on the way out
+		if( GST_OBJECT_FLAG_IS_SET(stage->element, GST_ELEMENT_FLAG_SINK) )
+		{
+			GstPad* pad = gst_element_get_static_pad(stage->element, "sink");
+
+			if( pad != NULL )
+			{
+				addProbe(stage, pad);
+				gst_object_unref(pad);
+			}
+
+			continue;
+		}
+
+		GstIterator* pads = gst_element_iterate_src_pads(stage->element);
+		GValue padItem = G_VALUE_INIT;
+
+		while( gst_iterator_next(pads, &padItem) == GST_ITERATOR_OK )
+		{
+			addProbe(stage, GST_PAD(g_value_get_object(&padItem)));
+			g_value_reset(&padItem);
+		}
+
+		g_value_unset(&padItem);
+		gst_iterator_free(pads);
+
+		// rtspsrc, decodebin and demuxers create their src pads once streaming
+		stage->padAdded = g_signal_connect(stage->element, "pad-added", G_CALLBACK(onPadAdded), stage);
+	}
+
+	printf("%s -- tracing latency through %zu stages\n", mName.c_str(), mStages.size());
+
+	// attached to a pipeline that's already playing, there won't be a state change to cache the clock on
+	if( GST_STATE(mPipeline) == GST_STATE_PLAYING )
+		updateClock();
+
+	mAttached = true;
+	return true;
+}
+
+
+// Detach
+void gstLatencyTracer::Detach()
+{
+	for( size_t n=0; n < mStages.size(); n++ )
+	{
+		Stage* stage = mStages[n];
+
+		if( stage->padAdded != 0 )
+			g_signal_handler_disconnect(stage->element, stage->padAdded);
+
+		{
+			std::lock_guard<std::mutex> lock(stage->mutex);
+
+			for( size_t p=0; p < stage->pads.size(); p++ )
+			{
+				gst_pad_remove_probe(stage->pads[p], stage->probes[p]);
+				gst_object_unref(stage->pads[p]);
+			}
+		}
+
+		if( stage->element != NULL )
+			gst_object_unref(stage->element);
+
+		delete stage;
+	}
+
+	for( size_t n=0; n < mSpans.size(); n++ )
+	{
+		mSpans[n]->from = NULL;
+		mSpans[n]->to   = NULL;
+	}
+
+	mStages.clear();
+	mAttached = false;
+}
+
+
+// addProbe
+void gstLatencyTracer::addProbe( Stage* stage, GstPad* pad )
+{
+	const gulong probe = gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST), onBuffer, stage, NULL);
+
+	if( probe == 0 )
+		return;
+
+	std::lock_guard<std::mutex> lock(stage->mutex);
+
+	stage->pads.push_back(GST_PAD(gst_object_ref(pad)));
+	stage->probes.push_back(probe);
+}
+
+
+// onPadAdded
+void gstLatencyTracer::onPadAdded( GstElement* element, GstPad* pad, gpointer user_data )
+{
+	Stage* stage = (Stage*)user_data;
+
+	if( GST_PAD_IS_SRC(pad) )
+		stage->tracer->addProbe(stage, pad);
+}
+
+
+// onBuffer
+GstPadProbeReturn gstLatencyTracer::onBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data )
+{
+	Stage* stage = (Stage*)user_data;
+	GstBuffer* buffer = NULL;
+
+	if( info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST )
+	{
+		GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+
+		if( list != NULL && gst_buffer_list_length(list) > 0 )
+			buffer = gst_buffer_list_get(list, 0);
+	}
+	else
+	{
+		buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+	}
+
+	if( buffer != NULL && GST_BUFFER_PTS_IS_VALID(buffer) )
+		stage->tracer->record(stage, GST_BUFFER_PTS(buffer));
+
+	return GST_PAD_PROBE_OK;
+}
+
+
+// HandleMessage
+void gstLatencyTracer::HandleMessage( GstMessage* msg )
+{
+	switch( GST_MESSAGE_TYPE(msg) )
+	{
+		case GST_MESSAGE_STATE_CHANGED:
+		{
+			if( GST_MESSAGE_SRC(msg) != GST_OBJECT(mPipeline) )
+				break;
+
+			GstState oldState, newState;
+			gst_message_parse_state_changed(msg, &oldState, &newState, NULL);
+
+			// the base time changes every time the pipeline goes back to PLAYING
+			if( newState == GST_STATE_PLAYING )
+				updateClock();
+			else if( oldState == GST_STATE_PLAYING )
+				mClock.store(NULL, std::memory_order_release);
+
+			break;
+		}
+		case GST_MESSAGE_NEW_CLOCK:
+			updateClock();
+			break;
+		case GST_MESSAGE_CLOCK_LOST:
+			mClock.store(NULL, std::memory_order_release);
+			break;
+		default:
+			break;
+	}
+}
+
+
+// updateClock
+void gstLatencyTracer::updateClock()
+{
+	GstClock* clock = gst_element_get_clock(mPipeline);
+
+	mBaseTime.store(gst_element_get_base_time(mPipeline), std::memory_order_relaxed);
+
+	if( clock != NULL )
+	{
+		std::lock_guard<std::mutex> lock(mClockMutex);
+
+		// keep the reference until the destructor, a probe may still be reading the previous clock
+		if( std::find(mClocks.begin(), mClocks.end(), clock) == mClocks.end() )
+			mClocks.push_back(clock);
+		else
+			gst_object_unref(clock);
+	}
+
+	mClock.store(clock, std::memory_order_release);
+}
+
+
+// Record
+void gstLatencyTracer::Record( uint32_t stage, GstClockTime pts )
+{
+	if( stage >= mAppStages.size() || !mAttached || !GST_CLOCK_TIME_IS_VALID(pts) )
+		return;
+
+	// the application stages are the last ones
+	record(mStages[mStages.size() - mAppStages.size() + stage], pts);
+}
+
+
+// record
+void gstLatencyTracer::record( Stage* stage, GstClockTime pts )
+{
+	GstClock* clock = mClock.load(std::memory_order_acquire);
+
+	// not playing yet
+	if( !clock )
+		return;
+
+	const GstClockTime now = gst_clock_get_time(clock);
+	const GstClockTime base = mBaseTime.load(std::memory_order_relaxed);
+
+	if( !stage->add(pts, now) )
+		return;
+
+	// running time of live streams starts at 0, so base_time + PTS is the
+	// clock time the frame was captured (or received) at
+	if( now >= base + pts )
+		stage->age.Add(now - base - pts);
+
+	for( size_t n=0; n < mSpans.size(); n++ )
+	{
+		Span* span = mSpans[n];
+		GstClockTime begin = 0;
+
+		if( span->to != stage )
+			continue;
+
+		if( span->from->find(pts, &begin) && now >= begin )
+			span->latency.Add(now - begin);
+		else
+			span->latency.Miss();
+	}
+
+	if( !stage->previous )
+		return;
+
+	GstClockTime previous = 0;
+
+	if( stage->previous->find(pts, &previous) && now >= previous )
+		stage->latency.Add(now - previous);
+	else
+		stage->latency.Miss();
+}
+
+
+// GetStageName
+const char* gstLatencyTracer::GetStageName( uint32_t stage ) const
+{
+	if( stage >= mStages.size() )
+		return NULL;
+
+	return mStages[stage]->name.c_str();
+}
+
+
+// GetLatency
+bool gstLatencyTracer::GetLatency( uint32_t stage, gstLatencyStats& stats ) const
+{
+	if( stage >= mStages.size() )
+		return false;
+
+	mStages[stage]->latency.GetStats(stats);
+	return true;
+}
+
+
+// GetAge
+bool gstLatencyTracer::GetAge( uint32_t stage, gstLatencyStats& stats ) const
+{
+	if( stage >= mStages.size() )
+		return false;
+
+	mStages[stage]->age.GetStats(stats);
+	return true;
+}
+
+
+// GetSpan
+bool gstLatencyTracer::GetSpan( uint32_t span, gstLatencyStats& stats ) const
+{
+	if( span >= mSpans.size() || !mSpans[span]->to )
+		return false;
+
+	mSpans[span]->latency.GetStats(stats);
+	return true;
+}
+
+
+// Reset
+void gstLatencyTracer::Reset()
+{
+	for( size_t n=0; n < mStages.size(); n++ )
+	{
+		mStages[n]->latency.Reset();
+		mStages[n]->age.Reset();
+	}
+
+	for( size_t n=0; n < mSpans.size(); n++ )
+		mSpans[n]->latency.Reset();
+}
+
+
+// Print
+void gstLatencyTracer::Print() const
+{
+	printf("%s -- latency per stage (ms)         count    mean     p50     p90     p99     max  |  age p50     p99\n", mName.c_str());
+
+	for( size_t n=0; n < mStages.size(); n++ )
+	{
+		gstLatencyStats latency;
+		gstLatencyStats age;
+
+		mStages[n]->latency.GetStats(latency);
+		mStages[n]->age.GetStats(age);
+
+		printf("%s --   %-28s %8llu %7.2f %7.2f %7.2f %7.2f %7.2f  |  %7.2f %7.2f\n", mName.c_str(), mStages[n]->name.c_str(),
+			(unsigned long long)latency.count, latency.mean, latency.p50, latency.p90, latency.p99, latency.max, age.p50, age.p99);
+	}
+
+	for( size_t n=0; n < mSpans.size(); n++ )
+	{
+		gstLatencyStats latency;
+
+		if( !GetSpan(n, latency) )
+			continue;
+
+		const std::string name = mSpans[n]->name + " (" + mSpans[n]->first + " to " + mSpans[n]->last + ")";
+
+		printf("%s --   %-28s %8llu %7.2f %7.2f %7.2f %7.2f %7.2f\n", mName.c_str(), name.c_str(),
+			(unsigned long long)latency.count, latency.mean, latency.p50, latency.p90, latency.p99, latency.max);
+	}
+}
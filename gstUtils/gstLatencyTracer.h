@@ -0,0 +1,216 @@
+#ifndef __GSTREAMER_LATENCY_TRACER_H__
+#define __GSTREAMER_LATENCY_TRACER_H__
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Summary of a latency histogram, in milliseconds.
+ */
+struct gstLatencyStats
+{
+	uint64_t count;	/**< number of samples */
+	uint64_t missed;	/**< buffers that couldn't be matched with the previous stage */
+	float    mean;
+	float    p50;
+	float    p90;
+	float    p99;
+	float    max;
+};
+
+
+/**
+ * Lock-free histogram of latencies, with 4 logarithmic buckets per octave
+ * from 1 us to ~28 s (so percentiles are within 19% of the actual value).
+ * Add() can be called from any thread.
+ */
+class gstLatencyHistogram
+{
+public:
+	gstLatencyHistogram();
+
+	/**
+	 * Add a sample, in nanoseconds.
+	 */
+	void Add( uint64_t ns );
+
+	/**
+	 * Count a buffer that couldn't be measured.
+	 */
+	inline void Miss()				{ mMissed.fetch_add(1, std::memory_order_relaxed); }
+
+	/**
+	 * Compute the mean, percentiles and max.
+	 */
+	void GetStats( gstLatencyStats& stats ) const;
+
+	/**
+	 * Remove all the samples.
+	 */
+	void Reset();
+
+	static const uint32_t NumBuckets = 100;
+
+private:
+	std::atomic<uint64_t> mBuckets[NumBuckets];
+	std::atomic<uint64_t> mMissed;
+	std::atomic<uint64_t> mSum;
+	std::atomic<uint64_t> mMax;
+};
+
+
+/**
+ * Measures where the latency of a pipeline is spent.
+ *
+ * A buffer probe on the src pads of every element (and on the sink pad of
+ * the sinks) reads the pipeline clock as each buffer goes through.  Buffers
+ * are matched across stages by their PTS, which the depayloaders, parsers
+ * and decoders carry over, so each stage reports two histograms:
+ *
+ *   - latency: time since the same frame left the previous stage
+ *   - age:     time since the frame's timestamp, base_time + PTS, which for
+ *              live sources is when it was captured or received (glass-to-stage)
+ *
+ * Stages that aren't elements (e.g. the application dequeuing the frame)
+ * can be added with AddStage() and recorded with Record().  The time each
+ * frame spends across several stages (e.g. from the decoder to the appsink)
+ * is measured per frame by a span, see AddSpan().
+ *
+ * Nothing is installed until Attach() is called, so a pipeline that isn't
+ * traced pays nothing.  When attached, each buffer costs a clock read and a
+ * short uncontended lock per stage.  The pipeline clock and base time are
+ * cached when the pipeline reaches PLAYING, so the pipeline's bus messages
+ * must be passed to HandleMessage() from a sync handler.
+ */
+class gstLatencyTracer
+{
+public:
+	/**
+	 * Create a tracer for a pipeline.  The probes are installed by Attach().
+	 * @param name prefix of the log messages (e.g. "gstDecoder")
+	 */
+	static gstLatencyTracer* Create( GstElement* pipeline, const char* name );
+
+	/**
+	 * Remove the probes.
+	 */
+	~gstLatencyTracer();
+
+	/**
+	 * Add a stage recorded by the application with Record().  Application
+	 * stages come after the pipeline's, in the order they're added.
+	 * Must be called before Attach().
+	 * @returns the id to pass to Record() (not the index of the stage).
+	 */
+	uint32_t AddStage( const char* name );
+
+	/**
+	 * Measure the time each frame takes from entering stage `first` (leaving
+	 * the stage before it) until it leaves stage `last` (or reaches it, for
+	 * sinks), by the element or application stage names.
+	 * Must be called before Attach().
+	 * @returns the id to pass to GetSpan().
+	 */
+	uint32_t AddSpan( const char* name, const char* first, const char* last );
+
+	/**
+	 * Install the probes on every element of the pipeline, in upstream to
+	 * downstream order.  Src pads added later (e.g. by rtspsrc) are traced too.
+	 */
+	bool Attach();
+
+	/**
+	 * Remove the probes.  The pipeline should be stopped.
+	 */
+	void Detach();
+
+	/**
+	 * Keep the cached clock and base time up to date, from a bus sync handler.
+	 * They're read when the pipeline reaches PLAYING or selects a new clock,
+	 * and dropped when it leaves PLAYING or loses its clock.  Until then,
+	 * buffers aren't measured.
+	 */
+	void HandleMessage( GstMessage* msg );
+
+	/**
+	 * Record the frame with timestamp `pts` going through an application stage,
+	 * identified by the id returned by AddStage().
+	 */
+	void Record( uint32_t stage, GstClockTime pts );
+
+	/**
+	 * Number of stages, valid once attached.
+	 */
+	inline uint32_t GetNumStages() const		{ return (uint32_t)mStages.size(); }
+
+	/**
+	 * Name of a stage (the element name for pipeline stages).
+	 */
+	const char* GetStageName( uint32_t stage ) const;
+
+	/**
+	 * Latency of a stage since the previous one.
+	 */
+	bool GetLatency( uint32_t stage, gstLatencyStats& stats ) const;
+
+	/**
+	 * Age of the frames at a stage, since their timestamp.
+	 */
+	bool GetAge( uint32_t stage, gstLatencyStats& stats ) const;
+
+	/**
+	 * Time per frame across the stages of a span, see AddSpan().
+	 * @returns `false` if there is no such span, or its stages weren't found.
+	 */
+	bool GetSpan( uint32_t span, gstLatencyStats& stats ) const;
+
+	/**
+	 * Clear the histograms of every stage and span.
+	 */
+	void Reset();
+
+	/**
+	 * Print the latency and age of every stage, followed by the spans.
+	 */
+	void Print() const;
+
+	/**
+	 * Returns true if the probes are installed.
+	 */
+	inline bool IsAttached() const			{ return mAttached; }
+
+private:
+	gstLatencyTracer( GstElement* pipeline, const char* name );
+
+	struct Stage;
+	struct Span;
+
+	static GstPadProbeReturn onBuffer( GstPad* pad, GstPadProbeInfo* info, gpointer user_data );
+	static void onPadAdded( GstElement* element, GstPad* pad, gpointer user_data );
+
+	void addProbe( Stage* stage, GstPad* pad );
+	void record( Stage* stage, GstClockTime pts );
+	void updateClock();
+
+	GstElement* mPipeline;
+	std::string mName;
+
+	std::vector<Stage*>      mStages;
+	std::vector<std::string> mAppStages;
+	std::vector<Span*>       mSpans;
+	bool                     mAttached;
+
+	// the clocks are only released by the destructor, so the probes can use mClock without a reference
+	std::atomic<GstClock*>    mClock;
+	std::atomic<GstClockTime> mBaseTime;
+	std::vector<GstClock*>    mClocks;
+	std::mutex                mClockMutex;
+};
+
+#endif
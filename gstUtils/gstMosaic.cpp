@@ -0,0 +1,203 @@
+#include "gstMosaic.h"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <system_error>
+#include <math.h>
+#include <stdio.h>
+
+
+// how long the render thread pumps GUI events at a time while waiting for the next refresh (ms)
+#define MOSAIC_IDLE_TIMEOUT 10
+
+
+// constructor
+gstMosaic::gstMosaic( const char* title, uint32_t tiles, uint32_t width, uint32_t height, float refreshRate, yuvInterpolation interp )
+{
+	mTitle         = title != NULL ? title : "mosaic";
+	mRefreshRate   = refreshRate;
+	mInterpolation = interp;
+	mRunning       = false;
+	mRendered      = 0;
+	mTilesUpdated  = 0;
+
+	// as many columns as rows, or one more
+	mColumns = (uint32_t)ceilf(sqrtf((float)tiles));
+
+	const uint32_t rows = (tiles + mColumns - 1) / mColumns;
+
+	mTileWidth  = width / mColumns;
+	mTileHeight = height / rows;
+
+	// black until the first frame of each tile
+	mCanvas = cv::Mat::zeros(mTileHeight * rows, mTileWidth * mColumns, CV_8UC3);
+
+	for( uint32_t n=0; n < tiles; n++ )
+		mTiles.push_back(std::unique_ptr< Mailbox<gstFrame::Ptr> >(new Mailbox<gstFrame::Ptr>()));
+}
+
+
+// destructor
+gstMosaic::~gstMosaic()
+{
+	Stop();
+}
+
+
+// Create
+gstMosaic* gstMosaic::Create( const char* title, uint32_t tiles, uint32_t width, uint32_t height, float refreshRate, yuvInterpolation interp )
+{
+	if( tiles == 0 || refreshRate <= 0.0f )
+	{
+		printf("gstMosaic -- invalid mosaic of %u tiles at %.1f Hz\n", tiles, refreshRate);
+		return NULL;
+	}
+
+	const uint32_t columns = (uint32_t)ceilf(sqrtf((float)tiles));
+	const uint32_t rows = (tiles + columns - 1) / columns;
+
+	if( width / columns == 0 || height / rows == 0 )
+	{
+		printf("gstMosaic -- a %ux%u window is too small for %u tiles\n", width, height, tiles);
+		return NULL;
+	}
+
+	gstMosaic* mosaic = new gstMosaic(title, tiles, width, height, refreshRate, interp);
+
+	printf("gstMosaic -- %u tiles of %ux%u (%ux%u grid) at %.1f Hz\n", tiles, mosaic->mTileWidth, mosaic->mTileHeight,
+		columns, rows, refreshRate);
+
+	return mosaic;
+}
+
+
+// Start
+bool gstMosaic::Start()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( mRunning )
+		return true;
+
+	mRunning = true;
+
+	try
+	{
+		mThread = std::thread(&gstMosaic::renderThread, this);
+	}
+	catch( const std::system_error& e )
+	{
+		printf("gstMosaic -- failed to start render thread (%s)\n", e.what());
+		mRunning = false;
+		return false;
+	}
+
+	return true;
+}
+
+
+// Stop
+void gstMosaic::Stop()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( !mRunning )
+		return;
+
+	mRunning = false;
+
+	if( mThread.joinable() )
+		mThread.join();
+
+	// release the decoders' buffers that were still pending
+	for( size_t n=0; n < mTiles.size(); n++ )
+		mTiles[n]->Clear();
+}
+
+
+// Render
+void gstMosaic::Render( uint32_t tile, const gstFrame::Ptr& frame )
+{
+	if( !frame || tile >= mTiles.size() || !mRunning.load(std::memory_order_relaxed) )
+		return;
+
+	mTiles[tile]->Post(frame);
+}
+
+
+// Clear
+void gstMosaic::Clear( uint32_t tile )
+{
+	if( tile < mTiles.size() )
+		mTiles[tile]->Clear();
+}
+
+
+// GetFramesSkipped
+uint64_t gstMosaic::GetFramesSkipped() const
+{
+	uint64_t skipped = 0;
+
+	for( size_t n=0; n < mTiles.size(); n++ )
+		skipped += mTiles[n]->GetSkipped();
+
+	return skipped;
+}
+
+
+// renderThread
+void gstMosaic::renderThread()
+{
+	const std::chrono::steady_clock::duration period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<float>(1.0f / mRefreshRate));
+
+	std::chrono::steady_clock::time_point nextRefresh = std::chrono::steady_clock::now();
+	bool shown = false;
+
+	while( mRunning.load(std::memory_order_acquire) )
+	{
+		uint32_t updated = 0;
+
+		for( uint32_t n=0; n < mTiles.size(); n++ )
+		{
+			gstFrame::Ptr frame;
+
+			if( !mTiles[n]->Wait(frame, 0) )
+				continue;
+
+			// convert only at tile resolution, straight into the tile's region of the canvas
+			uint8_t* tile = mCanvas.ptr((n / mColumns) * mTileHeight) + (n % mColumns) * mTileWidth * 3;
+
+			if( frame->ToBGR(tile, (uint32_t)mCanvas.step, mTileWidth, mTileHeight, mInterpolation) )
+				updated++;
+		}
+
+		if( updated > 0 )
+		{
+			cv::imshow(mTitle, mCanvas);
+			mRendered++;
+			mTilesUpdated += updated;
+			shown = true;
+		}
+
+		// keep the window responsive until the next refresh, and catch up without bursting if late
+		nextRefresh += period;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if( nextRefresh < now )
+			nextRefresh = now;
+
+		do
+		{
+			const int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextRefresh - now).count();
+
+			cv::waitKey(remaining > MOSAIC_IDLE_TIMEOUT ? MOSAIC_IDLE_TIMEOUT : (remaining > 0 ? (int)remaining : 1));
+			now = std::chrono::steady_clock::now();
+		}
+		while( now < nextRefresh && mRunning.load(std::memory_order_acquire) );
+	}
+
+	if( shown )
+		cv::destroyWindow(mTitle);
+}
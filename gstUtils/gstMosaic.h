@@ -0,0 +1,135 @@
+#ifndef __GSTREAMER_MOSAIC_H__
+#define __GSTREAMER_MOSAIC_H__
+
+#include "Mailbox.h"
+#include "gstFrame.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Preview window showing many streams at once, one tile per stream.
+ *
+ * Each tile has a single-slot mailbox like gstRenderer, so Render() never
+ * blocks the streaming thread.  The render thread wakes up at a fixed
+ * refresh rate, converts the latest frame of each tile from NV12 (or I420)
+ * straight into its region of a canvas allocated once, at tile resolution,
+ * and shows the canvas in one window.
+ *
+ * The canvas size and refresh rate bound the work: converting every tile
+ * is one canvas worth of pixels per refresh however many streams there
+ * are, and frames that arrive between two refreshes are skipped.
+ */
+class gstMosaic
+{
+public:
+	/**
+	 * Create the mosaic (it's shown once Start() is called).  The tiles are
+	 * laid out in a grid as close to square as possible.
+	 *
+	 * @param title       window title
+	 * @param tiles       number of tiles
+	 * @param width       width of the window, shared by the columns
+	 * @param height      height of the window, shared by the rows
+	 * @param refreshRate window updates per second
+	 * @param interp      resampling filter of the tiles
+	 */
+	static gstMosaic* Create( const char* title, uint32_t tiles, uint32_t width=DefaultWidth, uint32_t height=DefaultHeight,
+					      float refreshRate=10.0f, yuvInterpolation interp=YUV_INTERP_BILINEAR );
+
+	/**
+	 * Stop the render thread and close the window.
+	 */
+	~gstMosaic();
+
+	/**
+	 * Start the render thread.  Does nothing if it's already running.
+	 * @returns `false` if the thread couldn't be started.
+	 */
+	bool Start();
+
+	/**
+	 * Stop the render thread and close the window.
+	 */
+	void Stop();
+
+	/**
+	 * Queue a frame for a tile.  Never blocks, so it's safe to call from
+	 * the streaming thread.  Frames are ignored while the mosaic is stopped.
+	 */
+	void Render( uint32_t tile, const gstFrame::Ptr& frame );
+
+	/**
+	 * Release the frame waiting for a tile, e.g. when its stream closes.
+	 */
+	void Clear( uint32_t tile );
+
+	/**
+	 * Number of tiles.
+	 */
+	inline uint32_t GetNumTiles() const		{ return (uint32_t)mTiles.size(); }
+
+	/**
+	 * Size of a tile.
+	 */
+	inline uint32_t GetTileWidth() const		{ return mTileWidth; }
+	inline uint32_t GetTileHeight() const		{ return mTileHeight; }
+
+	/**
+	 * Number of times the window was updated.
+	 */
+	inline uint64_t GetFramesRendered() const	{ return mRendered.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of frames converted into their tile.
+	 */
+	inline uint64_t GetTilesUpdated() const	{ return mTilesUpdated.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of frames replaced by a newer one before they were displayed.
+	 */
+	uint64_t GetFramesSkipped() const;
+
+	/**
+	 * Returns true if the render thread is running.
+	 */
+	inline bool IsRunning() const			{ return mRunning.load(std::memory_order_acquire); }
+
+	/**
+	 * Default size of the window.
+	 */
+	static const uint32_t DefaultWidth  = 1280;
+	static const uint32_t DefaultHeight = 720;
+
+private:
+	gstMosaic( const char* title, uint32_t tiles, uint32_t width, uint32_t height, float refreshRate, yuvInterpolation interp );
+
+	void renderThread();
+
+	std::string mTitle;
+	uint32_t    mColumns;
+	uint32_t    mTileWidth;
+	uint32_t    mTileHeight;
+	float       mRefreshRate;
+
+	yuvInterpolation mInterpolation;
+
+	cv::Mat mCanvas;
+	std::vector< std::unique_ptr< Mailbox<gstFrame::Ptr> > > mTiles;
+
+	std::thread mThread;
+	std::mutex  mControlMutex;
+
+	std::atomic<bool>     mRunning;
+	std::atomic<uint64_t> mRendered;
+	std::atomic<uint64_t> mTilesUpdated;
+};
+
+#endif
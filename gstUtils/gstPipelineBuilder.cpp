@@ -0,0 +1,676 @@
+#include "gstPipelineBuilder.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * Known decoders, with a hand-assigned priority (not a measurement): hardware
+ * decoders first, then libav (which is multithreaded), then the reference
+ * software decoders.  On Windows d3d11h264dec decodes much faster than
+ * avdec_h264, which is itself faster than openh264dec.  Decoders missing from
+ * the table get their plugin rank instead, which puts them between libav
+ * (PRIMARY) and the slow software decoders.  Throughput measured on the
+ * machine by gstDecoder_bench takes precedence, see LoadThroughput().
+ */
+struct gstDecoderInfo
+{
+	gstVideoCodec codec;
+	const char*   element;
+	uint32_t      priority;
+	const char*   properties;	// set on the decoder
+	const char*   convert;		// downloads the frames to system memory
+};
+
+static const gstDecoderInfo gDecoders[] =
+{
+	{ VIDEO_CODEC_H264,  "nvv4l2decoder", 1000, "enable-max-performance=1", "nvvidconv ! video/x-raw" },
+	{ VIDEO_CODEC_H264,  "nvh264dec",     900,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "d3d11h264dec",  850,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "qsvh264dec",    800,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "msdkh264dec",   780,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "vah264dec",     750,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "vaapih264dec",  700,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "v4l2h264dec",   600,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "avdec_h264",    300,  NULL, NULL },
+	{ VIDEO_CODEC_H264,  "openh264dec",   100,  NULL, NULL },
+
+	{ VIDEO_CODEC_H265,  "nvv4l2decoder", 1000, "enable-max-performance=1", "nvvidconv ! video/x-raw" },
+	{ VIDEO_CODEC_H265,  "nvh265dec",     900,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "d3d11h265dec",  850,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "qsvh265dec",    800,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "msdkh265dec",   780,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "vah265dec",     750,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "vaapih265dec",  700,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "v4l2h265dec",   600,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "avdec_h265",    300,  NULL, NULL },
+	{ VIDEO_CODEC_H265,  "libde265dec",   100,  NULL, NULL },
+
+	{ VIDEO_CODEC_MJPEG, "nvv4l2decoder", 1000, "mjpeg=1", "nvvidconv ! video/x-raw" },
+	{ VIDEO_CODEC_MJPEG, "nvjpegdec",     900,  NULL, NULL },
+	{ VIDEO_CODEC_MJPEG, "d3d11jpegdec",  850,  NULL, NULL },
+	{ VIDEO_CODEC_MJPEG, "vajpegdec",     750,  NULL, NULL },
+	{ VIDEO_CODEC_MJPEG, "jpegdec",       300,  NULL, NULL },
+	{ VIDEO_CODEC_MJPEG, "avdec_mjpeg",   250,  NULL, NULL },
+};
+
+static const uint32_t gNumDecoders = sizeof(gDecoders) / sizeof(gstDecoderInfo);
+
+
+// name of the queue in front of the converter
+const char* gstPipelineBuilder::QueueName   = "outqueue";
+const char* gstPipelineBuilder::DecoderName = "decoder";
+const char* gstPipelineBuilder::ConvertName = "convert";
+const char* gstPipelineBuilder::ScaleName   = "scale";
+const char* gstPipelineBuilder::SourceName  = "source";
+const char* gstPipelineBuilder::DepayName   = "depay";
+
+// written by gstDecoder_bench --throughput, and read from the working directory
+const char* gstPipelineBuilder::DefaultThroughputFile = "gstDecoder_throughput.txt";
+
+
+// measured frames per second, by "<codec> <element>"
+static std::map<std::string, float> gThroughput;
+static std::mutex gThroughputMutex;
+static bool gThroughputLoaded = false;
+
+
+// throughputKey
+static std::string throughputKey( gstVideoCodec codec, const std::string& element )
+{
+	return std::string(gstPipelineBuilder::CodecToStr(codec)) + " " + element;
+}
+
+
+// findDecoder
+static const gstDecoderInfo* findDecoder( gstVideoCodec codec, const std::string& element )
+{
+	for( uint32_t n=0; n < gNumDecoders; n++ )
+	{
+		if( gDecoders[n].codec == codec && element == gDecoders[n].element )
+			return &gDecoders[n];
+	}
+
+	return NULL;
+}
+
+
+// codecCaps
+static const char* codecCaps( gstVideoCodec codec )
+{
+	switch( codec )
+	{
+		case VIDEO_CODEC_H264:  return "video/x-h264";
+		case VIDEO_CODEC_H265:  return "video/x-h265";
+		case VIDEO_CODEC_MJPEG: return "image/jpeg";
+	}
+
+	return NULL;
+}
+
+
+// codecParser
+static const char* codecParser( gstVideoCodec codec )
+{
+	switch( codec )
+	{
+		case VIDEO_CODEC_H264:  return "h264parse";
+		case VIDEO_CODEC_H265:  return "h265parse";
+		case VIDEO_CODEC_MJPEG: return "jpegparse";
+	}
+
+	return NULL;
+}
+
+
+// codecDepayloader
+static const char* codecDepayloader( gstVideoCodec codec )
+{
+	switch( codec )
+	{
+		case VIDEO_CODEC_H264:  return "rtph264depay";
+		case VIDEO_CODEC_H265:  return "rtph265depay";
+		case VIDEO_CODEC_MJPEG: return "rtpjpegdepay";
+	}
+
+	return NULL;
+}
+
+
+// CodecToStr
+const char* gstPipelineBuilder::CodecToStr( gstVideoCodec codec )
+{
+	switch( codec )
+	{
+		case VIDEO_CODEC_H264:  return "h264";
+		case VIDEO_CODEC_H265:  return "h265";
+		case VIDEO_CODEC_MJPEG: return "mjpeg";
+	}
+
+	return "unknown";
+}
+
+
+// RateToFraction
+bool gstPipelineBuilder::RateToFraction( float frameRate, gint* num, gint* den )
+{
+	if( frameRate <= 0.0f )
+		return false;
+
+	// gst_util_double_to_fraction() turns 29.97 into 2997/100, which no NTSC source advertises
+	const gint ntsc = (gint)roundf(frameRate * 1.001f);
+
+	if( fabsf(frameRate - ntsc * 1000.0f / 1001.0f) < 0.005f && fabsf(frameRate - (float)ntsc) > 0.005f )
+	{
+		*num = ntsc * 1000;
+		*den = 1001;
+		return true;
+	}
+
+	gst_util_double_to_fraction(frameRate, num, den);
+	return *num > 0 && *den > 0;
+}
+
+
+// ListDecoders
+std::vector<std::string> gstPipelineBuilder::ListDecoders( gstVideoCodec codec )
+{
+	struct Candidate
+	{
+		std::string element;
+		uint32_t    priority;
+		uint32_t    rank;
+		float       throughput;
+	};
+
+	std::vector<Candidate> candidates;
+
+	// the measurements of a previous gstDecoder_bench run, if any
+	{
+		std::lock_guard<std::mutex> lock(gThroughputMutex);
+
+		if( !gThroughputLoaded )
+		{
+			gThroughputLoaded = true;
+			loadThroughput(DefaultThroughputFile);
+		}
+	}
+
+	GstCaps* caps = gst_caps_from_string(codecCaps(codec));
+	GList* decoders = gst_element_factory_list_get_elements(GST_ELEMENT_FACTORY_TYPE_DECODER | GST_ELEMENT_FACTORY_TYPE_MEDIA_VIDEO | GST_ELEMENT_FACTORY_TYPE_MEDIA_IMAGE, GST_RANK_NONE);
+	GList* filtered = gst_element_factory_list_filter(decoders, caps, GST_PAD_SINK, FALSE);
+
+	for( GList* n=filtered; n != NULL; n = n->next )
+	{
+		GstElementFactory* factory = GST_ELEMENT_FACTORY(n->data);
+
+		Candidate candidate;
+
+		candidate.element = GST_OBJECT_NAME(factory);
+		candidate.rank    = gst_plugin_feature_get_rank(GST_PLUGIN_FEATURE(factory));
+		candidate.throughput = GetThroughput(codec, candidate.element);
+
+		const gstDecoderInfo* info = findDecoder(codec, candidate.element);
+
+		// unranked elements aren't meant to be autoplugged, unless we know them
+		if( info != NULL )
+			candidate.priority = info->priority;
+		else if( candidate.rank > GST_RANK_NONE || candidate.throughput > 0.0f )
+			candidate.priority = candidate.rank;
+		else
+			continue;
+
+		candidates.push_back(candidate);
+	}
+
+	gst_plugin_feature_list_free(filtered);
+	gst_plugin_feature_list_free(decoders);
+	gst_caps_unref(caps);
+
+	// measured decoders first, fastest first, then the others by priority
+	std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		const bool measuredA = a.throughput > 0.0f;
+		const bool measuredB = b.throughput > 0.0f;
+
+		if( measuredA != measuredB )
+			return measuredA;
+
+		if( measuredA && a.throughput != b.throughput )
+			return a.throughput > b.throughput;
+
+		if( a.priority != b.priority )
+			return a.priority > b.priority;
+
+		return a.rank > b.rank;
+	});
+
+	std::vector<std::string> elements;
+
+	for( size_t n=0; n < candidates.size(); n++ )
+		elements.push_back(candidates[n].element);
+
+	return elements;
+}
+
+
+// loadThroughput (with gThroughputMutex held)
+bool gstPipelineBuilder::loadThroughput( const char* path )
+{
+	if( !path )
+		return false;
+
+	FILE* file = fopen(path, "r");
+
+	if( !file )
+		return false;
+
+	char line[512];
+	uint32_t loaded = 0;
+
+	// "<codec> <element> <frames per second>" per line, # starts a comment
+	while( fgets(line, sizeof(line), file) != NULL )
+	{
+		char codec[32];
+		char element[256];
+		float fps = 0.0f;
+
+		if( line[0] == '#' || sscanf(line, "%31s %255s %f", codec, element, &fps) != 3 || fps <= 0.0f )
+			continue;
+
+		gThroughput[std::string(codec) + " " + element] = fps;
+		loaded++;
+	}
+
+	fclose(file);
+
+	printf("gstPipelineBuilder -- loaded the measured throughput of %u decoders from %s\n", loaded, path);
+	return true;
+}
+
+
+// LoadThroughput
+bool gstPipelineBuilder::LoadThroughput( const char* path )
+{
+	std::lock_guard<std::mutex> lock(gThroughputMutex);
+
+	gThroughputLoaded = true;
+	return loadThroughput(path);
+}
+
+
+// SaveThroughput
+bool gstPipelineBuilder::SaveThroughput( const char* path )
+{
+	if( !path )
+		return false;
+
+	FILE* file = fopen(path, "w");
+
+	if( !file )
+	{
+		printf("gstPipelineBuilder -- failed to write %s\n", path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(gThroughputMutex);
+
+	fprintf(file, "# decoder throughput measured by gstDecoder_bench (codec element fps)\n");
+
+	for( std::map<std::string, float>::const_iterator n=gThroughput.begin(); n != gThroughput.end(); n++ )
+		fprintf(file, "%s %.1f\n", n->first.c_str(), n->second);
+
+	fclose(file);
+	return true;
+}
+
+
+// SetThroughput
+void gstPipelineBuilder::SetThroughput( gstVideoCodec codec, const std::string& element, float fps )
+{
+	std::lock_guard<std::mutex> lock(gThroughputMutex);
+	gThroughput[throughputKey(codec, element)] = fps;
+}
+
+
+// GetThroughput
+float gstPipelineBuilder::GetThroughput( gstVideoCodec codec, const std::string& element )
+{
+	std::lock_guard<std::mutex> lock(gThroughputMutex);
+	std::map<std::string, float>::const_iterator n = gThroughput.find(throughputKey(codec, element));
+
+	return n != gThroughput.end() ? n->second : 0.0f;
+}
+
+
+// probeDecoder
+bool gstPipelineBuilder::probeDecoder( const std::string& element )
+{
+	static std::map<std::string, bool> probed;
+	static std::mutex mutex;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<std::string, bool>::iterator cached = probed.find(element);
+
+	if( cached != probed.end() )
+		return cached->second;
+
+	// hardware decoders are registered when their plugin is installed, but
+	// only open the device when they go to READY
+	GstElement* decoder = gst_element_factory_make(element.c_str(), NULL);
+	bool usable = false;
+
+	if( decoder != NULL )
+	{
+		usable = gst_element_set_state(decoder, GST_STATE_READY) != GST_STATE_CHANGE_FAILURE;
+		gst_element_set_state(decoder, GST_STATE_NULL);
+		gst_object_unref(decoder);
+	}
+
+	if( !usable )
+		printf("gstPipelineBuilder -- %s is unavailable, skipping it\n", element.c_str());
+
+	probed[element] = usable;
+	return usable;
+}
+
+
+// SelectDecoder
+std::string gstPipelineBuilder::SelectDecoder( gstVideoCodec codec )
+{
+	const std::vector<std::string> decoders = ListDecoders(codec);
+
+	for( size_t n=0; n < decoders.size(); n++ )
+	{
+		if( probeDecoder(decoders[n]) )
+		{
+			printf("gstPipelineBuilder -- selected %s decoder %s\n", CodecToStr(codec), decoders[n].c_str());
+			return decoders[n];
+		}
+	}
+
+	printf("gstPipelineBuilder -- no %s decoder available\n", CodecToStr(codec));
+	return "";
+}
+
+
+// buildDecoder
+std::string gstPipelineBuilder::buildDecoder( const Options& options )
+{
+	const std::string element = !options.decoder.empty() ? options.decoder : SelectDecoder(options.codec);
+
+	// let decodebin find whatever it can
+	if( element.empty() )
+		return std::string("decodebin name=") + DecoderName + " ! ";
+
+	std::ostringstream ss;
+	const gstDecoderInfo* info = findDecoder(options.codec, element);
+
+	ss << codecParser(options.codec) << " ! " << element << " name=" << DecoderName << " ";
+
+	if( info != NULL && info->properties != NULL )
+		ss << info->properties << " ";
+
+	// libav starts a thread per CPU for every stream otherwise
+	if( options.decoderThreads != 0 && element.compare(0, 6, "avdec_") == 0 )
+		ss << "max-threads=" << options.decoderThreads << " ";
+
+	ss << "! ";
+
+	if( info != NULL && info->convert != NULL )
+		ss << info->convert << " ! ";
+
+	return ss.str();
+}
+
+
+// outputRate (the frame rate delivered to the appsink, if it's set)
+static bool outputRate( const gstPipelineBuilder::Options& options, gint* num, gint* den )
+{
+	if( options.frameNum > 0 && options.frameDen > 0 )
+	{
+		*num = (gint)options.frameNum;
+		*den = (gint)options.frameDen;
+		return true;
+	}
+
+	return gstPipelineBuilder::RateToFraction(options.frameRate, num, den);
+}
+
+
+// matchSource
+static void matchSource( const char* sourceCaps, const gstPipelineBuilder::Options& options, bool* format, bool* size, bool* rate )
+{
+	*format = false;
+	*size   = false;
+	*rate   = false;
+
+	if( !sourceCaps || sourceCaps[0] == 0 )
+		return;
+
+	GstCaps* caps = gst_caps_from_string(sourceCaps);
+
+	if( !caps )
+		return;
+
+	if( gst_caps_get_size(caps) > 0 )
+	{
+		const GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+		// decoded formats aren't known in advance, only raw modes can skip the converter
+		if( gst_structure_has_name(structure, "video/x-raw") )
+		{
+			const char* sourceFormat = gst_structure_get_string(structure, "format");
+			*format = sourceFormat != NULL && options.format == sourceFormat;
+		}
+
+		gint width = 0;
+		gint height = 0;
+
+		*size = (options.width == 0 || options.height == 0) ||
+			   (gst_structure_get_int(structure, "width", &width) && gst_structure_get_int(structure, "height", &height) &&
+			    (uint32_t)width == options.width && (uint32_t)height == options.height);
+
+		gint num = 0;
+		gint den = 1;
+		gint outputNum = 0;
+		gint outputDen = 1;
+
+		// the exact fraction, a rate rebuilt from a float wouldn't intersect the source's
+		*rate = !outputRate(options, &outputNum, &outputDen) ||
+			   (gst_structure_get_fraction(structure, "framerate", &num, &den) && den != 0 &&
+			    gst_util_fraction_compare(num, den, outputNum, outputDen) == 0);
+	}
+
+	gst_caps_unref(caps);
+}
+
+
+// buildOutput
+std::string gstPipelineBuilder::buildOutput( const Options& options, const char* sourceCaps, bool decoded )
+{
+	std::ostringstream ss;
+
+	// a camera opened in the output mode needs no converter at all
+	bool nativeFormat = false;
+	bool nativeSize = false;
+	bool nativeRate = false;
+
+	matchSource(sourceCaps, options, &nativeFormat, &nativeSize, &nativeRate);
+
+	gint rateNum = 0;
+	gint rateDen = 1;
+
+	const bool rate = outputRate(options, &rateNum, &rateDen);
+
+	// bounding the queue keeps a slow consumer from piling up decoded frames
+	ss << "queue name=" << QueueName << " ";
+
+	if( options.queueSize != 0 )
+		ss << "max-size-buffers=" << options.queueSize << " max-size-bytes=0 max-size-time=0 ";
+
+	if( options.queueLeaky == QUEUE_LEAKY_UPSTREAM )
+		ss << "leaky=upstream ";
+	else if( options.queueLeaky == QUEUE_LEAKY_DOWNSTREAM )
+		ss << "leaky=downstream ";
+
+	ss << "! ";
+
+	// 不要直接在管道中转码为RGB，可以转为NV12，否则会比较慢
+	if( !nativeFormat )
+	{
+		ss << "videoconvert name=" << ConvertName << " ";
+
+		if( options.convertThreads != 0 )
+			ss << "n-threads=" << options.convertThreads << " ";
+
+		ss << "! ";
+	}
+
+	if( options.width != 0 && options.height != 0 && !nativeSize )
+	{
+		ss << "videoscale name=" << ScaleName << " ";
+
+		if( options.convertThreads != 0 )
+			ss << "n-threads=" << options.convertThreads << " ";
+
+		ss << "! ";
+	}
+
+	if( rate && !nativeRate )
+		ss << "videorate ! ";
+
+	// videoconvert is in passthrough for a decoder that outputs I420 (avdec_h264, jpegdec)
+	if( decoded && options.format == "NV12" )
+		ss << "video/x-raw,format=(string){NV12,I420}";
+	else
+		ss << "video/x-raw,format=(string)" << options.format;
+
+	if( options.width != 0 && options.height != 0 )
+		ss << ",width=(int)" << options.width << ",height=(int)" << options.height;
+
+	if( rate )
+		ss << ",framerate=(fraction)" << rateNum << "/" << rateDen;
+
+	ss << " ! appsink name=" << options.sinkName << " sync=" << (options.sync ? "true" : "false");
+	return ss.str();
+}
+
+
+// fileDemuxer
+static const char* fileDemuxer( const std::string& path, bool* elementary )
+{
+	const size_t dot = path.find_last_of('.');
+
+	*elementary = false;
+
+	if( dot == std::string::npos )
+		return NULL;
+
+	std::string ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	if( ext == "mp4" || ext == "mov" || ext == "m4v" )
+		return "qtdemux";
+	else if( ext == "mkv" || ext == "webm" )
+		return "matroskademux";
+	else if( ext == "ts" || ext == "m2ts" )
+		return "tsdemux";
+	else if( ext == "flv" )
+		return "flvdemux";
+	else if( ext == "avi" )
+		return "avidemux";
+	else if( ext == "h264" || ext == "264" || ext == "h265" || ext == "265" )
+		*elementary = true;
+
+	return NULL;
+}
+
+
+// Build
+std::string gstPipelineBuilder::Build( const std::string& uri, const Options& options )
+{
+	std::ostringstream ss;
+
+	const size_t separator = uri.find("://");
+	const std::string protocol = (separator != std::string::npos) ? uri.substr(0, separator) : "file";
+	std::string location = (separator != std::string::npos) ? uri.substr(separator + 3) : uri;
+
+	// mode the camera is opened in, if it was matched against its caps
+	const char* sourceCaps = NULL;
+
+	// raw cameras deliver the format they were matched in, anything else went through a decoder
+	bool decoded = true;
+
+	if( protocol == "rtsp" || protocol == "rtsps" )
+	{
+		ss << "rtspsrc name=" << SourceName << " location=" << uri << " ! ";
+		ss << codecDepayloader(options.codec) << " name=" << DepayName << " ! ";
+		ss << buildDecoder(options);
+	}
+	else if( protocol == "file" )
+	{
+		bool elementary = false;
+		const char* demuxer = fileDemuxer(location, &elementary);
+
+		ss << "filesrc location=\"" << location << "\" ! ";
+
+		if( demuxer != NULL )
+			ss << demuxer << " ! " << buildDecoder(options);
+		else if( elementary )
+			ss << buildDecoder(options);
+		else
+			ss << "decodebin name=" << DecoderName << " ! ";
+	}
+	else if( protocol == "v4l2" || protocol == "dshow" )
+	{
+		decoded = false;
+
+		if( protocol == "v4l2" )
+			ss << "v4l2src device=" << location << " do-timestamp=true ! ";
+		else
+			ss << "dshowvideosrc device-index=" << (location.empty() ? "0" : location) << " do-timestamp=true ! ";
+
+		// open the camera in the mode that was matched against its caps
+		if( !options.sourceCaps.empty() )
+		{
+			ss << options.sourceCaps << " ! ";
+
+			if( options.sourceCaps.compare(0, 10, "image/jpeg") == 0 )
+			{
+				Options mjpeg = options;
+				mjpeg.codec = VIDEO_CODEC_MJPEG;
+				ss << buildDecoder(mjpeg);
+
+				decoded = true;
+			}
+
+			sourceCaps = options.sourceCaps.c_str();
+		}
+	}
+	else if( protocol == "csi" )
+	{
+		decoded = false;
+
+		ss << "nvarguscamerasrc sensor-id=" << (location.empty() ? "0" : location) << " ! video/x-raw(memory:NVMM)";
+
+		if( options.width != 0 && options.height != 0 )
+			ss << ", width=(int)" << options.width << ", height=(int)" << options.height;
+
+		ss << " ! nvvidconv ! video/x-raw ! ";
+	}
+	else
+	{
+		ss << "uridecodebin uri=" << uri << " name=" << DecoderName << " ! ";
+	}
+
+	ss << buildOutput(options, sourceCaps, decoded);
+	return ss.str();
+}
@@ -0,0 +1,237 @@
+#ifndef __GSTREAMER_PIPELINE_BUILDER_H__
+#define __GSTREAMER_PIPELINE_BUILDER_H__
+
+#include <gst/gst.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Compressed video formats the builder knows how to depayload, parse and decode.
+ */
+enum gstVideoCodec
+{
+	VIDEO_CODEC_H264 = 0,
+	VIDEO_CODEC_H265,
+	VIDEO_CODEC_MJPEG
+};
+
+
+/**
+ * Which buffers the queue in front of the converter drops when it's full
+ * (see the `leaky` property of GstQueue).
+ */
+enum gstQueueLeaky
+{
+	QUEUE_LEAKY_NONE       = 0,	/**< block the decoder until there is room */
+	QUEUE_LEAKY_UPSTREAM   = 1,	/**< drop the incoming buffer */
+	QUEUE_LEAKY_DOWNSTREAM = 2	/**< drop the oldest queued buffer */
+};
+
+
+/**
+ * Builds gst-launch pipeline strings from a source URI, ending in an appsink.
+ *
+ * Supported sources:
+ *   - rtsp://host/path                 (rtspsrc, depayloaded and decoded)
+ *   - file:///path or a plain path      (demuxed by extension, decodebin otherwise)
+ *   - any other URI, e.g. http://        (uridecodebin)
+ *   - v4l2:///dev/video0, dshow://0     (raw camera, no decoder)
+ *   - csi://0                           (MIPI CSI camera through nvarguscamerasrc)
+ *
+ * The decoder is chosen at runtime, see SelectDecoder(), so the same build
+ * picks the hardware decoder of each machine and falls back to software on
+ * machines that have none.
+ */
+class gstPipelineBuilder
+{
+public:
+	/**
+	 * Output requirements of the pipeline.
+	 */
+	struct Options
+	{
+		/**
+		 * Codec of the stream, used for the depayloader, parser and decoder.
+		 */
+		gstVideoCodec codec;
+
+		/**
+		 * Decoder element to use instead of selecting one, if set.
+		 */
+		std::string decoder;
+
+		/**
+		 * Pixel format delivered to the appsink (a GstVideoFormat name).
+		 * When it's NV12, decoded streams are also accepted in I420, which
+		 * the software decoders output, so videoconvert passes them through
+		 * instead of repacking every frame (gstFrame handles both).
+		 */
+		std::string format;
+
+		/**
+		 * Size of the frames delivered to the appsink, 0 keeps the decoded size.
+		 */
+		uint32_t width;
+		uint32_t height;
+
+		/**
+		 * Frame rate delivered to the appsink, 0 keeps the stream's rate.
+		 */
+		float frameRate;
+
+		/**
+		 * The same frame rate as an exact fraction (e.g. 30000/1001 of a camera
+		 * mode), used instead of frameRate when frameNum isn't 0.
+		 */
+		uint32_t frameNum;
+		uint32_t frameDen;
+
+		/**
+		 * Maximum number of buffers in the queue in front of the converter
+		 * (named "outqueue"), 0 keeps GstQueue's defaults (200 buffers, 10 MB, 1 s).
+		 */
+		uint32_t queueSize;
+
+		/**
+		 * What that queue does when it's full.
+		 */
+		gstQueueLeaky queueLeaky;
+
+		/**
+		 * Mode the camera sources (v4l2://, dshow://) are opened in, as a caps
+		 * string, e.g. the one gstCamera matched against the device's caps.
+		 * image/jpeg modes are decoded with the MJPEG decoder.  Empty lets the
+		 * camera pick.  When the mode already is the output format, size or
+		 * frame rate, videoconvert, videoscale or videorate are left out.
+		 */
+		std::string sourceCaps;
+
+		/**
+		 * Number of threads of videoconvert and videoscale (their n-threads),
+		 * 0 keeps their default of a single thread.
+		 */
+		uint32_t convertThreads;
+
+		/**
+		 * Maximum number of threads of the libav decoders (their max-threads),
+		 * 0 keeps their default of one per CPU.  Other decoders ignore it.
+		 */
+		uint32_t decoderThreads;
+
+		/**
+		 * Name of the appsink element.
+		 */
+		std::string sinkName;
+
+		/**
+		 * Synchronize the appsink to the clock, or deliver frames as soon as they're decoded.
+		 */
+		bool sync;
+
+		Options() : codec(VIDEO_CODEC_H264), format("NV12"), width(0), height(0), frameRate(0.0f), frameNum(0), frameDen(1), queueSize(0), queueLeaky(QUEUE_LEAKY_NONE), convertThreads(0), decoderThreads(0), sinkName("mysink"), sync(false) {}
+	};
+
+	/**
+	 * Build the launch string for `uri`.
+	 * gst_init() must have been called, since the decoder is selected from the registry.
+	 */
+	static std::string Build( const std::string& uri, const Options& options=Options() );
+
+	/**
+	 * Select the fastest usable decoder for a codec.
+	 *
+	 * Candidates are every video decoder in the registry that accepts the
+	 * codec.  The ones whose throughput was measured on this machine (see
+	 * LoadThroughput()) come first, fastest first.  The others follow in the
+	 * order of a hand-assigned priority table (hardware decoders, then libav,
+	 * then the reference software decoders), and of their plugin rank for the
+	 * ones missing from the table.  The first one that can be instantiated
+	 * and brought to READY is used, so a decoder whose plugin is installed but
+	 * whose hardware is missing is skipped.  The results are cached.
+	 *
+	 * @returns the element name, or an empty string if no decoder is available.
+	 */
+	static std::string SelectDecoder( gstVideoCodec codec );
+
+	/**
+	 * The candidate decoders of a codec, fastest first (whether usable or not).
+	 */
+	static std::vector<std::string> ListDecoders( gstVideoCodec codec );
+
+	/**
+	 * Load decoder throughput measured by gstDecoder_bench --throughput, one
+	 * "<codec> <element> <fps>" line per decoder.  DefaultThroughputFile is
+	 * loaded on first use unless this is called before.
+	 * @returns `false` if the file couldn't be read.
+	 */
+	static bool LoadThroughput( const char* path );
+
+	/**
+	 * Write the throughput measured so far, in the format read by LoadThroughput().
+	 */
+	static bool SaveThroughput( const char* path );
+
+	/**
+	 * Record the frames per second a decoder reached on this machine.
+	 */
+	static void SetThroughput( gstVideoCodec codec, const std::string& element, float fps );
+
+	/**
+	 * Measured frames per second of a decoder, 0 if it wasn't measured.
+	 */
+	static float GetThroughput( gstVideoCodec codec, const std::string& element );
+
+	/**
+	 * File of measured throughput loaded from the working directory by default.
+	 */
+	static const char* DefaultThroughputFile;
+
+	/**
+	 * Convert a codec to its name (h264, h265, mjpeg).
+	 */
+	static const char* CodecToStr( gstVideoCodec codec );
+
+	/**
+	 * Convert a frame rate to a fraction, with the NTSC rates (23.976, 29.97,
+	 * 59.94...) as their exact x000/1001.
+	 * @returns `false` if the rate isn't positive.
+	 */
+	static bool RateToFraction( float frameRate, gint* num, gint* den );
+
+	/**
+	 * Name of the queue in front of the converter.
+	 */
+	static const char* QueueName;
+
+	/**
+	 * Name of the decoder element (or of the decodebin/uridecodebin).
+	 */
+	static const char* DecoderName;
+
+	/**
+	 * Names of the videoconvert and videoscale elements.
+	 */
+	static const char* ConvertName;
+	static const char* ScaleName;
+
+	/**
+	 * Name of the network source of RTSP pipelines (rtspsrc).
+	 */
+	static const char* SourceName;
+
+	/**
+	 * Name of the depayloader the network source is linked to.
+	 */
+	static const char* DepayName;
+
+private:
+	static std::string buildDecoder( const Options& options );
+	static std::string buildOutput( const Options& options, const char* sourceCaps=NULL, bool decoded=false );
+	static bool probeDecoder( const std::string& element );
+	static bool loadThroughput( const char* path );
+};
+
+#endif
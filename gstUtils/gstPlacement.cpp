@@ -0,0 +1,312 @@
+#include "gstPlacement.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+
+// where Linux lists the NUMA nodes
+#define PLACEMENT_SYSFS_NODES "/sys/devices/system/node"
+
+
+// constructor
+gstPlacement::gstPlacement( gstPlacementPolicy policy )
+{
+	mPolicy = policy;
+}
+
+
+// Create
+gstPlacement* gstPlacement::Create( gstPlacementPolicy policy )
+{
+	gstPlacement* placement = new gstPlacement(policy);
+
+	// without the topology, the whole machine is a single node
+	if( !placement->discover() )
+	{
+		Node node;
+
+		node.id      = 0;
+		node.streams = 0;
+
+		const uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for( uint32_t n=0; n < cpus; n++ )
+			node.cpus.push_back(n);
+
+		placement->mNodes.clear();
+		placement->mNodes.push_back(node);
+	}
+
+	if( policy != PLACEMENT_NONE && placement->mNodes.size() < 2 )
+		printf("gstPlacement -- single NUMA node, streams won't be pinned\n");
+	else if( policy != PLACEMENT_NONE )
+		printf("gstPlacement -- %zu NUMA nodes, placing streams with the '%s' policy\n", placement->mNodes.size(), PolicyToStr(policy));
+
+	return placement;
+}
+
+
+#ifdef __linux__
+// parseCPUs (a cpulist like "0-7,16-23")
+static bool parseCPUs( const char* str, std::vector<uint32_t>& cpus )
+{
+	while( *str != '\0' && *str != '\n' )
+	{
+		char* end = NULL;
+		const unsigned long first = strtoul(str, &end, 10);
+
+		if( end == str )
+			return false;
+
+		unsigned long last = first;
+		str = end;
+
+		if( *str == '-' )
+		{
+			last = strtoul(str + 1, &end, 10);
+
+			if( end == str + 1 || last < first )
+				return false;
+
+			str = end;
+		}
+
+		for( unsigned long n=first; n <= last; n++ )
+			cpus.push_back((uint32_t)n);
+
+		if( *str == ',' )
+			str++;
+	}
+
+	return !cpus.empty();
+}
+#endif
+
+
+// discover
+bool gstPlacement::discover()
+{
+#if defined(__linux__)
+	DIR* dir = opendir(PLACEMENT_SYSFS_NODES);
+
+	if( !dir )
+		return false;
+
+	struct dirent* entry = NULL;
+
+	while( (entry = readdir(dir)) != NULL )
+	{
+		unsigned int id = 0;
+		char extra = 0;
+
+		// node0, node1... next to files like possible and online
+		if( sscanf(entry->d_name, "node%u%c", &id, &extra) != 1 )
+			continue;
+
+		const std::string path = std::string(PLACEMENT_SYSFS_NODES "/") + entry->d_name + "/cpulist";
+		FILE* file = fopen(path.c_str(), "r");
+
+		if( !file )
+			continue;
+
+		char line[4096];
+		Node node;
+
+		node.id      = id;
+		node.streams = 0;
+
+		// memory-only nodes have no CPUs, there's nothing to pin to them
+		if( fgets(line, sizeof(line), file) != NULL && parseCPUs(line, node.cpus) )
+			mNodes.push_back(node);
+
+		fclose(file);
+	}
+
+	closedir(dir);
+
+	std::sort(mNodes.begin(), mNodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+	return !mNodes.empty();
+
+#elif defined(_WIN32)
+	ULONG highest = 0;
+
+	if( !GetNumaHighestNodeNumber(&highest) )
+		return false;
+
+	for( ULONG id=0; id <= highest; id++ )
+	{
+		ULONGLONG mask = 0;
+
+		if( !GetNumaNodeProcessorMask((UCHAR)id, &mask) || mask == 0 )
+			continue;
+
+		Node node;
+
+		node.id      = id;
+		node.streams = 0;
+
+		for( uint32_t n=0; n < 64; n++ )
+		{
+			if( mask & (1ULL << n) )
+				node.cpus.push_back(n);
+		}
+
+		mNodes.push_back(node);
+	}
+
+	return !mNodes.empty();
+#else
+	return false;
+#endif
+}
+
+
+// Assign
+int gstPlacement::Assign()
+{
+	if( !IsEnabled() )
+		return -1;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	int selected = -1;
+
+	// fill the most loaded node that still has a CPU per stream
+	if( mPolicy == PLACEMENT_PACK )
+	{
+		for( size_t n=0; n < mNodes.size(); n++ )
+		{
+			if( mNodes[n].streams >= mNodes[n].cpus.size() )
+				continue;
+
+			if( selected < 0 || mNodes[n].streams > mNodes[selected].streams )
+				selected = (int)n;
+		}
+	}
+
+	// the least loaded node, which deals streams round-robin when they're added in a row
+	if( selected < 0 )
+	{
+		for( size_t n=0; n < mNodes.size(); n++ )
+		{
+			if( selected < 0 || mNodes[n].streams < mNodes[selected].streams )
+				selected = (int)n;
+		}
+	}
+
+	mNodes[selected].streams++;
+	return selected;
+}
+
+
+// Release
+void gstPlacement::Release( int node )
+{
+	if( node < 0 || node >= (int)mNodes.size() )
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if( mNodes[node].streams > 0 )
+		mNodes[node].streams--;
+}
+
+
+// GetNumStreams
+uint32_t gstPlacement::GetNumStreams( uint32_t node )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNodes[node].streams;
+}
+
+
+// Print
+void gstPlacement::Print()
+{
+	for( uint32_t n=0; n < mNodes.size(); n++ )
+	{
+		const std::vector<uint32_t>& cpus = mNodes[n].cpus;
+
+		printf("gstPlacement -- node %u  %zu CPUs (%u-%u)  %u streams\n", mNodes[n].id, cpus.size(),
+			cpus.front(), cpus.back(), GetNumStreams(n));
+	}
+
+	printf("gstPlacement -- policy '%s'%s\n", PolicyToStr(mPolicy), IsEnabled() ? "" : " (not pinning)");
+}
+
+
+// PinThread
+bool gstPlacement::PinThread( const std::vector<uint32_t>& cpus )
+{
+	if( cpus.empty() )
+		return false;
+
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for( size_t n=0; n < cpus.size(); n++ )
+	{
+		if( cpus[n] < CPU_SETSIZE )
+			CPU_SET(cpus[n], &set);
+	}
+
+	const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	if( result != 0 )
+	{
+		printf("gstPlacement -- failed to set the affinity of a thread (error %i)\n", result);
+		return false;
+	}
+
+	return true;
+
+#elif defined(_WIN32)
+	DWORD_PTR mask = 0;
+
+	for( size_t n=0; n < cpus.size(); n++ )
+	{
+		if( cpus[n] < sizeof(DWORD_PTR) * 8 )
+			mask |= (DWORD_PTR)1 << cpus[n];
+	}
+
+	if( mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0 )
+	{
+		printf("gstPlacement -- failed to set the affinity of a thread\n");
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// PolicyToStr
+const char* gstPlacement::PolicyToStr( gstPlacementPolicy policy )
+{
+	switch(policy)
+	{
+		case PLACEMENT_NONE:	return "none";
+		case PLACEMENT_SPREAD:	return "spread";
+		case PLACEMENT_PACK:	return "pack";
+	}
+
+	return "unknown";
+}
@@ -0,0 +1,119 @@
+#ifndef __GSTREAMER_PLACEMENT_H__
+#define __GSTREAMER_PLACEMENT_H__
+
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * How streams are placed on the NUMA nodes (see gstPlacement).
+ */
+enum gstPlacementPolicy
+{
+	PLACEMENT_NONE   = 0,	/**< threads run wherever the OS schedules them */
+	PLACEMENT_SPREAD = 1,	/**< each stream goes to the node with the fewest streams */
+	PLACEMENT_PACK   = 2	/**< streams fill a node, one per CPU, before using the next */
+};
+
+
+/**
+ * Places streams on the NUMA nodes of the machine.
+ *
+ * On a multi-socket machine, a decoder writing frames on one socket that
+ * are then read on the other pays for every byte crossing the interconnect.
+ * Assign() picks a node for each stream according to the policy, and the
+ * stream's streaming threads and its consumer are pinned to the CPUs of
+ * that node with PinThread().  Memory isn't bound explicitly: the OS
+ * allocates pages on the node of the thread that first touches them, so
+ * buffers allocated and filled by pinned threads end up on their node.
+ *
+ * The nodes are read from /sys/devices/system/node on Linux and from the
+ * NUMA API on Windows (processor group 0).  On a single node, or where the
+ * topology isn't available, placement is disabled and nothing is pinned.
+ */
+class gstPlacement
+{
+public:
+	/**
+	 * Discover the NUMA nodes of the machine.
+	 */
+	static gstPlacement* Create( gstPlacementPolicy policy=PLACEMENT_SPREAD );
+
+	/**
+	 * Pick the node of a new stream.  Release() it when the stream is removed.
+	 * @returns the index of the node, or -1 if placement is disabled.
+	 */
+	int Assign();
+
+	/**
+	 * A stream assigned to `node` was removed.
+	 */
+	void Release( int node );
+
+	/**
+	 * Number of NUMA nodes (1 if the topology isn't available).
+	 */
+	inline uint32_t GetNumNodes() const			{ return (uint32_t)mNodes.size(); }
+
+	/**
+	 * CPUs of a node.
+	 */
+	inline const std::vector<uint32_t>& GetCPUs( uint32_t node ) const	{ return mNodes[node].cpus; }
+
+	/**
+	 * OS identifier of a node.
+	 */
+	inline uint32_t GetNodeId( uint32_t node ) const	{ return mNodes[node].id; }
+
+	/**
+	 * Number of streams assigned to a node.
+	 */
+	uint32_t GetNumStreams( uint32_t node );
+
+	/**
+	 * The placement policy.
+	 */
+	inline gstPlacementPolicy GetPolicy() const		{ return mPolicy; }
+
+	/**
+	 * Returns true if streams are placed, i.e. there is a policy and more than one node.
+	 */
+	inline bool IsEnabled() const				{ return mPolicy != PLACEMENT_NONE && mNodes.size() > 1; }
+
+	/**
+	 * Print the nodes with their CPUs and the number of streams on each.
+	 */
+	void Print();
+
+	/**
+	 * Pin the calling thread to a set of CPUs.  Threads it creates afterwards
+	 * inherit the set on Linux.
+	 * @returns `false` if the CPUs are empty or the affinity couldn't be set.
+	 */
+	static bool PinThread( const std::vector<uint32_t>& cpus );
+
+	/**
+	 * Convert a policy to its name (none, spread, pack).
+	 */
+	static const char* PolicyToStr( gstPlacementPolicy policy );
+
+private:
+	gstPlacement( gstPlacementPolicy policy );
+
+	bool discover();
+
+	struct Node
+	{
+		uint32_t id;
+		uint32_t streams;
+		std::vector<uint32_t> cpus;
+	};
+
+	std::vector<Node> mNodes;
+	std::mutex mMutex;
+
+	gstPlacementPolicy mPolicy;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "gstRenderer.h"
+
+#include <opencv2/opencv.hpp>
+#include <system_error>
+#include <stdio.h>
+
+
+// how often the render thread pumps GUI events while no frames arrive (ms)
+#define RENDER_IDLE_TIMEOUT 10
+
+
+// constructor
+gstRenderer::gstRenderer( const char* title, uint32_t width, uint32_t height, yuvInterpolation interp )
+{
+	mTitle         = title != NULL ? title : "preview";
+	mWidth         = width;
+	mHeight        = height;
+	mInterpolation = interp;
+	mRunning       = false;
+	mRendered      = 0;
+}
+
+
+// destructor
+gstRenderer::~gstRenderer()
+{
+	Stop();
+}
+
+
+// Create
+gstRenderer* gstRenderer::Create( const char* title, uint32_t width, uint32_t height, yuvInterpolation interp )
+{
+	return new gstRenderer(title, width, height, interp);
+}
+
+
+// Start
+bool gstRenderer::Start()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( mRunning )
+		return true;
+
+	mMailbox.Restart();
+	mRunning = true;
+
+	try
+	{
+		mThread = std::thread(&gstRenderer::renderThread, this);
+	}
+	catch( const std::system_error& e )
+	{
+		printf("gstRenderer -- failed to start render thread (%s)\n", e.what());
+		mRunning = false;
+		return false;
+	}
+
+	return true;
+}
+
+
+// Stop
+void gstRenderer::Stop()
+{
+	std::lock_guard<std::mutex> lock(mControlMutex);
+
+	if( !mRunning )
+		return;
+
+	mRunning = false;
+	mMailbox.Shutdown();
+
+	if( mThread.joinable() )
+		mThread.join();
+
+	// release the decoder's buffer if a frame was still pending
+	mMailbox.Clear();
+}
+
+
+// Render
+void gstRenderer::Render( const gstFrame::Ptr& frame )
+{
+	if( !frame || !mRunning.load(std::memory_order_relaxed) )
+		return;
+
+	mMailbox.Post(frame);
+}
+
+
+// renderThread
+void gstRenderer::renderThread()
+{
+	cv::Mat image;
+	bool shown = false;
+
+	while( mRunning.load(std::memory_order_acquire) )
+	{
+		gstFrame::Ptr frame;
+
+		if( mMailbox.Wait(frame, RENDER_IDLE_TIMEOUT) )
+		{
+			const int width = mWidth != 0 ? mWidth : frame->GetWidth();
+			const int height = mHeight != 0 ? mHeight : frame->GetHeight();
+
+			// the image is only reallocated when the size changes
+			image.create(height, width, CV_8UC3);
+
+			if( frame->ToBGR(image.data, (uint32_t)image.step, width, height, mInterpolation) )
+			{
+				// hand the buffer back before waiting on the GUI
+				frame.reset();
+
+				cv::imshow(mTitle, image);
+				mRendered++;
+				shown = true;
+			}
+		}
+
+		// keep the window responsive, even when no new frames arrive
+		cv::waitKey(1);
+	}
+
+	if( shown )
+		cv::destroyWindow(mTitle);
+}
@@ -0,0 +1,97 @@
+#ifndef __GSTREAMER_RENDERER_H__
+#define __GSTREAMER_RENDERER_H__
+
+#include "Mailbox.h"
+#include "gstFrame.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+/**
+ * Preview window driven from its own thread.
+ *
+ * cv::imshow() and cv::waitKey() are slow and can stall for a long time on
+ * GUI events, so they must not run on the GStreamer streaming thread.
+ * Render() only posts the frame handle to a single-slot mailbox and returns;
+ * the render thread converts and displays whichever frame is the latest when
+ * it gets to it.  Frames that were replaced before being displayed are
+ * counted in GetFramesSkipped(), so the decoder never waits on the display.
+ *
+ * The window is created, pumped and destroyed by the render thread only.
+ */
+class gstRenderer
+{
+public:
+	/**
+	 * Create a preview window (it's shown once Start() is called).
+	 *
+	 * @param title  window title
+	 * @param width  displayed width, or 0 for the width of the frames
+	 * @param height displayed height, or 0 for the height of the frames
+	 * @param interp resampling filter, if the frames have to be resized
+	 */
+	static gstRenderer* Create( const char* title, uint32_t width=0, uint32_t height=0,
+						   yuvInterpolation interp=YUV_INTERP_BILINEAR );
+
+	/**
+	 * Stop the render thread and close the window.
+	 */
+	~gstRenderer();
+
+	/**
+	 * Start the render thread.  Does nothing if it's already running.
+	 * @returns `false` if the thread couldn't be started.
+	 */
+	bool Start();
+
+	/**
+	 * Stop the render thread and close the window.
+	 * Must not be called from the render thread itself.
+	 */
+	void Stop();
+
+	/**
+	 * Queue a frame for display.  Never blocks, so it's safe to call from
+	 * the streaming thread.  Frames are ignored while the renderer is stopped.
+	 */
+	void Render( const gstFrame::Ptr& frame );
+
+	/**
+	 * Number of frames displayed.
+	 */
+	inline uint64_t GetFramesRendered() const	{ return mRendered.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of frames replaced by a newer one before they could be displayed.
+	 */
+	inline uint64_t GetFramesSkipped() const	{ return mMailbox.GetSkipped(); }
+
+	/**
+	 * Returns true if the render thread is running.
+	 */
+	inline bool IsRunning() const			{ return mRunning.load(std::memory_order_acquire); }
+
+private:
+	gstRenderer( const char* title, uint32_t width, uint32_t height, yuvInterpolation interp );
+
+	void renderThread();
+
+	std::string mTitle;
+	uint32_t    mWidth;
+	uint32_t    mHeight;
+
+	yuvInterpolation mInterpolation;
+
+	Mailbox<gstFrame::Ptr> mMailbox;
+
+	std::thread mThread;
+	std::mutex  mControlMutex;
+
+	std::atomic<bool>     mRunning;
+	std::atomic<uint64_t> mRendered;
+};
+
+#endif
@@ -0,0 +1,709 @@
+#include "gstShmRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#include <string.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#define SHM_MAGIC       0x4D485347	// "GSHM"
+#define SHM_VERSION     1
+#define SHM_MAX_READERS 32		// bits of the reader masks
+#define SHM_ALIGNMENT   4096
+#define SHM_PLANE_ALIGN 64		// planes start on a cache line in the slots
+
+
+// the atomics are shared between processes, so they must not fall back to locks
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "gstShmRing requires lock-free atomics");
+
+
+// start of the segment
+struct shmHeader
+{
+	std::atomic<uint32_t> magic;		// set once the segment is initialized
+	uint32_t version;
+	uint32_t numSlots;
+	uint32_t reserved;
+	uint64_t slotSize;
+	uint64_t dataOffset;
+	int64_t  publisherPid;
+
+	std::atomic<uint32_t> closed;
+	std::atomic<uint32_t> readers;	// mask of the attached readers
+	std::atomic<uint64_t> sequence;	// last frame published
+	std::atomic<int64_t>  readerPid[SHM_MAX_READERS];
+};
+
+// frame descriptor, the slots follow the header
+struct shmSlot
+{
+	std::atomic<uint64_t> sequence;	// 0 while empty or being written
+	std::atomic<uint32_t> readers;	// mask of the readers holding the frame
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t numPlanes;
+	char     format[16];
+	uint64_t timestamp;
+	uint64_t size;
+	uint32_t stride[gstFormat::MaxPlanes];
+	uint64_t offset[gstFormat::MaxPlanes];
+};
+
+
+// alignUp
+static inline size_t alignUp( size_t size, size_t alignment )
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+
+// slotLayout (offsets of the planes of a frame copied to a slot, returns the size it takes)
+static size_t slotLayout( const gstFrame::Ptr& frame, uint64_t* offsets )
+{
+	size_t size = 0;
+
+	for( uint32_t n=0; n < frame->GetNumPlanes(); n++ )
+	{
+		offsets[n] = size;
+		size = alignUp(size + frame->GetPlaneSize(n), SHM_PLANE_ALIGN);
+	}
+
+	return size;
+}
+
+
+// currentProcess
+static int64_t currentProcess()
+{
+#ifdef _WIN32
+	return (int64_t)GetCurrentProcessId();
+#else
+	return (int64_t)getpid();
+#endif
+}
+
+
+// processAlive
+static bool processAlive( int64_t pid )
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+
+	if( !process )
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	const DWORD result = WaitForSingleObject(process, 0);
+	CloseHandle(process);
+
+	return result == WAIT_TIMEOUT;
+#else
+	return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+
+// mapped shared memory
+struct gstShmSegment
+{
+	std::string name;
+	uint8_t*    base;
+	size_t      size;
+	bool        owner;
+
+#ifdef _WIN32
+	HANDLE handle;
+#endif
+
+	gstShmSegment() : base(NULL), size(0), owner(false)
+	{
+	#ifdef _WIN32
+		handle = NULL;
+	#endif
+	}
+
+	~gstShmSegment()
+	{
+	#ifdef _WIN32
+		if( base != NULL )
+			UnmapViewOfFile(base);
+
+		if( handle != NULL )
+			CloseHandle(handle);
+	#else
+		if( base != NULL )
+			munmap(base, size);
+
+		if( owner )
+			shm_unlink(name.c_str());
+	#endif
+	}
+
+	inline shmHeader* header() const			{ return (shmHeader*)base; }
+	inline shmSlot* slot( uint32_t n ) const		{ return (shmSlot*)(base + sizeof(shmHeader)) + n; }
+	inline uint8_t* data( uint32_t n ) const		{ return base + header()->dataOffset + header()->slotSize * n; }
+
+	static std::string systemName( const std::string& name )
+	{
+	#ifdef _WIN32
+		return "Local\\" + name;
+	#else
+		return "/" + name;
+	#endif
+	}
+
+	// create a zero-filled segment
+	static std::shared_ptr<gstShmSegment> create( const std::string& name, size_t size )
+	{
+		std::shared_ptr<gstShmSegment> segment = std::make_shared<gstShmSegment>();
+
+		segment->name = systemName(name);
+		segment->size = size;
+
+	#ifdef _WIN32
+		segment->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, segment->name.c_str());
+
+		if( !segment->handle || GetLastError() == ERROR_ALREADY_EXISTS )
+		{
+			printf("gstShmPublisher -- failed to create shared memory %s (error %lu)\n", name.c_str(), GetLastError());
+			return NULL;
+		}
+
+		segment->base = (uint8_t*)MapViewOfFile(segment->handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	#else
+		// the segment may be left behind by a publisher that crashed, but not taken from one that's running
+		const int existing = shm_open(segment->name.c_str(), O_RDONLY, 0);
+
+		if( existing >= 0 )
+		{
+			struct stat info;
+			int64_t publisher = 0;
+
+			if( fstat(existing, &info) == 0 && (size_t)info.st_size >= sizeof(shmHeader) )
+			{
+				void* header = mmap(NULL, sizeof(shmHeader), PROT_READ, MAP_SHARED, existing, 0);
+
+				if( header != MAP_FAILED )
+				{
+					publisher = ((const shmHeader*)header)->publisherPid;
+					munmap(header, sizeof(shmHeader));
+				}
+			}
+
+			close(existing);
+
+			if( publisher != 0 && processAlive(publisher) )
+			{
+				printf("gstShmPublisher -- %s is already published by process %lld\n", name.c_str(), (long long)publisher);
+				return NULL;
+			}
+
+			printf("gstShmPublisher -- removing %s left behind by process %lld\n", name.c_str(), (long long)publisher);
+			shm_unlink(segment->name.c_str());
+		}
+
+		const int fd = shm_open(segment->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+
+		if( fd < 0 )
+		{
+			printf("gstShmPublisher -- failed to create shared memory %s (%s)\n", name.c_str(), strerror(errno));
+			return NULL;
+		}
+
+		segment->owner = true;
+
+		if( ftruncate(fd, size) != 0 )
+		{
+			printf("gstShmPublisher -- failed to allocate %zu bytes of shared memory (%s)\n", size, strerror(errno));
+			close(fd);
+			return NULL;
+		}
+
+		void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		segment->base = (base != MAP_FAILED) ? (uint8_t*)base : NULL;
+	#endif
+
+		if( !segment->base )
+		{
+			printf("gstShmPublisher -- failed to map shared memory %s\n", name.c_str());
+			return NULL;
+		}
+
+		return segment;
+	}
+
+	// open an existing segment
+	static std::shared_ptr<gstShmSegment> open( const std::string& name )
+	{
+		std::shared_ptr<gstShmSegment> segment = std::make_shared<gstShmSegment>();
+
+		segment->name = systemName(name);
+
+	#ifdef _WIN32
+		segment->handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, segment->name.c_str());
+
+		if( !segment->handle )
+			return NULL;
+
+		segment->base = (uint8_t*)MapViewOfFile(segment->handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		MEMORY_BASIC_INFORMATION info;
+
+		if( segment->base != NULL && VirtualQuery(segment->base, &info, sizeof(info)) != 0 )
+			segment->size = info.RegionSize;
+	#else
+		const int fd = shm_open(segment->name.c_str(), O_RDWR, 0);
+
+		if( fd < 0 )
+			return NULL;
+
+		struct stat info;
+
+		if( fstat(fd, &info) == 0 && info.st_size > 0 )
+		{
+			segment->size = info.st_size;
+
+			void* base = mmap(NULL, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			segment->base = (base != MAP_FAILED) ? (uint8_t*)base : NULL;
+		}
+
+		close(fd);
+	#endif
+
+		if( !segment->base || segment->size < sizeof(shmHeader) )
+			return NULL;
+
+		// the publisher may still be initializing it
+		const shmHeader* header = segment->header();
+
+		if( header->magic.load(std::memory_order_acquire) != SHM_MAGIC || header->version != SHM_VERSION )
+			return NULL;
+
+		if( segment->size < header->dataOffset + header->slotSize * header->numSlots )
+			return NULL;
+
+		return segment;
+	}
+};
+
+
+//------------------------------------------------------------------------------
+// gstShmPublisher
+//------------------------------------------------------------------------------
+
+// constructor
+gstShmPublisher::gstShmPublisher( const char* name, uint32_t numSlots, size_t maxFrameSize )
+{
+	mName         = name;
+	mNumSlots     = numSlots;
+	mMaxFrameSize = maxFrameSize;
+	mNextSlot     = 0;
+	mSequence     = 0;
+	mPublished    = 0;
+	mDropped      = 0;
+}
+
+
+// destructor
+gstShmPublisher::~gstShmPublisher()
+{
+	if( mSegment != NULL )
+		mSegment->header()->closed.store(1, std::memory_order_release);
+}
+
+
+// Create
+gstShmPublisher* gstShmPublisher::Create( const char* name, uint32_t numSlots, size_t maxFrameSize )
+{
+	if( !name || name[0] == '\0' || numSlots < 2 )
+	{
+		printf("gstShmPublisher -- invalid name or number of slots\n");
+		return NULL;
+	}
+
+	return new gstShmPublisher(name, numSlots, maxFrameSize);
+}
+
+
+// create
+bool gstShmPublisher::create( size_t frameSize )
+{
+	const size_t slotSize = alignUp(std::max(frameSize, mMaxFrameSize), SHM_ALIGNMENT);
+	const size_t dataOffset = alignUp(sizeof(shmHeader) + sizeof(shmSlot) * mNumSlots, SHM_ALIGNMENT);
+
+	std::shared_ptr<gstShmSegment> segment = gstShmSegment::create(mName, dataOffset + slotSize * mNumSlots);
+
+	if( !segment )
+		return false;
+
+	shmHeader* header = new(segment->base) shmHeader();
+
+	header->version      = SHM_VERSION;
+	header->numSlots     = mNumSlots;
+	header->reserved     = 0;
+	header->slotSize     = slotSize;
+	header->dataOffset   = dataOffset;
+	header->publisherPid = currentProcess();
+
+	header->closed.store(0, std::memory_order_relaxed);
+	header->readers.store(0, std::memory_order_relaxed);
+	header->sequence.store(0, std::memory_order_relaxed);
+
+	for( uint32_t n=0; n < SHM_MAX_READERS; n++ )
+		header->readerPid[n].store(0, std::memory_order_relaxed);
+
+	for( uint32_t n=0; n < mNumSlots; n++ )
+	{
+		shmSlot* slot = new(segment->slot(n)) shmSlot();
+
+		slot->sequence.store(0, std::memory_order_relaxed);
+		slot->readers.store(0, std::memory_order_relaxed);
+	}
+
+	// readers check the magic before anything else
+	header->magic.store(SHM_MAGIC, std::memory_order_release);
+
+	mSegment = segment;
+
+	printf("gstShmPublisher -- publishing %s (%u slots of %zu bytes)\n", mName.c_str(), mNumSlots, slotSize);
+	return true;
+}
+
+
+// findSlot
+int gstShmPublisher::findSlot()
+{
+	for( uint32_t n=0; n < mNumSlots; n++ )
+	{
+		const uint32_t index = (mNextSlot + n) % mNumSlots;
+		shmSlot* slot = mSegment->slot(index);
+
+		if( slot->readers.load(std::memory_order_acquire) != 0 )
+			continue;
+
+		// invalidate the slot, then make sure no reader grabbed it meanwhile
+		// (a reader marks the slot, then checks the sequence, so one of the two backs off)
+		const uint64_t previous = slot->sequence.exchange(0);
+
+		if( slot->readers.load() != 0 )
+		{
+			slot->sequence.store(previous, std::memory_order_release);
+			continue;
+		}
+
+		mNextSlot = (index + 1) % mNumSlots;
+		return index;
+	}
+
+	return -1;
+}
+
+
+// reapReaders
+void gstShmPublisher::reapReaders()
+{
+	shmHeader* header = mSegment->header();
+	const uint32_t readers = header->readers.load(std::memory_order_acquire);
+
+	for( uint32_t n=0; n < SHM_MAX_READERS; n++ )
+	{
+		const uint32_t bit = (1u << n);
+
+		if( !(readers & bit) )
+			continue;
+
+		// 0 while the reader is attaching
+		const int64_t pid = header->readerPid[n].load(std::memory_order_acquire);
+
+		if( pid == 0 || processAlive(pid) )
+			continue;
+
+		printf("gstShmPublisher -- %s reader %u (process %lld) went away, releasing its frames\n", mName.c_str(), n, (long long)pid);
+
+		for( uint32_t s=0; s < mNumSlots; s++ )
+			mSegment->slot(s)->readers.fetch_and(~bit);
+
+		header->readerPid[n].store(0, std::memory_order_release);
+		header->readers.fetch_and(~bit);
+	}
+}
+
+
+// Publish
+bool gstShmPublisher::Publish( const gstFrame::Ptr& frame )
+{
+	if( !frame )
+		return false;
+
+	uint64_t offsets[gstFormat::MaxPlanes];
+	const size_t size = slotLayout(frame, offsets);
+
+	if( !mSegment && !create(size) )
+	{
+		mDropped++;
+		return false;
+	}
+
+	shmHeader* header = mSegment->header();
+
+	if( size > header->slotSize )
+	{
+		if( mDropped++ == 0 )
+			printf("gstShmPublisher -- %zu byte frame doesn't fit in the %llu byte slots of %s\n", size, (unsigned long long)header->slotSize, mName.c_str());
+
+		return false;
+	}
+
+	int index = findSlot();
+
+	if( index < 0 )
+	{
+		// every slot is held, maybe by a reader that crashed
+		reapReaders();
+		index = findSlot();
+	}
+
+	if( index < 0 )
+	{
+		mDropped++;
+		return false;
+	}
+
+	// the planes may be in separate memory blocks, each one is copied with its stride
+	shmSlot* slot = mSegment->slot(index);
+
+	for( uint32_t n=0; n < frame->GetNumPlanes(); n++ )
+		memcpy(mSegment->data(index) + offsets[n], frame->GetPlane(n), frame->GetPlaneSize(n));
+
+	slot->width     = frame->GetWidth();
+	slot->height    = frame->GetHeight();
+	slot->numPlanes = frame->GetNumPlanes();
+	slot->timestamp = frame->GetTimestamp();
+	slot->size      = size;
+
+	strncpy(slot->format, frame->GetFormat(), sizeof(slot->format) - 1);
+	slot->format[sizeof(slot->format) - 1] = '\0';
+
+	for( uint32_t n=0; n < gstFormat::MaxPlanes; n++ )
+	{
+		const bool valid = (n < slot->numPlanes);
+
+		slot->stride[n] = valid ? frame->GetStride(n) : 0;
+		slot->offset[n] = valid ? offsets[n] : 0;
+	}
+
+	mSequence++;
+
+	slot->sequence.store(mSequence, std::memory_order_release);
+	header->sequence.store(mSequence, std::memory_order_release);
+
+	mPublished++;
+	return true;
+}
+
+
+// GetNumReaders
+uint32_t gstShmPublisher::GetNumReaders() const
+{
+	if( !mSegment )
+		return 0;
+
+	const uint32_t readers = mSegment->header()->readers.load(std::memory_order_relaxed);
+	uint32_t count = 0;
+
+	for( uint32_t n=0; n < SHM_MAX_READERS; n++ )
+	{
+		if( readers & (1u << n) )
+			count++;
+	}
+
+	return count;
+}
+
+
+//------------------------------------------------------------------------------
+// gstShmSubscriber
+//------------------------------------------------------------------------------
+
+// attachment to a ring, released once the subscriber and its frames are gone
+struct gstShmSubscriber::Reader
+{
+	std::shared_ptr<gstShmSegment> segment;
+	uint32_t index;
+
+	~Reader()
+	{
+		shmHeader* header = segment->header();
+
+		header->readerPid[index].store(0, std::memory_order_release);
+		header->readers.fetch_and(~(1u << index));
+	}
+};
+
+
+// constructor
+gstShmSubscriber::gstShmSubscriber( const std::shared_ptr<Reader>& reader )
+{
+	mReader       = reader;
+	mLastSequence = 0;
+	mReceived     = 0;
+	mSkipped      = 0;
+}
+
+
+// Create
+gstShmSubscriber* gstShmSubscriber::Create( const char* name )
+{
+	if( !name )
+		return NULL;
+
+	std::shared_ptr<gstShmSegment> segment = gstShmSegment::open(name);
+
+	if( !segment )
+		return NULL;
+
+	// claim a reader index
+	shmHeader* header = segment->header();
+	uint32_t readers = header->readers.load();
+	uint32_t index = 0;
+
+	while( true )
+	{
+		for( index=0; index < SHM_MAX_READERS && (readers & (1u << index)); index++ );
+
+		if( index >= SHM_MAX_READERS )
+		{
+			printf("gstShmSubscriber -- %s already has %u readers\n", name, SHM_MAX_READERS);
+			return NULL;
+		}
+
+		if( header->readers.compare_exchange_weak(readers, readers | (1u << index)) )
+			break;
+	}
+
+	header->readerPid[index].store(currentProcess(), std::memory_order_release);
+
+	std::shared_ptr<Reader> reader = std::make_shared<Reader>();
+
+	reader->segment = segment;
+	reader->index   = index;
+
+	return new gstShmSubscriber(reader);
+}
+
+
+// tryAcquire
+gstShmSubscriber::FramePtr gstShmSubscriber::tryAcquire()
+{
+	const gstShmSegment* segment = mReader->segment.get();
+	const shmHeader* header = segment->header();
+
+	const uint64_t sequence = header->sequence.load(std::memory_order_acquire);
+
+	if( sequence == 0 || sequence == mLastSequence )
+		return FramePtr();
+
+	const uint32_t bit = (1u << mReader->index);
+
+	for( uint32_t n=0; n < header->numSlots; n++ )
+	{
+		shmSlot* slot = segment->slot(n);
+
+		if( slot->sequence.load(std::memory_order_acquire) != sequence )
+			continue;
+
+		// mark the slot, then make sure the publisher didn't start overwriting it
+		slot->readers.fetch_or(bit);
+
+		if( slot->sequence.load() != sequence )
+		{
+			slot->readers.fetch_and(~bit);
+			break;
+		}
+
+		if( mLastSequence != 0 && sequence > mLastSequence + 1 )
+			mSkipped += sequence - mLastSequence - 1;
+
+		mLastSequence = sequence;
+		mReceived++;
+
+		Frame* frame = new Frame();
+
+		frame->sequence  = sequence;
+		frame->timestamp = slot->timestamp;
+		frame->width     = slot->width;
+		frame->height    = slot->height;
+		frame->numPlanes = slot->numPlanes;
+		frame->size      = slot->size;
+
+		memcpy(frame->format, slot->format, sizeof(frame->format));
+
+		for( uint32_t p=0; p < gstFormat::MaxPlanes; p++ )
+		{
+			frame->stride[p] = slot->stride[p];
+			frame->planes[p] = (p < slot->numPlanes) ? segment->data(n) + slot->offset[p] : NULL;
+		}
+
+		std::shared_ptr<Reader> reader = mReader;
+
+		return FramePtr(frame, [reader, n, bit]( const Frame* frame )
+		{
+			delete frame;
+			reader->segment->slot(n)->readers.fetch_and(~bit, std::memory_order_release);
+		});
+	}
+
+	// already overwritten, the next frame is on its way
+	return FramePtr();
+}
+
+
+// Acquire
+gstShmSubscriber::FramePtr gstShmSubscriber::Acquire( uint64_t timeout )
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	// the publisher doesn't signal new frames, so poll for them every millisecond
+	while( mReader->segment->header()->closed.load(std::memory_order_acquire) == 0 )
+	{
+		FramePtr frame = tryAcquire();
+
+		if( frame != NULL )
+			return frame;
+
+		if( timeout != UINT64_MAX && std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(timeout) )
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return FramePtr();
+}
+
+
+// IsClosed
+bool gstShmSubscriber::IsClosed() const
+{
+	const shmHeader* header = mReader->segment->header();
+
+	if( header->closed.load(std::memory_order_acquire) != 0 )
+		return true;
+
+	return !processAlive(header->publisherPid);
+}
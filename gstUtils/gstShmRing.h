@@ -0,0 +1,180 @@
+#ifndef __GSTREAMER_SHM_RING_H__
+#define __GSTREAMER_SHM_RING_H__
+
+#include "gstFrame.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+
+struct gstShmSegment;
+
+
+/**
+ * Publishes decoded frames to a shared-memory ring, so other processes on
+ * the same machine can read them without decoding the stream again.
+ *
+ * The segment (POSIX shm_open(), or a named file mapping on Windows) holds
+ * a header, one descriptor per slot (sequence number, PTS, format, size,
+ * plane strides and offsets) and the slots themselves.  Each frame is
+ * copied once into a free slot, and the readers access it in place.
+ *
+ * Every reader marks the slots it holds, and a slot held by any reader is
+ * never overwritten: the publisher moves on to the next free slot, and
+ * drops the frame if all of them are held.  The marks of readers that died
+ * without releasing their frames are cleared when their process is gone.
+ *
+ * @see gstShmSubscriber
+ */
+class gstShmPublisher
+{
+public:
+	/**
+	 * Create the publisher.  The segment is created on the first frame, which
+	 * fails if another process that's still running publishes the same name.
+	 * @param name         name of the ring, shared with the readers
+	 * @param numSlots     number of frames in the ring (at least 2)
+	 * @param maxFrameSize size of the slots in bytes, 0 sizes them from the first frame
+	 */
+	static gstShmPublisher* Create( const char* name, uint32_t numSlots=DefaultSlots, size_t maxFrameSize=0 );
+
+	/**
+	 * Close and remove the segment.  Readers still see the frames they hold.
+	 */
+	~gstShmPublisher();
+
+	/**
+	 * Copy a frame into the ring.
+	 * @returns `false` if the frame was dropped (every slot held, or too large).
+	 */
+	bool Publish( const gstFrame::Ptr& frame );
+
+	/**
+	 * Number of frames published.
+	 */
+	inline uint64_t GetPublished() const		{ return mPublished; }
+
+	/**
+	 * Number of frames dropped because every slot was held, or the frame didn't fit.
+	 */
+	inline uint64_t GetDropped() const		{ return mDropped; }
+
+	/**
+	 * Number of readers currently attached.
+	 */
+	uint32_t GetNumReaders() const;
+
+	/**
+	 * Name of the ring.
+	 */
+	inline const std::string& GetName() const	{ return mName; }
+
+	/**
+	 * Default number of slots.
+	 */
+	static const uint32_t DefaultSlots = 8;
+
+private:
+	gstShmPublisher( const char* name, uint32_t numSlots, size_t maxFrameSize );
+
+	bool create( size_t frameSize );
+	int  findSlot();
+	void reapReaders();
+
+	std::shared_ptr<gstShmSegment> mSegment;
+
+	std::string mName;
+	uint32_t    mNumSlots;
+	size_t      mMaxFrameSize;
+	uint32_t    mNextSlot;
+	uint64_t    mSequence;
+
+	uint64_t mPublished;
+	uint64_t mDropped;
+};
+
+
+/**
+ * Reads the frames of a gstShmPublisher from another process.
+ *
+ * Acquire() returns the newest frame, in place in the shared memory, and
+ * holds its slot until the handle is released.  Frames published while the
+ * reader was busy are skipped and counted.  Deleting the subscriber detaches
+ * it from the ring once the frames it still holds are released.
+ */
+class gstShmSubscriber
+{
+public:
+	/**
+	 * Frame held in the ring.
+	 */
+	struct Frame
+	{
+		uint64_t       sequence;		/**< publication number, starting at 1 */
+		GstClockTime   timestamp;		/**< PTS of the frame */
+		uint32_t       width;
+		uint32_t       height;
+		char           format[16];		/**< GstVideoFormat name, e.g. "NV12" */
+		uint32_t       numPlanes;
+		uint32_t       stride[gstFormat::MaxPlanes];
+		const uint8_t* planes[gstFormat::MaxPlanes];
+		size_t         size;			/**< size of the frame in bytes */
+	};
+
+	/**
+	 * Shared handle to a frame, the slot is released with the last reference.
+	 */
+	typedef std::shared_ptr<const Frame> FramePtr;
+
+	/**
+	 * Attach to a ring.
+	 * @returns NULL if there is no such ring, or too many readers are attached.
+	 */
+	static gstShmSubscriber* Create( const char* name );
+
+	/**
+	 * Acquire the newest frame not read yet.
+	 * @param timeout time in milliseconds to wait for a new frame, UINT64_MAX waits indefinetly
+	 * @returns an empty handle on timeout, or if the publisher went away (see IsClosed()).
+	 */
+	FramePtr Acquire( uint64_t timeout=DefaultTimeout );
+
+	/**
+	 * Returns true once the publisher closed the ring, or died.
+	 * A new subscriber has to be created to attach to its next ring.
+	 */
+	bool IsClosed() const;
+
+	/**
+	 * Number of frames acquired.
+	 */
+	inline uint64_t GetReceived() const		{ return mReceived; }
+
+	/**
+	 * Number of frames published that this reader skipped.
+	 */
+	inline uint64_t GetSkipped() const		{ return mSkipped; }
+
+	/**
+	 * Default Acquire() timeout in milliseconds.
+	 */
+	static const uint64_t DefaultTimeout = 1000;
+
+private:
+	struct Reader;
+
+	gstShmSubscriber( const std::shared_ptr<Reader>& reader );
+
+	FramePtr tryAcquire();
+
+	// shared with the frames, the reader stays attached until they're released
+	std::shared_ptr<Reader> mReader;
+
+	uint64_t mLastSequence;
+	uint64_t mReceived;
+	uint64_t mSkipped;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "gstState.h"
+
+#include <stdio.h>
+
+
+// gstSetState
+bool gstSetState( GstElement* pipeline, GstState state, uint64_t timeout, const char* name )
+{
+	if( !pipeline )
+		return false;
+
+	if( !name )
+		name = "gstreamer";
+
+	const GstStateChangeReturn result = gst_element_set_state(pipeline, state);
+
+	if( result == GST_STATE_CHANGE_FAILURE )
+	{
+		printf("%s -- failed to set pipeline state to %s\n", name, gst_element_state_get_name(state));
+		return false;
+	}
+
+	// SUCCESS, or NO_PREROLL for live sources
+	if( result != GST_STATE_CHANGE_ASYNC )
+		return true;
+
+	GstState current = GST_STATE_VOID_PENDING;
+	GstState pending = GST_STATE_VOID_PENDING;
+
+	const GstClockTime wait = (timeout == UINT64_MAX) ? GST_CLOCK_TIME_NONE : timeout * GST_MSECOND;
+	const GstStateChangeReturn done = gst_element_get_state(pipeline, &current, &pending, wait);
+
+	if( done == GST_STATE_CHANGE_FAILURE )
+	{
+		printf("%s -- failed to set pipeline state to %s\n", name, gst_element_state_get_name(state));
+		return false;
+	}
+	else if( done == GST_STATE_CHANGE_ASYNC )
+	{
+		printf("%s -- timeout after %llu ms waiting for pipeline state %s (currently %s)\n", name,
+			(unsigned long long)timeout, gst_element_state_get_name(state), gst_element_state_get_name(current));
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,22 @@
+#ifndef __GSTREAMER_STATE_H__
+#define __GSTREAMER_STATE_H__
+
+#include <gst/gst.h>
+#include <stdint.h>
+
+
+/**
+ * Change the state of a pipeline, and if the change is asynchronous wait
+ * for it to complete (ASYNC_DONE) for at most `timeout` milliseconds.
+ *
+ * Live sources report NO_PREROLL and are considered done right away, since
+ * they won't produce data before reaching PLAYING.  UINT64_MAX waits
+ * indefinetly.
+ *
+ * @param name prefix of the log messages (e.g. "gstDecoder")
+ * @returns `true` once the state is reached, `false` if the change failed
+ *          or didn't complete in time.
+ */
+bool gstSetState( GstElement* pipeline, GstState state, uint64_t timeout, const char* name );
+
+#endif
@@ -0,0 +1,292 @@
+#include "gstTaskPool.h"
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+
+// the GstTaskPool instance, which forwards to its gstTaskPool
+struct gstTaskPool::Object
+{
+	GstTaskPool     parent;
+	gstTaskPool*    owner;
+};
+
+
+// a pool thread, waiting for a task or running one
+struct gstTaskPool::Worker
+{
+	GstTaskPoolFunction func;
+	gpointer            data;
+	bool                exit;
+
+	std::condition_variable cond;
+
+	Worker() : func(NULL), data(NULL), exit(false)	{}
+};
+
+
+// constructor
+gstTaskPool::gstTaskPool( uint32_t maxThreads, uint32_t maxIdle )
+{
+	mMaxThreads = maxThreads;
+	mMaxIdle    = maxIdle;
+	mStopping   = false;
+
+	memset(&mStats, 0, sizeof(mStats));
+
+	mPool = (GstTaskPool*)g_object_new(objectType(), NULL);
+	((Object*)mPool)->owner = this;
+
+	gst_object_ref_sink(mPool);
+
+	gst_task_pool_prepare(mPool, NULL);
+}
+
+
+// destructor
+gstTaskPool::~gstTaskPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		mStopping = true;
+
+		for( size_t n=0; n < mIdle.size(); n++ )
+		{
+			mIdle[n]->exit = true;
+			mIdle[n]->cond.notify_one();
+		}
+
+		mIdle.clear();
+		mExitCond.wait(lock, [this]() { return mStats.threads == 0; });
+	}
+
+	gst_task_pool_cleanup(mPool);
+	gst_object_unref(mPool);
+}
+
+
+// Create
+gstTaskPool* gstTaskPool::Create( uint32_t maxThreads, uint32_t maxIdle )
+{
+	gstTaskPool* pool = new gstTaskPool(maxThreads, maxIdle);
+
+	if( maxThreads != 0 )
+		printf("gstTaskPool -- streams admitted for %u streaming threads, %u kept idle\n", maxThreads, maxIdle);
+
+	return pool;
+}
+
+
+// Get
+gstTaskPool* gstTaskPool::Get()
+{
+	// never destroyed, so it can be used until the very end of the process
+	static gstTaskPool* pool = Create(0, DefaultMaxIdle);
+	return pool;
+}
+
+
+// objectType
+GType gstTaskPool::objectType()
+{
+	static const GType type = g_type_register_static_simple(GST_TYPE_TASK_POOL, "gstTaskPoolObject",
+		sizeof(GstTaskPoolClass), onClassInit, sizeof(Object), NULL, (GTypeFlags)0);
+
+	return type;
+}
+
+
+// onClassInit
+void gstTaskPool::onClassInit( gpointer klass, gpointer class_data )
+{
+	GstTaskPoolClass* poolClass = (GstTaskPoolClass*)klass;
+
+	poolClass->prepare = onPrepare;
+	poolClass->cleanup = onCleanup;
+	poolClass->push    = onPush;
+}
+
+
+// onPrepare
+void gstTaskPool::onPrepare( GstTaskPool* pool, GError** error )
+{
+	// the threads are started on demand
+}
+
+
+// onCleanup
+void gstTaskPool::onCleanup( GstTaskPool* pool )
+{
+	// the threads are stopped by the destructor
+}
+
+
+// onPush
+gpointer gstTaskPool::onPush( GstTaskPool* pool, GstTaskPoolFunction func, gpointer user_data, GError** error )
+{
+	gstTaskPool* owner = ((Object*)pool)->owner;
+
+	if( !owner->push(func, user_data) )
+		g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_FAILED, "gstTaskPool has no thread available");
+
+	// GstTask waits for the task itself to stop, there is nothing to join
+	return NULL;
+}
+
+
+// push
+bool gstTaskPool::push( GstTaskPoolFunction func, gpointer user_data )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if( mStopping )
+		return false;
+
+	Worker* worker = NULL;
+
+	// the most recently idle thread first, its stack is still in the cache
+	if( !mIdle.empty() )
+	{
+		worker = mIdle.back();
+		mIdle.pop_back();
+		mStats.reused++;
+	}
+	else
+	{
+		worker = new Worker();
+
+		try
+		{
+			std::thread(&gstTaskPool::run, this, worker).detach();
+		}
+		catch( const std::system_error& e )
+		{
+			printf("gstTaskPool -- failed to start a thread (%s)\n", e.what());
+			delete worker;
+			return false;
+		}
+
+		mStats.threads++;
+		mStats.created++;
+		mStats.peak = std::max(mStats.peak, mStats.threads);
+	}
+
+	worker->func = func;
+	worker->data = user_data;
+
+	// refusing it would fail the element, the streams are admitted against maxThreads
+	if( mMaxThreads != 0 && mStats.busy >= mMaxThreads )
+		mStats.exceeded++;
+
+	mStats.busy++;
+	mStats.tasks++;
+
+	worker->cond.notify_one();
+	return true;
+}
+
+
+// run
+void gstTaskPool::run( Worker* worker )
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while( true )
+	{
+		worker->cond.wait(lock, [worker]() { return worker->func != NULL || worker->exit; });
+
+		if( !worker->func )
+			break;
+
+		GstTaskPoolFunction func = worker->func;
+		gpointer data = worker->data;
+
+		// the streaming loop, which only returns once the task is stopped
+		lock.unlock();
+		func(data);
+		lock.lock();
+
+		worker->func = NULL;
+		worker->data = NULL;
+
+		mStats.busy--;
+
+		if( mStopping || mIdle.size() >= mMaxIdle )
+			break;
+
+		mIdle.push_back(worker);
+	}
+
+	mStats.threads--;
+	delete worker;
+
+	mExitCond.notify_all();
+}
+
+
+// HandleMessage
+bool gstTaskPool::HandleMessage( GstMessage* msg )
+{
+	if( GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS )
+		return false;
+
+	GstStreamStatusType type;
+	GstElement* owner = NULL;
+
+	gst_message_parse_stream_status(msg, &type, &owner);
+
+	// posted right before the task is started, so it starts in the pool
+	if( type == GST_STREAM_STATUS_TYPE_CREATE )
+	{
+		const GValue* value = gst_message_get_stream_status_object(msg);
+
+		if( value != NULL && G_VALUE_HOLDS(value, GST_TYPE_TASK) )
+			gst_task_set_pool(GST_TASK(g_value_get_object(value)), mPool);
+	}
+
+	return true;
+}
+
+
+// GetStats
+gstTaskPool::Stats gstTaskPool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+
+// Print
+void gstTaskPool::Print()
+{
+	const Stats stats = GetStats();
+
+	printf("gstTaskPool -- %u threads (%u busy, peak %u)  %llu created  %llu tasks (%llu on reused threads)  %llu past the limit\n",
+		stats.threads, stats.busy, stats.peak, (unsigned long long)stats.created, (unsigned long long)stats.tasks,
+		(unsigned long long)stats.reused, (unsigned long long)stats.exceeded);
+}
+
+
+// GetContextSwitches
+uint64_t gstTaskPool::GetContextSwitches()
+{
+#ifdef __linux__
+	struct rusage usage;
+
+	if( getrusage(RUSAGE_SELF, &usage) != 0 )
+		return 0;
+
+	return (uint64_t)usage.ru_nvcsw + (uint64_t)usage.ru_nivcsw;
+#else
+	return 0;
+#endif
+}
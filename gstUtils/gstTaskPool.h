@@ -0,0 +1,132 @@
+#ifndef __GSTREAMER_TASK_POOL_H__
+#define __GSTREAMER_TASK_POOL_H__
+
+#include <gst/gst.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * GstTaskPool shared by the streaming threads of many pipelines.
+ *
+ * Every source, queue and jitterbuffer of a pipeline runs its streaming
+ * loop in a GstTask.  By default, each task gets a new thread, and with
+ * hundreds of streams the threads are created and destroyed again whenever
+ * a stream is opened, closed or reconnected.  HandleMessage() moves the tasks
+ * of a pipeline to this pool when they're created (on their STREAM_STATUS
+ * message), where the threads are reused across pipelines: a task starts on
+ * the thread that most recently became idle, and up to maxIdle threads are
+ * kept waiting.
+ *
+ * A streaming loop only returns when its task stops, so a thread belongs to
+ * one task at a time and can't be taken over by another stream meanwhile.
+ * The pool doesn't reduce the number of threads, and never refuses a task,
+ * as the element would fail to start.  maxThreads is bounded by admitting
+ * streams instead (see StreamManager::AddStream()), and the tasks that are
+ * started past it anyway are counted.
+ * Threads that elements start on their own (rtpsession, the libav decoders,
+ * see gstThreadBudget) are not part of the pool.
+ */
+class gstTaskPool
+{
+public:
+	/**
+	 * Thread usage of the pool.
+	 */
+	struct Stats
+	{
+		uint32_t threads;	/**< threads alive */
+		uint32_t busy;		/**< threads running a task */
+		uint32_t peak;		/**< most threads alive at once */
+		uint64_t created;	/**< threads created */
+		uint64_t tasks;	/**< tasks started */
+		uint64_t reused;	/**< tasks started on an idle thread */
+		uint64_t exceeded;	/**< tasks started while maxThreads were busy */
+	};
+
+	/**
+	 * Create a pool.
+	 * @param maxThreads threads the streams are admitted for, 0 for no limit
+	 * @param maxIdle    most idle threads kept for the next tasks
+	 */
+	static gstTaskPool* Create( uint32_t maxThreads=0, uint32_t maxIdle=DefaultMaxIdle );
+
+	/**
+	 * The pool shared by the process, without a thread limit.
+	 */
+	static gstTaskPool* Get();
+
+	/**
+	 * Stop the idle threads.  The pipelines using the pool must be stopped first.
+	 */
+	~gstTaskPool();
+
+	/**
+	 * Move a newly created task to the pool, called with every message from
+	 * the bus sync handler of a pipeline (see gstBusWatcher::Callbacks::sync).
+	 * @returns `true` if it was a STREAM_STATUS message, which needs no further handling.
+	 */
+	bool HandleMessage( GstMessage* msg );
+
+	/**
+	 * Thread usage since the pool was created.
+	 */
+	Stats GetStats();
+
+	/**
+	 * Print the thread usage on one line.
+	 */
+	void Print();
+
+	/**
+	 * The GstTaskPool, to set on tasks directly with gst_task_set_pool().
+	 */
+	inline GstTaskPool* GetPool() const		{ return mPool; }
+
+	/**
+	 * The threads the streams are admitted for, 0 for no limit.
+	 */
+	inline uint32_t GetMaxThreads() const		{ return mMaxThreads; }
+
+	/**
+	 * Voluntary and involuntary context switches of the process so far,
+	 * to compare the pool against the default one (0 if not available).
+	 */
+	static uint64_t GetContextSwitches();
+
+	/**
+	 * Default number of idle threads kept by the pool.
+	 */
+	static const uint32_t DefaultMaxIdle = 8;
+
+private:
+	gstTaskPool( uint32_t maxThreads, uint32_t maxIdle );
+
+	struct Object;
+	struct Worker;
+
+	static GType objectType();
+	static void onClassInit( gpointer klass, gpointer class_data );
+	static void onPrepare( GstTaskPool* pool, GError** error );
+	static void onCleanup( GstTaskPool* pool );
+	static gpointer onPush( GstTaskPool* pool, GstTaskPoolFunction func, gpointer user_data, GError** error );
+
+	bool push( GstTaskPoolFunction func, gpointer user_data );
+	void run( Worker* worker );
+
+	GstTaskPool* mPool;
+
+	std::vector<Worker*> mIdle;
+	std::mutex mMutex;
+	std::condition_variable mExitCond;
+	bool mStopping;
+
+	uint32_t mMaxThreads;
+	uint32_t mMaxIdle;
+	Stats    mStats;
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "gstThreadBudget.h"
+
+#include <algorithm>
+#include <thread>
+#include <math.h>
+#include <stdio.h>
+
+
+// frame rate assumed for streams that don't advertise one
+#define THREAD_BUDGET_DEFAULT_FPS 30.0f
+
+
+// constructor
+gstThreadBudget::gstThreadBudget( uint32_t threads )
+{
+	mThreads   = threads;
+	mAllocated = 0;
+	mNextId    = 1;
+}
+
+
+// Create
+gstThreadBudget* gstThreadBudget::Create( uint32_t threads )
+{
+	if( threads == 0 )
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	printf("gstThreadBudget -- budget of %u threads\n", threads);
+	return new gstThreadBudget(threads);
+}
+
+
+// Get
+gstThreadBudget* gstThreadBudget::Get()
+{
+	// never destroyed, so it can be used until the very end of the process
+	static gstThreadBudget* budget = Create(0);
+	return budget;
+}
+
+
+// Acquire
+gstThreadBudget::Allocation gstThreadBudget::Acquire( uint32_t width, uint32_t height, float frameRate, ResizeCallback callback, void* user_data )
+{
+	Entry entry;
+
+	entry.allocation.width     = width;
+	entry.allocation.height    = height;
+	entry.allocation.frameRate = frameRate > 0.0f ? frameRate : THREAD_BUDGET_DEFAULT_FPS;
+	entry.callback = callback;
+	entry.userData = user_data;
+
+	const float pixelRate = (float)width * (float)height * entry.allocation.frameRate * 1e-6f;
+
+	// the threads each stage needs to keep up with the stream
+	entry.wantedDecoder = std::max((uint32_t)ceilf(pixelRate / DecodeRate), 1u);
+	entry.wantedConvert = std::max((uint32_t)ceilf(pixelRate / ConvertRate), 1u);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	uint32_t decoders = 0;
+	uint32_t wanted = entry.wantedDecoder + entry.wantedConvert;
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		decoders += mEntries[n].allocation.decoderThreads;
+		wanted   += mEntries[n].wantedDecoder + mEntries[n].wantedConvert;
+	}
+
+	// the proportional share of the decoder, within what the running decoders
+	// left (they can't shrink), keeping a converter thread for every stream
+	const uint32_t streams = mEntries.size() + 1;
+	const uint32_t share = wanted > mThreads ? entry.wantedDecoder * mThreads / wanted : entry.wantedDecoder;
+	const uint32_t left = mThreads > decoders + streams ? mThreads - decoders - streams : 0;
+
+	entry.allocation.id = mNextId++;
+	entry.allocation.decoderThreads = std::max(std::min(share, left), 1u);
+
+	mEntries.push_back(entry);
+
+	// the new stream applies its own threads, the others are told
+	rebalance(entry.allocation.id);
+
+	const Allocation allocation = mEntries.back().allocation;
+
+	printf("gstThreadBudget -- %ux%u @ %.1f fps (%.1f Mpixel/s) gets %u/%u decoder + %u/%u converter threads (%u/%u allocated)\n",
+		width, height, allocation.frameRate, pixelRate, allocation.decoderThreads, entry.wantedDecoder,
+		allocation.convertThreads, entry.wantedConvert, mAllocated, mThreads);
+
+	return allocation;
+}
+
+
+// Release
+void gstThreadBudget::Release( uint32_t id )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		if( mEntries[n].allocation.id != id )
+			continue;
+
+		mEntries.erase(mEntries.begin() + n);
+		rebalance(0);
+		return;
+	}
+}
+
+
+// rebalance (called with mMutex locked)
+void gstThreadBudget::rebalance( uint32_t skip )
+{
+	uint32_t decoders = 0;
+	uint32_t wanted = 0;
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		decoders += mEntries[n].allocation.decoderThreads;
+		wanted   += mEntries[n].wantedConvert;
+	}
+
+	// the converters share what the decoders leave, in proportion to what they want
+	const uint32_t available = mThreads > decoders ? mThreads - decoders : 0;
+
+	mAllocated = decoders;
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		Entry& entry = mEntries[n];
+
+		const uint32_t threads = wanted > available ? std::max(entry.wantedConvert * available / wanted, 1u) : entry.wantedConvert;
+
+		mAllocated += threads;
+
+		if( threads == entry.allocation.convertThreads )
+			continue;
+
+		entry.allocation.convertThreads = threads;
+
+		if( entry.allocation.id != skip && entry.callback != NULL )
+			entry.callback(entry.allocation, entry.userData);
+	}
+}
+
+
+// Measure
+void gstThreadBudget::Measure( uint32_t id, float frameRate )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+	{
+		if( mEntries[n].allocation.id == id )
+		{
+			mEntries[n].allocation.measuredRate = frameRate;
+			return;
+		}
+	}
+}
+
+
+// GetAllocations
+std::vector<gstThreadBudget::Allocation> gstThreadBudget::GetAllocations()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<Allocation> allocations;
+
+	for( size_t n=0; n < mEntries.size(); n++ )
+		allocations.push_back(mEntries[n].allocation);
+
+	return allocations;
+}
+
+
+// GetAllocated
+uint32_t gstThreadBudget::GetAllocated()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mAllocated;
+}
+
+
+// Print
+void gstThreadBudget::Print()
+{
+	const std::vector<Allocation> allocations = GetAllocations();
+
+	for( size_t n=0; n < allocations.size(); n++ )
+	{
+		const Allocation& a = allocations[n];
+		const float pixelRate = (float)a.width * (float)a.height * a.measuredRate * 1e-6f;
+
+		printf("gstThreadBudget -- [%u] %4ux%-4u  %u decoder + %u converter threads  %6.1f/%.1f fps  %7.1f Mpixel/s  (%.1f per thread)\n",
+			a.id, a.width, a.height, a.decoderThreads, a.convertThreads, a.measuredRate, a.frameRate,
+			pixelRate, pixelRate / (a.decoderThreads + a.convertThreads));
+	}
+
+	const uint32_t allocated = GetAllocated();
+
+	// the running decoders don't give threads back, and each stream gets one of each
+	printf("gstThreadBudget -- %u/%u threads allocated to %zu streams%s\n", allocated, mThreads, allocations.size(),
+		allocated > mThreads ? " (oversubscribed)" : "");
+}
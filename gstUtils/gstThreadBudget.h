@@ -0,0 +1,141 @@
+#ifndef __GSTREAMER_THREAD_BUDGET_H__
+#define __GSTREAMER_THREAD_BUDGET_H__
+
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Divides the CPU cores between the software decoders and converters of many streams.
+ *
+ * libav decoders start as many threads as there are cores, and videoconvert
+ * and videoscale run on a single thread, whatever the resolution.  With many
+ * streams, the decoders oversubscribe the cores while the converter of a 4K
+ * stream can't keep up.  Each stream instead acquires an allocation sized by
+ * its pixel rate once its resolution is known: it wants one decoder thread
+ * per DecodeRate and one converter thread per ConvertRate Mpixel/s, so a 4K
+ * stream wants several threads of each, while a 720p stream wants one.
+ *
+ * When the streams want more threads than the budget, they're shared in
+ * proportion to what each one wants, over all the live allocations:
+ *
+ *   - the decoder threads are fixed once the decoder is opened, so a new
+ *     stream gets its proportional share of decoder threads, capped to
+ *     what the other streams' decoders left
+ *   - the converters are resized on every Acquire() and Release(), and the
+ *     new n-threads are passed to the streams whose share changed through
+ *     their ResizeCallback, to be applied while they run
+ *
+ * Every stream gets at least one thread of each, so streams added once the
+ * running decoders took their share can exceed the budget (see Print()).
+ *
+ * Streams report the frame rate they actually reach (see Measure()), so
+ * the throughput of each allocation can be compared with Print().
+ */
+class gstThreadBudget
+{
+public:
+	/**
+	 * Threads allocated to a stream.
+	 */
+	struct Allocation
+	{
+		uint32_t id;			/**< identifies the allocation, 0 if none */
+		uint32_t width;		/**< resolution of the stream */
+		uint32_t height;
+		float    frameRate;		/**< frame rate of the stream (30 if unknown) */
+		uint32_t decoderThreads;	/**< max-threads of the decoder */
+		uint32_t convertThreads;	/**< n-threads of videoconvert and videoscale */
+		float    measuredRate;		/**< frames per second actually delivered, see Measure() */
+
+		Allocation() : id(0), width(0), height(0), frameRate(0), decoderThreads(0), convertThreads(0), measuredRate(0) {}
+	};
+
+	/**
+	 * Called with the new convertThreads of an allocation when the converters
+	 * are rebalanced, with the budget locked: it must not call back into it.
+	 */
+	typedef void (*ResizeCallback)( const Allocation& allocation, void* user_data );
+
+	/**
+	 * Create a budget of `threads` threads, 0 for the number of CPUs.
+	 */
+	static gstThreadBudget* Create( uint32_t threads=0 );
+
+	/**
+	 * The budget shared by the process, of one thread per CPU.
+	 */
+	static gstThreadBudget* Get();
+
+	/**
+	 * Allocate threads to a stream of the given resolution and frame rate
+	 * (0 if unknown), and rebalance the converters of the other streams.
+	 * Release() must be called once the stream stops.
+	 * @param callback called when the converters of this stream are resized later on
+	 */
+	Allocation Acquire( uint32_t width, uint32_t height, float frameRate, ResizeCallback callback=NULL, void* user_data=NULL );
+
+	/**
+	 * Return the threads of an allocation to the budget, and rebalance the
+	 * converters of the other streams.  Once it returns, the allocation's
+	 * ResizeCallback isn't called anymore.
+	 */
+	void Release( uint32_t id );
+
+	/**
+	 * Record the frame rate a stream actually delivers with its allocation.
+	 */
+	void Measure( uint32_t id, float frameRate );
+
+	/**
+	 * The current allocations.
+	 */
+	std::vector<Allocation> GetAllocations();
+
+	/**
+	 * Print each allocation with its measured throughput per thread.
+	 */
+	void Print();
+
+	/**
+	 * Number of threads in the budget.
+	 */
+	inline uint32_t GetThreads() const			{ return mThreads; }
+
+	/**
+	 * Number of threads currently allocated.
+	 */
+	uint32_t GetAllocated();
+
+	/**
+	 * Mpixel/s a single thread of a software decoder or of the converter is
+	 * expected to handle.
+	 */
+	static const uint32_t DecodeRate  = 60;
+	static const uint32_t ConvertRate = 150;
+
+private:
+	gstThreadBudget( uint32_t threads );
+
+	void rebalance( uint32_t skip );
+
+	// an allocation, with the threads it wants and who to tell when it's resized
+	struct Entry
+	{
+		Allocation     allocation;
+		uint32_t       wantedDecoder;
+		uint32_t       wantedConvert;
+		ResizeCallback callback;
+		void*          userData;
+	};
+
+	std::vector<Entry> mEntries;
+	std::mutex mMutex;
+
+	uint32_t mThreads;
+	uint32_t mAllocated;
+	uint32_t mNextId;
+};
+
+#endif
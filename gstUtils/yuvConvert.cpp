@@ -0,0 +1,350 @@
+#include "yuvConvert.h"
+#include "yuvConvertKernels.h"
+
+#include <vector>
+#include <stdio.h>
+#include <math.h>
+
+#ifdef YUV_CONVERT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+const uint8_t yuvInterleaveBGR[3][3][16] =
+{
+	{
+		{ 0x00, 0x80, 0x80, 0x01, 0x80, 0x80, 0x02, 0x80, 0x80, 0x03, 0x80, 0x80, 0x04, 0x80, 0x80, 0x05 },
+		{ 0x80, 0x00, 0x80, 0x80, 0x01, 0x80, 0x80, 0x02, 0x80, 0x80, 0x03, 0x80, 0x80, 0x04, 0x80, 0x80 },
+		{ 0x80, 0x80, 0x00, 0x80, 0x80, 0x01, 0x80, 0x80, 0x02, 0x80, 0x80, 0x03, 0x80, 0x80, 0x04, 0x80 }
+	},
+	{
+		{ 0x80, 0x80, 0x06, 0x80, 0x80, 0x07, 0x80, 0x80, 0x08, 0x80, 0x80, 0x09, 0x80, 0x80, 0x0A, 0x80 },
+		{ 0x05, 0x80, 0x80, 0x06, 0x80, 0x80, 0x07, 0x80, 0x80, 0x08, 0x80, 0x80, 0x09, 0x80, 0x80, 0x0A },
+		{ 0x80, 0x05, 0x80, 0x80, 0x06, 0x80, 0x80, 0x07, 0x80, 0x80, 0x08, 0x80, 0x80, 0x09, 0x80, 0x80 }
+	},
+	{
+		{ 0x80, 0x0B, 0x80, 0x80, 0x0C, 0x80, 0x80, 0x0D, 0x80, 0x80, 0x0E, 0x80, 0x80, 0x0F, 0x80, 0x80 },
+		{ 0x80, 0x80, 0x0B, 0x80, 0x80, 0x0C, 0x80, 0x80, 0x0D, 0x80, 0x80, 0x0E, 0x80, 0x80, 0x0F, 0x80 },
+		{ 0x0A, 0x80, 0x80, 0x0B, 0x80, 0x80, 0x0C, 0x80, 0x80, 0x0D, 0x80, 0x80, 0x0E, 0x80, 0x80, 0x0F }
+	}
+};
+
+const uint8_t yuvDuplicateU[16] = { 0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14 };
+const uint8_t yuvDuplicateV[16] = { 1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15 };
+
+
+// clamp8
+static inline uint8_t clamp8( int value )
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+// yuvConvertRowNV12_scalar
+void yuvConvertRowNV12_scalar( const uint8_t* y, const uint8_t* uv, uint8_t* bgr, uint32_t begin, uint32_t end, const yuvCoeffs& c )
+{
+	for( uint32_t x=begin; x < end; x++ )
+	{
+		const int luma = c.yMul * ((int)y[x] - c.yOff) + YUV_COEFF_ROUND;
+		const int u = (int)uv[(x & ~1u)] - 128;
+		const int v = (int)uv[(x & ~1u) + 1] - 128;
+
+		bgr[x * 3 + 0] = clamp8((luma + c.bu * u) >> YUV_COEFF_BITS);
+		bgr[x * 3 + 1] = clamp8((luma - c.gu * u - c.gv * v) >> YUV_COEFF_BITS);
+		bgr[x * 3 + 2] = clamp8((luma + c.rv * v) >> YUV_COEFF_BITS);
+	}
+}
+
+// yuvConvertNV12_scalar
+void yuvConvertNV12_scalar( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c )
+{
+	yuvConvertRowNV12_scalar(y0, uv, bgr0, 0, width, c);
+
+	if( y1 != NULL )
+		yuvConvertRowNV12_scalar(y1, uv, bgr1, 0, width, c);
+}
+
+
+// compute the fixed-point coefficients from the luma weights of the matrix
+static yuvCoeffs computeCoeffs( const yuvColorSpace& colorSpace )
+{
+	const double kr = (colorSpace.matrix == YUV_MATRIX_BT709) ? 0.2126 : 0.299;
+	const double kb = (colorSpace.matrix == YUV_MATRIX_BT709) ? 0.0722 : 0.114;
+	const double kg = 1.0 - kr - kb;
+
+	double yScale = 1.0;
+	double cScale = 1.0;
+
+	if( colorSpace.range == YUV_RANGE_LIMITED )
+	{
+		yScale = 255.0 / 219.0;
+		cScale = 255.0 / 224.0;
+	}
+
+	const double scale = (double)(1 << YUV_COEFF_BITS);
+
+	yuvCoeffs c;
+
+	c.yMul = (int16_t)lround(yScale * scale);
+	c.yOff = (colorSpace.range == YUV_RANGE_LIMITED) ? 16 : 0;
+	c.rv   = (int16_t)lround(2.0 * (1.0 - kr) * cScale * scale);
+	c.bu   = (int16_t)lround(2.0 * (1.0 - kb) * cScale * scale);
+	c.gu   = (int16_t)lround(2.0 * (1.0 - kb) * kb / kg * cScale * scale);
+	c.gv   = (int16_t)lround(2.0 * (1.0 - kr) * kr / kg * cScale * scale);
+
+	return c;
+}
+
+// coefficient table for each matrix/range combination
+const yuvCoeffs& yuvGetCoeffs( const yuvColorSpace& colorSpace )
+{
+	static const yuvCoeffs table[2][2] =
+	{
+		{ computeCoeffs(yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_LIMITED)), computeCoeffs(yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_FULL)) },
+		{ computeCoeffs(yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_LIMITED)), computeCoeffs(yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_FULL)) }
+	};
+
+	return table[colorSpace.matrix == YUV_MATRIX_BT709 ? 1 : 0][colorSpace.range == YUV_RANGE_FULL ? 1 : 0];
+}
+
+
+#ifdef YUV_CONVERT_X86
+// cpuid
+static void cpuid( int info[4], int leaf, int subleaf )
+{
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+// xgetbv
+static uint64_t xgetbv()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax = 0;
+	uint32_t edx = 0;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+// yuvConvertHasPath
+bool yuvConvertHasPath( yuvConvertPath path )
+{
+	switch(path)
+	{
+		case YUV_CONVERT_AUTO:
+		case YUV_CONVERT_SCALAR:
+			return true;
+
+	#ifdef YUV_CONVERT_X86
+		case YUV_CONVERT_SSE41:
+		case YUV_CONVERT_AVX2:
+		{
+			int info[4] = {0};
+			cpuid(info, 0, 0);
+
+			const int maxLeaf = info[0];
+
+			cpuid(info, 1, 0);
+
+			const bool ssse3 = (info[2] & (1 << 9)) != 0;
+			const bool sse41 = (info[2] & (1 << 19)) != 0;
+
+			if( path == YUV_CONVERT_SSE41 )
+				return ssse3 && sse41;
+
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx     = (info[2] & (1 << 28)) != 0;
+
+			if( !osxsave || !avx || (xgetbv() & 0x6) != 0x6 || maxLeaf < 7 )
+				return false;
+
+			cpuid(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+		}
+	#endif
+
+	#ifdef YUV_CONVERT_ARM_NEON
+		case YUV_CONVERT_NEON:
+			return true;	// NEON is mandatory on AArch64 and was enabled at compile time otherwise
+	#endif
+
+		default:
+			return false;
+	}
+}
+
+// pick the fastest supported path
+static yuvConvertPath detectPath()
+{
+	if( yuvConvertHasPath(YUV_CONVERT_AVX2) )
+		return YUV_CONVERT_AVX2;
+
+	if( yuvConvertHasPath(YUV_CONVERT_SSE41) )
+		return YUV_CONVERT_SSE41;
+
+	if( yuvConvertHasPath(YUV_CONVERT_NEON) )
+		return YUV_CONVERT_NEON;
+
+	return YUV_CONVERT_SCALAR;
+}
+
+// kernel for a path
+static yuvKernelNV12 selectKernel( yuvConvertPath path )
+{
+	switch(path)
+	{
+	#ifdef YUV_CONVERT_X86
+		case YUV_CONVERT_SSE41:	return yuvConvertNV12_sse41;
+		case YUV_CONVERT_AVX2:	return yuvConvertNV12_avx2;
+	#endif
+	#ifdef YUV_CONVERT_ARM_NEON
+		case YUV_CONVERT_NEON:	return yuvConvertNV12_neon;
+	#endif
+		default:				return yuvConvertNV12_scalar;
+	}
+}
+
+static yuvConvertPath gConvertPath = YUV_CONVERT_AUTO;
+static yuvKernelNV12  gKernelNV12  = NULL;
+
+// detect the CPU features, unless a path was already forced
+static bool initKernel()
+{
+	if( gKernelNV12 != NULL )
+		return true;
+
+	yuvConvertSetPath(YUV_CONVERT_AUTO);	// always resolves, at worst to scalar
+	printf("yuvConvert -- using %s conversion kernels\n", yuvConvertPathToStr(gConvertPath));
+
+	return true;
+}
+
+// resolve the kernel on first use (thread-safe static initialization)
+yuvKernelNV12 yuvGetKernelNV12()
+{
+	static const bool initialized = initKernel();
+	(void)initialized;
+
+	return gKernelNV12;
+}
+
+// yuvConvertSetPath
+bool yuvConvertSetPath( yuvConvertPath path )
+{
+	if( path == YUV_CONVERT_AUTO )
+		path = detectPath();
+
+	if( !yuvConvertHasPath(path) )
+		return false;
+
+	gConvertPath = path;
+	gKernelNV12  = selectKernel(path);
+
+	return true;
+}
+
+// yuvConvertGetPath
+yuvConvertPath yuvConvertGetPath()
+{
+	yuvGetKernelNV12();
+	return gConvertPath;
+}
+
+// yuvConvertPathToStr
+const char* yuvConvertPathToStr( yuvConvertPath path )
+{
+	switch(path)
+	{
+		case YUV_CONVERT_AUTO:   return "auto";
+		case YUV_CONVERT_SCALAR: return "scalar";
+		case YUV_CONVERT_SSE41:  return "sse4.1";
+		case YUV_CONVERT_AVX2:   return "avx2";
+		case YUV_CONVERT_NEON:   return "neon";
+	}
+
+	return "unknown";
+}
+
+// yuvMatrixToStr
+const char* yuvMatrixToStr( yuvMatrix matrix )
+{
+	return (matrix == YUV_MATRIX_BT709) ? "bt709" : "bt601";
+}
+
+// yuvInterpolationToStr
+const char* yuvInterpolationToStr( yuvInterpolation interp )
+{
+	return (interp == YUV_INTERP_NEAREST) ? "nearest" : "bilinear";
+}
+
+
+// yuvConvertNV12ToBGR
+void yuvConvertNV12ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* uv, uint32_t uvStride,
+					 uint8_t* bgr, uint32_t bgrStride, uint32_t width, uint32_t height,
+					 const yuvColorSpace& colorSpace )
+{
+	if( !y || !uv || !bgr || width == 0 || height == 0 )
+		return;
+
+	const yuvKernelNV12 kernel = yuvGetKernelNV12();
+	const yuvCoeffs& coeffs = yuvGetCoeffs(colorSpace);
+
+	// each chroma row is shared by two luma rows
+	for( uint32_t row=0; row < height; row += 2 )
+	{
+		const bool pair = (row + 1 < height);
+
+		kernel(y + (size_t)row * yStride,
+			  pair ? y + (size_t)(row + 1) * yStride : NULL,
+			  uv + (size_t)(row / 2) * uvStride,
+			  bgr + (size_t)row * bgrStride,
+			  pair ? bgr + (size_t)(row + 1) * bgrStride : NULL,
+			  width, coeffs);
+	}
+}
+
+// yuvConvertI420ToBGR
+void yuvConvertI420ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride,
+					 uint8_t* bgr, uint32_t bgrStride, uint32_t width, uint32_t height,
+					 const yuvColorSpace& colorSpace )
+{
+	if( !y || !u || !v || !bgr || width == 0 || height == 0 )
+		return;
+
+	const yuvKernelNV12 kernel = yuvGetKernelNV12();
+	const yuvCoeffs& coeffs = yuvGetCoeffs(colorSpace);
+
+	// the chroma planes are interleaved one row at a time, for the NV12 kernels
+	const uint32_t chromaWidth = (width + 1) / 2;
+	std::vector<uint8_t> rowUV(chromaWidth * 2 + 64);
+
+	for( uint32_t row=0; row < height; row += 2 )
+	{
+		const bool pair = (row + 1 < height);
+		const uint8_t* rowU = u + (size_t)(row / 2) * uStride;
+		const uint8_t* rowV = v + (size_t)(row / 2) * vStride;
+
+		for( uint32_t x=0; x < chromaWidth; x++ )
+		{
+			rowUV[x * 2 + 0] = rowU[x];
+			rowUV[x * 2 + 1] = rowV[x];
+		}
+
+		kernel(y + (size_t)row * yStride,
+			  pair ? y + (size_t)(row + 1) * yStride : NULL,
+			  rowUV.data(),
+			  bgr + (size_t)row * bgrStride,
+			  pair ? bgr + (size_t)(row + 1) * bgrStride : NULL,
+			  width, coeffs);
+	}
+}
@@ -0,0 +1,151 @@
+#ifndef __YUV_CONVERT_H__
+#define __YUV_CONVERT_H__
+
+#include <stdint.h>
+
+
+/**
+ * YUV to RGB matrix coefficients.
+ */
+enum yuvMatrix
+{
+	YUV_MATRIX_BT601 = 0,	/**< ITU-R BT.601 (SD video, most webcams) */
+	YUV_MATRIX_BT709 = 1	/**< ITU-R BT.709 (HD video) */
+};
+
+/**
+ * Quantization range of the YUV samples.
+ */
+enum yuvRange
+{
+	YUV_RANGE_LIMITED = 0,	/**< Y in [16,235], UV in [16,240] ("TV" range) */
+	YUV_RANGE_FULL    = 1	/**< Y and UV in [0,255] ("PC" / JPEG range) */
+};
+
+/**
+ * Colorimetry of a YUV frame, as negotiated in the caps.
+ */
+struct yuvColorSpace
+{
+	yuvMatrix matrix;
+	yuvRange  range;
+
+	yuvColorSpace() : matrix(YUV_MATRIX_BT601), range(YUV_RANGE_LIMITED) {}
+	yuvColorSpace( yuvMatrix m, yuvRange r ) : matrix(m), range(r) {}
+};
+
+/**
+ * Resampling filter used when converting to a different output size.
+ */
+enum yuvInterpolation
+{
+	YUV_INTERP_NEAREST  = 0,	/**< nearest neighbour, fastest */
+	YUV_INTERP_BILINEAR = 1	/**< bilinear, like cv::INTER_LINEAR */
+};
+
+/**
+ * Conversion kernels, selected at run-time from the CPU features.
+ */
+enum yuvConvertPath
+{
+	YUV_CONVERT_AUTO   = 0,	/**< pick the fastest path supported by the CPU */
+	YUV_CONVERT_SCALAR = 1,	/**< portable reference implementation */
+	YUV_CONVERT_SSE41  = 2,	/**< x86 SSE4.1 */
+	YUV_CONVERT_AVX2   = 3,	/**< x86 AVX2 */
+	YUV_CONVERT_NEON   = 4	/**< ARM NEON */
+};
+
+/**
+ * Convert an NV12 image to packed 8-bit BGR (the layout of a CV_8UC3 cv::Mat).
+ *
+ * All kernels use the same 13-bit fixed-point arithmetic, so every path
+ * produces bit-exact output to YUV_CONVERT_SCALAR.
+ *
+ * @param y        luma plane
+ * @param yStride  luma row pitch in bytes
+ * @param uv       interleaved chroma plane (half resolution)
+ * @param uvStride chroma row pitch in bytes
+ * @param bgr      output image, width*height*3 bytes
+ * @param bgrStride output row pitch in bytes
+ */
+void yuvConvertNV12ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* uv, uint32_t uvStride,
+					 uint8_t* bgr, uint32_t bgrStride, uint32_t width, uint32_t height,
+					 const yuvColorSpace& colorSpace=yuvColorSpace() );
+
+/**
+ * Convert an NV12 image to packed 8-bit BGR and resize it in the same pass.
+ *
+ * Only the output pixels are produced: each pair of output rows is resampled
+ * from the source planes into small NV12 scratch rows, which then go through
+ * the same SIMD kernels as yuvConvertNV12ToBGR().  When the sizes match this
+ * is equivalent to yuvConvertNV12ToBGR().
+ *
+ * @param srcWidth  width of the NV12 image
+ * @param srcHeight height of the NV12 image
+ * @param dstWidth  width of the BGR output
+ * @param dstHeight height of the BGR output
+ * @param interp    resampling filter
+ */
+void yuvConvertResizeNV12ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* uv, uint32_t uvStride,
+						  uint32_t srcWidth, uint32_t srcHeight,
+						  uint8_t* bgr, uint32_t bgrStride, uint32_t dstWidth, uint32_t dstHeight,
+						  yuvInterpolation interp=YUV_INTERP_BILINEAR,
+						  const yuvColorSpace& colorSpace=yuvColorSpace() );
+
+/**
+ * Convert an I420 image (separate U and V planes) to packed 8-bit BGR.
+ * The chroma rows are interleaved on the fly, and go through the same
+ * kernels as yuvConvertNV12ToBGR().
+ *
+ * @param u       U plane (half resolution)
+ * @param uStride row pitch of the U plane in bytes
+ * @param v       V plane (half resolution)
+ * @param vStride row pitch of the V plane in bytes, which can differ from the U plane's
+ */
+void yuvConvertI420ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride,
+					 uint8_t* bgr, uint32_t bgrStride, uint32_t width, uint32_t height,
+					 const yuvColorSpace& colorSpace=yuvColorSpace() );
+
+/**
+ * Convert an I420 image to packed 8-bit BGR and resize it in the same pass.
+ * @see yuvConvertResizeNV12ToBGR()
+ */
+void yuvConvertResizeI420ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride,
+						  uint32_t srcWidth, uint32_t srcHeight,
+						  uint8_t* bgr, uint32_t bgrStride, uint32_t dstWidth, uint32_t dstHeight,
+						  yuvInterpolation interp=YUV_INTERP_BILINEAR,
+						  const yuvColorSpace& colorSpace=yuvColorSpace() );
+
+/**
+ * Force a specific conversion path (mostly for benchmarking and verification).
+ * @returns `false` if the path isn't supported by this build or CPU, in which
+ *          case the current path is left unchanged.
+ */
+bool yuvConvertSetPath( yuvConvertPath path );
+
+/**
+ * The conversion path currently in use.
+ */
+yuvConvertPath yuvConvertGetPath();
+
+/**
+ * Returns true if the given path can run on this build and CPU.
+ */
+bool yuvConvertHasPath( yuvConvertPath path );
+
+/**
+ * Name of a conversion path ("scalar", "sse4.1", "avx2", "neon").
+ */
+const char* yuvConvertPathToStr( yuvConvertPath path );
+
+/**
+ * Name of a matrix ("bt601", "bt709").
+ */
+const char* yuvMatrixToStr( yuvMatrix matrix );
+
+/**
+ * Name of an interpolation mode ("nearest", "bilinear").
+ */
+const char* yuvInterpolationToStr( yuvInterpolation interp );
+
+#endif
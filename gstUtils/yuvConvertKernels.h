@@ -0,0 +1,94 @@
+#ifndef __YUV_CONVERT_KERNELS_H__
+#define __YUV_CONVERT_KERNELS_H__
+
+// Internal to yuvConvert*.cpp.  The SIMD kernels are compiled with their own
+// instruction set flags, so keep this header free of inline code that could
+// end up being shared with the rest of the program.
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define YUV_CONVERT_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define YUV_CONVERT_ARM_NEON
+#endif
+
+
+/**
+ * Fixed-point conversion coefficients (Q13), shared by all kernels:
+ *
+ *   R = clamp((yMul*(Y-yOff) + rv*(V-128)              + 4096) >> 13)
+ *   G = clamp((yMul*(Y-yOff) - gu*(U-128) - gv*(V-128) + 4096) >> 13)
+ *   B = clamp((yMul*(Y-yOff) + bu*(U-128)              + 4096) >> 13)
+ *
+ * Every coefficient fits in an int16 so the x86 kernels can use pmaddwd.
+ */
+struct yuvCoeffs
+{
+	int16_t yMul;
+	int16_t yOff;
+	int16_t rv;
+	int16_t gu;
+	int16_t gv;
+	int16_t bu;
+};
+
+#define YUV_COEFF_BITS  13
+#define YUV_COEFF_ROUND (1 << (YUV_COEFF_BITS - 1))
+
+/**
+ * Converts one or two rows of NV12 sharing the same chroma row.
+ * y1 and bgr1 are NULL when the last row of an odd-height image is converted.
+ */
+typedef void (*yuvKernelNV12)( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+						 uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c );
+
+/**
+ * Scalar reference, converts pixels [begin,end) of a row.
+ * The SIMD kernels use it for the remainder at the end of each row.
+ */
+void yuvConvertRowNV12_scalar( const uint8_t* y, const uint8_t* uv, uint8_t* bgr,
+						 uint32_t begin, uint32_t end, const yuvCoeffs& c );
+
+void yuvConvertNV12_scalar( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+					   uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c );
+
+#ifdef YUV_CONVERT_X86
+void yuvConvertNV12_sse41( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+					  uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c );
+
+void yuvConvertNV12_avx2( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+					 uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c );
+#endif
+
+#ifdef YUV_CONVERT_ARM_NEON
+void yuvConvertNV12_neon( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv,
+					 uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c );
+#endif
+
+/**
+ * The kernel selected for this CPU (or forced with yuvConvertSetPath).
+ */
+yuvKernelNV12 yuvGetKernelNV12();
+
+/**
+ * The fixed-point coefficients of a colorimetry.
+ */
+struct yuvColorSpace;
+const yuvCoeffs& yuvGetCoeffs( const yuvColorSpace& colorSpace );
+
+/**
+ * pshufb masks that interleave 16 B, G and R bytes into 48 bytes of BGR.
+ * yuvInterleaveBGR[j][c] gathers channel c (0=B, 1=G, 2=R) into output block j.
+ */
+extern const uint8_t yuvInterleaveBGR[3][3][16];
+
+/**
+ * pshufb masks that split 8 interleaved UV pairs into 16 duplicated U or V bytes.
+ */
+extern const uint8_t yuvDuplicateU[16];
+extern const uint8_t yuvDuplicateV[16];
+
+#endif
@@ -0,0 +1,111 @@
+#include "yuvConvertKernels.h"
+
+#ifdef YUV_CONVERT_X86
+
+#include <immintrin.h>	// AVX2
+
+
+// interleave 16 pixels of B, G and R into 48 bytes of packed BGR
+static inline void storeBGR( uint8_t* dst, __m128i b, __m128i g, __m128i r )
+{
+	for( int j=0; j < 3; j++ )
+	{
+		const __m128i out = _mm_or_si128(_mm_or_si128(
+			_mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][0])),
+			_mm_shuffle_epi8(g, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][1]))),
+			_mm_shuffle_epi8(r, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][2])));
+
+		_mm_storeu_si128((__m128i*)(dst + j * 16), out);
+	}
+}
+
+// multiply-add interleaved pairs, round and shift back to 16 bits
+static inline __m256i madd16( __m256i a, __m256i b, __m256i k, __m256i add )
+{
+	// the 128-bit lanes of unpacklo/unpackhi hold pixels 0-3,8-11 and 4-7,12-15,
+	// which packs_epi32 puts back in order
+	const __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), k), add);
+	const __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), k), add);
+
+	return _mm256_packs_epi32(_mm256_srai_epi32(lo, YUV_COEFF_BITS), _mm256_srai_epi32(hi, YUV_COEFF_BITS));
+}
+
+// convert a row of 16 pixels
+static inline void convert16( const uint8_t* y, uint8_t* dst, __m256i u, __m256i v, __m256i yOff, const __m256i* k )
+{
+	const __m256i round = _mm256_set1_epi32(YUV_COEFF_ROUND);
+	const __m256i one = _mm256_set1_epi16(1);
+
+	const __m256i luma = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)y)), yOff);
+
+	// k[0] = (yMul, bu)  k[1] = (yMul, -gu)  k[2] = (-gv, round)  k[3] = (yMul, rv)
+	const __m256i b = madd16(luma, u, k[0], round);
+	const __m256i r = madd16(luma, v, k[3], round);
+
+	const __m256i g_lo = _mm256_add_epi32(
+		_mm256_madd_epi16(_mm256_unpacklo_epi16(luma, u), k[1]),
+		_mm256_madd_epi16(_mm256_unpacklo_epi16(v, one), k[2]));
+
+	const __m256i g_hi = _mm256_add_epi32(
+		_mm256_madd_epi16(_mm256_unpackhi_epi16(luma, u), k[1]),
+		_mm256_madd_epi16(_mm256_unpackhi_epi16(v, one), k[2]));
+
+	const __m256i g = _mm256_packs_epi32(_mm256_srai_epi32(g_lo, YUV_COEFF_BITS), _mm256_srai_epi32(g_hi, YUV_COEFF_BITS));
+
+	// saturate to 8 bits, packus works per lane so restore the order with a qword permute
+	const __m256i rg = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, g), 0xD8);
+	const __m256i bb = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0xD8);
+
+	storeBGR(dst, _mm256_castsi256_si128(bb), _mm256_extracti128_si256(rg, 1), _mm256_castsi256_si128(rg));
+}
+
+// pack two int16 coefficients into each 32-bit lane for pmaddwd
+static inline __m256i coeffPair( int lo, int hi )
+{
+	return _mm256_set1_epi32((int)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+
+// yuvConvertNV12_avx2
+void yuvConvertNV12_avx2( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c )
+{
+	const __m256i k[4] = {
+		coeffPair(c.yMul, c.bu),
+		coeffPair(c.yMul, -c.gu),
+		coeffPair(-c.gv, YUV_COEFF_ROUND),
+		coeffPair(c.yMul, c.rv)
+	};
+
+	const __m256i yOff = _mm256_set1_epi16(c.yOff);
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const __m128i dupU = _mm_loadu_si128((const __m128i*)yuvDuplicateU);
+	const __m128i dupV = _mm_loadu_si128((const __m128i*)yuvDuplicateV);
+
+	uint32_t x = 0;
+
+	for( ; x + 16 <= width; x += 16 )
+	{
+		// 8 UV pairs cover 16 pixels of both rows
+		const __m128i chroma = _mm_loadu_si128((const __m128i*)(uv + x));
+
+		const __m256i u = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(chroma, dupU)), c128);
+		const __m256i v = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(chroma, dupV)), c128);
+
+		convert16(y0 + x, bgr0 + x * 3, u, v, yOff, k);
+
+		if( y1 != NULL )
+			convert16(y1 + x, bgr1 + x * 3, u, v, yOff, k);
+	}
+
+	if( x < width )
+	{
+		yuvConvertRowNV12_scalar(y0, uv, bgr0, x, width, c);
+
+		if( y1 != NULL )
+			yuvConvertRowNV12_scalar(y1, uv, bgr1, x, width, c);
+	}
+
+	_mm256_zeroupper();
+}
+
+#endif
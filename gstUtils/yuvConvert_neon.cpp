@@ -0,0 +1,88 @@
+#include "yuvConvertKernels.h"
+
+#ifdef YUV_CONVERT_ARM_NEON
+
+#include <arm_neon.h>
+
+
+// convert 8 pixels to 8-bit B, G, R
+static inline void convert8( int16x8_t y, int16x8_t u, int16x8_t v, const yuvCoeffs& c, uint8x8_t& b, uint8x8_t& g, uint8x8_t& r )
+{
+	const int32x4_t luma_lo = vmull_n_s16(vget_low_s16(y), c.yMul);
+	const int32x4_t luma_hi = vmull_n_s16(vget_high_s16(y), c.yMul);
+
+	// vrshrq_n_s32 adds the rounding term before shifting, like the scalar path
+	const int32x4_t b_lo = vrshrq_n_s32(vmlal_n_s16(luma_lo, vget_low_s16(u), c.bu), YUV_COEFF_BITS);
+	const int32x4_t b_hi = vrshrq_n_s32(vmlal_n_s16(luma_hi, vget_high_s16(u), c.bu), YUV_COEFF_BITS);
+
+	const int32x4_t g_lo = vrshrq_n_s32(vmlsl_n_s16(vmlsl_n_s16(luma_lo, vget_low_s16(u), c.gu), vget_low_s16(v), c.gv), YUV_COEFF_BITS);
+	const int32x4_t g_hi = vrshrq_n_s32(vmlsl_n_s16(vmlsl_n_s16(luma_hi, vget_high_s16(u), c.gu), vget_high_s16(v), c.gv), YUV_COEFF_BITS);
+
+	const int32x4_t r_lo = vrshrq_n_s32(vmlal_n_s16(luma_lo, vget_low_s16(v), c.rv), YUV_COEFF_BITS);
+	const int32x4_t r_hi = vrshrq_n_s32(vmlal_n_s16(luma_hi, vget_high_s16(v), c.rv), YUV_COEFF_BITS);
+
+	b = vqmovun_s16(vcombine_s16(vqmovn_s32(b_lo), vqmovn_s32(b_hi)));
+	g = vqmovun_s16(vcombine_s16(vqmovn_s32(g_lo), vqmovn_s32(g_hi)));
+	r = vqmovun_s16(vcombine_s16(vqmovn_s32(r_lo), vqmovn_s32(r_hi)));
+}
+
+// convert a row of 16 pixels
+static inline void convert16( const uint8_t* y, uint8_t* dst, int16x8x2_t u, int16x8x2_t v, int16x8_t yOff, const yuvCoeffs& c )
+{
+	const uint8x16_t luma = vld1q_u8(y);
+
+	const int16x8_t y_lo = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(luma))), yOff);
+	const int16x8_t y_hi = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(luma))), yOff);
+
+	uint8x8_t b_lo, g_lo, r_lo;
+	uint8x8_t b_hi, g_hi, r_hi;
+
+	convert8(y_lo, u.val[0], v.val[0], c, b_lo, g_lo, r_lo);
+	convert8(y_hi, u.val[1], v.val[1], c, b_hi, g_hi, r_hi);
+
+	uint8x16x3_t bgr;
+
+	bgr.val[0] = vcombine_u8(b_lo, b_hi);
+	bgr.val[1] = vcombine_u8(g_lo, g_hi);
+	bgr.val[2] = vcombine_u8(r_lo, r_hi);
+
+	vst3q_u8(dst, bgr);
+}
+
+
+// yuvConvertNV12_neon
+void yuvConvertNV12_neon( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c )
+{
+	const int16x8_t yOff = vdupq_n_s16(c.yOff);
+	const int16x8_t c128 = vdupq_n_s16(128);
+
+	uint32_t x = 0;
+
+	for( ; x + 16 <= width; x += 16 )
+	{
+		// 8 UV pairs cover 16 pixels of both rows
+		const uint8x8x2_t chroma = vld2_u8(uv + x);
+
+		const int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chroma.val[0])), c128);
+		const int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chroma.val[1])), c128);
+
+		// duplicate each chroma sample for the two pixels it covers
+		const int16x8x2_t u2 = vzipq_s16(u, u);
+		const int16x8x2_t v2 = vzipq_s16(v, v);
+
+		convert16(y0 + x, bgr0 + x * 3, u2, v2, yOff, c);
+
+		if( y1 != NULL )
+			convert16(y1 + x, bgr1 + x * 3, u2, v2, yOff, c);
+	}
+
+	if( x < width )
+	{
+		yuvConvertRowNV12_scalar(y0, uv, bgr0, x, width, c);
+
+		if( y1 != NULL )
+			yuvConvertRowNV12_scalar(y1, uv, bgr1, x, width, c);
+	}
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "yuvConvertKernels.h"
+
+#ifdef YUV_CONVERT_X86
+
+#include <smmintrin.h>	// SSE4.1 (and SSSE3 pshufb)
+
+
+// interleave 16 pixels of B, G and R into 48 bytes of packed BGR
+static inline void storeBGR( uint8_t* dst, __m128i b, __m128i g, __m128i r )
+{
+	for( int j=0; j < 3; j++ )
+	{
+		const __m128i out = _mm_or_si128(_mm_or_si128(
+			_mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][0])),
+			_mm_shuffle_epi8(g, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][1]))),
+			_mm_shuffle_epi8(r, _mm_loadu_si128((const __m128i*)yuvInterleaveBGR[j][2])));
+
+		_mm_storeu_si128((__m128i*)(dst + j * 16), out);
+	}
+}
+
+// convert 8 pixels to 16-bit B, G, R
+static inline void convert8( __m128i y, __m128i u, __m128i v, const __m128i* k, __m128i& b, __m128i& g, __m128i& r )
+{
+	const __m128i round = _mm_set1_epi32(YUV_COEFF_ROUND);
+	const __m128i one = _mm_set1_epi16(1);
+
+	const __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+	const __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+	const __m128i yv_lo = _mm_unpacklo_epi16(y, v);
+	const __m128i yv_hi = _mm_unpackhi_epi16(y, v);
+	const __m128i v1_lo = _mm_unpacklo_epi16(v, one);
+	const __m128i v1_hi = _mm_unpackhi_epi16(v, one);
+
+	// k[0] = (yMul, bu)  k[1] = (yMul, -gu)  k[2] = (-gv, round)  k[3] = (yMul, rv)
+	b = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_lo, k[0]), round), YUV_COEFF_BITS),
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_hi, k[0]), round), YUV_COEFF_BITS));
+
+	g = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_lo, k[1]), _mm_madd_epi16(v1_lo, k[2])), YUV_COEFF_BITS),
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu_hi, k[1]), _mm_madd_epi16(v1_hi, k[2])), YUV_COEFF_BITS));
+
+	r = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv_lo, k[3]), round), YUV_COEFF_BITS),
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv_hi, k[3]), round), YUV_COEFF_BITS));
+}
+
+// convert a row of 16 pixels
+static inline void convert16( const uint8_t* y, uint8_t* dst, __m128i u_lo, __m128i u_hi, __m128i v_lo, __m128i v_hi, __m128i yOff, const __m128i* k )
+{
+	const __m128i luma = _mm_loadu_si128((const __m128i*)y);
+	const __m128i y_lo = _mm_sub_epi16(_mm_cvtepu8_epi16(luma), yOff);
+	const __m128i y_hi = _mm_sub_epi16(_mm_unpackhi_epi8(luma, _mm_setzero_si128()), yOff);
+
+	__m128i b_lo, g_lo, r_lo;
+	__m128i b_hi, g_hi, r_hi;
+
+	convert8(y_lo, u_lo, v_lo, k, b_lo, g_lo, r_lo);
+	convert8(y_hi, u_hi, v_hi, k, b_hi, g_hi, r_hi);
+
+	storeBGR(dst, _mm_packus_epi16(b_lo, b_hi), _mm_packus_epi16(g_lo, g_hi), _mm_packus_epi16(r_lo, r_hi));
+}
+
+// pack two int16 coefficients into each 32-bit lane for pmaddwd
+static inline __m128i coeffPair( int lo, int hi )
+{
+	return _mm_set1_epi32((int)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo));
+}
+
+
+// yuvConvertNV12_sse41
+void yuvConvertNV12_sse41( const uint8_t* y0, const uint8_t* y1, const uint8_t* uv, uint8_t* bgr0, uint8_t* bgr1, uint32_t width, const yuvCoeffs& c )
+{
+	const __m128i k[4] = {
+		coeffPair(c.yMul, c.bu),
+		coeffPair(c.yMul, -c.gu),
+		coeffPair(-c.gv, YUV_COEFF_ROUND),
+		coeffPair(c.yMul, c.rv)
+	};
+
+	const __m128i yOff = _mm_set1_epi16(c.yOff);
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i dupU = _mm_loadu_si128((const __m128i*)yuvDuplicateU);
+	const __m128i dupV = _mm_loadu_si128((const __m128i*)yuvDuplicateV);
+
+	uint32_t x = 0;
+
+	for( ; x + 16 <= width; x += 16 )
+	{
+		// 8 UV pairs cover 16 pixels of both rows
+		const __m128i chroma = _mm_loadu_si128((const __m128i*)(uv + x));
+		const __m128i u = _mm_shuffle_epi8(chroma, dupU);
+		const __m128i v = _mm_shuffle_epi8(chroma, dupV);
+
+		const __m128i u_lo = _mm_sub_epi16(_mm_cvtepu8_epi16(u), c128);
+		const __m128i u_hi = _mm_sub_epi16(_mm_unpackhi_epi8(u, zero), c128);
+		const __m128i v_lo = _mm_sub_epi16(_mm_cvtepu8_epi16(v), c128);
+		const __m128i v_hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), c128);
+
+		convert16(y0 + x, bgr0 + x * 3, u_lo, u_hi, v_lo, v_hi, yOff, k);
+
+		if( y1 != NULL )
+			convert16(y1 + x, bgr1 + x * 3, u_lo, u_hi, v_lo, v_hi, yOff, k);
+	}
+
+	if( x < width )
+	{
+		yuvConvertRowNV12_scalar(y0, uv, bgr0, x, width, c);
+
+		if( y1 != NULL )
+			yuvConvertRowNV12_scalar(y1, uv, bgr1, x, width, c);
+	}
+}
+
+#endif
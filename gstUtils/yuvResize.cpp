@@ -0,0 +1,232 @@
+#include "yuvConvert.h"
+#include "yuvConvertKernels.h"
+
+#include <vector>
+#include <math.h>
+
+
+// source index and bilinear weight (Q8) for each output position
+struct resampleMap
+{
+	std::vector<uint32_t> i0;
+	std::vector<uint32_t> i1;
+	std::vector<uint16_t> w;
+};
+
+// computeMap
+static void computeMap( uint32_t srcSize, uint32_t dstSize, yuvInterpolation interp, resampleMap& map )
+{
+	map.i0.resize(dstSize);
+	map.i1.resize(dstSize);
+	map.w.resize(dstSize);
+
+	const double scale = (double)srcSize / (double)dstSize;
+
+	for( uint32_t n=0; n < dstSize; n++ )
+	{
+		uint32_t i0 = 0;
+		uint32_t w = 0;
+
+		if( interp == YUV_INTERP_NEAREST )
+		{
+			i0 = (uint32_t)((n + 0.5) * scale);
+		}
+		else
+		{
+			// pixel centers are aligned, like cv::resize
+			double f = (n + 0.5) * scale - 0.5;
+
+			if( f < 0.0 )
+				f = 0.0;
+
+			i0 = (uint32_t)f;
+			w = (uint32_t)lround((f - i0) * 256.0);
+
+			if( w >= 256 )
+			{
+				i0++;
+				w = 0;
+			}
+		}
+
+		if( i0 >= srcSize - 1 )
+		{
+			i0 = srcSize - 1;
+			w = 0;
+		}
+
+		map.i0[n] = i0;
+		map.i1[n] = (i0 + 1 < srcSize) ? i0 + 1 : i0;
+		map.w[n]  = (uint16_t)w;
+	}
+}
+
+// bilinear blend of four samples (Q8 weights)
+static inline uint8_t blend( uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11, uint32_t wx, uint32_t wy )
+{
+	const uint32_t top = p00 * (256 - wx) + p01 * wx;
+	const uint32_t bottom = p10 * (256 - wx) + p11 * wx;
+
+	return (uint8_t)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+}
+
+// resample one luma row
+static void resampleLuma( const uint8_t* y, uint32_t yStride, const resampleMap& xmap, const resampleMap& ymap, uint32_t row, uint32_t width, uint8_t* out )
+{
+	const uint8_t* r0 = y + (size_t)ymap.i0[row] * yStride;
+	const uint8_t* r1 = y + (size_t)ymap.i1[row] * yStride;
+	const uint32_t wy = ymap.w[row];
+
+	const uint32_t* x0 = xmap.i0.data();
+	const uint32_t* x1 = xmap.i1.data();
+	const uint16_t* wx = xmap.w.data();
+
+	for( uint32_t x=0; x < width; x++ )
+		out[x] = blend(r0[x0[x]], r0[x1[x]], r1[x0[x]], r1[x1[x]], wx[x], wy);
+}
+
+// resample one chroma row into an interleaved row, U and V are `step` bytes apart from one sample to the next
+static void resampleChroma( const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride, uint32_t step, const resampleMap& xmap, const resampleMap& ymap, uint32_t row, uint32_t width, uint8_t* out )
+{
+	const uint8_t* u0 = u + (size_t)ymap.i0[row] * uStride;
+	const uint8_t* u1 = u + (size_t)ymap.i1[row] * uStride;
+	const uint8_t* v0 = v + (size_t)ymap.i0[row] * vStride;
+	const uint8_t* v1 = v + (size_t)ymap.i1[row] * vStride;
+	const uint32_t wy = ymap.w[row];
+
+	for( uint32_t x=0; x < width; x++ )
+	{
+		const size_t x0 = xmap.i0[x] * step;
+		const size_t x1 = xmap.i1[x] * step;
+		const uint32_t wx = xmap.w[x];
+
+		out[x * 2 + 0] = blend(u0[x0], u0[x1], u1[x0], u1[x1], wx, wy);
+		out[x * 2 + 1] = blend(v0[x0], v0[x1], v1[x0], v1[x1], wx, wy);
+	}
+}
+
+// gather one luma row (nearest)
+static void sampleLuma( const uint8_t* y, uint32_t yStride, const resampleMap& xmap, const resampleMap& ymap, uint32_t row, uint32_t width, uint8_t* out )
+{
+	const uint8_t* r0 = y + (size_t)ymap.i0[row] * yStride;
+	const uint32_t* x0 = xmap.i0.data();
+
+	for( uint32_t x=0; x < width; x++ )
+		out[x] = r0[x0[x]];
+}
+
+// gather one chroma row into an interleaved row (nearest)
+static void sampleChroma( const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride, uint32_t step, const resampleMap& xmap, const resampleMap& ymap, uint32_t row, uint32_t width, uint8_t* out )
+{
+	const uint8_t* u0 = u + (size_t)ymap.i0[row] * uStride;
+	const uint8_t* v0 = v + (size_t)ymap.i0[row] * vStride;
+
+	for( uint32_t x=0; x < width; x++ )
+	{
+		const size_t x0 = xmap.i0[x] * step;
+
+		out[x * 2 + 0] = u0[x0];
+		out[x * 2 + 1] = v0[x0];
+	}
+}
+
+
+// resizeToBGR (NV12 is read as U and V planes 1 byte apart, with a step of 2)
+static void resizeToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride, uint32_t chromaStep,
+					uint32_t srcWidth, uint32_t srcHeight,
+					uint8_t* bgr, uint32_t bgrStride, uint32_t dstWidth, uint32_t dstHeight,
+					yuvInterpolation interp, const yuvColorSpace& colorSpace )
+{
+	const yuvKernelNV12 kernel = yuvGetKernelNV12();
+	const yuvCoeffs& coeffs = yuvGetCoeffs(colorSpace);
+
+	// luma and chroma are resampled separately, each at its own resolution
+	const uint32_t srcChromaWidth  = (srcWidth + 1) / 2;
+	const uint32_t srcChromaHeight = (srcHeight + 1) / 2;
+	const uint32_t dstChromaWidth  = (dstWidth + 1) / 2;
+	const uint32_t dstChromaHeight = (dstHeight + 1) / 2;
+
+	resampleMap lumaX, lumaY;
+	resampleMap chromaX, chromaY;
+
+	computeMap(srcWidth, dstWidth, interp, lumaX);
+	computeMap(srcHeight, dstHeight, interp, lumaY);
+	computeMap(srcChromaWidth, dstChromaWidth, interp, chromaX);
+	computeMap(srcChromaHeight, dstChromaHeight, interp, chromaY);
+
+	// NV12 scratch rows at the output resolution, padded for the SIMD loads
+	std::vector<uint8_t> scratch(dstWidth * 2 + dstChromaWidth * 2 + 64);
+
+	uint8_t* row0 = scratch.data();
+	uint8_t* row1 = row0 + dstWidth;
+	uint8_t* rowUV = row1 + dstWidth;
+
+	const bool nearest = (interp == YUV_INTERP_NEAREST);
+
+	for( uint32_t row=0; row < dstHeight; row += 2 )
+	{
+		const bool pair = (row + 1 < dstHeight);
+
+		if( nearest )
+		{
+			sampleLuma(y, yStride, lumaX, lumaY, row, dstWidth, row0);
+
+			if( pair )
+				sampleLuma(y, yStride, lumaX, lumaY, row + 1, dstWidth, row1);
+
+			sampleChroma(u, uStride, v, vStride, chromaStep, chromaX, chromaY, row / 2, dstChromaWidth, rowUV);
+		}
+		else
+		{
+			resampleLuma(y, yStride, lumaX, lumaY, row, dstWidth, row0);
+
+			if( pair )
+				resampleLuma(y, yStride, lumaX, lumaY, row + 1, dstWidth, row1);
+
+			resampleChroma(u, uStride, v, vStride, chromaStep, chromaX, chromaY, row / 2, dstChromaWidth, rowUV);
+		}
+
+		kernel(row0, pair ? row1 : NULL, rowUV,
+			  bgr + (size_t)row * bgrStride,
+			  pair ? bgr + (size_t)(row + 1) * bgrStride : NULL,
+			  dstWidth, coeffs);
+	}
+}
+
+
+// yuvConvertResizeNV12ToBGR
+void yuvConvertResizeNV12ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* uv, uint32_t uvStride,
+						  uint32_t srcWidth, uint32_t srcHeight,
+						  uint8_t* bgr, uint32_t bgrStride, uint32_t dstWidth, uint32_t dstHeight,
+						  yuvInterpolation interp, const yuvColorSpace& colorSpace )
+{
+	if( !y || !uv || !bgr || srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0 )
+		return;
+
+	if( srcWidth == dstWidth && srcHeight == dstHeight )
+	{
+		yuvConvertNV12ToBGR(y, yStride, uv, uvStride, bgr, bgrStride, dstWidth, dstHeight, colorSpace);
+		return;
+	}
+
+	resizeToBGR(y, yStride, uv, uvStride, uv + 1, uvStride, 2, srcWidth, srcHeight, bgr, bgrStride, dstWidth, dstHeight, interp, colorSpace);
+}
+
+
+// yuvConvertResizeI420ToBGR
+void yuvConvertResizeI420ToBGR( const uint8_t* y, uint32_t yStride, const uint8_t* u, uint32_t uStride, const uint8_t* v, uint32_t vStride,
+						  uint32_t srcWidth, uint32_t srcHeight,
+						  uint8_t* bgr, uint32_t bgrStride, uint32_t dstWidth, uint32_t dstHeight,
+						  yuvInterpolation interp, const yuvColorSpace& colorSpace )
+{
+	if( !y || !u || !v || !bgr || srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0 )
+		return;
+
+	if( srcWidth == dstWidth && srcHeight == dstHeight )
+	{
+		yuvConvertI420ToBGR(y, yStride, u, uStride, v, vStride, bgr, bgrStride, dstWidth, dstHeight, colorSpace);
+		return;
+	}
+
+	resizeToBGR(y, yStride, u, uStride, v, vStride, 1, srcWidth, srcHeight, bgr, bgrStride, dstWidth, dstHeight, interp, colorSpace);
+}
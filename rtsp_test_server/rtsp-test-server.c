@@ -0,0 +1,84 @@
+/*
+ * Local RTSP server for testing gstDecoder/StreamManager with many streams.
+ *
+ * usage: rtsp_test_server [streams] [width] [height]
+ *
+ * Serves rtsp://127.0.0.1:8554/test0 ... /testN-1, each an H.264 encoded
+ * videotestsrc pattern, e.g.
+ *
+ *   rtsp_test_server 64
+ *   gstDecoder rtsp://127.0.0.1:8554/test0 rtsp://127.0.0.1:8554/test1 ...
+ *
+ * tests/streamManager_scale_test serves the same streams itself and checks
+ * that StreamManager delivers all of them.
+ */
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+#include <stdlib.h>
+
+#define DEFAULT_STREAMS 16
+#define DEFAULT_PORT "8554"
+
+int main(int argc, char *argv[])
+{
+    GMainLoop *loop;
+    GstRTSPServer *server;
+    GstRTSPMountPoints *mounts;
+    int streams = DEFAULT_STREAMS;
+    int width = 1280;
+    int height = 720;
+    int i;
+
+    gst_init(&argc, &argv);
+
+    if (argc > 1)
+        streams = atoi(argv[1]);
+    if (argc > 3)
+    {
+        width = atoi(argv[2]);
+        height = atoi(argv[3]);
+    }
+
+    loop = g_main_loop_new(NULL, FALSE);
+
+    server = gst_rtsp_server_new();
+    gst_rtsp_server_set_service(server, DEFAULT_PORT);
+
+    mounts = gst_rtsp_server_get_mount_points(server);
+
+    for (i = 0; i < streams; i++)
+    {
+        GstRTSPMediaFactory *factory = gst_rtsp_media_factory_new();
+        gchar *launch, *path;
+
+        /* a different pattern per stream, so they can be told apart */
+        launch = g_strdup_printf("( videotestsrc is-live=true pattern=%d ! video/x-raw,width=%d,height=%d,framerate=30/1 ! "
+                                 "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=30 ! rtph264pay name=pay0 pt=96 )",
+                                 i % 20, width, height);
+        path = g_strdup_printf("/test%d", i);
+
+        gst_rtsp_media_factory_set_launch(factory, launch);
+
+        /* every client of a mount shares the same encoder */
+        gst_rtsp_media_factory_set_shared(factory, TRUE);
+        gst_rtsp_mount_points_add_factory(mounts, path, factory);
+
+        g_free(launch);
+        g_free(path);
+    }
+
+    g_object_unref(mounts);
+
+    if (gst_rtsp_server_attach(server, NULL) == 0)
+    {
+        g_printerr("Failed to attach the server\n");
+        return -1;
+    }
+
+    g_print("Serving %d streams at rtsp://127.0.0.1:%s/test0 ... /test%d\n", streams, DEFAULT_PORT, streams - 1);
+    g_main_loop_run(loop);
+
+    g_main_loop_unref(loop);
+    g_object_unref(server);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Checks gstDeviceCache against the vivid virtual V4L2 driver.
+ *
+ *   sudo modprobe vivid
+ *
+ * The first lookup of the vivid capture device has to enumerate, the next
+ * ones (in the same process, and from a new cache loading the file) are
+ * served from the cache.  A cache file whose fingerprint or bus info no
+ * longer matches the device, as after the driver was reloaded with other
+ * formats or a different camera was plugged in, has to enumerate again.
+ *
+ * Returns 0 if every check passes, and SKIP_TEST_CODE (reported as skipped
+ * by ctest) if there is no vivid device.
+ */
+#include "gstDeviceCache.h"
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+
+#include <string>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#define SKIP_TEST_CODE 77		// SKIP_RETURN_CODE of the test in CMakeLists.txt
+#define MAX_VIDEO_NODES 64
+
+
+// findVivid (the first capture device of the vivid driver)
+static std::string findVivid()
+{
+#ifdef __linux__
+	for( int n=0; n < MAX_VIDEO_NODES; n++ )
+	{
+		const std::string path = "/dev/video" + std::to_string(n);
+		const int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+
+		if( fd < 0 )
+			continue;
+
+		struct v4l2_capability caps;
+		memset(&caps, 0, sizeof(caps));
+
+		const bool vivid = ioctl(fd, VIDIOC_QUERYCAP, &caps) == 0 &&
+					    strncmp((const char*)caps.driver, "vivid", sizeof(caps.driver)) == 0 &&
+					    (caps.device_caps & V4L2_CAP_VIDEO_CAPTURE);
+		close(fd);
+
+		if( vivid )
+			return path;
+	}
+#endif
+	return "";
+}
+
+
+// setKey (change a value of a device in the cache file)
+static bool setKey( const std::string& filename, const std::string& path, const char* key, const char* value )
+{
+	GKeyFile* file = g_key_file_new();
+	bool saved = false;
+
+	if( g_key_file_load_from_file(file, filename.c_str(), G_KEY_FILE_NONE, NULL) && g_key_file_has_group(file, path.c_str()) )
+	{
+		g_key_file_set_string(file, path.c_str(), key, value);
+		saved = g_key_file_save_to_file(file, filename.c_str(), NULL);
+	}
+
+	if( !saved )
+		printf("deviceCache_test -- FAILED  couldn't change %s of %s in %s\n", key, path.c_str(), filename.c_str());
+
+	g_key_file_free(file);
+	return saved;
+}
+
+
+// lookup (expecting a hit or a miss)
+static bool lookup( gstDeviceCache* cache, const std::string& path, bool hit, const char* step )
+{
+	const uint64_t hits   = cache->GetHits();
+	const uint64_t misses = cache->GetMisses();
+
+	gstDeviceCache::Device device;
+
+	if( !cache->Lookup(path.c_str(), device) )
+	{
+		printf("deviceCache_test -- FAILED  %s: %s wasn't found\n", step, path.c_str());
+		return false;
+	}
+
+	if( device.caps.empty() || device.fingerprint.empty() )
+	{
+		printf("deviceCache_test -- FAILED  %s: %s has no caps or fingerprint\n", step, path.c_str());
+		return false;
+	}
+
+	if( cache->GetHits() != hits + (hit ? 1 : 0) || cache->GetMisses() != misses + (hit ? 0 : 1) )
+	{
+		printf("deviceCache_test -- FAILED  %s: expected a cache %s\n", step, hit ? "hit" : "miss");
+		return false;
+	}
+
+	printf("deviceCache_test -- %s: %s (%s)\n", step, hit ? "hit" : "miss", device.fingerprint.c_str());
+	return true;
+}
+
+
+int main( int argc, char** argv )
+{
+	gst_init(&argc, &argv);
+
+	const std::string path = findVivid();
+
+	if( path.empty() )
+	{
+		printf("deviceCache_test -- no vivid device (sudo modprobe vivid), skipped\n");
+		return SKIP_TEST_CODE;
+	}
+
+	// a cache of its own, so the user's isn't touched
+	gchar* filename = g_build_filename(g_get_tmp_dir(), "deviceCache_test.ini", NULL);
+	const std::string cacheFile = filename;
+	g_free(filename);
+
+	g_remove(cacheFile.c_str());
+
+	bool passed = true;
+
+	gstDeviceCache* cache = gstDeviceCache::Create(cacheFile.c_str());
+
+	passed &= lookup(cache, path, false, "first lookup");
+	passed &= lookup(cache, path, true, "second lookup");
+
+	delete cache;
+
+	// a new process would load the file
+	cache = gstDeviceCache::Create(cacheFile.c_str());
+	passed &= lookup(cache, path, true, "reloaded");
+	delete cache;
+
+	// the driver reloaded with other formats
+	passed &= setKey(cacheFile, path, "fingerprint", "0.0.0 00000000 GREY");
+
+	cache = gstDeviceCache::Create(cacheFile.c_str());
+	passed &= lookup(cache, path, false, "other formats");
+	passed &= lookup(cache, path, true, "after enumerating");
+	delete cache;
+
+	// a different device plugged in at the same path
+	passed &= setKey(cacheFile, path, "bus-info", "usb-0000:00:00.0-0");
+
+	cache = gstDeviceCache::Create(cacheFile.c_str());
+	passed &= lookup(cache, path, false, "other device");
+	delete cache;
+
+	g_remove(cacheFile.c_str());
+
+	printf("deviceCache_test -- %s\n", passed ? "PASSED" : "FAILED");
+	return passed ? 0 : 1;
+}
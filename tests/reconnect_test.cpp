@@ -0,0 +1,232 @@
+/*
+ * Checks that gstDecoder reconnects an rtsp:// stream whose server was
+ * killed and restarted.
+ *
+ * The test serves a stream with testServer from a second process (itself,
+ * started with `serve`), receives frames from it, kills the server as a
+ * crash would and starts it again on the same port after a while.  The
+ * same decoder, opened once, has to notice the lost connection, reconnect
+ * on its own and keep delivering frames: GetReconnects() is at least 1,
+ * GetConnectionState() is back to CONNECTED and GetRecoveryTime() is set.
+ *
+ *   reconnect_test
+ *
+ * Returns 0 if every check passes.
+ */
+#include "gstDecoder.h"
+#include "testProcess.h"
+#include "testServer.h"
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define RECONNECT_TEST_PORT     "8655"
+#define RECONNECT_TEST_FRAMES   30		// frames to receive before the server is killed, and after it's back
+#define RECONNECT_TEST_DOWNTIME 3000		// ms the server stays down
+#define RECONNECT_TEST_TIMEOUT  30000		// ms to wait for each step
+
+
+// runServer (the second process, serving until it's killed)
+static int runServer()
+{
+	testServer server(RECONNECT_TEST_PORT);
+
+	if( !server.Start(1, 320, 240) )
+		return 1;
+
+	while( true )
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+
+	return 0;
+}
+
+
+// waitServer (until the server accepts connections)
+static bool waitServer()
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	GSocketClient* client = g_socket_client_new();
+	bool listening = false;
+
+	while( !listening && std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(RECONNECT_TEST_TIMEOUT) )
+	{
+		GSocketConnection* connection = g_socket_client_connect_to_host(client, "127.0.0.1:" RECONNECT_TEST_PORT, 0, NULL, NULL);
+
+		if( connection != NULL )
+		{
+			g_object_unref(connection);
+			listening = true;
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+
+	g_object_unref(client);
+
+	if( !listening )
+		printf("reconnect_test -- FAILED  the server didn't start on port %s\n", RECONNECT_TEST_PORT);
+
+	return listening;
+}
+
+
+// receive (frames from the decoder, which must not fail or end meanwhile)
+static bool receive( gstDecoder* decoder, uint32_t frames, const char* step )
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	uint32_t received = 0;
+
+	while( received < frames )
+	{
+		if( std::chrono::steady_clock::now() - begin > std::chrono::milliseconds(RECONNECT_TEST_TIMEOUT) )
+		{
+			printf("reconnect_test -- FAILED  %s: %u/%u frames\n", step, received, frames);
+			return false;
+		}
+
+		gstFrame::Ptr frame;
+		int status = gstDecoder::TIMEOUT;
+
+		if( decoder->Capture(frame, &status, 100) )
+			received++;
+		else if( status == gstDecoder::ERROR || status == gstDecoder::EOS )
+		{
+			printf("reconnect_test -- FAILED  %s: the stream reported %s\n", step, status == gstDecoder::ERROR ? "an error" : "EOS");
+			return false;
+		}
+	}
+
+	printf("reconnect_test -- %s: %u frames\n", step, received);
+	return true;
+}
+
+
+// waitState (for the connection to reach or leave CONNECTED, discarding frames meanwhile)
+static bool waitState( gstDecoder* decoder, bool connected, const char* step )
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	while( (decoder->GetConnectionState() == gstDecoder::CONNECTED) != connected )
+	{
+		if( std::chrono::steady_clock::now() - begin > std::chrono::milliseconds(RECONNECT_TEST_TIMEOUT) )
+		{
+			printf("reconnect_test -- FAILED  %s\n", step);
+			return false;
+		}
+
+		gstFrame::Ptr frame;
+		int status = gstDecoder::TIMEOUT;
+
+		if( !decoder->Capture(frame, &status, 100) && (status == gstDecoder::ERROR || status == gstDecoder::EOS) )
+		{
+			printf("reconnect_test -- FAILED  %s: the stream reported %s\n", step, status == gstDecoder::ERROR ? "an error" : "EOS");
+			return false;
+		}
+	}
+
+	printf("reconnect_test -- %s\n", step);
+	return true;
+}
+
+
+int main( int argc, char** argv )
+{
+	gst_init(&argc, &argv);
+
+	if( argc > 1 && strcmp(argv[1], "serve") == 0 )
+		return runServer();
+
+	int64_t server = 0;
+
+	if( !spawnProcess(argv[0], {"serve"}, &server) )
+	{
+		printf("reconnect_test -- FAILED  couldn't start the server\n");
+		return 1;
+	}
+
+	if( !waitServer() )
+	{
+		killProcess(server);
+		return 1;
+	}
+
+	// notice the lost connection and retry quickly, the defaults take several seconds
+	gstDecoder::Options options;
+
+	options.uri     = "rtsp://127.0.0.1:" RECONNECT_TEST_PORT "/test0";
+	options.preview = false;
+
+	options.reconnect         = true;
+	options.reconnectTimeout  = 2000;
+	options.reconnectDelay    = 250;
+	options.reconnectMaxDelay = 1000;
+
+	gstDecoder* decoder = gstDecoder::Create(options);
+	bool passed = decoder != NULL && decoder->Open();
+
+	if( !passed )
+		printf("reconnect_test -- FAILED  couldn't open %s\n", options.uri.c_str());
+
+	passed = passed && receive(decoder, RECONNECT_TEST_FRAMES, "before the restart");
+
+	// a crash, the clients aren't told
+	killProcess(server);
+	server = 0;
+
+	passed = passed && waitState(decoder, false, "lost the connection");
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(RECONNECT_TEST_DOWNTIME));
+
+	if( passed && (!spawnProcess(argv[0], {"serve"}, &server) || !waitServer()) )
+	{
+		printf("reconnect_test -- FAILED  couldn't restart the server\n");
+		passed = false;
+	}
+
+	passed = passed && waitState(decoder, true, "reconnected");
+	passed = passed && receive(decoder, RECONNECT_TEST_FRAMES, "after the restart");
+
+	if( passed )
+	{
+		const uint64_t reconnects = decoder->GetReconnects();
+		const float recoveryTime = decoder->GetRecoveryTime();
+
+		if( reconnects < 1 )
+		{
+			printf("reconnect_test -- FAILED  GetReconnects() is %llu\n", (unsigned long long)reconnects);
+			passed = false;
+		}
+
+		if( decoder->GetConnectionState() != gstDecoder::CONNECTED )
+		{
+			printf("reconnect_test -- FAILED  the connection isn't CONNECTED anymore\n");
+			passed = false;
+		}
+
+		if( recoveryTime <= 0.0f )
+		{
+			printf("reconnect_test -- FAILED  GetRecoveryTime() is %.1f ms\n", recoveryTime);
+			passed = false;
+		}
+
+		printf("reconnect_test -- %llu reconnects, recovered in %.1f ms\n", (unsigned long long)reconnects, recoveryTime);
+	}
+
+	delete decoder;
+
+	if( server != 0 )
+		killProcess(server);
+
+	printf("reconnect_test -- %s\n", passed ? "PASSED" : "FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+/*
+ * Checks gstShmPublisher and gstShmSubscriber across processes.
+ *
+ * The test publishes NV12 frames filled with a pattern derived from their
+ * index (also their PTS, in milliseconds) and spawns itself as the reader,
+ * which checks that the sequence numbers and the PTS only go forward, that
+ * every pixel of every frame it reads matches the pattern, and that it saw
+ * the last frame before the ring was closed.
+ *
+ * Before that, it checks that a segment left behind by a publisher that
+ * died is taken over, and that the segment of a running publisher isn't.
+ *
+ *   shmRing_test [frames]
+ *
+ * Returns 0 if every check passes, in both processes.
+ */
+#include "gstShmRing.h"
+#include "testProcess.h"
+
+#include <gst/gst.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SHM_TEST_WIDTH   642		// not a multiple of 4, so the rows are padded
+#define SHM_TEST_HEIGHT  362
+#define SHM_TEST_FRAMES  300
+#define SHM_TEST_TIMEOUT 10000		// ms to wait for the other process
+
+
+// pattern (value of a byte of a plane of frame `index`)
+static inline uint8_t pattern( uint32_t index, uint32_t plane, uint32_t x, uint32_t row )
+{
+	return (uint8_t)(index * 7 + plane * 50 + x + row * 3);
+}
+
+// rowSize (bytes of pixels in a row of an NV12 plane)
+static inline uint32_t rowSize( uint32_t plane, uint32_t width )
+{
+	return (plane == 0) ? width : (width + 1) / 2 * 2;
+}
+
+// numRows (rows of an NV12 plane)
+static inline uint32_t numRows( uint32_t plane, uint32_t height )
+{
+	return (plane == 0) ? height : (height + 1) / 2;
+}
+
+
+// makeFrame
+static gstFrame::Ptr makeFrame( const gstFormat::Ptr& format, uint32_t index )
+{
+	GstBuffer* buffer = gst_buffer_new_allocate(NULL, format->GetSize(), NULL);
+	GstMapInfo map;
+
+	if( !buffer || !gst_buffer_map(buffer, &map, GST_MAP_WRITE) )
+		return gstFrame::Ptr();
+
+	memset(map.data, 0, map.size);
+
+	for( uint32_t plane=0; plane < format->GetNumPlanes(); plane++ )
+	{
+		for( uint32_t row=0; row < numRows(plane, format->GetHeight()); row++ )
+		{
+			uint8_t* data = map.data + format->GetOffset(plane) + (size_t)format->GetStride(plane) * row;
+
+			for( uint32_t x=0; x < rowSize(plane, format->GetWidth()); x++ )
+				data[x] = pattern(index, plane, x, row);
+		}
+	}
+
+	gst_buffer_unmap(buffer, &map);
+
+	GST_BUFFER_PTS(buffer) = index * GST_MSECOND;
+
+	GstSample* sample = gst_sample_new(buffer, format->GetCaps(), NULL, NULL);
+	gstFrame::Ptr frame = gstFrame::Create(sample, format);
+
+	gst_sample_unref(sample);
+	gst_buffer_unref(buffer);
+
+	return frame;
+}
+
+
+// checkFrame
+static bool checkFrame( const gstShmSubscriber::Frame& frame, uint32_t index )
+{
+	if( strcmp(frame.format, "NV12") != 0 || frame.numPlanes != 2 || frame.width != SHM_TEST_WIDTH || frame.height != SHM_TEST_HEIGHT )
+	{
+		printf("shmRing_test -- FAILED  frame %u is %s %ux%u with %u planes\n", index, frame.format, frame.width, frame.height, frame.numPlanes);
+		return false;
+	}
+
+	for( uint32_t plane=0; plane < frame.numPlanes; plane++ )
+	{
+		for( uint32_t row=0; row < numRows(plane, frame.height); row++ )
+		{
+			const uint8_t* data = frame.planes[plane] + (size_t)frame.stride[plane] * row;
+
+			for( uint32_t x=0; x < rowSize(plane, frame.width); x++ )
+			{
+				if( data[x] != pattern(index, plane, x, row) )
+				{
+					printf("shmRing_test -- FAILED  frame %u plane %u differs at %u,%u (%u instead of %u)\n",
+						  index, plane, x, row, data[x], pattern(index, plane, x, row));
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// runCrashed (publish a frame and exit without closing the ring)
+static int runCrashed( const gstFormat::Ptr& format, const char* name )
+{
+	gstShmPublisher* publisher = gstShmPublisher::Create(name);
+
+	if( !publisher || !publisher->Publish(makeFrame(format, 0)) )
+		return 1;
+
+	fflush(stdout);
+	_Exit(0);
+}
+
+
+// runReader
+static int runReader( const char* name, uint32_t frames )
+{
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	gstShmSubscriber* subscriber = NULL;
+
+	while( !(subscriber = gstShmSubscriber::Create(name)) )
+	{
+		if( std::chrono::steady_clock::now() - begin > std::chrono::milliseconds(SHM_TEST_TIMEOUT) )
+		{
+			printf("shmRing_test -- FAILED  reader couldn't attach to %s\n", name);
+			return 1;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	bool passed = true;
+	uint64_t lastSequence = 0;
+	int64_t  lastIndex = -1;
+
+	while( passed )
+	{
+		gstShmSubscriber::FramePtr frame = subscriber->Acquire();
+
+		if( !frame )
+		{
+			if( subscriber->IsClosed() )
+				break;
+
+			if( std::chrono::steady_clock::now() - begin > std::chrono::milliseconds(SHM_TEST_TIMEOUT * 3) )
+			{
+				printf("shmRing_test -- FAILED  reader timed out after frame %lld\n", (long long)lastIndex);
+				passed = false;
+			}
+
+			continue;
+		}
+
+		const int64_t index = (int64_t)(frame->timestamp / GST_MSECOND);
+
+		if( frame->sequence <= lastSequence || index <= lastIndex )
+		{
+			printf("shmRing_test -- FAILED  frame %lld (sequence %llu) after frame %lld (sequence %llu)\n", (long long)index,
+				  (unsigned long long)frame->sequence, (long long)lastIndex, (unsigned long long)lastSequence);
+			passed = false;
+		}
+
+		passed &= checkFrame(*frame, (uint32_t)index);
+
+		lastSequence = frame->sequence;
+		lastIndex    = index;
+	}
+
+	if( passed && lastIndex != (int64_t)frames )
+	{
+		printf("shmRing_test -- FAILED  reader's last frame was %lld instead of %u\n", (long long)lastIndex, frames);
+		passed = false;
+	}
+
+	printf("shmRing_test -- reader received %llu frames, skipped %llu\n",
+		  (unsigned long long)subscriber->GetReceived(), (unsigned long long)subscriber->GetSkipped());
+
+	delete subscriber;
+	return passed ? 0 : 1;
+}
+
+
+// runPublisher
+static int runPublisher( const char* self, const gstFormat::Ptr& format, uint32_t frames )
+{
+	// unique to this run, the test may run several times at once
+#ifdef _WIN32
+	const std::string name = "shmRing_test-" + std::to_string((long long)GetCurrentProcessId());
+#else
+	const std::string name = "shmRing_test-" + std::to_string((long long)getpid());
+#endif
+
+	int64_t process = 0;
+
+	// a ring left behind by a publisher that died is taken over
+	if( !spawnProcess(self, {"crash", name}, &process) || waitProcess(process) != 0 )
+	{
+		printf("shmRing_test -- FAILED  couldn't run the crashing publisher\n");
+		return 1;
+	}
+
+	gstShmPublisher* publisher = gstShmPublisher::Create(name.c_str());
+
+	if( !publisher->Publish(makeFrame(format, 0)) )
+	{
+		printf("shmRing_test -- FAILED  couldn't take over the ring of a dead publisher\n");
+		delete publisher;
+		return 1;
+	}
+
+	bool passed = true;
+
+	// but not the ring of one that's running
+	gstShmPublisher* second = gstShmPublisher::Create(name.c_str());
+
+	if( second->Publish(makeFrame(format, 0)) )
+	{
+		printf("shmRing_test -- FAILED  a second publisher took over a running publisher's ring\n");
+		passed = false;
+	}
+
+	delete second;
+
+	if( !spawnProcess(self, {"reader", name, std::to_string(frames)}, &process) )
+	{
+		printf("shmRing_test -- FAILED  couldn't start the reader\n");
+		delete publisher;
+		return 1;
+	}
+
+	const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	while( publisher->GetNumReaders() == 0 && std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(SHM_TEST_TIMEOUT) )
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	for( uint32_t n=1; n <= frames; n++ )
+	{
+		// a frame the reader holds is never overwritten, so the last one can't be dropped
+		while( !publisher->Publish(makeFrame(format, n)) && n == frames )
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	// let the reader get the last frame before closing the ring
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	printf("shmRing_test -- published %llu frames, dropped %llu\n",
+		  (unsigned long long)publisher->GetPublished(), (unsigned long long)publisher->GetDropped());
+
+	delete publisher;
+
+	if( waitProcess(process) != 0 )
+		passed = false;
+
+	return passed ? 0 : 1;
+}
+
+
+int main( int argc, char** argv )
+{
+	gst_init(&argc, &argv);
+
+	GstCaps* caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "NV12",
+								 "width", G_TYPE_INT, SHM_TEST_WIDTH, "height", G_TYPE_INT, SHM_TEST_HEIGHT,
+								 "framerate", GST_TYPE_FRACTION, 30, 1, NULL);
+
+	const gstFormat::Ptr format = gstFormat::Create(caps);
+	gst_caps_unref(caps);
+
+	if( !format )
+	{
+		printf("shmRing_test -- FAILED  couldn't create the NV12 format\n");
+		return 1;
+	}
+
+	if( argc > 3 && strcmp(argv[1], "reader") == 0 )
+		return runReader(argv[2], (uint32_t)atoi(argv[3]));
+
+	if( argc > 2 && strcmp(argv[1], "crash") == 0 )
+		return runCrashed(format, argv[2]);
+
+	const int frames = (argc > 1) ? atoi(argv[1]) : SHM_TEST_FRAMES;
+
+	if( frames <= 0 )
+	{
+		printf("usage: shmRing_test [frames]\n");
+		return 2;
+	}
+
+	const int result = runPublisher(argv[0], format, (uint32_t)frames);
+
+	printf("shmRing_test -- %s\n", result == 0 ? "PASSED" : "FAILED");
+	return result;
+}
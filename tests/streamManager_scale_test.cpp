@@ -0,0 +1,114 @@
+/*
+ * Scale test of StreamManager against local RTSP stand-ins.
+ *
+ * Serves `streams` H.264 encoded videotestsrc patterns with testServer (the
+ * same mounts as rtsp_test_server, on their own port), opens all of them
+ * in one StreamManager and lets them run for `seconds`.  The test passes if
+ * every stream delivered its first frame and kept streaming, without any
+ * error, dropped frame, lost connection or reconnection.
+ *
+ *   streamManager_scale_test [streams] [seconds] [width] [height]
+ *
+ * Returns 0 if every stream passed.
+ */
+#include "StreamManager.h"
+#include "testServer.h"
+
+#include <gst/gst.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define SCALE_TEST_PORT "8654"
+
+
+int main( int argc, char** argv )
+{
+	const int streams = (argc > 1) ? atoi(argv[1]) : 16;
+	const int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+	const int width   = (argc > 3) ? atoi(argv[3]) : 640;
+	const int height  = (argc > 4) ? atoi(argv[4]) : 360;
+
+	if( streams <= 0 || seconds <= 0 || width <= 0 || height <= 0 )
+	{
+		printf("usage: streamManager_scale_test [streams] [seconds] [width] [height]\n");
+		return 2;
+	}
+
+	gst_init(&argc, &argv);
+
+	testServer server(SCALE_TEST_PORT);
+
+	if( !server.Start(streams, width, height) )
+		return 1;
+
+	StreamManager* manager = StreamManager::Create();
+	std::vector<int> ids;
+
+	for( int n=0; n < streams; n++ )
+	{
+		const std::string uri = std::string("rtsp://127.0.0.1:" SCALE_TEST_PORT "/test") + std::to_string(n);
+		ids.push_back(manager->AddStream(uri.c_str()));
+	}
+
+	bool passed = manager->Start();
+
+	if( !passed )
+		printf("streamManager_scale_test -- FAILED  no stream could be opened\n");
+
+	for( int n=0; passed && n < seconds; n++ )
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		manager->PrintStats();
+	}
+
+	// check every stream before closing them, the state is the one they ran with
+	for( int n=0; n < streams; n++ )
+	{
+		StreamManager::StreamStats stats;
+
+		if( ids[n] < 0 || !manager->GetStats(ids[n], stats) )
+		{
+			printf("streamManager_scale_test -- FAILED  stream %d couldn't be created\n", n);
+			passed = false;
+			continue;
+		}
+
+		std::string failures;
+
+		if( stats.timeToFirstFrame < 0.0f || stats.frames == 0 )
+			failures += " no-first-frame";
+
+		if( stats.error != 0 || stats.eos != 0 || stats.streaming == 0 )
+			failures += " not-streaming";
+
+		if( stats.dropped != 0 )
+			failures += " dropped=" + std::to_string(stats.dropped);
+
+		if( stats.disconnected != 0 || stats.reconnects != 0 )
+			failures += " reconnected=" + std::to_string(stats.reconnects);
+
+		if( !failures.empty() )
+		{
+			printf("streamManager_scale_test -- FAILED  %s:%s\n", stats.uri.c_str(), failures.c_str());
+			passed = false;
+		}
+	}
+
+	const StreamManager::StreamStats total = manager->GetTotalStats();
+
+	printf("streamManager_scale_test -- %u/%d streams, %llu frames, %llu dropped, slowest first frame %.1f ms\n",
+		  total.streaming, streams, (unsigned long long)total.frames, (unsigned long long)total.dropped, total.timeToFirstFrame);
+
+	manager->Stop();
+	delete manager;
+
+	printf("streamManager_scale_test -- %s\n", passed ? "PASSED" : "FAILED");
+	return passed ? 0 : 1;
+}
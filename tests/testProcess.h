@@ -0,0 +1,104 @@
+/*
+ * Runs a test program again in a second process, with other arguments,
+ * for the tests that check something across processes.
+ */
+#ifndef __TEST_PROCESS_H__
+#define __TEST_PROCESS_H__
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+
+// spawnProcess (run this program again with other arguments)
+static inline bool spawnProcess( const char* self, const std::vector<std::string>& arguments, int64_t* handle )
+{
+#ifdef _WIN32
+	char path[MAX_PATH];
+
+	if( GetModuleFileNameA(NULL, path, MAX_PATH) == 0 )
+		return false;
+
+	std::string cmdline = std::string("\"") + path + "\"";
+
+	for( size_t n=0; n < arguments.size(); n++ )
+		cmdline += " " + arguments[n];
+
+	STARTUPINFOA startup;
+	PROCESS_INFORMATION info;
+
+	memset(&startup, 0, sizeof(startup));
+	startup.cb = sizeof(startup);
+
+	if( !CreateProcessA(path, &cmdline[0], NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info) )
+		return false;
+
+	CloseHandle(info.hThread);
+	*handle = (int64_t)info.hProcess;
+	return true;
+#else
+	std::vector<char*> args;
+
+	args.push_back((char*)self);
+
+	for( size_t n=0; n < arguments.size(); n++ )
+		args.push_back((char*)arguments[n].c_str());
+
+	args.push_back(NULL);
+
+	pid_t pid = 0;
+
+	if( posix_spawn(&pid, self, NULL, NULL, args.data(), environ) != 0 )
+		return false;
+
+	*handle = pid;
+	return true;
+#endif
+}
+
+// waitProcess (exit code of a spawned process)
+static inline int waitProcess( int64_t handle )
+{
+#ifdef _WIN32
+	DWORD code = 1;
+
+	WaitForSingleObject((HANDLE)handle, INFINITE);
+	GetExitCodeProcess((HANDLE)handle, &code);
+	CloseHandle((HANDLE)handle);
+
+	return (int)code;
+#else
+	int status = 0;
+
+	if( waitpid((pid_t)handle, &status, 0) < 0 || !WIFEXITED(status) )
+		return 1;
+
+	return WEXITSTATUS(status);
+#endif
+}
+
+// killProcess (end a spawned process abruptly, as a crash would, and reap it)
+static inline void killProcess( int64_t handle )
+{
+#ifdef _WIN32
+	TerminateProcess((HANDLE)handle, 1);
+#else
+	kill((pid_t)handle, SIGKILL);
+#endif
+	waitProcess(handle);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Local RTSP stand-ins for the tests, served with gst-rtsp-server.
+ *
+ * Serves `streams` H.264 encoded videotestsrc patterns at /test0, /test1...
+ * (the same mounts as rtsp_test_server) on the given port, from a main loop
+ * thread of its own.
+ */
+#ifndef __TEST_SERVER_H__
+#define __TEST_SERVER_H__
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+
+
+// serves the test streams from its own main loop thread
+class testServer
+{
+public:
+	testServer( const char* port ) : mPort(port), mContext(NULL), mLoop(NULL), mServer(NULL)	{}
+
+	~testServer()
+	{
+		if( mLoop != NULL )
+		{
+			g_main_loop_quit(mLoop);
+
+			if( mThread.joinable() )
+				mThread.join();
+
+			g_main_loop_unref(mLoop);
+		}
+
+		if( mServer != NULL )
+			g_object_unref(mServer);
+
+		if( mContext != NULL )
+			g_main_context_unref(mContext);
+	}
+
+	bool Start( int streams, int width, int height )
+	{
+		mContext = g_main_context_new();
+		mLoop    = g_main_loop_new(mContext, FALSE);
+		mServer  = gst_rtsp_server_new();
+
+		gst_rtsp_server_set_service(mServer, mPort.c_str());
+
+		GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(mServer);
+
+		for( int n=0; n < streams; n++ )
+		{
+			GstRTSPMediaFactory* factory = gst_rtsp_media_factory_new();
+
+			gchar* launch = g_strdup_printf("( videotestsrc is-live=true pattern=%d ! video/x-raw,width=%d,height=%d,framerate=30/1 ! "
+									  "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=30 ! rtph264pay name=pay0 pt=96 )",
+									  n % 20, width, height);
+			gchar* path = g_strdup_printf("/test%d", n);
+
+			gst_rtsp_media_factory_set_launch(factory, launch);
+			gst_rtsp_media_factory_set_shared(factory, TRUE);
+			gst_rtsp_mount_points_add_factory(mounts, path, factory);
+
+			g_free(launch);
+			g_free(path);
+		}
+
+		g_object_unref(mounts);
+
+		if( gst_rtsp_server_attach(mServer, mContext) == 0 )
+		{
+			printf("testServer -- failed to start the RTSP server on port %s\n", mPort.c_str());
+			return false;
+		}
+
+		mThread = std::thread([this]()
+		{
+			g_main_context_push_thread_default(mContext);
+			g_main_loop_run(mLoop);
+			g_main_context_pop_thread_default(mContext);
+		});
+
+		return true;
+	}
+
+private:
+	std::string    mPort;
+	GMainContext*  mContext;
+	GMainLoop*     mLoop;
+	GstRTSPServer* mServer;
+	std::thread    mThread;
+};
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Checks the yuvConvert kernels against a double-precision BT.601/BT.709
+ * reference that doesn't share any code with them (coefficients, rounding
+ * or chroma siting), so a bug in the fixed-point tables is caught too.
+ *
+ *   - the reference itself must turn black and white into 0 and 255
+ *   - the scalar path must be within YUV_TEST_TOLERANCE of the reference
+ *   - every SIMD path must be bit-exact to the scalar path
+ *   - I420 must convert exactly like the same samples interleaved as NV12,
+ *     with U and V planes of different strides, resized or not
+ *
+ * Returns 0 if every check passes.
+ */
+#include "yuvConvert.h"
+
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// largest difference allowed between the scalar path and the reference
+#define YUV_TEST_TOLERANCE 1
+
+
+// referenceBGR (one pixel, straight from the definition of the matrices)
+static void referenceBGR( int Y, int U, int V, const yuvColorSpace& colorSpace, uint8_t bgr[3] )
+{
+	const double kr = (colorSpace.matrix == YUV_MATRIX_BT709) ? 0.2126 : 0.299;
+	const double kb = (colorSpace.matrix == YUV_MATRIX_BT709) ? 0.0722 : 0.114;
+	const double kg = 1.0 - kr - kb;
+
+	// normalize to E'y in [0,1] and E'cb/E'cr in [-0.5,0.5]
+	double ey, cb, cr;
+
+	if( colorSpace.range == YUV_RANGE_LIMITED )
+	{
+		ey = (Y - 16.0) / 219.0;
+		cb = (U - 128.0) / 224.0;
+		cr = (V - 128.0) / 224.0;
+	}
+	else
+	{
+		ey = Y / 255.0;
+		cb = (U - 128.0) / 255.0;
+		cr = (V - 128.0) / 255.0;
+	}
+
+	const double r = ey + 2.0 * (1.0 - kr) * cr;
+	const double b = ey + 2.0 * (1.0 - kb) * cb;
+	const double g = (ey - kr * r - kb * b) / kg;
+
+	const double rgb[3] = { b, g, r };
+
+	for( int c=0; c < 3; c++ )
+	{
+		const double value = floor(rgb[c] * 255.0 + 0.5);
+		bgr[c] = (uint8_t)(value < 0.0 ? 0.0 : (value > 255.0 ? 255.0 : value));
+	}
+}
+
+// colorSpaceToStr
+static const char* colorSpaceToStr( const yuvColorSpace& colorSpace )
+{
+	if( colorSpace.matrix == YUV_MATRIX_BT709 )
+		return colorSpace.range == YUV_RANGE_FULL ? "bt709 full" : "bt709 limited";
+	else
+		return colorSpace.range == YUV_RANGE_FULL ? "bt601 full" : "bt601 limited";
+}
+
+// checkAnchors (the reference must map the extremes of each range exactly)
+static bool checkAnchors( const yuvColorSpace& colorSpace )
+{
+	const int black = (colorSpace.range == YUV_RANGE_LIMITED) ? 16 : 0;
+	const int white = (colorSpace.range == YUV_RANGE_LIMITED) ? 235 : 255;
+
+	uint8_t bgr[2][3];
+
+	referenceBGR(black, 128, 128, colorSpace, bgr[0]);
+	referenceBGR(white, 128, 128, colorSpace, bgr[1]);
+
+	for( int c=0; c < 3; c++ )
+	{
+		if( bgr[0][c] != 0 || bgr[1][c] != 255 )
+		{
+			printf("yuvConvert_test -- FAILED  reference doesn't map black/white to 0/255 (%s)\n", colorSpaceToStr(colorSpace));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// checkReference (scalar path against the reference, within the tolerance)
+static bool checkReference( const std::vector<uint8_t>& nv12, uint32_t width, uint32_t height, uint32_t stride,
+					   const std::vector<uint8_t>& bgr, const yuvColorSpace& colorSpace )
+{
+	const uint8_t* uv = nv12.data() + (size_t)stride * height;
+
+	int maxDiff = 0;
+
+	for( uint32_t row=0; row < height; row++ )
+	{
+		for( uint32_t x=0; x < width; x++ )
+		{
+			const uint8_t* chroma = uv + (size_t)(row / 2) * stride + (x / 2) * 2;
+
+			uint8_t expected[3];
+			referenceBGR(nv12[(size_t)row * stride + x], chroma[0], chroma[1], colorSpace, expected);
+
+			for( int c=0; c < 3; c++ )
+			{
+				const int diff = abs((int)bgr[((size_t)row * width + x) * 3 + c] - (int)expected[c]);
+
+				if( diff > maxDiff )
+					maxDiff = diff;
+			}
+		}
+	}
+
+	if( maxDiff > YUV_TEST_TOLERANCE )
+	{
+		printf("yuvConvert_test -- FAILED  scalar differs from the reference by %d at %ux%u (%s)\n",
+			  maxDiff, width, height, colorSpaceToStr(colorSpace));
+		return false;
+	}
+
+	return true;
+}
+
+int main( int argc, char** argv )
+{
+	const yuvConvertPath paths[] = { YUV_CONVERT_SSE41, YUV_CONVERT_AVX2, YUV_CONVERT_NEON };
+	const uint32_t sizes[][2] = { {64, 32}, {1283, 721}, {1920, 1080}, {7, 3} };
+
+	const yuvColorSpace colorSpaces[] = {
+		yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_LIMITED),
+		yuvColorSpace(YUV_MATRIX_BT601, YUV_RANGE_FULL),
+		yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_LIMITED),
+		yuvColorSpace(YUV_MATRIX_BT709, YUV_RANGE_FULL)
+	};
+
+	bool passed = true;
+
+	for( const yuvColorSpace& colorSpace : colorSpaces )
+		passed &= checkAnchors(colorSpace);
+
+	srand(1);
+
+	for( const auto& size : sizes )
+	{
+		const uint32_t width  = size[0];
+		const uint32_t height = size[1];
+		const uint32_t stride = (width + 1) / 2 * 2;
+		const uint32_t chromaWidth  = (width + 1) / 2;
+		const uint32_t chromaHeight = (height + 1) / 2;
+
+		// random NV12 image, the chroma plane directly follows the luma plane
+		std::vector<uint8_t> nv12((size_t)stride * (height + chromaHeight));
+
+		for( size_t n=0; n < nv12.size(); n++ )
+			nv12[n] = (uint8_t)(rand() & 0xFF);
+
+		const uint8_t* y  = nv12.data();
+		const uint8_t* uv = nv12.data() + (size_t)stride * height;
+
+		// the same chroma as separate planes, the V rows padded differently than the U rows
+		const uint32_t uStride = chromaWidth;
+		const uint32_t vStride = chromaWidth + 13;
+
+		std::vector<uint8_t> u((size_t)uStride * chromaHeight);
+		std::vector<uint8_t> v((size_t)vStride * chromaHeight, 0xFF);
+
+		for( uint32_t row=0; row < chromaHeight; row++ )
+		{
+			for( uint32_t x=0; x < chromaWidth; x++ )
+			{
+				u[(size_t)row * uStride + x] = uv[(size_t)row * stride + x * 2 + 0];
+				v[(size_t)row * vStride + x] = uv[(size_t)row * stride + x * 2 + 1];
+			}
+		}
+
+		std::vector<uint8_t> scalar((size_t)width * height * 3);
+		std::vector<uint8_t> output((size_t)width * height * 3);
+
+		for( const yuvColorSpace& colorSpace : colorSpaces )
+		{
+			yuvConvertSetPath(YUV_CONVERT_SCALAR);
+			yuvConvertNV12ToBGR(y, stride, uv, stride, scalar.data(), width * 3, width, height, colorSpace);
+
+			passed &= checkReference(nv12, width, height, stride, scalar, colorSpace);
+
+			// I420 goes through the same kernels once interleaved
+			memset(output.data(), 0, output.size());
+			yuvConvertI420ToBGR(y, stride, u.data(), uStride, v.data(), vStride, output.data(), width * 3, width, height, colorSpace);
+
+			if( output != scalar )
+			{
+				printf("yuvConvert_test -- FAILED  I420 differs from NV12 at %ux%u (%s)\n", width, height, colorSpaceToStr(colorSpace));
+				passed = false;
+			}
+
+			// and the resampled rows too
+			const uint32_t halfWidth  = (width + 1) / 2;
+			const uint32_t halfHeight = (height + 1) / 2;
+
+			std::vector<uint8_t> resizedNV12((size_t)halfWidth * halfHeight * 3);
+			std::vector<uint8_t> resizedI420((size_t)halfWidth * halfHeight * 3);
+
+			yuvConvertResizeNV12ToBGR(y, stride, uv, stride, width, height, resizedNV12.data(), halfWidth * 3, halfWidth, halfHeight, YUV_INTERP_BILINEAR, colorSpace);
+			yuvConvertResizeI420ToBGR(y, stride, u.data(), uStride, v.data(), vStride, width, height, resizedI420.data(), halfWidth * 3, halfWidth, halfHeight, YUV_INTERP_BILINEAR, colorSpace);
+
+			if( resizedI420 != resizedNV12 )
+			{
+				printf("yuvConvert_test -- FAILED  resized I420 differs from NV12 at %ux%u (%s)\n", width, height, colorSpaceToStr(colorSpace));
+				passed = false;
+			}
+
+			for( yuvConvertPath path : paths )
+			{
+				if( !yuvConvertSetPath(path) )
+					continue;
+
+				memset(output.data(), 0, output.size());
+				yuvConvertNV12ToBGR(y, stride, uv, stride, output.data(), width * 3, width, height, colorSpace);
+
+				if( output != scalar )
+				{
+					printf("yuvConvert_test -- FAILED  %s differs from scalar at %ux%u (%s)\n",
+						  yuvConvertPathToStr(path), width, height, colorSpaceToStr(colorSpace));
+					passed = false;
+				}
+			}
+		}
+	}
+
+	for( yuvConvertPath path : paths )
+	{
+		if( !yuvConvertHasPath(path) )
+			printf("yuvConvert_test -- %s not supported here, skipped\n", yuvConvertPathToStr(path));
+	}
+
+	printf("yuvConvert_test -- %s\n", passed ? "PASSED" : "FAILED");
+	return passed ? 0 : 1;
+}